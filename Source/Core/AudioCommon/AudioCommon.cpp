@@ -157,6 +157,7 @@ namespace AudioCommon
 		if (soundStream)
 		{
 			soundStream->GetMixer()->SetThrottle(SConfig::GetInstance().m_Framelimit == 2);
+			soundStream->GetMixer()->SetLatency(SConfig::GetInstance().m_MixerLatency);
 			soundStream->SetVolume(SConfig::GetInstance().m_Volume);
 		}
 	}
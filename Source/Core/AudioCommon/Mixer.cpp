@@ -2,6 +2,8 @@
 // Licensed under GPLv2
 // Refer to the license.txt file included.
 
+#include <algorithm>
+
 #include "Atomic.h"
 #include "Mixer.h"
 #include "AudioCommon.h"
@@ -13,171 +15,208 @@
 // UGLINESS
 #include "../Core/PowerPC/PowerPC.h"
 
-#if _M_SSE >= 0x301 && !(defined __GNUC__ && !defined __SSSE3__)
-#include <tmmintrin.h>
+#if (defined(_M_X64) || defined(_M_IX86)) && !defined(_M_GENERIC)
+#include <emmintrin.h>
 #endif
 
-// Executed from sound stream thread
-unsigned int CMixer::Mix(short* samples, unsigned int numSamples)
+static inline s16 ClampSample(int sample)
 {
-	if (!samples)
-		return 0;
-
-	std::lock_guard<std::mutex> lk(m_csMixing);
+	if (sample > 32767)
+		return 32767;
+	if (sample < -32768)
+		return -32768;
+	return sample;
+}
 
-	if (PowerPC::GetState() != PowerPC::CPU_RUNNING)
-	{
-		// Silence
-		memset(samples, 0, numSamples * 4);
-		return numSamples;
-	}
+unsigned int CMixer::MixerFifo::GetQueuedSamples() const
+{
+	return ((Common::AtomicLoad(m_indexW) - Common::AtomicLoad(m_indexR)) & INDEX_MASK) / 2;
+}
 
-	unsigned int numLeft = GetNumSamples();
-	if (m_AIplaying) {
-		if (numLeft < numSamples)//cannot do much about this
-			m_AIplaying = false;
-		if (numLeft < MAX_SAMPLES/4)//low watermark
-			m_AIplaying = false;
-	} else {
-		if (numLeft > MAX_SAMPLES/2)//high watermark
-			m_AIplaying = true;
-	}
+unsigned int CMixer::MixerFifo::GetTargetSamples() const
+{
+	u64 target = (u64)m_mixer->m_latency * m_input_sample_rate / 1000;
+	return (unsigned int)std::min<u64>(target, MAX_SAMPLES / 2);
+}
 
+// Executed from sound stream thread
+unsigned int CMixer::MixerFifo::Mix(short* samples, unsigned int numSamples)
+{
 	// Cache access in non-volatile variable
 	// This is the only function changing the read value, so it's safe to
 	// cache it locally although it's written here.
 	// The writing pointer will be modified outside, but it will only increase,
 	// so we will just ignore new written data while interpolating.
-	// Without this cache, the compiler wouldn't be allowed to optimize the
-	// interpolation loop.
 	u32 indexR = Common::AtomicLoad(m_indexR);
-	u32 indexW = Common::AtomicLoad(m_indexW);
-
-	if (m_AIplaying) {
-		numLeft = (numLeft > numSamples) ? numSamples : numLeft;
-
-		if (AudioInterface::GetAIDSampleRate() == m_sampleRate) // (1:1)
+	u32 indexW = Common::AtomicLoadAcquire(m_indexW);
+	u32 numLeft = ((indexW - indexR) & INDEX_MASK) / 2;
+	const unsigned int target = GetTargetSamples();
+
+	// After running dry, wait for the target latency to be buffered again
+	// instead of playing every sample as soon as it arrives. Bursts shorter
+	// than that, like Wiimote speaker clips, start once the producer stopped
+	// writing or the first samples waited for the target latency.
+	if (!m_playing)
+	{
+		if (numLeft < 2)
 		{
-#if _M_SSE >= 0x301
-			if (cpu_info.bSSSE3 && !((numLeft * 2) % 8))
-			{
-				static const __m128i sr_mask =
-					_mm_set_epi32(0x0C0D0E0FL, 0x08090A0BL,
-								  0x04050607L, 0x00010203L);
-
-				for (unsigned int i = 0; i < numLeft * 2; i += 8)
-				{
-					_mm_storeu_si128((__m128i *)&samples[i], _mm_shuffle_epi8(_mm_loadu_si128((__m128i *)&m_buffer[(indexR + i) & INDEX_MASK]), sr_mask));
-				}
-			}
-			else
-#endif
-			{
-				for (unsigned int i = 0; i < numLeft * 2; i+=2)
-				{
-					samples[i] = Common::swap16(m_buffer[(indexR + i + 1) & INDEX_MASK]);
-					samples[i+1] = Common::swap16(m_buffer[(indexR + i) & INDEX_MASK]);
-				}
-			}
-			indexR += numLeft * 2;
+			m_waited = 0;
+			m_lastNumLeft = numLeft;
+			return 0;
 		}
-		else //linear interpolation
+
+		const u64 timeout = (u64)m_mixer->m_latency * m_mixer->m_sampleRate / 1000;
+		const bool idle = m_waited && numLeft == m_lastNumLeft;
+		if (numLeft < target && !idle && m_waited < timeout)
 		{
-			//render numleft sample pairs to samples[]
-			//advance indexR with sample position
-			//remember fractional offset
-
-			static u32 frac = 0;
-			const u32 ratio = (u32)( 65536.0f * (float)AudioInterface::GetAIDSampleRate() / (float)m_sampleRate );
-
-			for (u32 i = 0; i < numLeft * 2; i+=2) {
-				u32 indexR2 = indexR + 2; //next sample
-				if ((indexR2 & INDEX_MASK) == (indexW & INDEX_MASK)) //..if it exists
-					indexR2 = indexR;
-
-				s16 l1 = Common::swap16(m_buffer[indexR & INDEX_MASK]); //current
-				s16 l2 = Common::swap16(m_buffer[indexR2 & INDEX_MASK]); //next
-				int sampleL = ((l1 << 16) + (l2 - l1) * (u16)frac)  >> 16;
-				samples[i+1] = sampleL;
-
-				s16 r1 = Common::swap16(m_buffer[(indexR + 1) & INDEX_MASK]); //current
-				s16 r2 = Common::swap16(m_buffer[(indexR2 + 1) & INDEX_MASK]); //next
-				int sampleR = ((r1 << 16) + (r2 - r1) * (u16)frac)  >> 16;
-				samples[i] = sampleR;
-
-				frac += ratio;
-				indexR += 2 * (u16)(frac >> 16);
-				frac &= 0xffff;
-			}
+			m_waited += numSamples;
+			m_lastNumLeft = numLeft;
+			return 0;
 		}
 
-	} else {
-		numLeft = 0;
+		m_playing = true;
+		m_waited = 0;
+		m_numLeftI = (float)numLeft;
 	}
 
-	// Padding
-	if (numSamples > numLeft)
+	// The backends pull in bursts, so the rate follows the average fill level
+	m_numLeftI = ((float)numLeft + m_numLeftI * (CONTROL_AVG - 1)) / CONTROL_AVG;
+	float offset = ((float)m_numLeftI - (float)target) * CONTROL_FACTOR;
+	if (offset > MAX_FREQ_SHIFT) offset = MAX_FREQ_SHIFT;
+	if (offset < -MAX_FREQ_SHIFT) offset = -MAX_FREQ_SHIFT;
+
+	const float rate = (float)m_input_sample_rate + offset;
+	const u32 ratio = (u32)(65536.0f * rate / (float)m_mixer->m_sampleRate);
+
+	// Every output sample interpolates towards the next input sample, so it
+	// must have been written already
+	u32 count = 0;
+	if (numLeft >= 2 && ratio)
 	{
-		unsigned short s[2];
-		s[0] = Common::swap16(m_buffer[(indexR - 1) & INDEX_MASK]);
-		s[1] = Common::swap16(m_buffer[(indexR - 2) & INDEX_MASK]);
-		for (unsigned int i = numLeft*2; i < numSamples*2; i+=2)
-			*(u32*)(samples+i) = *(u32*)(s);
-//		memset(&samples[numLeft * 2], 0, (numSamples - numLeft) * 4);
+		u64 limit = (u64)(numLeft - 1) << 16;
+		if (limit > m_frac)
+			count = (u32)std::min<u64>((limit - m_frac - 1) / ratio + 1, numSamples);
 	}
 
-	// Flush cached variable
-	Common::AtomicStore(m_indexR, indexR);
+	u32 frac = m_frac;
+	u32 i = 0;
+
+#if (defined(_M_X64) || defined(_M_IX86)) && !defined(_M_GENERIC)
+	// Two output samples per iteration: the current and next input sample of
+	// both are byteswapped, interleaved per channel and weighted with 14 bit
+	// fractions by one pmaddwd
+	for (; i + 2 <= count; i += 2)
+	{
+		u32 c0 = *(const u32*)&m_buffer[indexR & INDEX_MASK];
+		u32 n0 = *(const u32*)&m_buffer[(indexR + 2) & INDEX_MASK];
+		const s16 w0 = (s16)((frac & 0xffff) >> 2);
+		frac += ratio;
+		indexR += 2 * (frac >> 16);
+		frac &= 0xffff;
+
+		u32 c1 = *(const u32*)&m_buffer[indexR & INDEX_MASK];
+		u32 n1 = *(const u32*)&m_buffer[(indexR + 2) & INDEX_MASK];
+		const s16 w1 = (s16)(frac >> 2);
+		frac += ratio;
+		indexR += 2 * (frac >> 16);
+		frac &= 0xffff;
+
+		__m128i v = _mm_set_epi32(n1, c1, n0, c0);
+		v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+		v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(3, 1, 2, 0));
+		v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(3, 1, 2, 0));
+		const __m128i weights = _mm_set_epi16(w1, 0x4000 - w1, w1, 0x4000 - w1,
+			w0, 0x4000 - w0, w0, 0x4000 - w0);
+		__m128i mixed = _mm_srai_epi32(_mm_madd_epi16(v, weights), 14);
+		mixed = _mm_packs_epi32(mixed, mixed);
+		// The DMA order is right, left
+		mixed = _mm_shufflelo_epi16(mixed, _MM_SHUFFLE(2, 3, 0, 1));
+
+		__m128i out = _mm_loadl_epi64((const __m128i*)&samples[i * 2]);
+		_mm_storel_epi64((__m128i*)&samples[i * 2], _mm_adds_epi16(out, mixed));
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		const int w = (frac & 0xffff) >> 2;
+
+		s16 l1 = Common::swap16(m_buffer[indexR & INDEX_MASK]); //current
+		s16 l2 = Common::swap16(m_buffer[(indexR + 2) & INDEX_MASK]); //next
+		int sampleL = ((l1 * (0x4000 - w) + l2 * w) >> 14) + samples[i * 2 + 1];
+		samples[i * 2 + 1] = ClampSample(sampleL);
 
-	//when logging, also throttle HLE audio
-	if (m_logAudio) {
-		if (m_AIplaying) {
-			Premix(samples, numLeft);
+		s16 r1 = Common::swap16(m_buffer[(indexR + 1) & INDEX_MASK]); //current
+		s16 r2 = Common::swap16(m_buffer[(indexR + 3) & INDEX_MASK]); //next
+		int sampleR = ((r1 * (0x4000 - w) + r2 * w) >> 14) + samples[i * 2];
+		samples[i * 2] = ClampSample(sampleR);
 
-			AudioInterface::Callback_GetStreaming(samples, numLeft, m_sampleRate);
+		frac += ratio;
+		indexR += 2 * (frac >> 16);
+		frac &= 0xffff;
+	}
 
-			g_wave_writer.AddStereoSamples(samples, numLeft);
+	// Underrun: hold the last sample, then start buffering again
+	if (count < numSamples)
+	{
+		m_playing = false;
+		u32 last = indexR != indexW ? indexR : indexR - 2;
+		s16 l = Common::swap16(m_buffer[last & INDEX_MASK]);
+		s16 r = Common::swap16(m_buffer[(last + 1) & INDEX_MASK]);
+		for (i = count; i < numSamples; i++)
+		{
+			samples[i * 2 + 1] = ClampSample(samples[i * 2 + 1] + l);
+			samples[i * 2] = ClampSample(samples[i * 2] + r);
 		}
 	}
-	else { 	//or mix as usual
-		// Add the DSPHLE sound, re-sampling is done inside
-		Premix(samples, numSamples);
 
-		// Add the DTK Music
-		// Re-sampling is done inside
-		AudioInterface::Callback_GetStreaming(samples, numSamples, m_sampleRate);
+	m_frac = frac;
+
+	// Flush cached variable
+	Common::AtomicStore(m_indexR, indexR);
+
+	return count;
+}
+
+// Executed from sound stream thread
+unsigned int CMixer::Mix(short* samples, unsigned int numSamples)
+{
+	if (!samples)
+		return 0;
+
+	std::lock_guard<std::mutex> lk(m_csMixing);
+
+	memset(samples, 0, numSamples * 4);
+
+	if (PowerPC::GetState() != PowerPC::CPU_RUNNING)
+	{
+		// Silence
+		return numSamples;
 	}
 
+	m_dma_mixer.Mix(samples, numSamples);
+	m_streaming_mixer.Mix(samples, numSamples);
+	m_wiimote_speaker_mixer.Mix(samples, numSamples);
+	m_space_available.Set();
+
+	// Add the DSPHLE sound, re-sampling is done inside
+	Premix(samples, numSamples);
+
+	if (m_logAudio)
+		g_wave_writer.AddStereoSamples(samples, numSamples);
+
 	return numSamples;
 }
 
-
-void CMixer::PushSamples(const short *samples, unsigned int num_samples)
+bool CMixer::MixerFifo::PushSamples(const short *samples, unsigned int num_samples)
 {
 	// Cache access in non-volatile variable
-	// indexR isn't allowed to cache in the audio throttling loop as it
-	// needs to get updates to not deadlock.
 	u32 indexW = Common::AtomicLoad(m_indexW);
 
-	if (m_throttle)
-	{
-		// The auto throttle function. This loop will put a ceiling on the CPU MHz.
-		while (num_samples * 2 + ((indexW - Common::AtomicLoad(m_indexR)) & INDEX_MASK) >= MAX_SAMPLES * 2)
-		{
-			if (*PowerPC::GetStatePtr() != PowerPC::CPU_RUNNING || soundStream->IsMuted())
-				break;
-			// Shortcut key for Throttle Skipping
-			if (Host_GetKeyState('\t'))
-				break;
-			SLEEP(1);
-			soundStream->Update();
-		}
-	}
-
 	// Check if we have enough free space
 	// indexW == m_indexR results in empty buffer, so indexR must always be smaller than indexW
 	if (num_samples * 2 + ((indexW - Common::AtomicLoad(m_indexR)) & INDEX_MASK) >= MAX_SAMPLES * 2)
-		return;
+		return false;
 
 	// AyuanX: Actual re-sampling work has been moved to sound thread
 	// to alleviate the workload on main thread
@@ -193,29 +232,45 @@ void CMixer::PushSamples(const short *samples, unsigned int num_samples)
 		memcpy(&m_buffer[indexW & INDEX_MASK], samples, num_samples * 4);
 	}
 
-	Common::AtomicAdd(m_indexW, num_samples * 2);
-
-	return;
+	// Publishes the samples to the sound thread
+	Common::AtomicStoreRelease(m_indexW, indexW + num_samples * 2);
+	return true;
 }
 
-unsigned int CMixer::GetNumSamples()
+void CMixer::PushSamples(const short *samples, unsigned int num_samples)
 {
-	// Guess how many samples would be available after interpolation.
-	// As interpolation needs at least on sample from the future to
-	// linear interpolate between them, one sample less is available.
-	// We also can't say the current interpolation state (specially
-	// the frac), so to be sure, subtract one again to be sure not
-	// to underflow the fifo.
-
-	u32 numSamples = ((Common::AtomicLoad(m_indexW) - Common::AtomicLoad(m_indexR)) & INDEX_MASK) / 2;
-
-	if (AudioInterface::GetAIDSampleRate() == m_sampleRate)
-		; //numSamples = numSamples; // 1:1
-	else if (m_sampleRate == 48000 && AudioInterface::GetAIDSampleRate() == 32000)
-		numSamples = numSamples * 3 / 2 - 2; // most common case
-	else
-		numSamples = numSamples * m_sampleRate / AudioInterface::GetAIDSampleRate() - 2;
+	m_dma_mixer.SetInputSampleRate(AudioInterface::GetAIDSampleRate());
 
-	return numSamples;
+	if (m_throttle)
+	{
+		// The auto throttle function. This loop will put a ceiling on the CPU MHz,
+		// emulation waits until the sound thread has played down to the target latency,
+		// the fill level the rate control steers to. A full ring would drop the samples.
+		unsigned int limit = std::max(m_dma_mixer.GetTargetSamples(), num_samples + RESERVED_SAMPLES);
+		limit = std::min(limit, MAX_SAMPLES - 1u);
+		while (m_dma_mixer.GetQueuedSamples() + num_samples > limit)
+		{
+			if (*PowerPC::GetStatePtr() != PowerPC::CPU_RUNNING || soundStream->IsMuted())
+				break;
+			// Shortcut key for Throttle Skipping
+			if (Host_GetKeyState('\t'))
+				break;
+			soundStream->Update();
+			m_space_available.WaitFor(1);
+		}
+	}
+
+	m_dma_mixer.PushSamples(samples, num_samples);
+}
+
+void CMixer::PushStreamingSamples(const short *samples, unsigned int num_samples, unsigned int sample_rate)
+{
+	m_streaming_mixer.SetInputSampleRate(sample_rate);
+	m_streaming_mixer.PushSamples(samples, num_samples);
 }
 
+void CMixer::PushWiimoteSpeakerSamples(const short *samples, unsigned int num_samples, unsigned int sample_rate)
+{
+	m_wiimote_speaker_mixer.SetInputSampleRate(sample_rate);
+	m_wiimote_speaker_mixer.PushSamples(samples, num_samples);
+}
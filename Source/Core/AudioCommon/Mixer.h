@@ -7,12 +7,20 @@
 
 #include "WaveFile.h"
 #include "StdMutex.h"
+#include "Thread.h"
 
 // 16 bit Stereo
 #define MAX_SAMPLES			(1024 * 8)
 #define INDEX_MASK			(MAX_SAMPLES * 2 - 1)
 #define RESERVED_SAMPLES	(256)
 
+// Rate control: the input rate of a source is shifted by CONTROL_FACTOR Hz per
+// sample its buffer is away from the target latency, averaged over CONTROL_AVG
+// calls to Mix and limited to MAX_FREQ_SHIFT Hz.
+#define CONTROL_FACTOR		(0.2f)
+#define CONTROL_AVG			(32)
+#define MAX_FREQ_SHIFT		(200)
+
 class CMixer {
 
 public:
@@ -21,18 +29,19 @@ public:
 		, m_dacSampleRate(DACSampleRate)
 		, m_bits(16)
 		, m_channels(2)
+		, m_dma_mixer(this, 32000)
+		, m_streaming_mixer(this, 48000)
+		, m_wiimote_speaker_mixer(this, 6000)
 		, m_HLEready(false)
 		, m_logAudio(0)
-		, m_indexW(0)
-		, m_indexR(0)
-		, m_AIplaying(true)
+		, m_throttle(false)
+		, m_latency(40)
+		, m_speed(1.0f)
 	{
 		// AyuanX: The internal (Core & DSP) sample rate is fixed at 32KHz
 		// So when AI/DAC sample rate differs than 32KHz, we have to do re-sampling
 		m_sampleRate = BackendSampleRate;
 
-		memset(m_buffer, 0, sizeof(m_buffer));
-
 		INFO_LOG(AUDIO_INTERFACE, "Mixer is initialized (AISampleRate:%i, DACSampleRate:%i)", AISampleRate, DACSampleRate);
 	}
 
@@ -41,13 +50,16 @@ public:
 	// Called from audio threads
 	virtual unsigned int Mix(short* samples, unsigned int numSamples);
 	virtual void Premix(short * /*samples*/, unsigned int /*numSamples*/) {}
-	unsigned int GetNumSamples();
 
-	// Called from main thread
+	// Called from main thread. Every source takes big endian stereo samples,
+	// in the order the AI DMA reads them, at its own sample rate.
 	virtual void PushSamples(const short* samples, unsigned int num_samples);
+	void PushStreamingSamples(const short* samples, unsigned int num_samples, unsigned int sample_rate);
+	void PushWiimoteSpeakerSamples(const short* samples, unsigned int num_samples, unsigned int sample_rate);
 	unsigned int GetSampleRate() const {return m_sampleRate;}
 
 	void SetThrottle(bool use) { m_throttle = use;}
+	void SetLatency(unsigned int ms) { m_latency = ms;}
 
 	// TODO: do we need this
 	bool IsHLEReady() const { return m_HLEready;}
@@ -82,24 +94,66 @@ public:
 	void UpdateSpeed(volatile float val) { m_speed = val; }
 
 protected:
+	// Single producer, single consumer ring of one source. Only the emulation
+	// thread moves m_indexW and only the sound thread moves m_indexR.
+	class MixerFifo {
+	public:
+		MixerFifo(CMixer *mixer, unsigned int sample_rate)
+			: m_mixer(mixer)
+			, m_input_sample_rate(sample_rate)
+			, m_indexW(0)
+			, m_indexR(0)
+			, m_playing(false)
+			, m_numLeftI(0.0f)
+			, m_frac(0)
+			, m_waited(0)
+			, m_lastNumLeft(0)
+		{
+			memset(m_buffer, 0, sizeof(m_buffer));
+		}
+		bool PushSamples(const short* samples, unsigned int num_samples);
+		// Adds the source to samples, returns the number of samples it had data for
+		unsigned int Mix(short* samples, unsigned int numSamples);
+		void SetInputSampleRate(unsigned int rate) { m_input_sample_rate = rate;}
+		// In stereo samples
+		unsigned int GetQueuedSamples() const;
+		unsigned int GetTargetSamples() const;
+	private:
+		CMixer *m_mixer;
+		volatile unsigned int m_input_sample_rate;
+		short m_buffer[MAX_SAMPLES * 2];
+		volatile u32 m_indexW;
+		volatile u32 m_indexR;
+		// Sound thread only
+		bool m_playing;
+		float m_numLeftI;
+		u32 m_frac;
+		// Output samples waited for the buffer to fill, and its fill level then
+		u64 m_waited;
+		u32 m_lastNumLeft;
+	};
+
 	unsigned int m_sampleRate;
 	unsigned int m_aiSampleRate;
 	unsigned int m_dacSampleRate;
 	int m_bits;
 	int m_channels;
 
+	MixerFifo m_dma_mixer;
+	MixerFifo m_streaming_mixer;
+	MixerFifo m_wiimote_speaker_mixer;
+
 	WaveFileWriter g_wave_writer;
 
 	bool m_HLEready;
 	bool m_logAudio;
 
 	bool m_throttle;
+	// Set by Mix, the throttle waits on it for space in the DMA ring
+	Common::Event m_space_available;
 
-	short m_buffer[MAX_SAMPLES * 2];
-	volatile u32 m_indexW;
-	volatile u32 m_indexR;
+	volatile unsigned int m_latency;
 
-	bool m_AIplaying;
 	std::mutex m_csMixing;
 
 	volatile float m_speed; // Current rate of the emulation (1.0 = 100% speed)
@@ -44,6 +44,11 @@ inline void AtomicOr(volatile u32& target, u32 value) {
 	__sync_or_and_fetch(&target, value);
 }
 
+// Sets target to value if it is expected, returns whether it did
+inline bool AtomicCompareExchange(volatile u32& target, u32 expected, u32 value) {
+	return __sync_bool_compare_and_swap(&target, expected, value);
+}
+
 #ifdef __clang__
 template <typename T>
 _Atomic(T)* ToC11Atomic(volatile T* loc)
@@ -50,6 +50,11 @@ inline void AtomicOr(volatile u32& target, u32 value) {
 	_InterlockedOr((volatile LONG*)&target, (LONG)value);
 }
 
+// Sets target to value if it is expected, returns whether it did
+inline bool AtomicCompareExchange(volatile u32& target, u32 expected, u32 value) {
+	return _InterlockedCompareExchange((volatile LONG*)&target, (LONG)value, (LONG)expected) == (LONG)expected;
+}
+
 template <typename T>
 inline T AtomicLoad(volatile T& src) {
 	return src; // 32-bit reads are always atomic.
@@ -9,6 +9,8 @@
 #include "StdMutex.h"
 #include "StdThread.h"
 
+#include <chrono>
+
 // Don't include common.h here as it will break LogManager
 #include "CommonTypes.h"
 #include <stdio.h>
@@ -57,6 +59,16 @@ public:
 		is_set = false;
 	}
 
+	// Returns false if the timeout expired before the event was set
+	bool WaitFor(u32 ms)
+	{
+		std::unique_lock<std::mutex> lk(m_mutex);
+		if (!m_condvar.wait_for(lk, std::chrono::milliseconds(ms), [&]{ return is_set; }))
+			return false;
+		is_set = false;
+		return true;
+	}
+
 	void Reset()
 	{
 		std::unique_lock<std::mutex> lk(m_mutex);
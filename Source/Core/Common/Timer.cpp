@@ -29,6 +29,26 @@ u32 Timer::GetTimeMs()
 #endif
 }
 
+u64 Timer::GetTimeNs()
+{
+#ifdef _WIN32
+	static LARGE_INTEGER freq;
+	if (!freq.QuadPart)
+		QueryPerformanceFrequency(&freq);
+	LARGE_INTEGER count;
+	QueryPerformanceCounter(&count);
+	return (u64)((double)count.QuadPart * 1000000000.0 / (double)freq.QuadPart);
+#elif defined(__APPLE__)
+	struct timeval t;
+	(void)gettimeofday(&t, NULL);
+	return (u64)t.tv_sec * 1000000000ULL + (u64)t.tv_usec * 1000ULL;
+#else
+	struct timespec t;
+	(void)clock_gettime(CLOCK_MONOTONIC, &t);
+	return (u64)t.tv_sec * 1000000000ULL + (u64)t.tv_nsec;
+#endif
+}
+
 // --------------------------------------------
 // Initiate, Start, Stop, and Update the time
 // --------------------------------------------
@@ -34,6 +34,8 @@ public:
 	u64 GetTimeElapsed();
 
 	static u32 GetTimeMs();
+	// Monotonic high resolution clock, meant for measuring short intervals
+	static u64 GetTimeNs();
 
 private:
 	u64 m_LastTime;
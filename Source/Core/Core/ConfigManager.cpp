@@ -258,6 +258,7 @@ void SConfig::SaveSettings()
 
 	ini.Set("Core", "WiiSDCard", m_WiiSDCard);
 	ini.Set("Core", "WiiKeyboard", m_WiiKeyboard);
+	ini.Set("Core", "NANDWriteBack", m_NANDWriteBack);
 	ini.Set("Core", "WiimoteContinuousScanning", m_WiimoteContinuousScanning);
 	ini.Set("Core", "WiimoteEnableSpeaker", m_WiimoteEnableSpeaker);
 	ini.Set("Core", "RunCompareServer",	m_LocalCoreStartupParameter.bRunCompareServer);
@@ -277,6 +278,7 @@ void SConfig::SaveSettings()
 	ini.Set("DSP", "DumpAudio", m_DumpAudio);
 	ini.Set("DSP", "Backend", sBackend);
 	ini.Set("DSP", "Volume", m_Volume);
+	ini.Set("DSP", "MixerLatency", m_MixerLatency);
 
 	// Fifo Player
 	ini.Set("FifoPlayer", "LoopReplay", m_LocalCoreStartupParameter.bLoopFifoReplay);
@@ -419,6 +421,7 @@ void SConfig::LoadSettings()
 
 		ini.Get("Core", "WiiSDCard",		&m_WiiSDCard,									false);
 		ini.Get("Core", "WiiKeyboard",		&m_WiiKeyboard,									false);
+		ini.Get("Core", "NANDWriteBack",	&m_NANDWriteBack,								false);
 		ini.Get("Core", "WiimoteContinuousScanning", &m_WiimoteContinuousScanning,			false);
 		ini.Get("Core", "WiimoteEnableSpeaker", &m_WiimoteEnableSpeaker,					true);
 		ini.Get("Core", "RunCompareServer",	&m_LocalCoreStartupParameter.bRunCompareServer,	false);
@@ -455,6 +458,7 @@ void SConfig::LoadSettings()
 		ini.Get("DSP", "Backend", &sBackend, BACKEND_NULLSOUND);
 	#endif
 		ini.Get("DSP", "Volume", &m_Volume, 100);
+		ini.Get("DSP", "MixerLatency", &m_MixerLatency, 40);
 
 		ini.Get("FifoPlayer", "LoopReplay", &m_LocalCoreStartupParameter.bLoopFifoReplay, true);
 	}
@@ -28,6 +28,8 @@ struct SConfig : NonCopyable
 	// Wii Devices
 	bool m_WiiSDCard;
 	bool m_WiiKeyboard;
+	// Buffer writes to NAND files until the file is closed
+	bool m_NANDWriteBack;
 	bool m_WiimoteContinuousScanning;
 	bool m_WiimoteEnableSpeaker;
 
@@ -83,6 +85,8 @@ struct SConfig : NonCopyable
 	bool m_EnableJIT;
 	bool m_DumpAudio;
 	int m_Volume;
+	// Audio the mixer keeps buffered for every source, in ms
+	int m_MixerLatency;
 	std::string sBackend;
 
 	SysConf* m_SYSCONF;
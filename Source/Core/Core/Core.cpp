@@ -58,6 +58,7 @@
 
 #include "State.h"
 #include "Movie.h"
+#include "MovieBenchmark.h"
 #include "NetPlayProto.h"
 #include "PatchEngine.h"
 
@@ -621,8 +622,10 @@ void VideoThrottle()
 	else
 		isTabPressed = false;
 
-	// Disable the frame-limiter when the throttle (Tab) key is held down. Audio throttle: m_Framelimit = 2
-	if (SConfig::GetInstance().m_Framelimit && SConfig::GetInstance().m_Framelimit != 2 && !Host_GetKeyState('\t'))
+	// Disable the frame-limiter when the throttle (Tab) key is held down, while NetPlay
+	// catches up after a rollback, or while benchmarking a movie. Audio throttle: m_Framelimit = 2
+	if (SConfig::GetInstance().m_Framelimit && SConfig::GetInstance().m_Framelimit != 2 && !Host_GetKeyState('\t') &&
+		!NetPlay::IsResimulating() && !MovieBenchmark::IsActive())
 	{
 		u32 frametime = ((SConfig::GetInstance().b_UseFPS)? Common::AtomicLoad(DrawnFrame) : DrawnVideo) * 1000 / TargetVPS;
 
@@ -98,6 +98,8 @@ struct SCoreStartupParameter
 	// 1 = Jit
 	// 2 = JitIL
 	// 3 = JIT ARM
+	// 4 = JITIL ARM
+	// 5 = Cached interpreter
 	int iCPUCore;
 
 	// JIT (shared between JIT and JITIL)
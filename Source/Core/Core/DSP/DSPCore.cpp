@@ -311,6 +311,7 @@ int DSPCore_RunCycles(int cycles)
 		DSPCompiledCode pExecAddr = (DSPCompiledCode)dspjit->enterDispatcher;
 		pExecAddr();
 
+		dspjit->UpdateUCodeCache();
 		if (g_dsp.reset_dspjit_codespace)
 			dspjit->ClearIRAMandDSPJITCodespaceReset();
 
@@ -2,8 +2,10 @@
 // Licensed under GPLv2
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include <cstring>
 
+#include "Hash.h"
 #include "DSPEmitter.h"
 #include "DSPMemoryMap.h"
 #include "DSPCore.h"
@@ -22,9 +24,12 @@ DSPEmitter::DSPEmitter() : gpr(*this), storeIndex(-1), storeIndex2(-1)
 
 	AllocCodeSpace(COMPILED_CODE_SIZE);
 
-	blocks = new DSPCompiledCode[MAX_BLOCKS];
-	blockLinks = new Block[MAX_BLOCKS];
-	blockSize = new u16[MAX_BLOCKS];
+	for (int i = 0; i < MAX_UCODE_CACHES; i++)
+		AllocBlocks(ucodeCaches[i]);
+	AllocBlocks(loadingCache);
+	ucodeUseCount = 0;
+	iramChanged = false;
+	loadingCompiled = false;
 
 	compileSR = 0;
 	compileSR |= SR_INT_ENABLE;
@@ -34,47 +39,131 @@ DSPEmitter::DSPEmitter() : gpr(*this), storeIndex(-1), storeIndex2(-1)
 	stubEntryPoint = CompileStub();
 
 	//clear all of the block references
+	for (int i = 0; i < MAX_UCODE_CACHES; i++)
+		ResetBlocks(ucodeCaches[i]);
+	ResetBlocks(loadingCache);
+	ucodeCaches[0].iramHash = GetHash64((const u8*)g_dsp.iram, DSP_IRAM_BYTE_SIZE, 0);
+	SelectUCodeCache(0);
+}
+
+DSPEmitter::~DSPEmitter()
+{
+	for (int i = 0; i < MAX_UCODE_CACHES; i++)
+		FreeBlocks(ucodeCaches[i]);
+	FreeBlocks(loadingCache);
+	FreeCodeSpace();
+}
+
+void DSPEmitter::AllocBlocks(UCodeCache &cache)
+{
+	cache.iramHash = 0;
+	cache.lastUsed = 0;
+	cache.blocks = new DSPCompiledCode[MAX_BLOCKS];
+	cache.blockLinks = new Block[MAX_BLOCKS];
+	cache.blockSize = new u16[MAX_BLOCKS];
+	cache.unresolvedJumps = new std::list<u16>[MAX_BLOCKS];
+}
+
+void DSPEmitter::FreeBlocks(UCodeCache &cache)
+{
+	delete[] cache.blocks;
+	delete[] cache.blockLinks;
+	delete[] cache.blockSize;
+	delete[] cache.unresolvedJumps;
+}
+
+void DSPEmitter::ResetBlocks(UCodeCache &cache)
+{
 	for(int i = 0x0000; i < MAX_BLOCKS; i++)
 	{
-		blocks[i] = (DSPCompiledCode)stubEntryPoint;
-		blockLinks[i] = 0;
-		blockSize[i] = 0;
+		cache.blocks[i] = (DSPCompiledCode)stubEntryPoint;
+		cache.blockLinks[i] = 0;
+		cache.blockSize[i] = 0;
+		cache.unresolvedJumps[i].clear();
 	}
 }
 
-DSPEmitter::~DSPEmitter()
+void DSPEmitter::SelectTables(const UCodeCache &cache)
 {
-	delete[] blocks;
-	delete[] blockLinks;
-	delete[] blockSize;
-	FreeCodeSpace();
+	blocks = cache.blocks;
+	blockLinks = cache.blockLinks;
+	blockSize = cache.blockSize;
+	unresolvedJumps = cache.unresolvedJumps;
 }
 
+void DSPEmitter::SelectUCodeCache(int index)
+{
+	UCodeCache &cache = ucodeCaches[index];
+	cache.lastUsed = ++ucodeUseCount;
+	currentUCode = index;
+	SelectTables(cache);
+}
+
+// Called whenever new code was copied to IRAM. Ucodes are often uploaded in
+// several DMAs, so until UpdateUCodeCache runs, blocks are compiled into
+// the loading tables and the image isn't hashed yet.
 void DSPEmitter::ClearIRAM()
 {
-	for(int i = 0x0000; i < 0x1000; i++)
+	if (loadingCompiled)
+		ResetBlocks(loadingCache);
+	SelectTables(loadingCache);
+	iramChanged = true;
+	loadingCompiled = false;
+}
+
+// Called when the dispatcher returned, once the DMAs that changed IRAM are done
+void DSPEmitter::UpdateUCodeCache()
+{
+	if (!iramChanged)
+		return;
+	iramChanged = false;
+
+	u64 hash = GetHash64((const u8*)g_dsp.iram, DSP_IRAM_BYTE_SIZE, 0);
+
+	int victim = 0;
+	for (int i = 0; i < MAX_UCODE_CACHES; i++)
 	{
-		blocks[i] = (DSPCompiledCode)stubEntryPoint;
-		blockLinks[i] = 0;
-		blockSize[i] = 0;
-		unresolvedJumps[i].clear();
+		if (ucodeCaches[i].lastUsed && ucodeCaches[i].iramHash == hash)
+		{
+			SelectUCodeCache(i);
+			return;
+		}
+		if (ucodeCaches[i].lastUsed < ucodeCaches[victim].lastUsed)
+			victim = i;
 	}
-	g_dsp.reset_dspjit_codespace = true;
+
+	// The blocks compiled since the upload are kept, the tables of the
+	// evicted ucode become the next loading tables. Its code stays in the
+	// code space until the next reset. Only start over when it is getting
+	// full, it is cheaper than recompiling on every ucode switch.
+	UCodeCache &cache = ucodeCaches[victim];
+	std::swap(cache.blocks, loadingCache.blocks);
+	std::swap(cache.blockLinks, loadingCache.blockLinks);
+	std::swap(cache.blockSize, loadingCache.blockSize);
+	std::swap(cache.unresolvedJumps, loadingCache.unresolvedJumps);
+	cache.iramHash = hash;
+	SelectUCodeCache(victim);
+	loadingCompiled = true;
+
+	if (GetSpaceLeft() < COMPILED_CODE_SIZE / 2)
+		g_dsp.reset_dspjit_codespace = true;
 }
 
+// Drops the code of every ucode, only the current one is kept, with empty tables
 void DSPEmitter::ClearIRAMandDSPJITCodespaceReset()
 {
 	ClearCodeSpace();
 	CompileDispatcher();
 	stubEntryPoint = CompileStub();
 
-	for(int i = 0x0000; i < 0x10000; i++)
+	for (int i = 0; i < MAX_UCODE_CACHES; i++)
 	{
-		blocks[i] = (DSPCompiledCode)stubEntryPoint;
-		blockLinks[i] = 0;
-		blockSize[i] = 0;
-		unresolvedJumps[i].clear();
+		ResetBlocks(ucodeCaches[i]);
+		if (i != currentUCode)
+			ucodeCaches[i].lastUsed = 0;
 	}
+	ResetBlocks(loadingCache);
+	loadingCompiled = false;
 	g_dsp.reset_dspjit_codespace = false;
 }
 
@@ -203,6 +292,8 @@ void DSPEmitter::Compile(u16 start_addr)
 	// Remember the current block address for later
 	startAddr = start_addr;
 	unresolvedJumps[start_addr].clear();
+	if (iramChanged)
+		loadingCompiled = true;
 
 	const u8 *entryPoint = AlignCode16();
 
@@ -403,11 +494,12 @@ void DSPEmitter::CompileDispatcher()
 	// Execute block. Cycles executed returned in EAX.
 #ifdef _M_IX86
 	MOVZX(32, 16, ECX, M(&g_dsp.pc));
-	MOV(32, R(EBX), ImmPtr(blocks));
+	MOV(32, R(EBX), M(&blocks));
 	JMPptr(MComplex(EBX, ECX, SCALE_4, 0));
 #else
 	MOVZX(64, 16, ECX, M(&g_dsp.pc));//for clarity, use 64 here.
-	MOV(64, R(RBX), ImmPtr(blocks));
+	MOV(64, R(RBX), ImmPtr(&blocks));
+	MOV(64, R(RBX), MatR(RBX));
 	JMPptr(MComplex(RBX, RCX, SCALE_8, 0));
 #endif
 
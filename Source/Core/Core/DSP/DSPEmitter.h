@@ -16,6 +16,9 @@
 
 #define MAX_BLOCKS 0x10000
 
+// IRAM images whose compiled blocks are kept around
+#define MAX_UCODE_CACHES 4
+
 typedef u32 (*DSPCompiledCode)();
 typedef const u8 *Block;
 
@@ -29,6 +32,7 @@ public:
 
 	void EmitInstruction(UDSPInstruction inst);
 	void ClearIRAM();
+	void UpdateUCodeCache();
 	void ClearIRAMandDSPJITCodespaceReset();
 
 	void CompileDispatcher();
@@ -253,10 +257,40 @@ public:
 	u16 startAddr;
 	Block *blockLinks;
 	u16 *blockSize;
-	std::list<u16> unresolvedJumps[MAX_BLOCKS];
+	std::list<u16> *unresolvedJumps;
 
 	DSPJitRegCache gpr;
 private:
+	// The block tables of one IRAM image. Games switch between a few ucodes,
+	// switching back to one that is still cached only swaps the tables, its
+	// code is still in the code space.
+	struct UCodeCache
+	{
+		u64 iramHash;
+		// 0 if the cache is unused
+		u32 lastUsed;
+		DSPCompiledCode *blocks;
+		Block *blockLinks;
+		u16 *blockSize;
+		std::list<u16> *unresolvedJumps;
+	};
+
+	UCodeCache ucodeCaches[MAX_UCODE_CACHES];
+	int currentUCode;
+	u32 ucodeUseCount;
+	// Used from the time IRAM changes until UpdateUCodeCache looks it up
+	UCodeCache loadingCache;
+	bool iramChanged;
+	// Whether the loading tables need a reset before they are used again
+	bool loadingCompiled;
+
+	void AllocBlocks(UCodeCache &cache);
+	void FreeBlocks(UCodeCache &cache);
+	void ResetBlocks(UCodeCache &cache);
+	void SelectTables(const UCodeCache &cache);
+	void SelectUCodeCache(int index);
+
+	// Points to the tables of the current ucode, the dispatcher loads it on every dispatch
 	DSPCompiledCode *blocks;
 	Block blockLinkEntry;
 	u16 compileSR;
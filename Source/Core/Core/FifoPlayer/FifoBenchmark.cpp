@@ -0,0 +1,140 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <stdio.h>
+#include <vector>
+
+#include "FifoBenchmark.h"
+#include "FifoPlayer.h"
+
+#include "FileUtil.h"
+#include "Timer.h"
+
+#include "VideoTimings.h"
+
+namespace FifoBenchmark
+{
+
+struct FrameTimings
+{
+	u32 run;
+	u32 frame;
+	u64 total;
+	VideoTimings video;
+};
+
+static bool s_active = false;
+static u32 s_run;
+static u64 s_frameStart;
+static std::vector<FrameTimings> s_frames;
+
+static void FrameWritten()
+{
+	u32 frame = FifoPlayer::GetInstance().GetCurrentFrameNum();
+	if (!s_frames.empty() && frame <= s_frames.back().frame)
+		++s_run;
+
+	VideoTimings_Reset();
+	s_frameStart = Common::Timer::GetTimeNs();
+}
+
+static void FrameFinished()
+{
+	FrameTimings timings;
+	timings.total = Common::Timer::GetTimeNs() - s_frameStart;
+	timings.run = s_run;
+	timings.frame = FifoPlayer::GetInstance().GetCurrentFrameNum();
+	timings.video = g_video_timings;
+	s_frames.push_back(timings);
+}
+
+void Init(u32 runs)
+{
+	s_active = true;
+	s_run = 0;
+	s_frames.clear();
+
+	FifoPlayer &player = FifoPlayer::GetInstance();
+	player.SetLoopCount(runs);
+	player.SetFrameWrittenCallback(FrameWritten);
+	player.SetFrameFinishedCallback(FrameFinished);
+
+	VideoTimings_Reset();
+	g_bGatherVideoTimings = true;
+}
+
+static void WriteRow(FILE *out, const char *run, const char *frame, const FrameTimings &t)
+{
+	fprintf(out, "%s,%s,%.3f,%.3f,%.3f,%.3f,%.3f\n", run, frame,
+		t.total / 1000.0, t.video.decode / 1000.0, t.video.vertexLoad / 1000.0,
+		t.video.textureLoad / 1000.0, t.video.flush / 1000.0);
+}
+
+static void Accumulate(FrameTimings &sum, const FrameTimings &t)
+{
+	sum.total += t.total;
+	sum.video.decode += t.video.decode;
+	sum.video.vertexLoad += t.video.vertexLoad;
+	sum.video.textureLoad += t.video.textureLoad;
+	sum.video.flush += t.video.flush;
+}
+
+bool Shutdown(const std::string& filename)
+{
+	if (!s_active)
+		return false;
+
+	s_active = false;
+	g_bGatherVideoTimings = false;
+
+	FifoPlayer &player = FifoPlayer::GetInstance();
+	player.SetLoopCount(0);
+	player.SetFrameWrittenCallback(NULL);
+	player.SetFrameFinishedCallback(NULL);
+
+	File::IOFile file;
+	FILE *out = stdout;
+	if (!filename.empty())
+	{
+		if (!file.Open(filename, "w"))
+			return false;
+		out = file.GetHandle();
+	}
+
+	// All times are in microseconds. decode includes the other stages and
+	// flush includes the texture loads done while flushing.
+	fprintf(out, "run,frame,total_us,decode_us,vertex_us,texture_us,flush_us\n");
+
+	FrameTimings runTotal = {}, total = {};
+	for (size_t i = 0; i < s_frames.size(); ++i)
+	{
+		const FrameTimings &t = s_frames[i];
+		WriteRow(out, std::to_string(t.run).c_str(), std::to_string(t.frame).c_str(), t);
+		Accumulate(runTotal, t);
+		Accumulate(total, t);
+
+		if (i + 1 == s_frames.size() || s_frames[i + 1].run != t.run)
+		{
+			WriteRow(out, std::to_string(t.run).c_str(), "total", runTotal);
+			runTotal = FrameTimings();
+		}
+	}
+	WriteRow(out, "all", "total", total);
+
+	if (total.total)
+	{
+		fprintf(stderr, "%u frames in %.3f ms, %.2f FPS\n", (u32)s_frames.size(),
+			total.total / 1000000.0, s_frames.size() * 1000000000.0 / total.total);
+	}
+
+	s_frames.clear();
+	return true;
+}
+
+bool IsActive()
+{
+	return s_active;
+}
+
+}
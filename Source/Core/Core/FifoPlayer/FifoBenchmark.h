@@ -0,0 +1,28 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#ifndef _FIFOBENCHMARK_H_
+#define _FIFOBENCHMARK_H_
+
+#include <string>
+
+#include "CommonTypes.h"
+
+// Drives FifoPlayer as a benchmark: the log is replayed a fixed number of
+// times and the host time spent on every frame is recorded, broken down into
+// the video pipeline stages measured by VideoTimings.
+namespace FifoBenchmark
+{
+
+// Must be called before the FIFO log is booted
+void Init(u32 runs);
+
+// Writes the results as CSV, to stdout if filename is empty
+bool Shutdown(const std::string& filename);
+
+bool IsActive();
+
+}
+
+#endif
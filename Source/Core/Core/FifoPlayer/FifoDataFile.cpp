@@ -2,28 +2,80 @@
 // Licensed under GPLv2
 // Refer to the license.txt file included.
 
+#include <algorithm>
+#include <unordered_map>
+
+#include <lzo/lzo1x.h>
+
 #include "FifoDataFile.h"
 #include "FifoFileStruct.h"
 
 #include "FileUtil.h"
+#include "Hash.h"
 
 using namespace FifoFileStruct;
 using namespace std;
 
+static bool InitLZO()
+{
+	static bool initialized = false;
+	if (!initialized)
+		initialized = lzo_init() == LZO_E_OK;
+	return initialized;
+}
+
+// Returns the number of bytes written to dst, which must hold at least
+// size + size / 16 + 64 + 3 bytes. Stores the data as is if it doesn't compress.
+static u32 CompressChunk(const u8 *src, u32 size, u8 *dst, vector<lzo_align_t> &wrkmem)
+{
+	lzo_uint outSize = 0;
+	if (lzo1x_1_compress(src, size, dst, &outSize, wrkmem.data()) != LZO_E_OK || outSize >= size)
+	{
+		memcpy(dst, src, size);
+		return size;
+	}
+	return (u32)outSize;
+}
+
+static bool DecompressChunk(const u8 *src, u32 compressedSize, u8 *dst, u32 size)
+{
+	if (compressedSize == size)
+	{
+		memcpy(dst, src, size);
+		return true;
+	}
+
+	lzo_uint outSize = size;
+	return lzo1x_decompress_safe(src, compressedSize, dst, &outSize, NULL) == LZO_E_OK && outSize == size;
+}
+
 FifoDataFile::FifoDataFile() :
-	m_Flags(0)
+	m_Flags(0),
+	m_Streaming(false),
+	m_StreamFile(NULL)
 {
 }
 
 FifoDataFile::~FifoDataFile()
 {
 	for (auto& frame : m_Frames)
-	{
-		for (auto& update : frame.memoryUpdates)
-			delete []update.data;
+		FreeFrame(frame);
 
-		delete []frame.fifoData;
-	}
+	delete m_StreamFile;
+}
+
+void FifoDataFile::FreeFrame(FifoFrameInfo &frame)
+{
+	for (auto& update : frame.memoryUpdates)
+		delete []update.data;
+
+	delete []frame.fifoData;
+}
+
+void FifoDataFile::DeleteFrame(FifoFrameInfo *frame)
+{
+	FreeFrame(*frame);
+	delete frame;
 }
 
 void FifoDataFile::SetIsWii(bool isWii)
@@ -41,8 +93,38 @@ void FifoDataFile::AddFrame(const FifoFrameInfo &frameInfo)
 	m_Frames.push_back(frameInfo);
 }
 
+std::shared_ptr<const FifoFrameInfo> FifoDataFile::GetFrame(int frame)
+{
+	// Frames that are fully loaded live as long as the file
+	if (!m_Streaming)
+		return std::shared_ptr<const FifoFrameInfo>(&m_Frames[frame], [](const FifoFrameInfo*) {});
+
+	std::lock_guard<std::mutex> lk(m_StreamLock);
+
+	if (m_CachedFrames[frame])
+	{
+		m_CacheOrder.erase(std::find(m_CacheOrder.begin(), m_CacheOrder.end(), frame));
+		m_CacheOrder.push_back(frame);
+		return m_CachedFrames[frame];
+	}
+
+	if (m_CacheOrder.size() >= CACHED_FRAMES)
+	{
+		int evicted = m_CacheOrder.front();
+		m_CacheOrder.pop_front();
+		m_CachedFrames[evicted].reset();
+	}
+
+	m_CachedFrames[frame] = std::shared_ptr<FifoFrameInfo>(LoadFrame(frame), DeleteFrame);
+	m_CacheOrder.push_back(frame);
+	return m_CachedFrames[frame];
+}
+
 bool FifoDataFile::Save(const char *filename)
 {
+	if (!InitLZO())
+		return false;
+
 	File::IOFile file;
 	if (!file.Open(filename, "wb"))
 		return false;
@@ -67,8 +149,94 @@ bool FifoDataFile::Save(const char *filename)
 	u64 xfRegsOffset = file.Tell();
 	file.WriteArray(m_XFRegs, XF_REGS_SIZE);
 
+	vector<lzo_align_t> wrkmem((LZO1X_1_MEM_COMPRESS + sizeof(lzo_align_t) - 1) / sizeof(lzo_align_t));
+	vector<u8> chunk;
+	vector<u8> compressed;
+
+	// Memory updates are mostly the same textures and vertex arrays over and
+	// over again, so every distinct payload is stored only once
+	vector<FileBlob> blobs;
+	unordered_multimap<u64, u32> blobsByHash;
+	vector<const u8*> blobData;
+
+	// Write frames
+	for (unsigned int i = 0; i < m_Frames.size(); ++i)
+	{
+		const FifoFrameInfo &srcFrame = m_Frames[i];
+		const vector<MemoryUpdate> &memUpdates = srcFrame.memoryUpdates;
+
+		chunk.resize(srcFrame.fifoDataSize + memUpdates.size() * sizeof(FileMemoryUpdate));
+		memcpy(chunk.data(), srcFrame.fifoData, srcFrame.fifoDataSize);
+
+		for (unsigned int j = 0; j < memUpdates.size(); ++j)
+		{
+			const MemoryUpdate &srcUpdate = memUpdates[j];
+			u64 hash = GetMurmurHash3(srcUpdate.data, srcUpdate.size, 0);
+
+			u32 blobIndex = (u32)blobs.size();
+			auto range = blobsByHash.equal_range(hash);
+			for (auto it = range.first; it != range.second; ++it)
+			{
+				if (blobs[it->second].dataSize == srcUpdate.size &&
+					memcmp(blobData[it->second], srcUpdate.data, srcUpdate.size) == 0)
+				{
+					blobIndex = it->second;
+					break;
+				}
+			}
+
+			if (blobIndex == blobs.size())
+			{
+				compressed.resize(srcUpdate.size + srcUpdate.size / 16 + 64 + 3);
+
+				FileBlob blob;
+				blob.hash = hash;
+				blob.dataOffset = file.Tell();
+				blob.dataSize = srcUpdate.size;
+				blob.compressedSize = CompressChunk(srcUpdate.data, srcUpdate.size, compressed.data(), wrkmem);
+				file.WriteBytes(compressed.data(), blob.compressedSize);
+
+				blobs.push_back(blob);
+				blobData.push_back(srcUpdate.data);
+				blobsByHash.insert(make_pair(hash, blobIndex));
+			}
+
+			FileMemoryUpdate dstUpdate;
+			memset(&dstUpdate, 0, sizeof(FileMemoryUpdate));
+			dstUpdate.address = srcUpdate.address;
+			dstUpdate.dataOffset = blobIndex;
+			dstUpdate.dataSize = srcUpdate.size;
+			dstUpdate.fifoPosition = srcUpdate.fifoPosition;
+			dstUpdate.type = srcUpdate.type;
+			memcpy(&chunk[srcFrame.fifoDataSize + j * sizeof(FileMemoryUpdate)], &dstUpdate, sizeof(FileMemoryUpdate));
+		}
+
+		compressed.resize(chunk.size() + chunk.size() / 16 + 64 + 3);
+
+		FileFrameInfo dstFrame;
+		memset(&dstFrame, 0, sizeof(FileFrameInfo));
+		dstFrame.fifoDataOffset = file.Tell();
+		dstFrame.fifoDataSize = srcFrame.fifoDataSize;
+		dstFrame.fifoStart = srcFrame.fifoStart;
+		dstFrame.fifoEnd = srcFrame.fifoEnd;
+		dstFrame.numMemoryUpdates = (u32)memUpdates.size();
+		dstFrame.chunkSize = CompressChunk(chunk.data(), (u32)chunk.size(), compressed.data(), wrkmem);
+		file.WriteBytes(compressed.data(), dstFrame.chunkSize);
+
+		// Write frame info
+		u64 frameOffset = frameListOffset + (i * sizeof(FileFrameInfo));
+		file.Seek(frameOffset, SEEK_SET);
+		file.WriteBytes(&dstFrame, sizeof(FileFrameInfo));
+		file.Seek(0, SEEK_END);
+	}
+
+	u64 blobListOffset = file.Tell();
+	if (!blobs.empty())
+		file.WriteArray(blobs.data(), blobs.size());
+
 	// Write header
 	FileHeader header;
+	memset(&header, 0, sizeof(FileHeader));
 	header.fileId = FILE_ID;
 	header.file_version = VERSION_NUMBER;
 	header.min_loader_version = MIN_LOADER_VERSION;
@@ -90,35 +258,12 @@ bool FifoDataFile::Save(const char *filename)
 
 	header.flags = m_Flags;
 
+	header.blobListOffset = blobListOffset;
+	header.blobCount = (u32)blobs.size();
+
 	file.Seek(0, SEEK_SET);
 	file.WriteBytes(&header, sizeof(FileHeader));
 
-	// Write frames list
-	for (unsigned int i = 0; i < m_Frames.size(); ++i)
-	{
-		const FifoFrameInfo &srcFrame = m_Frames[i];
-
-		// Write FIFO data
-		file.Seek(0, SEEK_END);
-		u64 dataOffset = file.Tell();
-		file.WriteBytes(srcFrame.fifoData, srcFrame.fifoDataSize);
-
-		u64 memoryUpdatesOffset = WriteMemoryUpdates(srcFrame.memoryUpdates, file);
-
-		FileFrameInfo dstFrame;
-		dstFrame.fifoDataSize = srcFrame.fifoDataSize;
-		dstFrame.fifoDataOffset = dataOffset;
-		dstFrame.fifoStart = srcFrame.fifoStart;
-		dstFrame.fifoEnd = srcFrame.fifoEnd;
-		dstFrame.memoryUpdatesOffset = memoryUpdatesOffset;
-		dstFrame.numMemoryUpdates = (u32)srcFrame.memoryUpdates.size();
-
-		// Write frame info
-		u64 frameOffset = frameListOffset + (i * sizeof(FileFrameInfo));
-		file.Seek(frameOffset, SEEK_SET);
-		file.WriteBytes(&dstFrame, sizeof(FileFrameInfo));
-	}
-
 	if (!file.Close())
 		return false;
 
@@ -127,17 +272,19 @@ bool FifoDataFile::Save(const char *filename)
 
 FifoDataFile *FifoDataFile::Load(const std::string &filename, bool flagsOnly)
 {
-	File::IOFile file;
-	file.Open(filename, "rb");
-	if (!file)
+	File::IOFile *file = new File::IOFile(filename, "rb");
+	if (!file->IsOpen())
+	{
+		delete file;
 		return NULL;
+	}
 
 	FileHeader header;
-	file.ReadBytes(&header, sizeof(header));
+	file->ReadBytes(&header, sizeof(header));
 
 	if (header.fileId != FILE_ID || header.min_loader_version > VERSION_NUMBER)
 	{
-		file.Close();
+		delete file;
 		return NULL;
 	}
 
@@ -147,33 +294,85 @@ FifoDataFile *FifoDataFile::Load(const std::string &filename, bool flagsOnly)
 
 	if (flagsOnly)
 	{
-		file.Close();
+		delete file;
 		return dataFile;
 	}
 
 	u32 size = std::min((u32)BP_MEM_SIZE, header.bpMemSize);
-	file.Seek(header.bpMemOffset, SEEK_SET);
-	file.ReadArray(dataFile->m_BPMem, size);
+	file->Seek(header.bpMemOffset, SEEK_SET);
+	file->ReadArray(dataFile->m_BPMem, size);
 
 	size = std::min((u32)CP_MEM_SIZE, header.cpMemSize);
-	file.Seek(header.cpMemOffset, SEEK_SET);
-	file.ReadArray(dataFile->m_CPMem, size);
+	file->Seek(header.cpMemOffset, SEEK_SET);
+	file->ReadArray(dataFile->m_CPMem, size);
 
 	size = std::min((u32)XF_MEM_SIZE, header.xfMemSize);
-	file.Seek(header.xfMemOffset, SEEK_SET);
-	file.ReadArray(dataFile->m_XFMem, size);
+	file->Seek(header.xfMemOffset, SEEK_SET);
+	file->ReadArray(dataFile->m_XFMem, size);
 
 	size = std::min((u32)XF_REGS_SIZE, header.xfRegsSize);
-	file.Seek(header.xfRegsOffset, SEEK_SET);
-	file.ReadArray(dataFile->m_XFRegs, size);
+	file->Seek(header.xfRegsOffset, SEEK_SET);
+	file->ReadArray(dataFile->m_XFRegs, size);
+
+	if (header.file_version >= FIRST_CHUNKED_VERSION)
+	{
+		if (!InitLZO())
+		{
+			delete file;
+			delete dataFile;
+			return NULL;
+		}
+
+		// Only read the indices, frames are loaded on demand by GetFrame
+		dataFile->m_FrameIndex.resize(header.frameCount);
+		file->Seek(header.frameListOffset, SEEK_SET);
+		for (u32 i = 0; i < header.frameCount; ++i)
+		{
+			FileFrameInfo srcFrame;
+			file->ReadBytes(&srcFrame, sizeof(FileFrameInfo));
+
+			FrameIndexEntry &entry = dataFile->m_FrameIndex[i];
+			entry.chunkOffset = srcFrame.fifoDataOffset;
+			entry.chunkSize = srcFrame.chunkSize;
+			entry.fifoDataSize = srcFrame.fifoDataSize;
+			entry.fifoStart = srcFrame.fifoStart;
+			entry.fifoEnd = srcFrame.fifoEnd;
+			entry.numMemoryUpdates = srcFrame.numMemoryUpdates;
+		}
+
+		dataFile->m_BlobIndex.resize(header.blobCount);
+		file->Seek(header.blobListOffset, SEEK_SET);
+		for (u32 i = 0; i < header.blobCount; ++i)
+		{
+			FileBlob srcBlob;
+			file->ReadBytes(&srcBlob, sizeof(FileBlob));
+
+			BlobIndexEntry &entry = dataFile->m_BlobIndex[i];
+			entry.dataOffset = srcBlob.dataOffset;
+			entry.dataSize = srcBlob.dataSize;
+			entry.compressedSize = srcBlob.compressedSize;
+		}
+
+		if (!file->IsGood())
+		{
+			delete file;
+			delete dataFile;
+			return NULL;
+		}
+
+		dataFile->m_Streaming = true;
+		dataFile->m_StreamFile = file;
+		dataFile->m_CachedFrames.resize(header.frameCount);
+		return dataFile;
+	}
 
 	// Read frames
 	for (u32 i = 0; i < header.frameCount; ++i)
 	{
 		u64 frameOffset = header.frameListOffset + (i * sizeof(FileFrameInfo));
-		file.Seek(frameOffset, SEEK_SET);
+		file->Seek(frameOffset, SEEK_SET);
 		FileFrameInfo srcFrame;
-		file.ReadBytes(&srcFrame, sizeof(FileFrameInfo));
+		file->ReadBytes(&srcFrame, sizeof(FileFrameInfo));
 
 		FifoFrameInfo dstFrame;
 		dstFrame.fifoData = new u8[srcFrame.fifoDataSize];
@@ -181,19 +380,83 @@ FifoDataFile *FifoDataFile::Load(const std::string &filename, bool flagsOnly)
 		dstFrame.fifoStart = srcFrame.fifoStart;
 		dstFrame.fifoEnd = srcFrame.fifoEnd;
 
-		file.Seek(srcFrame.fifoDataOffset, SEEK_SET);
-		file.ReadBytes(dstFrame.fifoData, srcFrame.fifoDataSize);
+		file->Seek(srcFrame.fifoDataOffset, SEEK_SET);
+		file->ReadBytes(dstFrame.fifoData, srcFrame.fifoDataSize);
 
-		ReadMemoryUpdates(srcFrame.memoryUpdatesOffset, srcFrame.numMemoryUpdates, dstFrame.memoryUpdates, file);
+		ReadMemoryUpdates(srcFrame.memoryUpdatesOffset, srcFrame.numMemoryUpdates, dstFrame.memoryUpdates, *file);
 
 		dataFile->AddFrame(dstFrame);
 	}
 
-	file.Close();
+	delete file;
 
 	return dataFile;
 }
 
+FifoFrameInfo *FifoDataFile::LoadFrame(int frame)
+{
+	const FrameIndexEntry &entry = m_FrameIndex[frame];
+
+	FifoFrameInfo *dstFrame = new FifoFrameInfo;
+	dstFrame->fifoDataSize = entry.fifoDataSize;
+	dstFrame->fifoStart = entry.fifoStart;
+	dstFrame->fifoEnd = entry.fifoEnd;
+	dstFrame->fifoData = new u8[entry.fifoDataSize];
+
+	u32 chunkSize = entry.fifoDataSize + entry.numMemoryUpdates * sizeof(FileMemoryUpdate);
+	vector<u8> compressed(entry.chunkSize);
+	vector<u8> chunk(chunkSize);
+
+	m_StreamFile->Seek(entry.chunkOffset, SEEK_SET);
+	if (!m_StreamFile->ReadBytes(compressed.data(), entry.chunkSize) ||
+		!DecompressChunk(compressed.data(), entry.chunkSize, chunk.data(), chunkSize))
+	{
+		PanicAlert("Failed to read frame %i of the FIFO log", frame);
+		memset(dstFrame->fifoData, 0, entry.fifoDataSize);
+		return dstFrame;
+	}
+
+	memcpy(dstFrame->fifoData, chunk.data(), entry.fifoDataSize);
+
+	dstFrame->memoryUpdates.resize(entry.numMemoryUpdates);
+	for (u32 i = 0; i < entry.numMemoryUpdates; ++i)
+	{
+		FileMemoryUpdate srcUpdate;
+		memcpy(&srcUpdate, &chunk[entry.fifoDataSize + i * sizeof(FileMemoryUpdate)], sizeof(FileMemoryUpdate));
+
+		MemoryUpdate &dstUpdate = dstFrame->memoryUpdates[i];
+		dstUpdate.address = srcUpdate.address;
+		dstUpdate.fifoPosition = srcUpdate.fifoPosition;
+		dstUpdate.size = srcUpdate.dataSize;
+		dstUpdate.data = new u8[srcUpdate.dataSize];
+		dstUpdate.type = (MemoryUpdate::Type)srcUpdate.type;
+
+		if (!ReadBlob((u32)srcUpdate.dataOffset, dstUpdate.data, srcUpdate.dataSize))
+		{
+			PanicAlert("Failed to read memory update %u of frame %i of the FIFO log", i, frame);
+			memset(dstUpdate.data, 0, srcUpdate.dataSize);
+		}
+	}
+
+	return dstFrame;
+}
+
+bool FifoDataFile::ReadBlob(u32 index, u8 *dst, u32 size)
+{
+	if (index >= m_BlobIndex.size() || m_BlobIndex[index].dataSize != size)
+		return false;
+
+	const BlobIndexEntry &blob = m_BlobIndex[index];
+	m_StreamFile->Seek(blob.dataOffset, SEEK_SET);
+
+	if (blob.compressedSize == blob.dataSize)
+		return m_StreamFile->ReadBytes(dst, size);
+
+	vector<u8> compressed(blob.compressedSize);
+	return m_StreamFile->ReadBytes(compressed.data(), blob.compressedSize) &&
+		DecompressChunk(compressed.data(), blob.compressedSize, dst, size);
+}
+
 void FifoDataFile::PadFile(u32 numBytes, File::IOFile &file)
 {
 	FILE *handle = file.GetHandle();
@@ -215,37 +478,6 @@ bool FifoDataFile::GetFlag(u32 flag) const
 	return !!(m_Flags & flag);
 }
 
-u64 FifoDataFile::WriteMemoryUpdates(const std::vector<MemoryUpdate> &memUpdates, File::IOFile &file)
-{
-	// Add space for memory update list
-	u64 updateListOffset = file.Tell();
-	for (size_t i = 0; i < memUpdates.size(); i++)
-		PadFile(sizeof(FileMemoryUpdate), file);
-
-	for (unsigned int i = 0; i < memUpdates.size(); ++i)
-	{
-		const MemoryUpdate &srcUpdate = memUpdates[i];
-
-		// Write memory
-		file.Seek(0, SEEK_END);
-		u64 dataOffset = file.Tell();
-		file.WriteBytes(srcUpdate.data, srcUpdate.size);
-
-		FileMemoryUpdate dstUpdate;
-		dstUpdate.address = srcUpdate.address;
-		dstUpdate.dataOffset = dataOffset;
-		dstUpdate.dataSize = srcUpdate.size;
-		dstUpdate.fifoPosition = srcUpdate.fifoPosition;
-		dstUpdate.type = srcUpdate.type;
-
-		u64 updateOffset = updateListOffset + (i * sizeof(FileMemoryUpdate));
-		file.Seek(updateOffset, SEEK_SET);
-		file.WriteBytes(&dstUpdate, sizeof(FileMemoryUpdate));
-	}
-
-	return updateListOffset;
-}
-
 void FifoDataFile::ReadMemoryUpdates(u64 fileOffset, u32 numUpdates, std::vector<MemoryUpdate> &memUpdates, File::IOFile &file)
 {
 	memUpdates.resize(numUpdates);
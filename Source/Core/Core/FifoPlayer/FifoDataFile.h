@@ -6,6 +6,9 @@
 #define _FIFODATAFILE_H_
 
 #include "Common.h"
+#include "StdMutex.h"
+#include <deque>
+#include <memory>
 #include <vector>
 
 namespace File
@@ -65,8 +68,11 @@ public:
 	u32 *GetXFRegs() { return m_XFRegs; }
 
 	void AddFrame(const FifoFrameInfo &frameInfo);
-	const FifoFrameInfo &GetFrame(int frame) const { return m_Frames[frame]; }
-	int GetFrameCount() { return (int)m_Frames.size(); }
+	// Frames of files loaded from a chunked log are streamed from disk and only
+	// the most recently used CACHED_FRAMES of them are kept in memory. An
+	// evicted frame stays alive until its last holder drops it.
+	std::shared_ptr<const FifoFrameInfo> GetFrame(int frame);
+	int GetFrameCount() { return (int)(m_Streaming ? m_FrameIndex.size() : m_Frames.size()); }
 
 	bool Save(const char *filename);
 
@@ -78,12 +84,39 @@ private:
 		FLAG_IS_WII = 1
 	};
 
+	enum
+	{
+		CACHED_FRAMES = 8
+	};
+
+	struct FrameIndexEntry
+	{
+		u64 chunkOffset;
+		u32 chunkSize;
+		u32 fifoDataSize;
+		u32 fifoStart;
+		u32 fifoEnd;
+		u32 numMemoryUpdates;
+	};
+
+	struct BlobIndexEntry
+	{
+		u64 dataOffset;
+		u32 dataSize;
+		u32 compressedSize;
+	};
+
+	static void FreeFrame(FifoFrameInfo &frame);
+	static void DeleteFrame(FifoFrameInfo *frame);
+
+	FifoFrameInfo *LoadFrame(int frame);
+	bool ReadBlob(u32 index, u8 *dst, u32 size);
+
 	void PadFile(u32 numBytes, File::IOFile &file);
 
 	void SetFlag(u32 flag, bool set);
 	bool GetFlag(u32 flag) const;
 
-	u64 WriteMemoryUpdates(const std::vector<MemoryUpdate> &memUpdates, File::IOFile &file);
 	static void ReadMemoryUpdates(u64 fileOffset, u32 numUpdates, std::vector<MemoryUpdate> &memUpdates, File::IOFile &file);
 
 	u32 m_BPMem[BP_MEM_SIZE];
@@ -94,6 +127,15 @@ private:
 	u32 m_Flags;
 
 	std::vector<FifoFrameInfo> m_Frames;
+
+	// Streaming state of chunked files
+	bool m_Streaming;
+	File::IOFile *m_StreamFile;
+	std::vector<FrameIndexEntry> m_FrameIndex;
+	std::vector<BlobIndexEntry> m_BlobIndex;
+	std::vector<std::shared_ptr<FifoFrameInfo> > m_CachedFrames;
+	std::deque<int> m_CacheOrder;
+	std::mutex m_StreamLock;
 };
 
 #endif
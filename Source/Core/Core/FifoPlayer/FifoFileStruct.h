@@ -13,8 +13,13 @@ namespace FifoFileStruct
 enum
 {
 	FILE_ID = 0x0d01f1f0,
-	VERSION_NUMBER = 1,
-	MIN_LOADER_VERSION = 1,
+	VERSION_NUMBER = 2,
+	MIN_LOADER_VERSION = 2,
+
+	// Version 2 stores every frame as one compressed chunk holding its FIFO
+	// data followed by its memory updates, and the memory update payloads
+	// once each in a table of compressed, hash deduplicated blobs.
+	FIRST_CHUNKED_VERSION = 2,
 };
 
 #pragma pack(push, 4)
@@ -37,6 +42,8 @@ union FileHeader
 		u64 frameListOffset;
 		u32 frameCount;
 		u32 flags;
+		u64 blobListOffset;
+		u32 blobCount;
 	};
 	u32 rawData[32];
 };
@@ -51,20 +58,31 @@ union FileFrameInfo
 		u32 fifoEnd;
 		u64 memoryUpdatesOffset;
 		u32 numMemoryUpdates;
+		// Chunked files only, fifoDataOffset is then the offset of the chunk
+		u32 chunkSize;
 	};
 	u32 rawData[16];
 };
 
 
+
 struct FileMemoryUpdate
 {
 	u32 fifoPosition;
 	u32 address;
-	u64 dataOffset;
+	u64 dataOffset; // Index into the blob list in chunked files
 	u32 dataSize;
 	u8 type;
 };
 
+struct FileBlob
+{
+	u64 hash;
+	u64 dataOffset;
+	u32 dataSize;
+	u32 compressedSize; // Equal to dataSize if stored uncompressed
+};
+
 #pragma pack(pop)
 
 }
@@ -51,7 +51,8 @@ void FifoPlaybackAnalyzer::AnalyzeFrames(FifoDataFile *file, std::vector<Analyze
 
 	for (int frameIdx = 0; frameIdx < file->GetFrameCount(); ++frameIdx)
 	{
-		const FifoFrameInfo& frame = file->GetFrame(frameIdx);
+		std::shared_ptr<const FifoFrameInfo> framePtr = file->GetFrame(frameIdx);
+		const FifoFrameInfo& frame = *framePtr;
 		AnalyzedFrameInfo& analyzed = frameInfo[frameIdx];
 
 		m_DrawingObject = false;
@@ -67,7 +68,16 @@ void FifoPlaybackAnalyzer::AnalyzeFrames(FifoDataFile *file, std::vector<Analyze
 			// Add memory updates that have occurred before this point in the frame
 			while (nextMemUpdate < frame.memoryUpdates.size() && frame.memoryUpdates[nextMemUpdate].fifoPosition <= cmdStart)
 			{
-				AddMemoryUpdate(frame.memoryUpdates[nextMemUpdate], analyzed);
+				const MemoryUpdate &srcUpdate = frame.memoryUpdates[nextMemUpdate];
+
+				AnalyzedMemoryUpdate memUpdate;
+				memUpdate.updateIndex = nextMemUpdate;
+				memUpdate.dataOffset = 0;
+				memUpdate.fifoPosition = srcUpdate.fifoPosition;
+				memUpdate.address = srcUpdate.address;
+				memUpdate.size = srcUpdate.size;
+				AddMemoryUpdate(memUpdate, analyzed);
+
 				++nextMemUpdate;
 			}
 
@@ -109,7 +119,7 @@ void FifoPlaybackAnalyzer::AnalyzeFrames(FifoDataFile *file, std::vector<Analyze
 	}
 }
 
-void FifoPlaybackAnalyzer::AddMemoryUpdate(MemoryUpdate memUpdate, AnalyzedFrameInfo &frameInfo)
+void FifoPlaybackAnalyzer::AddMemoryUpdate(AnalyzedMemoryUpdate memUpdate, AnalyzedFrameInfo &frameInfo)
 {
 	u32 begin = memUpdate.address;
 	u32 end = memUpdate.address + memUpdate.size;
@@ -132,7 +142,7 @@ void FifoPlaybackAnalyzer::AddMemoryUpdate(MemoryUpdate memUpdate, AnalyzedFrame
 				}
 
 				u32 bytesToRangeEnd = range.end - memUpdate.address;
-				memUpdate.data += bytesToRangeEnd;
+				memUpdate.dataOffset += bytesToRangeEnd;
 				memUpdate.size = postSize;
 				memUpdate.address = range.end;
 			}
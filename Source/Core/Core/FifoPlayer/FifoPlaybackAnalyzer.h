@@ -11,11 +11,22 @@
 #include <string>
 #include <vector>
 
+// The part of one of the frame's memory updates that isn't overwritten by the GP.
+// Refers to the frame's data by index since frames may be streamed from disk.
+struct AnalyzedMemoryUpdate
+{
+	u32 updateIndex;
+	u32 dataOffset;
+	u32 fifoPosition;
+	u32 address;
+	u32 size;
+};
+
 struct AnalyzedFrameInfo
 {
 	std::vector<u32> objectStarts;
 	std::vector<u32> objectEnds;
-	std::vector<MemoryUpdate> memoryUpdates;
+	std::vector<AnalyzedMemoryUpdate> memoryUpdates;
 };
 
 class FifoPlaybackAnalyzer
@@ -32,7 +43,7 @@ private:
 		u32 end;
 	};
 
-	void AddMemoryUpdate(MemoryUpdate memUpdate, AnalyzedFrameInfo &frameInfo);
+	void AddMemoryUpdate(AnalyzedMemoryUpdate memUpdate, AnalyzedFrameInfo &frameInfo);
 
 	u32 DecodeCommand(u8 *data);
 	void LoadBP(u32 value0);
@@ -61,6 +61,7 @@ bool FifoPlayer::Play()
 		return false;
 
 	m_CurrentFrame = m_FrameRangeStart;
+	m_LoopsPlayed = 0;
 
 	LoadMemory();
 
@@ -71,7 +72,8 @@ bool FifoPlayer::Play()
 		{
 			if (m_CurrentFrame >= m_FrameRangeEnd)
 			{
-				if (m_Loop)
+				bool loop = m_LoopCount ? ++m_LoopsPlayed < m_LoopCount : m_Loop;
+				if (loop)
 				{
 					m_CurrentFrame = m_FrameRangeStart;
 
@@ -92,7 +94,10 @@ bool FifoPlayer::Play()
 				if (m_EarlyMemoryUpdates && m_CurrentFrame == m_FrameRangeStart)
 					WriteAllMemoryUpdates();
 
-				WriteFrame(m_File->GetFrame(m_CurrentFrame), m_FrameInfo[m_CurrentFrame]);
+				WriteFrame(*m_File->GetFrame(m_CurrentFrame), m_FrameInfo[m_CurrentFrame]);
+
+				if (m_FrameFinishedCb)
+					m_FrameFinishedCb();
 
 				++m_CurrentFrame;
 			}
@@ -161,9 +166,12 @@ FifoPlayer::FifoPlayer() :
 	m_EarlyMemoryUpdates(false),
 	m_FileLoadedCb(NULL),
 	m_FrameWrittenCb(NULL),
+	m_FrameFinishedCb(NULL),
 	m_File(NULL)
 {
 	m_Loop = SConfig::GetInstance().m_LocalCoreStartupParameter.bLoopFifoReplay;
+	m_LoopCount = 0;
+	m_LoopsPlayed = 0;
 }
 
 void FifoPlayer::WriteFrame(const FifoFrameInfo &frame, const AnalyzedFrameInfo &info)
@@ -184,7 +192,7 @@ void FifoPlayer::WriteFrame(const FifoFrameInfo &frame, const AnalyzedFrameInfo
 	// Skip memory updates during frame if true
 	if (m_EarlyMemoryUpdates)
 	{
-		memoryUpdate = (u32)(frame.memoryUpdates.size());
+		memoryUpdate = (u32)(info.memoryUpdates.size());
 	}
 
 	if (numObjects > 0)
@@ -229,9 +237,9 @@ void FifoPlayer::WriteFramePart(u32 dataStart, u32 dataEnd, u32 &nextMemUpdate,
 {
 	u8 *data = frame.fifoData;
 
-	while (nextMemUpdate < frame.memoryUpdates.size() && dataStart < dataEnd)
+	while (nextMemUpdate < info.memoryUpdates.size() && dataStart < dataEnd)
 	{
-		const MemoryUpdate &memUpdate = info.memoryUpdates[nextMemUpdate];
+		const AnalyzedMemoryUpdate &memUpdate = info.memoryUpdates[nextMemUpdate];
 
 		if (memUpdate.fifoPosition < dataEnd)
 		{
@@ -241,7 +249,8 @@ void FifoPlayer::WriteFramePart(u32 dataStart, u32 dataEnd, u32 &nextMemUpdate,
 				dataStart = memUpdate.fifoPosition;
 			}
 
-			WriteMemory(memUpdate);
+			const u8 *memData = frame.memoryUpdates[memUpdate.updateIndex].data + memUpdate.dataOffset;
+			WriteMemory(memUpdate.address, memData, memUpdate.size);
 
 			++nextMemUpdate;
 		}
@@ -262,24 +271,24 @@ void FifoPlayer::WriteAllMemoryUpdates()
 
 	for (int frameNum = 0; frameNum < m_File->GetFrameCount(); ++frameNum)
 	{
-		const FifoFrameInfo &frame = m_File->GetFrame(frameNum);
-		for (auto& update : frame.memoryUpdates)
+		std::shared_ptr<const FifoFrameInfo> frame = m_File->GetFrame(frameNum);
+		for (auto& update : frame->memoryUpdates)
 		{
-			WriteMemory(update);
+			WriteMemory(update.address, update.data, update.size);
 		}
 	}
 }
 
-void FifoPlayer::WriteMemory(const MemoryUpdate& memUpdate)
+void FifoPlayer::WriteMemory(u32 address, const u8 *data, u32 size)
 {
 	u8 *mem = NULL;
 
-	if (memUpdate.address & 0x10000000)
-		mem = &Memory::m_pEXRAM[memUpdate.address & Memory::EXRAM_MASK];
+	if (address & 0x10000000)
+		mem = &Memory::m_pEXRAM[address & Memory::EXRAM_MASK];
 	else
-		mem = &Memory::m_pRAM[memUpdate.address & Memory::RAM_MASK];
+		mem = &Memory::m_pRAM[address & Memory::RAM_MASK];
 
-	memcpy(mem, memUpdate.data, memUpdate.size);
+	memcpy(mem, data, size);
 }
 
 void FifoPlayer::WriteFifo(u8 *data, u32 start, u32 end)
@@ -312,7 +321,8 @@ void FifoPlayer::SetupFifo()
 	WriteCP(0x02, 0);	// disable read, BP, interrupts
 	WriteCP(0x04, 7);	// clear overflow, underflow, metrics
 
-	const FifoFrameInfo& frame = m_File->GetFrame(m_CurrentFrame);
+	std::shared_ptr<const FifoFrameInfo> framePtr = m_File->GetFrame(m_CurrentFrame);
+	const FifoFrameInfo& frame = *framePtr;
 
 	// Set fifo bounds
 	WriteCP(0x20, frame.fifoStart);
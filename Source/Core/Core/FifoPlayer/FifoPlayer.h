@@ -51,9 +51,14 @@ public:
 	// Default is disabled
 	void SetEarlyMemoryUpdates(bool enabled) { m_EarlyMemoryUpdates = enabled; }
 
+	// Number of times the frame range is played before stopping
+	// Default is 0, which loops forever if LoopReplay is set and plays once otherwise
+	void SetLoopCount(u32 count) { m_LoopCount = count; }
+
 	// Callbacks
 	void SetFileLoadedCallback(CallbackFunc callback) { m_FileLoadedCb = callback; }
 	void SetFrameWrittenCallback(CallbackFunc callback) { m_FrameWrittenCb = callback; }
+	void SetFrameFinishedCallback(CallbackFunc callback) { m_FrameFinishedCb = callback; }
 
 	static FifoPlayer &GetInstance();
 
@@ -64,7 +69,7 @@ private:
 	void WriteFramePart(u32 dataStart, u32 dataEnd, u32 &nextMemUpdate, const FifoFrameInfo &frame, const AnalyzedFrameInfo &info);
 
 	void WriteAllMemoryUpdates();
-	void WriteMemory(const MemoryUpdate &memUpdate);
+	void WriteMemory(u32 address, const u8 *data, u32 size);
 
 	// writes a range of data to the fifo
 	// start and end must be relative to frame's fifo data so elapsed cycles are figured correctly
@@ -87,6 +92,8 @@ private:
 	bool ShouldLoadBP(u8 address);
 
 	bool m_Loop;
+	u32 m_LoopCount;
+	u32 m_LoopsPlayed;
 
 	u32 m_CurrentFrame;
 	u32 m_FrameRangeStart;
@@ -103,6 +110,7 @@ private:
 
 	CallbackFunc m_FileLoadedCb;
 	CallbackFunc m_FrameWrittenCb;
+	CallbackFunc m_FrameFinishedCb;
 
 	FifoDataFile *m_File;
 
@@ -50,6 +50,8 @@ This file mainly deals with the [Drive I/F], however [AIDFR] controls
   TODO maybe the files should be merged?
 */
 
+#include <algorithm>
+
 #include "Common.h"
 
 #include "StreamADPCM.h"
@@ -61,6 +63,7 @@ This file mainly deals with the [Drive I/F], however [AIDFR] controls
 #include "../PowerPC/PowerPC.h"
 #include "../CoreTiming.h"
 #include "SystemTimers.h"
+#include "AudioCommon.h"
 
 namespace AudioInterface
 {
@@ -129,6 +132,9 @@ static u64 g_CPUCyclesPerSample = 0xFFFFFFFFFFFULL;
 static unsigned int g_AISSampleRate = 48000;
 static unsigned int g_AIDSampleRate = 32000;
 
+// Streamed audio is handed to the mixer in chunks of at most this many samples
+static const u64 STREAMING_CHUNK_SAMPLES = 256;
+
 void DoState(PointerWrap &p)
 {
 	p.DoPOD(m_Control);
@@ -146,6 +152,7 @@ static void UpdateInterrupts();
 static void IncreaseSampleCount(const u32 _uAmount);
 void ReadStreamBlock(s16* _pPCM);
 u64 GetAIPeriod();
+static int GetUpdatePeriod();
 int et_AI;
 
 void Init()
@@ -239,7 +246,7 @@ void Write32(const u32 _Value, const u32 _Address)
 				DVDInterface::g_bStream = tmpAICtrl.PSTAT;
 
 				CoreTiming::RemoveEvent(et_AI);
-				CoreTiming::ScheduleEvent(((int)GetAIPeriod() / 2), et_AI);
+				CoreTiming::ScheduleEvent(GetUpdatePeriod(), et_AI);
 			}
 
 			// AI Interrupt
@@ -276,7 +283,7 @@ void Write32(const u32 _Value, const u32 _Address)
 	case AI_INTERRUPT_TIMING:
 		m_InterruptTiming = _Value;
 		CoreTiming::RemoveEvent(et_AI);
-		CoreTiming::ScheduleEvent(((int)GetAIPeriod() / 2), et_AI);
+		CoreTiming::ScheduleEvent(GetUpdatePeriod(), et_AI);
 		DEBUG_LOG(AUDIO_INTERFACE, "Set interrupt: %08x samples", m_InterruptTiming);
 		break;
 
@@ -310,117 +317,40 @@ void Callback_GetSampleRate(unsigned int &_AISampleRate, unsigned int &_DACSampl
 	_DACSampleRate = g_AIDSampleRate;
 }
 
-// Callback for the disc streaming
-// WARNING - called from audio thread
-unsigned int Callback_GetStreaming(short* _pDestBuffer, unsigned int _numSamples, unsigned int _sampleRate)
+// Decodes the disc streaming samples played since the last update and hands
+// them to the mixer, which resamples them on the sound thread
+static void GenerateStreamingSamples(u32 _numSamples)
 {
-	if (m_Control.PSTAT && !CCPU::IsStepping())
+	static int pos = 0;
+	static short pcm[NGCADPCM::SAMPLES_PER_BLOCK*2];
+	short buffer[STREAMING_CHUNK_SAMPLES*2];
+	const int lvolume = m_Volume.left;
+	const int rvolume = m_Volume.right;
+
+	CMixer *pMixer = soundStream ? soundStream->GetMixer() : NULL;
+	u32 count = 0;
+	for (u32 i = 0; i < _numSamples; i++)
 	{
-		static int pos = 0;
-		static short pcm[NGCADPCM::SAMPLES_PER_BLOCK*2];
-		const int lvolume = m_Volume.left;
-		const int rvolume = m_Volume.right;
-
-		if (g_AISSampleRate == 48000 && _sampleRate == 32000)
-		{
-			_dbg_assert_msg_(AUDIO_INTERFACE, !(_numSamples & 1), "Number of Samples: %i must be even!", _numSamples);
-			_numSamples = _numSamples * 3 / 2;
-		}
-
-		int pcm_l = 0, pcm_r = 0;
-		for (unsigned int i = 0; i < _numSamples; i++)
-		{
-			if (pos == 0)
-				ReadStreamBlock(pcm);
-
-			if (g_AISSampleRate == 48000 && _sampleRate == 32000) //downsample 48>32
-			{
-				if (i % 3)
-				{
-					pcm_l = (((pcm_l + (int)pcm[pos*2]) / 2  * lvolume) >> 8) + (int)(*_pDestBuffer);
-					if (pcm_l > 32767)			pcm_l = 32767;
-					else if (pcm_l < -32767)	pcm_l = -32767;
-					*_pDestBuffer++ = pcm_l;
-
-					pcm_r = (((pcm_r + (int)pcm[pos*2+1]) / 2 * rvolume) >> 8) + (int)(*_pDestBuffer);
- 					if (pcm_r > 32767)			pcm_r = 32767;
-					else if (pcm_r < -32767)	pcm_r = -32767;
-					*_pDestBuffer++ = pcm_r;
-				}
-				pcm_l = pcm[pos*2];
-				pcm_r = pcm[pos*2+1];
-
-				pos++;
-			}
-			else if (g_AISSampleRate == 32000 && _sampleRate == 48000) //upsample 32>48
-			{
-				//starts with one sample of 0
-				const u32 ratio = (u32)( 65536.0f * 32000.0f / (float)_sampleRate );
-				static u32 frac = 0;
-
-				static s16 l1 = 0;
-				static s16 l2 = 0;
-
-				if ( frac >= 0x10000 || frac == 0)
-				{
-					frac &= 0xffff;
-
-					l1 = l2;		   //current
-					l2 = pcm[pos * 2]; //next
-				}
-
-				pcm_l = ((l1 << 16) + (l2 - l1) * (u16)frac)  >> 16;
-				pcm_r = ((l1 << 16) + (l2 - l1) * (u16)frac)  >> 16;
-
+		if (pos == 0)
+			ReadStreamBlock(pcm);
 
-				pcm_l = (pcm_l * lvolume >> 8) + (int)(*_pDestBuffer);
-				if (pcm_l > 32767)			pcm_l = 32767;
-				else if (pcm_l < -32767)	pcm_l = -32767;
-				*_pDestBuffer++ = pcm_l;
+		// The mixer takes samples the way the AI DMA reads them from RAM
+		buffer[count*2] = Common::swap16((s16)(((int)pcm[pos*2+1] * rvolume) >> 8));
+		buffer[count*2+1] = Common::swap16((s16)(((int)pcm[pos*2] * lvolume) >> 8));
 
-				pcm_r = (pcm_r * lvolume >> 8) + (int)(*_pDestBuffer);
-				if (pcm_r > 32767)			pcm_r = 32767;
-				else if (pcm_r < -32767)	pcm_r = -32767;
-				*_pDestBuffer++ = pcm_r;
+		if (++pos == NGCADPCM::SAMPLES_PER_BLOCK)
+			pos = 0;
 
-				frac += ratio;
-				pos += frac >> 16;
-
-			}
-			else //1:1 no resampling
-			{
-				pcm_l = (((int)pcm[pos*2] * lvolume) >> 8) + (int)(*_pDestBuffer);
-				if (pcm_l > 32767)		pcm_l = 32767;
-				else if (pcm_l < -32767)	pcm_l = -32767;
-				*_pDestBuffer++ = pcm_l;
-
-				pcm_r = (((int)pcm[pos*2+1] * rvolume) >> 8) + (int)(*_pDestBuffer);
-				if (pcm_r > 32767)		pcm_r = 32767;
-				else if (pcm_r < -32767)	pcm_r = -32767;
-				*_pDestBuffer++ = pcm_r;
-
-				pos++;
-			}
-
-			if (pos == NGCADPCM::SAMPLES_PER_BLOCK)
-				pos = 0;
-		}
-	}
-	else
-	{
-		// Don't overwrite existed sample data
-		/*
-		for (unsigned int i = 0; i < _numSamples * 2; i++)
+		if (++count == STREAMING_CHUNK_SAMPLES || i + 1 == _numSamples)
 		{
-			_pDestBuffer[i] = 0; //silence!
+			if (pMixer)
+				pMixer->PushStreamingSamples(buffer, count, g_AISSampleRate);
+			count = 0;
 		}
-		*/
 	}
-
-	return _numSamples;
 }
 
-// WARNING - called from audio thread
+// Called from the CPU thread
 void ReadStreamBlock(s16 *_pPCM)
 {
 	u8 tempADPCM[NGCADPCM::ONE_BLOCK_SIZE];
@@ -463,9 +393,10 @@ void Update(u64 userdata, int cyclesLate)
 		{
 			const u32 Samples = static_cast<u32>(Diff / g_CPUCyclesPerSample);
 			g_LastCPUTime += Samples * g_CPUCyclesPerSample;
+			GenerateStreamingSamples(Samples);
 			IncreaseSampleCount(Samples);
 		}
-		CoreTiming::ScheduleEvent(((int)GetAIPeriod() / 2) - cyclesLate, et_AI);
+		CoreTiming::ScheduleEvent(GetUpdatePeriod() - cyclesLate, et_AI);
 	}
 }
 
@@ -477,4 +408,11 @@ u64 GetAIPeriod()
 	return period;
 }
 
+// Half the interrupt period, but streamed audio is only decoded on updates,
+// so they also have to come often enough to keep the mixer fed
+static int GetUpdatePeriod()
+{
+	return (int)std::min(GetAIPeriod() / 2, STREAMING_CHUNK_SAMPLES * g_CPUCyclesPerSample);
+}
+
 } // end of namespace AudioInterface
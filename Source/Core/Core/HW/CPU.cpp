@@ -4,6 +4,7 @@
 
 #include "Common.h"
 #include "Thread.h"
+#include "Atomic.h"
 
 #include "../DSPEmulator.h"
 #include "../PowerPC/PowerPC.h"
@@ -20,6 +21,17 @@ namespace
 	static Common::Event m_StepEvent;
 	static Common::Event *m_SyncEvent = NULL;
 	static std::mutex m_csCpuOccupied;
+	static void (*m_SafePointCallback)() = NULL;
+
+	static void RunSafePointCallback()
+	{
+		if (m_SafePointCallback)
+		{
+			void (*callback)() = m_SafePointCallback;
+			m_SafePointCallback = NULL;
+			callback();
+		}
+	}
 }
 
 void CCPU::Init(int cpu_core)
@@ -49,7 +61,17 @@ reswitch:
 			PowerPC::RunLoop();
 			break;
 
+		case PowerPC::CPU_SAFE_POINT:
+			// Go on running, unless a pause or a stop came in since
+			Common::AtomicCompareExchange(*(volatile u32 *)PowerPC::GetStatePtr(),
+				PowerPC::CPU_SAFE_POINT, PowerPC::CPU_RUNNING);
+			RunSafePointCallback();
+			break;
+
 		case PowerPC::CPU_STEPPING:
+			// A safe point requested before the pause still runs
+			RunSafePointCallback();
+
 			m_csCpuOccupied.unlock();
 
 			//1: wait for step command..
@@ -128,6 +150,15 @@ void CCPU::Break()
 	EnableStepping(true);
 }
 
+void CCPU::RunAtSafePoint(void (*callback)())
+{
+	m_SafePointCallback = callback;
+	// Only makes the core's Run() return. A pause or a stop that was already
+	// requested isn't overwritten, Run() calls the callback before it waits.
+	Common::AtomicCompareExchange(*(volatile u32 *)PowerPC::GetStatePtr(),
+		PowerPC::CPU_RUNNING, PowerPC::CPU_SAFE_POINT);
+}
+
 bool CCPU::PauseAndLock(bool doLock, bool unpauseOnUnlock)
 {
 	bool wasUnpaused = !IsStepping();
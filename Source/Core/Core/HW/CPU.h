@@ -50,6 +50,11 @@ public:
 	// e.g. when the GUI thread wants to make sure everything is paused so that it can create a savestate.
 	// the return value is whether the cpu was unpaused before the call.
 	static bool PauseAndLock(bool doLock, bool unpauseOnUnlock=true);
+
+	// makes the cpu core return at the end of the current block and calls callback,
+	// then carries on running. the callback runs on the cpu thread with the core
+	// stopped, so it can save and load states. only for the cpu thread itself.
+	static void RunAtSafePoint(void (*callback)());
 };
 
 #endif
@@ -799,10 +799,22 @@ unsigned int GetTicksPerFrame()
 	return TicksPerFrame;
 }
 
+u32 GetXFBWidth()
+{
+	return m_HorizontalStepping.FieldSteps * 16;
+}
+
+u32 GetXFBHeight()
+{
+	if (!m_HorizontalStepping.FieldSteps)
+		return 0;
+	return (m_HorizontalStepping.FbSteps / m_HorizontalStepping.FieldSteps) * m_VerticalTimingRegister.ACV;
+}
+
 static void BeginField(FieldType field)
 {
-	u32 fbWidth = m_HorizontalStepping.FieldSteps * 16;
-	u32 fbHeight = (m_HorizontalStepping.FbSteps / m_HorizontalStepping.FieldSteps) * m_VerticalTimingRegister.ACV;
+	u32 fbWidth = GetXFBWidth();
+	u32 fbHeight = GetXFBHeight();
 	u32 xfbAddr;
 
 	// NTSC and PAL have opposite field orders.
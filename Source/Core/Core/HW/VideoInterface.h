@@ -336,6 +336,10 @@ union UVIDTVStatus
 	u32 GetXFBAddressTop();
 	u32 GetXFBAddressBottom();
 
+	// size in pixels of a field of the xfb
+	u32 GetXFBWidth();
+	u32 GetXFBHeight();
+
 	// Update and draw framebuffer
 	void Update();
 
@@ -2,7 +2,10 @@
 // Licensed under GPLv2
 // Refer to the license.txt file included.
 
+#include <algorithm>
+
 #include "WiimoteEmu.h"
+#include "AudioCommon.h"
 
 //#define WIIMOTE_SPEAKER_DUMP
 #ifdef WIIMOTE_SPEAKER_DUMP
@@ -65,14 +68,20 @@ void Wiimote::SpeakerData(wm_speaker_data* sd)
 {
 	// TODO consider using static max size instead of new
 	s16 *samples = new s16[sd->length * 2];
+	unsigned int num_samples = 0;
+	unsigned int sample_rate_dividend = 0;
+	int volume_divisor = 1;
 
 	if (m_reg_speaker.format == 0x40)
 	{
 		// 8 bit PCM
 		for (int i = 0; i < sd->length; ++i)
 		{
-			samples[i] = (s16)(s8)sd->data[i];
+			samples[i] = (s16)(s8)sd->data[i] << 8;
 		}
+		num_samples = sd->length;
+		sample_rate_dividend = 12000000;
+		volume_divisor = 0xff;
 	}
 	else if (m_reg_speaker.format == 0x00)
 	{
@@ -82,6 +91,24 @@ void Wiimote::SpeakerData(wm_speaker_data* sd)
 			samples[i * 2] = adpcm_yamaha_expand_nibble(m_adpcm_state, (sd->data[i] >> 4) & 0xf);
 			samples[i * 2 + 1] = adpcm_yamaha_expand_nibble(m_adpcm_state, sd->data[i] & 0xf);
 		}
+		num_samples = sd->length * 2;
+		sample_rate_dividend = 6000000;
+		volume_divisor = 0x7f;
+	}
+
+	// The mixer takes big endian stereo, the way the AI DMA reads it
+	if (num_samples && m_reg_speaker.sample_rate && !m_speaker_mute && soundStream)
+	{
+		s16 *stereo = new s16[num_samples * 2];
+		for (unsigned int i = 0; i < num_samples; ++i)
+		{
+			s16 sample = (s16)(samples[i] * std::min<int>(m_reg_speaker.volume, volume_divisor) / volume_divisor);
+			stereo[i * 2] = stereo[i * 2 + 1] = Common::swap16(sample);
+		}
+		// The register divides the speaker clock, games sound right at twice that rate
+		unsigned int sample_rate = sample_rate_dividend / m_reg_speaker.sample_rate;
+		soundStream->GetMixer()->PushWiimoteSpeakerSamples(stereo, num_samples, sample_rate * 2);
+		delete[] stereo;
 	}
 
 #ifdef WIIMOTE_SPEAKER_DUMP
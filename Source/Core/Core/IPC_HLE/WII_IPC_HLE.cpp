@@ -267,6 +267,18 @@ void DoState(PointerWrap &p)
 	p.Do(reply_queue);
 	p.Do(last_reply_time);
 
+	if (p.GetMode() == PointerWrap::MODE_READ)
+	{
+		// Close the files of the current fds first, so the restored fds don't
+		// share their host handles and /dev/fs can replace /tmp
+		for (u32 i = 0; i < IPC_MAX_FDS; i++)
+		{
+			if (g_FdMap[i] != NULL && !g_FdMap[i]->IsHardware())
+				delete g_FdMap[i];
+			g_FdMap[i] = NULL;
+		}
+	}
+
 	TDeviceMap::const_iterator itr;
 
 	itr = g_DeviceMap.begin();
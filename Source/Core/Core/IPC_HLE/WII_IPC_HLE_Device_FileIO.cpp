@@ -3,18 +3,25 @@
 // Refer to the license.txt file included.
 
 #include "Common.h"
+#include "CommonPaths.h"
 #include "FileUtil.h"
 #include "StringUtil.h"
 #include "ChunkFile.h"
+#include "ConfigManager.h"
 
 #include "WII_IPC_HLE_Device_fs.h"
 #include "WII_IPC_HLE_Device_FileIO.h"
 #include "NandPaths.h"
 #include <algorithm>
+#include <map>
 
 
 static Common::replace_v replacements;
 
+// The host handles of the open files, by path. Every fd on a file uses the
+// same handle, so they see each other's writes even when they are buffered.
+static std::map<std::string, std::weak_ptr<File::IOFile>> openFiles;
+
 // This is used by several of the FileIO and /dev/fs functions
 std::string HLE_IPC_BuildFilename(std::string path_wii, int _size)
 {
@@ -32,6 +39,29 @@ std::string HLE_IPC_BuildFilename(std::string path_wii, int _size)
 	return path_full;
 }
 
+// Closes the host handles of the file or directory at path, and of every file
+// under it, before /dev/fs deletes or replaces them. The fds that are still
+// open on them fail from then on, a new fd gets a new handle.
+static void CloseOpenFile(std::map<std::string, std::weak_ptr<File::IOFile>>::iterator it)
+{
+	std::shared_ptr<File::IOFile> file = it->second.lock();
+	if (file)
+		file->Close();
+	openFiles.erase(it);
+}
+
+void HLE_IPC_CloseOpenFiles(const std::string& path)
+{
+	std::map<std::string, std::weak_ptr<File::IOFile>>::iterator it = openFiles.find(path);
+	if (it != openFiles.end())
+		CloseOpenFile(it);
+
+	const std::string dir = path + DIR_SEP;
+	it = openFiles.lower_bound(dir);
+	while (it != openFiles.end() && it->first.compare(0, dir.size(), dir) == 0)
+		CloseOpenFile(it++);
+}
+
 void HLE_IPC_CreateVirtualFATFilesystem()
 {
 	const int cdbSize = 0x01400000;
@@ -75,12 +105,14 @@ CWII_IPC_HLE_Device_FileIO::CWII_IPC_HLE_Device_FileIO(u32 _DeviceID, const std:
 
 CWII_IPC_HLE_Device_FileIO::~CWII_IPC_HLE_Device_FileIO()
 {
+	CloseFile();
 }
 
 bool CWII_IPC_HLE_Device_FileIO::Close(u32 _CommandAddress, bool _bForce)
 {
 	INFO_LOG(WII_IPC_FILEIO, "FileIO: Close %s (DeviceID=%08x)", m_Name.c_str(), m_DeviceID);
 	m_Mode = 0;
+	CloseFile();
 
 	// Close always return 0 for success
 	if (_CommandAddress && !_bForce)
@@ -110,6 +142,7 @@ bool CWII_IPC_HLE_Device_FileIO::Open(u32 _CommandAddress, u32 _Mode)
 	{
 		INFO_LOG(WII_IPC_FILEIO, "FileIO: Open %s (%s == %08X)", m_Name.c_str(), Modes[_Mode], _Mode);
 		ReturnValue = m_DeviceID;
+		OpenFile();
 	}
 	else
 	{
@@ -123,27 +156,48 @@ bool CWII_IPC_HLE_Device_FileIO::Open(u32 _CommandAddress, u32 _Mode)
 	return true;
 }
 
-File::IOFile CWII_IPC_HLE_Device_FileIO::OpenFile()
+void CWII_IPC_HLE_Device_FileIO::OpenFile()
 {
-	const char* open_mode = "";
-
-	switch (m_Mode)
+	if (m_Mode != ISFS_OPEN_READ && m_Mode != ISFS_OPEN_WRITE && m_Mode != ISFS_OPEN_RW)
 	{
-	case ISFS_OPEN_READ:
-		open_mode = "rb";
-		break;
+		PanicAlertT("FileIO: Unknown open mode : 0x%02x", m_Mode);
+		return;
+	}
 
-	case ISFS_OPEN_WRITE:
-	case ISFS_OPEN_RW:
-		open_mode = "r+b";
-		break;
+	std::weak_ptr<File::IOFile> &shared = openFiles[m_filepath];
+	m_file = shared.lock();
+	if (m_file)
+		return;
 
-	default:
-		PanicAlertT("FileIO: Unknown open mode : 0x%02x", m_Mode);
-		break;
+	// Read and Write check the emulated mode. The host handle is opened for
+	// writing whenever the host allows it, so every fd can share it.
+	m_file = std::make_shared<File::IOFile>(m_filepath, "r+b");
+	if (!m_file->IsOpen() && m_Mode == ISFS_OPEN_READ)
+		m_file->Open(m_filepath, "rb");
+
+	if (m_file->IsOpen())
+	{
+		shared = m_file;
 	}
+	else
+	{
+		m_file.reset();
+		openFiles.erase(m_filepath);
+	}
+}
+
+void CWII_IPC_HLE_Device_FileIO::CloseFile()
+{
+	if (!m_file)
+		return;
+
+	// Other fds may still use the handle, they should see everything that was written
+	m_file->Flush();
+	m_file.reset();
 
-	return File::IOFile(m_filepath, open_mode);
+	std::map<std::string, std::weak_ptr<File::IOFile>>::iterator it = openFiles.find(m_filepath);
+	if (it != openFiles.end() && it->second.expired())
+		openFiles.erase(it);
 }
 
 bool CWII_IPC_HLE_Device_FileIO::Seek(u32 _CommandAddress)
@@ -152,11 +206,11 @@ bool CWII_IPC_HLE_Device_FileIO::Seek(u32 _CommandAddress)
 	const s32 SeekPosition = Memory::Read_U32(_CommandAddress + 0xC);
 	const s32 Mode = Memory::Read_U32(_CommandAddress + 0x10);
 
-	if (auto file = OpenFile())
+	if (m_file)
 	{
 		ReturnValue = FS_RESULT_FATAL;
 
-		const s32 fileSize = (s32) file.GetSize();
+		const s32 fileSize = (s32) m_file->GetSize();
 		INFO_LOG(WII_IPC_FILEIO, "FileIO: Seek Pos: 0x%08x, Mode: %i (%s, Length=0x%08x)", SeekPosition, Mode, m_Name.c_str(), fileSize);
 
 		switch (Mode)
@@ -214,7 +268,7 @@ bool CWII_IPC_HLE_Device_FileIO::Read(u32 _CommandAddress)
 	const u32 Size	= Memory::Read_U32(_CommandAddress + 0x10);
 
 
-	if (auto file = OpenFile())
+	if (m_file)
 	{
 		if (m_Mode == ISFS_OPEN_WRITE)
 		{
@@ -223,9 +277,11 @@ bool CWII_IPC_HLE_Device_FileIO::Read(u32 _CommandAddress)
 		else
 		{
 			INFO_LOG(WII_IPC_FILEIO, "FileIO: Read 0x%x bytes to 0x%08x from %s", Size, Address, m_Name.c_str());
-			file.Seek(m_SeekPos, SEEK_SET);
-			ReturnValue = (u32)fread(Memory::GetPointer(Address), 1, Size, file.GetHandle());
-			if (ReturnValue != Size && ferror(file.GetHandle()))
+			// The handle outlives the request, an earlier error shouldn't stick
+			m_file->Clear();
+			m_file->Seek(m_SeekPos, SEEK_SET);
+			ReturnValue = (u32)fread(Memory::GetPointer(Address), 1, Size, m_file->GetHandle());
+			if (ReturnValue != Size && ferror(m_file->GetHandle()))
 			{
 				ReturnValue = FS_EACCESS;
 			}
@@ -253,7 +309,7 @@ bool CWII_IPC_HLE_Device_FileIO::Write(u32 _CommandAddress)
 	const u32 Size	= Memory::Read_U32(_CommandAddress + 0x10);
 
 
-	if (auto file = OpenFile())
+	if (m_file)
 	{
 		if (m_Mode == ISFS_OPEN_READ)
 		{
@@ -262,11 +318,17 @@ bool CWII_IPC_HLE_Device_FileIO::Write(u32 _CommandAddress)
 		else
 		{
 			INFO_LOG(WII_IPC_FILEIO, "FileIO: Write 0x%04x bytes from 0x%08x to %s", Size, Address, m_Name.c_str());
-			file.Seek(m_SeekPos, SEEK_SET);
-			if (file.WriteBytes(Memory::GetPointer(Address), Size))
+			m_file->Clear();
+			m_file->Seek(m_SeekPos, SEEK_SET);
+			if (m_file->WriteBytes(Memory::GetPointer(Address), Size))
 			{
 				ReturnValue = Size;
 				m_SeekPos += Size;
+				HLE_IPC_NANDIndexFileWritten(m_filepath, m_SeekPos);
+
+				// Unless write back is enabled, /dev/fs sees the new contents right away
+				if (!SConfig::GetInstance().m_NANDWriteBack)
+					m_file->Flush();
 			}
 		}
 	}
@@ -293,9 +355,9 @@ bool CWII_IPC_HLE_Device_FileIO::IOCtl(u32 _CommandAddress)
 	{
 	case ISFS_IOCTL_GETFILESTATS:
 		{
-			if (auto file = OpenFile())
+			if (m_file)
 			{
-				u32 m_FileLength = (u32)file.GetSize();
+				u32 m_FileLength = (u32)m_file->GetSize();
 
 				const u32 BufferOut = Memory::Read_U32(_CommandAddress + 0x18);
 				INFO_LOG(WII_IPC_FILEIO, "  File: %s, Length: %i, Pos: %i", m_Name.c_str(), m_FileLength, m_SeekPos);
@@ -330,5 +392,15 @@ void CWII_IPC_HLE_Device_FileIO::DoState(PointerWrap &p)
 	p.Do(m_Mode);
 	p.Do(m_SeekPos);
 
-	m_filepath = HLE_IPC_BuildFilename(m_Name, 64);
+	// The NAND isn't in the state, the host file has to be up to date when it is saved
+	if (m_file)
+		m_file->Flush();
+
+	if (p.GetMode() == PointerWrap::MODE_READ)
+	{
+		CloseFile();
+		m_filepath = HLE_IPC_BuildFilename(m_Name, 64);
+		if (m_Mode != 0 && File::Exists(m_filepath))
+			OpenFile();
+	}
 }
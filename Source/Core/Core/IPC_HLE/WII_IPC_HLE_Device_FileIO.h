@@ -5,10 +5,13 @@
 #ifndef _WII_IPC_HLE_DEVICE_FILEIO_H_
 #define _WII_IPC_HLE_DEVICE_FILEIO_H_
 
+#include <memory>
+
 #include "WII_IPC_HLE_Device.h"
 #include "FileUtil.h"
 
 std::string HLE_IPC_BuildFilename(std::string _pFilename, int _size);
+void HLE_IPC_CloseOpenFiles(const std::string& path);
 void HLE_IPC_CreateVirtualFATFilesystem();
 
 class CWII_IPC_HLE_Device_FileIO : public IWII_IPC_HLE_Device
@@ -26,7 +29,8 @@ public:
 	bool IOCtl(u32 _CommandAddress);
 	void DoState(PointerWrap &p);
 
-	File::IOFile OpenFile();
+	void OpenFile();
+	void CloseFile();
 
 private:
 	enum
@@ -66,6 +70,8 @@ private:
 	u32 m_SeekPos;
 
 	std::string m_filepath;
+	// Kept open until the fd is closed, and shared with every other fd on the same file
+	std::shared_ptr<File::IOFile> m_file;
 };
 
 #endif
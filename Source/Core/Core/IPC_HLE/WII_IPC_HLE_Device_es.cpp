@@ -34,6 +34,7 @@
 // =============
 
 #include "WII_IPC_HLE_Device_es.h"
+#include "WII_IPC_HLE_Device_fs.h"
 
 // need to include this before polarssl/aes.h,
 // otherwise we may not get __STDC_FORMAT_MACROS
@@ -764,6 +765,7 @@ bool CWII_IPC_HLE_Device_es::IOCtlV(u32 _CommandAddress)
 			INFO_LOG(WII_IPC_ES, "IOCTL_ES_DELETETICKET: title: %08x/%08x", (u32)(TitleID >> 32), (u32)TitleID);
 			if (File::Delete(Common::GetTicketFileName(TitleID)))
 			{
+				HLE_IPC_InvalidateNANDIndex(Common::GetTicketFileName(TitleID));
 				Memory::Write_U32(0, _CommandAddress + 0x4);
 			}
 			else
@@ -1159,5 +1161,7 @@ u32 CWII_IPC_HLE_Device_es::ES_DIVerify(u8* _pTMD, u32 _sz)
 			ERROR_LOG(WII_IPC_ES, "DIVerify failed to write disc TMD to NAND.");
 	}
 	DiscIO::cUIDsys::AccessInstance().AddTitle(tmdTitleID);
+	// The title directories were created and the save may have been moved above, once per boot
+	HLE_IPC_ClearNANDIndex();
 	return 0;
 }
@@ -2,6 +2,10 @@
 // Licensed under GPLv2
 // Refer to the license.txt file included.
 
+#include <map>
+#include <set>
+#include <vector>
+
 #include "Common.h"
 #include "CommonPaths.h"
 
@@ -9,7 +13,6 @@
 #include "WII_IPC_HLE_Device_FileIO.h"
 
 #include "StringUtil.h"
-#include "FileSearch.h"
 #include "FileUtil.h"
 #include "NandPaths.h"
 #include "ChunkFile.h"
@@ -21,6 +24,242 @@
 
 static Common::replace_v replacements;
 
+// What the index knows about one file or directory of the NAND on the host.
+// Entries are keyed by host path; an entry is only kept while it matches the
+// host, and while a directory is indexed so are all its children.
+struct NANDIndexEntry
+{
+	bool isDirectory;
+	u64 size;		// file length, or total length of the files below a directory
+	u32 iNodes;		// 1, plus the inodes below a directory
+	std::set<std::string> children;	// host names
+};
+
+static std::map<std::string, NANDIndexEntry> s_NANDIndex;
+
+// Drops repeated and trailing separators so every spelling of a path finds the same entry
+static std::string NANDIndexKey(const std::string& path)
+{
+	std::string key;
+	key.reserve(path.size());
+	for (char c : path)
+	{
+		if (c != DIR_SEP_CHR || key.empty() || key[key.size() - 1] != DIR_SEP_CHR)
+			key += c;
+	}
+	if (key.size() > 1 && key[key.size() - 1] == DIR_SEP_CHR)
+		key.erase(key.size() - 1);
+	return key;
+}
+
+static std::string NANDIndexParent(const std::string& key)
+{
+	size_t pos = key.rfind(DIR_SEP_CHR);
+	if (pos == std::string::npos || pos == 0)
+		return std::string();
+	return key.substr(0, pos);
+}
+
+static std::string NANDIndexName(const std::string& key)
+{
+	return key.substr(key.rfind(DIR_SEP_CHR) + 1);
+}
+
+// The entries below key, in the order of the map
+static std::map<std::string, NANDIndexEntry>::iterator NANDIndexSubtreeBegin(const std::string& key)
+{
+	return s_NANDIndex.lower_bound(key + DIR_SEP_CHR);
+}
+
+static std::map<std::string, NANDIndexEntry>::iterator NANDIndexSubtreeEnd(const std::string& key)
+{
+	return s_NANDIndex.lower_bound(key + (char)(DIR_SEP_CHR + 1));
+}
+
+// Adds the size and inode changes of key to the indexed directories above it
+static void NANDIndexPropagate(const std::string& key, s64 size, s32 iNodes)
+{
+	for (std::string parent = NANDIndexParent(key); !parent.empty(); parent = NANDIndexParent(parent))
+	{
+		std::map<std::string, NANDIndexEntry>::iterator it = s_NANDIndex.find(parent);
+		if (it == s_NANDIndex.end())
+			break;
+		it->second.size += size;
+		it->second.iNodes += iNodes;
+	}
+}
+
+static void NANDIndexTree(const std::string& key, const File::FSTEntry& tree, NANDIndexEntry& entry)
+{
+	entry.isDirectory = true;
+	entry.size = 0;
+	entry.iNodes = 1;
+	entry.children.clear();
+	for (const auto& child : tree.children)
+	{
+		std::string childKey = key + DIR_SEP + child.virtualName;
+		NANDIndexEntry& childEntry = s_NANDIndex[childKey];
+		if (child.isDirectory)
+		{
+			NANDIndexTree(childKey, child, childEntry);
+		}
+		else
+		{
+			childEntry.isDirectory = false;
+			childEntry.size = child.size;
+			childEntry.iNodes = 1;
+			childEntry.children.clear();
+		}
+		entry.size += childEntry.size;
+		entry.iNodes += childEntry.iNodes;
+		entry.children.insert(child.virtualName);
+	}
+}
+
+// Returns the entry of path, scanning it on the host the first time.
+// NULL if it doesn't exist.
+static const NANDIndexEntry* NANDIndexLookup(const std::string& path)
+{
+	std::string key(NANDIndexKey(path));
+	std::map<std::string, NANDIndexEntry>::iterator it = s_NANDIndex.find(key);
+	if (it != s_NANDIndex.end())
+		return &it->second;
+
+	if (!File::Exists(key))
+		return NULL;
+
+	NANDIndexEntry& entry = s_NANDIndex[key];
+	if (File::IsDirectory(key))
+	{
+		// Entries left below it by an invalidation may be out of date
+		s_NANDIndex.erase(NANDIndexSubtreeBegin(key), NANDIndexSubtreeEnd(key));
+		File::FSTEntry tree;
+		File::ScanDirectoryTree(key, tree);
+		NANDIndexTree(key, tree, entry);
+	}
+	else
+	{
+		entry.isDirectory = false;
+		entry.size = File::GetSize(key);
+		entry.iNodes = 1;
+	}
+
+	// An indexed parent has to list it, the host changed behind its back
+	it = s_NANDIndex.find(NANDIndexParent(key));
+	if (it != s_NANDIndex.end())
+	{
+		it->second.children.insert(NANDIndexName(key));
+		NANDIndexPropagate(key, entry.size, entry.iNodes);
+	}
+	return &entry;
+}
+
+// Records a file or directory that was just created on the host, together
+// with the parent directories CreateFullPath made for it
+static void NANDIndexAdd(const std::string& key)
+{
+	if (s_NANDIndex.count(key))
+		return;
+
+	std::string parent = NANDIndexParent(key);
+	if (parent.empty())
+		return;
+	NANDIndexAdd(parent);
+	std::map<std::string, NANDIndexEntry>::iterator it = s_NANDIndex.find(parent);
+	if (it == s_NANDIndex.end())
+		return;
+
+	NANDIndexEntry& entry = s_NANDIndex[key];
+	entry.isDirectory = File::IsDirectory(key);
+	entry.size = entry.isDirectory ? 0 : File::GetSize(key);
+	entry.iNodes = 1;
+	it->second.children.insert(NANDIndexName(key));
+	NANDIndexPropagate(key, entry.size, entry.iNodes);
+}
+
+// Forgets path, everything below it and the directories above it, for
+// changes the index can't follow
+static void NANDIndexInvalidate(const std::string& key)
+{
+	s_NANDIndex.erase(NANDIndexSubtreeBegin(key), NANDIndexSubtreeEnd(key));
+	s_NANDIndex.erase(key);
+	for (std::string parent = NANDIndexParent(key); !parent.empty(); parent = NANDIndexParent(parent))
+		s_NANDIndex.erase(parent);
+}
+
+// Records a file or directory that was just deleted on the host
+static void NANDIndexRemove(const std::string& key)
+{
+	std::map<std::string, NANDIndexEntry>::iterator it = s_NANDIndex.find(key);
+	if (it == s_NANDIndex.end())
+	{
+		NANDIndexInvalidate(key);
+		return;
+	}
+
+	NANDIndexPropagate(key, -(s64)it->second.size, -(s32)it->second.iNodes);
+	std::map<std::string, NANDIndexEntry>::iterator parent = s_NANDIndex.find(NANDIndexParent(key));
+	if (parent != s_NANDIndex.end())
+		parent->second.children.erase(NANDIndexName(key));
+	s_NANDIndex.erase(NANDIndexSubtreeBegin(key), NANDIndexSubtreeEnd(key));
+	s_NANDIndex.erase(it);
+}
+
+// Records a file or directory that was just renamed on the host
+static void NANDIndexMove(const std::string& from, const std::string& to)
+{
+	std::map<std::string, NANDIndexEntry>::iterator it = s_NANDIndex.find(from);
+	if (it == s_NANDIndex.end())
+	{
+		NANDIndexInvalidate(from);
+		NANDIndexInvalidate(to);
+		return;
+	}
+
+	std::vector<std::pair<std::string, NANDIndexEntry>> moved;
+	moved.push_back(std::make_pair(to, it->second));
+	for (std::map<std::string, NANDIndexEntry>::iterator child = NANDIndexSubtreeBegin(from);
+		child != NANDIndexSubtreeEnd(from); ++child)
+	{
+		moved.push_back(std::make_pair(to + child->first.substr(from.size()), child->second));
+	}
+	NANDIndexRemove(from);
+
+	std::string parentKey = NANDIndexParent(to);
+	NANDIndexAdd(parentKey);
+	std::map<std::string, NANDIndexEntry>::iterator parent = s_NANDIndex.find(parentKey);
+	if (parent == s_NANDIndex.end())
+		return;
+
+	// The rename replaced whatever was at to
+	if (s_NANDIndex.count(to))
+		NANDIndexRemove(to);
+
+	s_NANDIndex.insert(moved.begin(), moved.end());
+	parent->second.children.insert(NANDIndexName(to));
+	NANDIndexPropagate(to, moved[0].second.size, moved[0].second.iNodes);
+}
+
+void HLE_IPC_ClearNANDIndex()
+{
+	s_NANDIndex.clear();
+}
+
+void HLE_IPC_InvalidateNANDIndex(const std::string& path)
+{
+	NANDIndexInvalidate(NANDIndexKey(path));
+}
+
+void HLE_IPC_NANDIndexFileWritten(const std::string& path, u64 end)
+{
+	std::map<std::string, NANDIndexEntry>::iterator it = s_NANDIndex.find(NANDIndexKey(path));
+	if (it == s_NANDIndex.end() || it->second.isDirectory || end <= it->second.size)
+		return;
+
+	NANDIndexPropagate(it->first, end - it->second.size, 0);
+	it->second.size = end;
+}
+
 
 CWII_IPC_HLE_Device_fs::CWII_IPC_HLE_Device_fs(u32 _DeviceID, const std::string& _rDeviceName)
 	: IWII_IPC_HLE_Device(_DeviceID, _rDeviceName)
@@ -36,10 +275,14 @@ bool CWII_IPC_HLE_Device_fs::Open(u32 _CommandAddress, u32 _Mode)
 	// clear tmp folder
 	{
 		std::string Path = File::GetUserPath(D_WIIUSER_IDX) + "tmp";
+		HLE_IPC_CloseOpenFiles(Path);
 		File::DeleteDirRecursively(Path);
 		File::CreateDir(Path.c_str());
 	}
 
+	// Start over from the host, the NAND could have been changed since the last boot
+	HLE_IPC_ClearNANDIndex();
+
 	Memory::Write_U32(GetDeviceID(), _CommandAddress+4);
 	m_Active = true;
 	return true;
@@ -54,22 +297,6 @@ bool CWII_IPC_HLE_Device_fs::Close(u32 _CommandAddress, bool _bForce)
 	return true;
 }
 
-// Get total filesize of contents of a directory (recursive)
-// Only used for ES_GetUsage atm, could be useful elsewhere?
-static u64 ComputeTotalFileSize(const File::FSTEntry& parentEntry)
-{
-	u64 sizeOfFiles = 0;
-	const std::vector<File::FSTEntry>& children = parentEntry.children;
-	for (const auto& entry : children)
-	{
-		if (entry.isDirectory)
-			sizeOfFiles += ComputeTotalFileSize(entry);
-		else
-			sizeOfFiles += entry.size;
-	}
-	return sizeOfFiles;
-}
-
 bool CWII_IPC_HLE_Device_fs::IOCtlV(u32 _CommandAddress)
 {
 	u32 ReturnValue = FS_RESULT_OK;
@@ -93,13 +320,14 @@ bool CWII_IPC_HLE_Device_fs::IOCtlV(u32 _CommandAddress)
 
 			INFO_LOG(WII_IPC_FILEIO, "FS: IOCTL_READ_DIR %s", DirName.c_str());
 
-			if (!File::Exists(DirName))
+			const NANDIndexEntry* Dir = NANDIndexLookup(DirName);
+			if (!Dir)
 			{
 				WARN_LOG(WII_IPC_FILEIO, "FS: Search not found: %s", DirName.c_str());
 				ReturnValue = FS_FILE_NOT_EXIST;
 				break;
 			}
-			else if (!File::IsDirectory(DirName))
+			else if (!Dir->isDirectory)
 			{
 				// It's not a directory, so error.
 				// Games don't usually seem to care WHICH error they get, as long as it's <
@@ -109,19 +337,10 @@ bool CWII_IPC_HLE_Device_fs::IOCtlV(u32 _CommandAddress)
 				break;
 			}
 
-			// make a file search
-			CFileSearch::XStringVector Directories;
-			Directories.push_back(DirName);
-
-			CFileSearch::XStringVector Extensions;
-			Extensions.push_back("*.*");
-
-			CFileSearch FileSearch(Extensions, Directories);
-
 			// it is one
 			if ((CommandBuffer.InBuffer.size() == 1) && (CommandBuffer.PayloadBuffer.size() == 1))
 			{
-				size_t numFile = FileSearch.GetFileNames().size();
+				size_t numFile = Dir->children.size();
 				INFO_LOG(WII_IPC_FILEIO, "\t%lu files found", (unsigned long)numFile);
 
 				Memory::Write_U32((u32)numFile, CommandBuffer.PayloadBuffer[0].m_Address);
@@ -135,14 +354,12 @@ bool CWII_IPC_HLE_Device_fs::IOCtlV(u32 _CommandAddress)
 				size_t numFiles = 0;
 				char* pFilename = (char*)Memory::GetPointer((u32)(CommandBuffer.PayloadBuffer[0].m_Address));
 
-				for (size_t i=0; i<FileSearch.GetFileNames().size(); i++)
+				for (const auto& child : Dir->children)
 				{
-					if (i >= MaxEntries)
+					if (numFiles >= MaxEntries)
 						break;
 
-					std::string name, ext;
-					SplitPath(FileSearch.GetFileNames()[i], NULL, &name, &ext);
-					std::string FileName = name + ext;
+					std::string FileName = child;
 
 					// Decode entities of invalid file system characters so that
 					// games (such as HP:HBP) will be able to find what they expect.
@@ -182,7 +399,8 @@ bool CWII_IPC_HLE_Device_fs::IOCtlV(u32 _CommandAddress)
 			u32 iNodes = 0;
 
 			INFO_LOG(WII_IPC_FILEIO, "IOCTL_GETUSAGE %s", path.c_str());
-			if (File::IsDirectory(path))
+			const NANDIndexEntry* Dir = NANDIndexLookup(path);
+			if (Dir && Dir->isDirectory)
 			{
 				// LPFaint99: After I found that setting the number of inodes to the number of children + 1 for the directory itself
 				// I decided to compare with sneek which has the following 2 special cases which are
@@ -195,14 +413,12 @@ bool CWII_IPC_HLE_Device_fs::IOCtlV(u32 _CommandAddress)
 				}
 				else
 				{
-					File::FSTEntry parentDir;
-					// add one for the folder itself, allows some games to create their save files
+					// The index counts one for the folder itself, allows some games to create their save files
 					// R8XE52 (Jurassic: The Hunted), STEETR (Tetris Party Deluxe) now create their saves with this change
-					iNodes = 1 + File::ScanDirectoryTree(path, parentDir);
+					iNodes = Dir->iNodes;
 
-					u64 totalSize = ComputeTotalFileSize(parentDir); // "Real" size, to be converted to nand blocks
-
-					fsBlocks = (u32)(totalSize / (16 * 1024));  // one bock is 16kb
+					// "Real" size, to be converted to nand blocks
+					fsBlocks = (u32)(Dir->size / (16 * 1024));  // one bock is 16kb
 				}
 				ReturnValue = FS_RESULT_OK;
 
@@ -298,6 +514,7 @@ s32 CWII_IPC_HLE_Device_fs::ExecuteCommand(u32 _Parameter, u32 _BufferIn, u32 _B
 			DirName += DIR_SEP;
 			File::CreateFullPath(DirName);
 			_dbg_assert_msg_(WII_IPC_FILEIO, File::IsDirectory(DirName), "FS: CREATE_DIR %s failed", DirName.c_str());
+			NANDIndexAdd(NANDIndexKey(DirName));
 
 			return FS_RESULT_OK;
 		}
@@ -340,13 +557,14 @@ s32 CWII_IPC_HLE_Device_fs::ExecuteCommand(u32 _Parameter, u32 _BufferIn, u32 _B
 			u8 GroupPerm = 0x3;		// read/write
 			u8 OtherPerm = 0x3;		// read/write
 			u8 Attributes = 0x00;	// no attributes
-			if (File::IsDirectory(Filename))
+			const NANDIndexEntry* Entry = NANDIndexLookup(Filename);
+			if (Entry && Entry->isDirectory)
 			{
 				INFO_LOG(WII_IPC_FILEIO, "FS: GET_ATTR Directory %s - all permission flags are set", Filename.c_str());
 			}
 			else
 			{
-				if (File::Exists(Filename))
+				if (Entry)
 				{
 					INFO_LOG(WII_IPC_FILEIO, "FS: GET_ATTR %s - all permission flags are set", Filename.c_str());
 				}
@@ -382,13 +600,16 @@ s32 CWII_IPC_HLE_Device_fs::ExecuteCommand(u32 _Parameter, u32 _BufferIn, u32 _B
 
 			std::string Filename = HLE_IPC_BuildFilename((const char*)Memory::GetPointer(_BufferIn+Offset), 64);
 			Offset += 64;
+			HLE_IPC_CloseOpenFiles(Filename);
 			if (File::Delete(Filename))
 			{
 				INFO_LOG(WII_IPC_FILEIO, "FS: DeleteFile %s", Filename.c_str());
+				NANDIndexRemove(NANDIndexKey(Filename));
 			}
 			else if (File::DeleteDir(Filename))
 			{
 				INFO_LOG(WII_IPC_FILEIO, "FS: DeleteDir %s", Filename.c_str());
+				NANDIndexRemove(NANDIndexKey(Filename));
 			}
 			else
 			{
@@ -410,19 +631,26 @@ s32 CWII_IPC_HLE_Device_fs::ExecuteCommand(u32 _Parameter, u32 _BufferIn, u32 _B
 			std::string FilenameRename = HLE_IPC_BuildFilename((const char*)Memory::GetPointer(_BufferIn+Offset), 64);
 			Offset += 64;
 
+			// The fds open on either path don't follow the rename
+			HLE_IPC_CloseOpenFiles(Filename);
+			HLE_IPC_CloseOpenFiles(FilenameRename);
+
 			// try to make the basis directory
 			File::CreateFullPath(FilenameRename);
+			NANDIndexAdd(NANDIndexParent(NANDIndexKey(FilenameRename)));
 
 			// if there is already a file, delete it
 			if (File::Exists(Filename) && File::Exists(FilenameRename))
 			{
-				File::Delete(FilenameRename);
+				if (File::Delete(FilenameRename))
+					NANDIndexRemove(NANDIndexKey(FilenameRename));
 			}
 
 			// finally try to rename the file
 			if (File::Rename(Filename, FilenameRename))
 			{
 				INFO_LOG(WII_IPC_FILEIO, "FS: Rename %s to %s", Filename.c_str(), FilenameRename.c_str());
+				NANDIndexMove(NANDIndexKey(Filename), NANDIndexKey(FilenameRename));
 			}
 			else
 			{
@@ -462,7 +690,8 @@ s32 CWII_IPC_HLE_Device_fs::ExecuteCommand(u32 _Parameter, u32 _BufferIn, u32 _B
 				return FS_FILE_EXIST;
 			}
 
-			// create the file
+			// create the file, a handle that is still cached for the path is stale
+			HLE_IPC_CloseOpenFiles(Filename);
 			File::CreateFullPath(Filename);  // just to be sure
 			bool Result = File::CreateEmptyFile(Filename);
 			if (!Result)
@@ -471,6 +700,7 @@ s32 CWII_IPC_HLE_Device_fs::ExecuteCommand(u32 _Parameter, u32 _BufferIn, u32 _B
 				PanicAlert("CWII_IPC_HLE_Device_fs: couldn't create new file");
 				return FS_RESULT_FATAL;
 			}
+			NANDIndexAdd(NANDIndexKey(Filename));
 
 			INFO_LOG(WII_IPC_FILEIO, "\tresult = FS_RESULT_OK");
 			return FS_RESULT_OK;
@@ -505,10 +735,14 @@ void CWII_IPC_HLE_Device_fs::DoState(PointerWrap& p)
 	// handle /tmp
 
 	std::string Path = File::GetUserPath(D_WIIUSER_IDX) + "tmp";
+	// One copy buffer for all the files, rather than 64 KB on the stack per file
+	std::vector<char> buf(65536);
 	if (p.GetMode() == PointerWrap::MODE_READ)
 	{
+		HLE_IPC_CloseOpenFiles(Path);
 		File::DeleteDirRecursively(Path);
 		File::CreateDir(Path.c_str());
+		HLE_IPC_InvalidateNANDIndex(Path);
 
 		//now restore from the stream
 		while(1) {
@@ -532,7 +766,6 @@ void CWII_IPC_HLE_Device_fs::DoState(PointerWrap& p)
 				p.Do(size);
 
 				File::IOFile handle(name, "wb");
-				char buf[65536];
 				u32 count = size;
 				while(count > 65536) {
 					p.DoArray(&buf[0], 65536);
@@ -575,7 +808,6 @@ void CWII_IPC_HLE_Device_fs::DoState(PointerWrap& p)
 				p.Do(size);
 
 				File::IOFile handle(entry.physicalName, "rb");
-				char buf[65536];
 				u32 count = size;
 				while(count > 65536) {
 					handle.ReadArray(&buf[0], 65536);
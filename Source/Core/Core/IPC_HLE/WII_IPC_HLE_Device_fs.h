@@ -7,6 +7,16 @@
 
 #include "WII_IPC_HLE_Device.h"
 
+// The FS device answers READ_DIR, GETUSAGE and GET_ATTR from an index of the
+// NAND it builds from the host on first use. It follows the FS device's own
+// create, delete and rename calls and the writes through the file handles;
+// anything else that changes the NAND while a game runs has to invalidate
+// what it touched.
+void HLE_IPC_ClearNANDIndex();
+void HLE_IPC_InvalidateNANDIndex(const std::string& path);
+// A file handle wrote up to offset end of the file at path
+void HLE_IPC_NANDIndexFileWritten(const std::string& path, u64 end);
+
 struct NANDStat
 {
 	u32 BlockSize;
@@ -66,6 +66,8 @@ bool g_bRecordingFromSaveState = false;
 bool g_bPolled = false;
 int g_currentSaveVersion = 0;
 
+static FrameUpdateCallback s_onFrameUpdate = NULL;
+
 std::string tmpStateFilename = File::GetUserPath(D_STATESAVES_IDX) + "dtm.sav";
 
 std::string g_InputDisplay[8];
@@ -141,6 +143,14 @@ void FrameUpdate()
 		FrameSkipping();
 
 	g_bPolled = false;
+
+	if (s_onFrameUpdate)
+		s_onFrameUpdate();
+}
+
+void SetFrameUpdateCallback(FrameUpdateCallback callback)
+{
+	s_onFrameUpdate = callback;
 }
 
 // called when game is booting up, even if no movie is active,
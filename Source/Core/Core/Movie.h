@@ -121,6 +121,10 @@ void FrameUpdate();
 void InputUpdate();
 void Init();
 
+// Called at the end of every FrameUpdate, from the thread that copied the XFB
+typedef void(*FrameUpdateCallback)(void);
+void SetFrameUpdateCallback(FrameUpdateCallback callback);
+
 void SetPolledDevice();
 
 bool IsRecordingInput();
@@ -0,0 +1,151 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <inttypes.h>
+#include <stdio.h>
+#include <vector>
+
+#include "MovieBenchmark.h"
+#include "ConfigManager.h"
+#include "Host.h"
+#include "Movie.h"
+#include "HW/Memmap.h"
+#include "HW/VideoInterface.h"
+#include "PowerPC/PowerPC.h"
+
+#include "FileUtil.h"
+#include "Hash.h"
+#include "Timer.h"
+
+namespace MovieBenchmark
+{
+
+struct FrameResult
+{
+	u64 frame;
+	u64 time;
+	u64 ramHash;
+	u64 xfbHash;
+};
+
+static bool s_active = false;
+static u64 s_start;
+static u64 s_end;
+static u64 s_lastFrame;
+static u64 s_hashTime;
+static std::vector<FrameResult> s_frames;
+
+// Always murmur, GetHash64 can switch to CRC32 depending on the host CPU and
+// the hashes should compare across machines
+static u64 HashRAM()
+{
+	u64 hash = GetMurmurHash3(Memory::GetMainRAMPtr(), Memory::REALRAM_SIZE, 0);
+	if (SConfig::GetInstance().m_LocalCoreStartupParameter.bWii)
+		hash = hash * 31 + GetMurmurHash3(Memory::m_pEXRAM, Memory::EXRAM_SIZE, 0);
+	return hash;
+}
+
+// The XFB is only in emulated RAM with Real XFB, EFB copies to RAM or the
+// software renderer. Otherwise this hashes whatever the game left there.
+static u64 HashXFB()
+{
+	u32 address = VideoInterface::GetXFBAddressTop() & 0x0fffffff;
+	u32 size = VideoInterface::GetXFBWidth() * VideoInterface::GetXFBHeight() * 2;
+	if (!address || address >= Memory::REALRAM_SIZE || !size)
+		return 0;
+
+	size = std::min<u32>(size, Memory::REALRAM_SIZE - address);
+	return GetMurmurHash3(Memory::GetMainRAMPtr() + address, size, 0);
+}
+
+static void FrameUpdate()
+{
+	u64 now = Common::Timer::GetTimeNs();
+
+	FrameResult result;
+	result.frame = Movie::g_currentFrame;
+	result.time = now - s_lastFrame;
+	result.ramHash = HashRAM();
+	result.xfbHash = HashXFB();
+	s_frames.push_back(result);
+
+	s_lastFrame = Common::Timer::GetTimeNs();
+	s_hashTime += s_lastFrame - now;
+
+	// Playback also ends early when the input runs out
+	if (Movie::g_currentFrame >= Movie::g_totalFrames || !Movie::IsPlayingInput())
+	{
+		Movie::SetFrameUpdateCallback(NULL);
+		s_end = s_lastFrame;
+		PowerPC::Stop();
+		Host_Message(WM_USER_STOP);
+	}
+}
+
+bool Init(const std::string& movie)
+{
+	s_frames.clear();
+	s_hashTime = 0;
+	s_end = 0;
+
+	if (!Movie::PlayInput(movie.c_str()))
+		return false;
+
+	// BootCore takes the CPU thread setting from the movie
+	if (Movie::IsConfigSaved() && Movie::IsDualCore())
+		fprintf(stderr, "The movie was recorded in dual core mode, the hashes are not reproducible\n");
+
+	s_active = true;
+	Movie::SetFrameUpdateCallback(FrameUpdate);
+	s_start = s_lastFrame = Common::Timer::GetTimeNs();
+	return true;
+}
+
+bool Shutdown(const std::string& filename)
+{
+	if (!s_active)
+		return false;
+
+	s_active = false;
+	Movie::SetFrameUpdateCallback(NULL);
+	if (!s_end)
+		s_end = Common::Timer::GetTimeNs();
+
+	File::IOFile file;
+	FILE *out = stdout;
+	if (!filename.empty())
+	{
+		if (!file.Open(filename, "w"))
+			return false;
+		out = file.GetHandle();
+	}
+
+	// The frame times don't include the hashing, the first one includes booting
+	fprintf(out, "frame,time_us,ram_hash,xfb_hash\n");
+	for (size_t i = 0; i < s_frames.size(); ++i)
+	{
+		const FrameResult &r = s_frames[i];
+		fprintf(out, "%" PRIu64 ",%.3f,%016" PRIx64 ",%016" PRIx64 "\n",
+			r.frame, r.time / 1000.0, r.ramHash, r.xfbHash);
+	}
+
+	u64 wall = s_end - s_start;
+	u64 emulated = wall - s_hashTime;
+	fprintf(stderr, "%u of %u frames in %.3f ms (%.3f ms hashing)", (u32)s_frames.size(),
+		(u32)Movie::g_totalFrames, wall / 1000000.0, s_hashTime / 1000000.0);
+	if (emulated)
+		fprintf(stderr, ", %.2f FPS", s_frames.size() * 1000000000.0 / emulated);
+	fprintf(stderr, "\n");
+
+	s_frames.clear();
+	return true;
+}
+
+bool IsActive()
+{
+	return s_active;
+}
+
+}
@@ -0,0 +1,29 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#ifndef _MOVIEBENCHMARK_H_
+#define _MOVIEBENCHMARK_H_
+
+#include <string>
+
+#include "CommonTypes.h"
+
+// Plays back a DTM input recording as a whole system benchmark: the frame
+// limiter is bypassed, emulation stops at the last frame of the movie and
+// every frame gets a hash of emulated RAM and of the XFB the VI scans out, so
+// two runs can be compared for determinism.
+namespace MovieBenchmark
+{
+
+// Starts playing the movie, must be called before the game is booted
+bool Init(const std::string& movie);
+
+// Writes the results as CSV, to stdout if filename is empty
+bool Shutdown(const std::string& filename);
+
+bool IsActive();
+
+}
+
+#endif
@@ -2,6 +2,8 @@
 // Licensed under GPLv2
 // Refer to the license.txt file included.
 
+#include <algorithm>
+
 #include "NetPlayClient.h"
 
 // for wiimote
@@ -19,7 +21,11 @@
 #include "Core.h"
 #include "ConfigManager.h"
 #include "Movie.h"
+#include "State.h"
+#include "StringUtil.h"
+#include "HW/CPU.h"
 #include "HW/WiimoteEmu/WiimoteEmu.h"
+#include "PowerPC/PowerPC.h"
 
 std::mutex crit_netplay_client;
 static NetPlayClient * netplay_client = NULL;
@@ -27,6 +33,19 @@ NetSettings g_NetPlaySettings;
 
 #define RPT_SIZE_HACK	(1 << 16)
 
+enum
+{
+	// snapshots kept for rollbacks, one per frame
+	ROLLBACK_SNAPSHOTS = 8,
+	// polls the game may run ahead of the input of a remote pad,
+	// the snapshots have to reach back further than this
+	ROLLBACK_MAX_PREDICTED = 6,
+	// how often the rollback statistics are shown
+	ROLLBACK_REPORT_MS = 10000,
+};
+
+static void NetPlay_SafePoint();
+
 NetPad::NetPad()
 {
 	nHi = 0x00808080;
@@ -60,7 +79,7 @@ NetPlayClient::~NetPlayClient()
 }
 
 // called from ---GUI--- thread
-NetPlayClient::NetPlayClient(const std::string& address, const u16 port, NetPlayUI* dialog, const std::string& name) : m_dialog(dialog), m_is_running(false), m_do_loop(true)
+NetPlayClient::NetPlayClient(const std::string& address, const u16 port, NetPlayUI* dialog, const std::string& name) : m_rollback(false), m_dialog(dialog), m_is_running(false), m_do_loop(true)
 {
 	m_target_buffer_size = 20;
 	ClearBuffers();
@@ -213,8 +232,29 @@ unsigned int NetPlayClient::OnData(sf::Packet& packet)
 			packet >> map >> np.nHi >> np.nLo;
 
 			// trusting server for good map value (>=0 && <4)
-			// add to pad buffer
-			m_pad_buffer[map].Push(np);
+			if (m_rollback)
+			{
+				std::lock_guard<std::recursive_mutex> lkr(m_crit.rollback);
+				const u32 first = m_pad_first_poll[map];
+				const u32 poll = first + (u32)m_pad_inputs[map].size();
+				m_pad_inputs[map].push_back(np);
+
+				// the game already ran this poll with a prediction
+				if (poll < first + m_pad_used[map].size() && poll < m_mispredicted[map])
+				{
+					const NetPad& used = m_pad_used[map][poll - first];
+					if (used.nHi != np.nHi || used.nLo != np.nLo)
+					{
+						m_mispredicted[map] = poll;
+						m_rollback_pending = true;
+					}
+				}
+			}
+			else
+			{
+				// add to pad buffer
+				m_pad_buffer[map].Push(np);
+			}
 		}
 		break;
 
@@ -275,6 +315,18 @@ unsigned int NetPlayClient::OnData(sf::Packet& packet)
 			g_NetPlaySettings.m_EXIDevice[0] = (TEXIDevices) tmp;
 			packet >> tmp;
 			g_NetPlaySettings.m_EXIDevice[1] = (TEXIDevices) tmp;
+			packet >> g_NetPlaySettings.m_Rollback;
+			}
+
+			// set here, before the other players send any pad data
+			m_rollback = g_NetPlaySettings.m_Rollback;
+			for (unsigned int i = 0; i < 4; ++i)
+			{
+				if (m_rollback && m_wiimote_map[i] > 0)
+				{
+					m_dialog->AppendChat("< ROLLBACK DOESN'T SUPPORT WIIMOTES, USING THE PAD BUFFER >");
+					m_rollback = false;
+				}
 			}
 
 			m_dialog->OnMsgStartGame();
@@ -339,6 +391,9 @@ void NetPlayClient::ThreadFunc()
 {
 	while (m_do_loop)
 	{
+		if (m_rollback && m_is_running)
+			ReportRollbacks();
+
 		if (m_selector.Wait(0.01f))
 		{
 			sf::Packet rpac;
@@ -483,7 +538,12 @@ bool NetPlayClient::StartGame(const std::string &path)
 
 	ClearBuffers();
 
-	if (m_dialog->IsRecording())
+	if (m_dialog->IsRecording() && m_rollback)
+	{
+		// a rollback would have to take back recorded input
+		m_dialog->AppendChat(" -- INPUT RECORDING DOESN'T WORK WITH ROLLBACK -- ");
+	}
+	else if (m_dialog->IsRecording())
 	{
 
 		if (Movie::IsReadOnly())
@@ -555,6 +615,26 @@ void NetPlayClient::ClearBuffers()
 		while (m_wiimote_buffer[i].Size())
 			m_wiimote_buffer[i].Pop();
 	}
+
+	std::lock_guard<std::recursive_mutex> lkr(m_crit.rollback);
+	for (unsigned int i=0; i<4; ++i)
+	{
+		m_pad_inputs[i].clear();
+		m_pad_used[i].clear();
+		m_pad_first_poll[i] = 0;
+		m_mispredicted[i] = -1;
+		m_resimulate_to[i] = 0;
+	}
+	m_snapshots.clear();
+	m_rollback_pending = false;
+	m_safe_point_requested = false;
+	m_resimulating = false;
+	m_resimulate_start = 0;
+
+	m_rollback_count = m_reported_rollback_count = 0;
+	m_resimulated_frames = m_reported_resimulated_frames = 0;
+	m_resimulation_ms = m_reported_resimulation_ms = 0;
+	m_last_report = Common::Timer::GetTimeMs();
 }
 
 // called from ---CPU--- thread
@@ -585,37 +665,45 @@ bool NetPlayClient::GetNetPads(const u8 pad_nb, const SPADStatus* const pad_stat
 	// We should add this split between "in-game" pads and "local"
 	// pads higher up.
 
-	int in_game_num = LocalPadToInGamePad(pad_nb);
-
-	// If this in-game pad is one of ours, then update from the
-	// information given.
-	if (in_game_num < 4)
+	if (m_rollback)
 	{
-		NetPad np(pad_status);
+		if (!GetRollbackPad(pad_nb, pad_status, netvalues))
+			return false;
+	}
+	else
+	{
+		int in_game_num = LocalPadToInGamePad(pad_nb);
 
-		// adjust the buffer either up or down
-		// inserting multiple padstates or dropping states
-		while (m_pad_buffer[in_game_num].Size() <= m_target_buffer_size)
+		// If this in-game pad is one of ours, then update from the
+		// information given.
+		if (in_game_num < 4)
 		{
-			// add to buffer
-			m_pad_buffer[in_game_num].Push(np);
+			NetPad np(pad_status);
 
-			// send
-			SendPadState(in_game_num, np);
+			// adjust the buffer either up or down
+			// inserting multiple padstates or dropping states
+			while (m_pad_buffer[in_game_num].Size() <= m_target_buffer_size)
+			{
+				// add to buffer
+				m_pad_buffer[in_game_num].Push(np);
+
+				// send
+				SendPadState(in_game_num, np);
+			}
 		}
-	}
 
-	// Now, we need to swap out the local value with the values
-	// retrieved from NetPlay. This could be the value we pushed
-	// above if we're configured as P1 and the code is trying
-	// to retrieve data for slot 1.
-	while (!m_pad_buffer[pad_nb].Pop(*netvalues))
-	{
-		if (!m_is_running)
-			return false;
+		// Now, we need to swap out the local value with the values
+		// retrieved from NetPlay. This could be the value we pushed
+		// above if we're configured as P1 and the code is trying
+		// to retrieve data for slot 1.
+		while (!m_pad_buffer[pad_nb].Pop(*netvalues))
+		{
+			if (!m_is_running)
+				return false;
 
-		// TODO: use a condition instead of sleeping
-		Common::SleepCurrentThread(1);
+			// TODO: use a condition instead of sleeping
+			Common::SleepCurrentThread(1);
+		}
 	}
 
 	SPADStatus tmp;
@@ -641,6 +729,200 @@ bool NetPlayClient::GetNetPads(const u8 pad_nb, const SPADStatus* const pad_stat
 }
 
 
+// called from ---CPU--- thread
+bool NetPlayClient::GetRollbackPad(const u8 pad_nb, const SPADStatus* const pad_status, NetPad* const netvalues)
+{
+	std::unique_lock<std::recursive_mutex> lkr(m_crit.rollback);
+
+	// snapshot once per frame, and roll back as soon as a prediction turned out wrong
+	if (pad_nb == FirstPad() || m_rollback_pending)
+		RequestSafePoint();
+
+	// Same split between local and in-game pads as with the pad buffer,
+	// except that our input is only sent once per poll. After a rollback
+	// the input we sent is replayed instead.
+	int in_game_num = LocalPadToInGamePad(pad_nb);
+	if (in_game_num < 4 && m_pad_inputs[in_game_num].size() <= m_pad_used[in_game_num].size())
+	{
+		NetPad np(pad_status);
+		m_pad_inputs[in_game_num].push_back(np);
+		SendPadState(in_game_num, np);
+	}
+
+	std::vector<NetPad>& inputs = m_pad_inputs[pad_nb];
+	std::vector<NetPad>& used = m_pad_used[pad_nb];
+	const size_t poll = used.size();
+
+	// the game polls one of our pads more often than the local pad feeding it
+	if (poll >= inputs.size() && m_pad_map[pad_nb] == m_local_player->pid)
+	{
+		NetPad np = inputs.empty() ? NetPad() : inputs.back();
+		inputs.push_back(np);
+		SendPadState(pad_nb, np);
+	}
+
+	// Only predict as far back as the snapshots reach
+	while (poll >= inputs.size() && (m_snapshots.empty() || poll - inputs.size() >= ROLLBACK_MAX_PREDICTED))
+	{
+		if (!m_is_running)
+			return false;
+
+		lkr.unlock();
+		Common::SleepCurrentThread(1);
+		lkr.lock();
+	}
+
+	// the prediction is that the pad didn't change
+	if (poll < inputs.size())
+		*netvalues = inputs[poll];
+	else
+		*netvalues = inputs.empty() ? NetPad() : inputs.back();
+	used.push_back(*netvalues);
+
+	if (m_resimulating)
+	{
+		bool caught_up = true;
+		for (unsigned int i = 0; i < 4; ++i)
+			caught_up &= m_pad_first_poll[i] + m_pad_used[i].size() >= m_resimulate_to[i];
+		if (caught_up)
+		{
+			m_resimulation_ms += Common::Timer::GetTimeMs() - m_resimulate_start;
+			m_resimulating = false;
+		}
+	}
+
+	return true;
+}
+
+// called from ---CPU--- thread
+void NetPlayClient::RequestSafePoint()
+{
+	if (!m_safe_point_requested && PowerPC::GetState() == PowerPC::CPU_RUNNING)
+	{
+		m_safe_point_requested = true;
+		CCPU::RunAtSafePoint(NetPlay_SafePoint);
+	}
+}
+
+// called from ---CPU--- thread
+void NetPlayClient::OnSafePoint()
+{
+	std::lock_guard<std::recursive_mutex> lkr(m_crit.rollback);
+	m_safe_point_requested = false;
+
+	if (m_rollback_pending)
+	{
+		m_rollback_pending = false;
+
+		// snapshots from after a wrong prediction are wrong as well
+		while (!m_snapshots.empty())
+		{
+			bool before = true;
+			for (unsigned int i = 0; i < 4; ++i)
+				before &= m_snapshots.back().polls[i] <= m_mispredicted[i];
+			if (before)
+				break;
+			m_snapshots.pop_back();
+		}
+
+		for (unsigned int i = 0; i < 4; ++i)
+			m_mispredicted[i] = -1;
+
+		if (m_snapshots.empty())
+		{
+			m_dialog->AppendChat("< ROLLBACK WINDOW EXCEEDED, NETPLAY HAS PROBABLY DESYNCED >");
+			return;
+		}
+
+		RollbackSnapshot& snapshot = m_snapshots.back();
+		const u8 first_pad = FirstPad();
+		if (first_pad < 4)
+			m_resimulated_frames += m_pad_first_poll[first_pad] + (u32)m_pad_used[first_pad].size() - snapshot.polls[first_pad];
+		++m_rollback_count;
+
+		// a rollback while catching up from another one catches up to the same point
+		if (!m_resimulating)
+		{
+			for (unsigned int i = 0; i < 4; ++i)
+				m_resimulate_to[i] = m_pad_first_poll[i] + (u32)m_pad_used[i].size();
+			m_resimulate_start = Common::Timer::GetTimeMs();
+			m_resimulating = true;
+		}
+		for (unsigned int i = 0; i < 4; ++i)
+			m_pad_used[i].resize(snapshot.polls[i] - m_pad_first_poll[i]);
+
+		// the snapshot stays, a later rollback can go back to it again
+		State::LoadFromBuffer(snapshot.state);
+		return;
+	}
+
+	// recycle the buffer of the oldest snapshot
+	std::vector<u8> state;
+	if (m_snapshots.size() >= ROLLBACK_SNAPSHOTS)
+	{
+		state.swap(m_snapshots.front().state);
+		m_snapshots.pop_front();
+	}
+	State::SaveToBuffer(state);
+
+	m_snapshots.push_back(RollbackSnapshot());
+	RollbackSnapshot& snapshot = m_snapshots.back();
+	snapshot.state.swap(state);
+	for (unsigned int i = 0; i < 4; ++i)
+		snapshot.polls[i] = m_pad_first_poll[i] + (u32)m_pad_used[i].size();
+
+	TrimPadHistory();
+}
+
+// No rollback goes back further than the oldest snapshot, drop the polls before it
+void NetPlayClient::TrimPadHistory()
+{
+	const RollbackSnapshot& oldest = m_snapshots.front();
+	for (unsigned int i = 0; i < 4; ++i)
+	{
+		// the last confirmed input is still the prediction for the polls after it
+		size_t count = std::min<size_t>(oldest.polls[i] - m_pad_first_poll[i], m_pad_used[i].size());
+		count = std::min<size_t>(count, m_pad_inputs[i].empty() ? 0 : m_pad_inputs[i].size() - 1);
+
+		m_pad_inputs[i].erase(m_pad_inputs[i].begin(), m_pad_inputs[i].begin() + count);
+		m_pad_used[i].erase(m_pad_used[i].begin(), m_pad_used[i].begin() + count);
+		m_pad_first_poll[i] += (u32)count;
+	}
+}
+
+// the pad the game polls first in every frame
+u8 NetPlayClient::FirstPad() const
+{
+	u8 pad = 0;
+	while (pad < 4 && m_pad_map[pad] <= 0)
+		pad++;
+	return pad;
+}
+
+// called from ---NETPLAY--- thread
+void NetPlayClient::ReportRollbacks()
+{
+	std::lock_guard<std::recursive_mutex> lkr(m_crit.rollback);
+
+	const u32 now = Common::Timer::GetTimeMs();
+	if (now - m_last_report < ROLLBACK_REPORT_MS)
+		return;
+
+	const u32 rollbacks = m_rollback_count - m_reported_rollback_count;
+	if (rollbacks)
+	{
+		const u32 frames = m_resimulated_frames - m_reported_resimulated_frames;
+		const u32 ms = m_resimulation_ms - m_reported_resimulation_ms;
+		Core::DisplayMessage(StringFromFormat("Rollback: %u in %us, %.1f frames and %.1f ms resimulated each",
+			rollbacks, (now - m_last_report) / 1000, (float)frames / rollbacks, (float)ms / rollbacks), 3000);
+	}
+
+	m_reported_rollback_count = m_rollback_count;
+	m_reported_resimulated_frames = m_resimulated_frames;
+	m_reported_resimulation_ms = m_resimulation_ms;
+	m_last_report = now;
+}
+
 // called from ---CPU--- thread
 bool NetPlayClient::WiimoteUpdate(int _number, u8* data, const u8 size)
 {
@@ -749,6 +1031,15 @@ bool NetPlayClient::StopGame()
 
 	m_dialog->AppendChat(" -- STOPPING GAME -- ");
 
+	if (m_rollback)
+	{
+		std::lock_guard<std::recursive_mutex> lkr(m_crit.rollback);
+		std::ostringstream ss;
+		ss << " -- " << m_rollback_count << " ROLLBACKS, " << m_resimulated_frames << " FRAMES RESIMULATED IN "
+			<< m_resimulation_ms << " MS -- ";
+		m_dialog->AppendChat(ss.str());
+	}
+
 	m_is_running = false;
 	NetPlay_Disable();
 
@@ -911,6 +1202,21 @@ bool NetPlay::IsNetPlayRunning()
 	return netplay_client != NULL;
 }
 
+bool NetPlay::IsResimulating()
+{
+	NetPlayClient* const client = netplay_client;
+	return client != NULL && client->IsResimulating();
+}
+
+// called from ---CPU--- thread
+static void NetPlay_SafePoint()
+{
+	std::lock_guard<std::mutex> lk(crit_netplay_client);
+
+	if (netplay_client)
+		netplay_client->OnSafePoint();
+}
+
 void NetPlay_Enable(NetPlayClient* const np)
 {
 	std::lock_guard<std::mutex> lk(crit_netplay_client);
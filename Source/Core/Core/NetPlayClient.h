@@ -15,6 +15,7 @@
 #include "NetPlayProto.h"
 #include "GCPadStatus.h"
 
+#include <deque>
 #include <functional>
 #include <map>
 #include <queue>
@@ -86,6 +87,10 @@ public:
 
 	u8 LocalWiimoteToInGameWiimote(u8 local_pad);
 
+	// Rollback mode: saves or loads the state between two runs of the cpu core
+	void OnSafePoint();
+	bool IsResimulating() const { return m_resimulating; }
+
 protected:
 	void ClearBuffers();
 
@@ -94,11 +99,48 @@ protected:
 		std::recursive_mutex game;
 		// lock order
 		std::recursive_mutex players, send;
+		std::recursive_mutex rollback;
 	} m_crit;
 
 	Common::FifoQueue<NetPad>		m_pad_buffer[4];
 	Common::FifoQueue<NetWiimote>	m_wiimote_buffer[4];
 
+	// Rollback mode replaces the pad buffer. The game gets the input of a remote pad
+	// it doesn't have yet predicted, and when the input arrives and differs, the
+	// state from before that poll is loaded and the polls since are replayed.
+	struct RollbackSnapshot
+	{
+		std::vector<u8>	state;
+		// polls of each in-game pad before the state was saved
+		u32				polls[4];
+	};
+
+	bool			m_rollback;
+	// confirmed input of each in-game pad and what the game got, by poll,
+	// without the polls from before the oldest snapshot
+	std::vector<NetPad>	m_pad_inputs[4];
+	std::vector<NetPad>	m_pad_used[4];
+	// the poll of the first entry of m_pad_inputs and m_pad_used
+	u32				m_pad_first_poll[4];
+	// one per frame, oldest first
+	std::deque<RollbackSnapshot>	m_snapshots;
+	// first poll of each pad that got a wrong prediction, or -1
+	u32				m_mispredicted[4];
+	bool			m_rollback_pending;
+	bool			m_safe_point_requested;
+	volatile bool	m_resimulating;
+	u32				m_resimulate_to[4];
+	u32				m_resimulate_start;
+
+	// statistics, in polls of the first pad
+	u32		m_rollback_count;
+	u32		m_resimulated_frames;
+	u32		m_resimulation_ms;
+	u32		m_reported_rollback_count;
+	u32		m_reported_resimulated_frames;
+	u32		m_reported_resimulation_ms;
+	u32		m_last_report;
+
 	NetPlayUI*		m_dialog;
 	sf::SocketTCP	m_socket;
 	std::thread		m_thread;
@@ -121,6 +163,11 @@ protected:
 
 private:
 	void UpdateDevices();
+	bool GetRollbackPad(const u8 pad_nb, const SPADStatus* const pad_status, NetPad* const netvalues);
+	void RequestSafePoint();
+	void TrimPadHistory();
+	u8 FirstPad() const;
+	void ReportRollbacks();
 	void SendPadState(const PadMapping in_game_pad, const NetPad& np);
 	void SendWiimoteState(const PadMapping in_game_pad, const NetWiimote& nw);
 	unsigned int OnData(sf::Packet& packet);
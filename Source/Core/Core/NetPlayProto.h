@@ -17,6 +17,8 @@ struct NetSettings
 	bool m_DSPEnableJIT;
 	bool m_WriteToMemcard;
 	TEXIDevices m_EXIDevice[2];
+	// run ahead on predicted pad input and roll back, instead of the pad buffer
+	bool m_Rollback;
 };
 
 extern NetSettings g_NetPlaySettings;
@@ -28,7 +30,7 @@ struct Rpt : public std::vector<u8>
 
 typedef std::vector<u8> NetWiimote;
 
-#define NETPLAY_VERSION		"Dolphin NetPlay 2014-01-08"
+#define NETPLAY_VERSION		"Dolphin NetPlay 2014-01-20"
 
 const int NETPLAY_INITIAL_GCTIME = 1272737767;
 
@@ -75,6 +77,8 @@ enum
 
 namespace NetPlay {
 	bool IsNetPlayRunning();
+	// replaying polls after a rollback, the frame limit doesn't apply
+	bool IsResimulating();
 };
 
 #endif
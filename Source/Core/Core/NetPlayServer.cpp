@@ -542,6 +542,7 @@ bool NetPlayServer::StartGame(const std::string &path)
 	spac << m_settings.m_WriteToMemcard;
 	spac << m_settings.m_EXIDevice[0];
 	spac << m_settings.m_EXIDevice[1];
+	spac << m_settings.m_Rollback;
 
 	std::lock_guard<std::recursive_mutex> lkp(m_crit.players);
 	std::lock_guard<std::recursive_mutex> lks(m_crit.send);
@@ -0,0 +1,239 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <algorithm>
+
+#include "CachedInterpreter.h"
+#include "../PPCTables.h"
+
+static void HLEReplace(UGeckoInstruction _inst)
+{
+	HLE::Execute(PC, _inst.hex);
+}
+
+// The original instruction is the next record, at the same address
+static void HLEHookStart(UGeckoInstruction _inst)
+{
+	HLE::Execute(PC, _inst.hex);
+	NPC = PC;
+}
+
+void CachedInterpreter::Init()
+{
+	m_code.resize(MAX_INSTRUCTIONS);
+	m_blocks.resize(MAX_BLOCKS);
+	m_fast_lookup.resize(FAST_LOOKUP_SIZE);
+	ClearCache();
+}
+
+void CachedInterpreter::Shutdown()
+{
+	m_block_map.clear();
+	std::vector<Instruction>().swap(m_code);
+	std::vector<Block>().swap(m_blocks);
+	std::vector<int>().swap(m_fast_lookup);
+	m_num_instructions = 0;
+	m_num_blocks = 0;
+}
+
+void CachedInterpreter::ClearCache()
+{
+	// Only forget the blocks, the records stay valid until they are reused
+	// by the next CompileBlock
+	m_num_instructions = 0;
+	m_num_blocks = 0;
+	m_block_map.clear();
+	std::fill(m_fast_lookup.begin(), m_fast_lookup.end(), -1);
+}
+
+void CachedInterpreter::InvalidateICache(u32 address, u32 size)
+{
+	if (m_block_map.empty() || size == 0)
+		return;
+
+	// Blocks starting up to a block length in front of the range can still reach into it
+	u32 pAddr = address & 0x1FFFFFFF;
+	u32 first = pAddr > MAX_BLOCK_INSTRUCTIONS * 4 ? pAddr - MAX_BLOCK_INSTRUCTIONS * 4 : 0;
+	std::map<u32, int>::iterator it = m_block_map.lower_bound(first);
+	while (it != m_block_map.end() && it->first < pAddr + size)
+	{
+		Block &b = m_blocks[it->second];
+		if (b.address + b.length > pAddr)
+		{
+			b.address = INVALID_ADDRESS;
+			m_block_map.erase(it++);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+int CachedInterpreter::GetBlock(u32 address)
+{
+	u32 pAddr = address & 0x1FFFFFFF;
+	int &fast = m_fast_lookup[(pAddr >> 2) & (FAST_LOOKUP_SIZE - 1)];
+	if (fast >= 0 && m_blocks[fast].address == pAddr)
+		return fast;
+
+	std::map<u32, int>::iterator it = m_block_map.find(pAddr);
+	int block = it != m_block_map.end() ? it->second : CompileBlock(address);
+	if (block >= 0)
+		fast = block;
+	return block;
+}
+
+// Returns -1 when the first instruction can't be predecoded, InterpretBlock
+// then runs the block with all the checks of the plain interpreter
+int CachedInterpreter::CompileBlock(u32 address)
+{
+	if (m_num_blocks == MAX_BLOCKS || m_num_instructions + MAX_BLOCK_INSTRUCTIONS + 1 > MAX_INSTRUCTIONS)
+		ClearCache();
+
+	Block &b = m_blocks[m_num_blocks];
+	b.address = address & 0x1FFFFFFF;
+	b.first = m_num_instructions;
+	b.num_instructions = 0;
+	b.cycles = 0;
+	b.uses_fpu = false;
+
+	u32 pc = address;
+	bool end_block = false;
+
+	// HLE hooks are looked up once, when the block is decoded, like the JITs do
+	u32 function = HLE::GetFunctionIndex(address);
+	if (function != 0)
+	{
+		int type = HLE::GetFunctionTypeByIndex(function);
+		if ((type == HLE::HLE_HOOK_START || type == HLE::HLE_HOOK_REPLACE) &&
+			HLE::IsEnabled(HLE::GetFunctionFlagsByIndex(function)))
+		{
+			Instruction &op = m_code[b.first + b.num_instructions++];
+			op.func = type == HLE::HLE_HOOK_REPLACE ? HLEReplace : HLEHookStart;
+			op.inst.hex = function;
+			op.cycles = 1;
+			b.cycles += op.cycles;
+			if (type == HLE::HLE_HOOK_REPLACE)
+			{
+				pc += 4;
+				end_block = true;
+			}
+		}
+	}
+
+	while (!end_block && b.num_instructions < MAX_BLOCK_INSTRUCTIONS)
+	{
+		UGeckoInstruction inst(Memory::Read_Opcode(pc));
+		// Fetch errors and unknown instructions are left to the interpreter
+		if (inst.hex == 0)
+			break;
+		GekkoOPInfo *info = GetOpInfo(inst);
+		if (!info || (info->type & 0xFFFFFF) == OPTYPE_UNKNOWN)
+			break;
+
+		Instruction &op = m_code[b.first + b.num_instructions++];
+		op.func = GetInterpreterOp(inst);
+		op.inst = inst;
+		op.cycles = info->numCyclesMinusOne + 1;
+		b.cycles += op.cycles;
+		b.uses_fpu |= PPCTables::UsesFPU(inst);
+		end_block = (info->flags & FL_ENDBLOCK) != 0;
+		pc += 4;
+	}
+
+	if (b.num_instructions == 0)
+		return -1;
+
+	b.length = pc - address;
+	m_num_instructions += b.num_instructions;
+	m_block_map[b.address] = m_num_blocks;
+	return m_num_blocks++;
+}
+
+// Runs the interpreter up to the next branch
+int CachedInterpreter::InterpretBlock()
+{
+	Interpreter *interpreter = Interpreter::getInstance();
+	int cycles = 0;
+	Interpreter::m_EndBlock = false;
+	while (!Interpreter::m_EndBlock)
+		cycles += interpreter->SingleStepInner();
+	return cycles;
+}
+
+int CachedInterpreter::ExecuteBlock()
+{
+	int index = GetBlock(PC);
+	if (index < 0)
+		return InterpretBlock();
+
+	// A copy, the block can be invalidated while it runs
+	const Block b = m_blocks[index];
+
+	// Only the instructions that end a block change MSR.FP
+	if (b.uses_fpu && !((UReg_MSR&)MSR).FP)
+		return InterpretBlock();
+
+	const Instruction *code = &m_code[b.first];
+	for (u32 i = 0; i < b.num_instructions; i++)
+	{
+		NPC = PC + 4;
+		code[i].func(code[i].inst);
+		if (PowerPC::ppcState.Exceptions & EXCEPTION_DSI)
+		{
+			PowerPC::CheckExceptions();
+			PC = NPC;
+
+			int cycles = 0;
+			for (u32 j = 0; j <= i; j++)
+				cycles += code[j].cycles;
+			return cycles;
+		}
+		PC = NPC;
+	}
+	return b.cycles;
+}
+
+void CachedInterpreter::Run()
+{
+	const SCoreStartupParameter &startup = SConfig::GetInstance().m_LocalCoreStartupParameter;
+	// Breakpoints and address translation need the per instruction checks
+	if (startup.bEnableDebugging || startup.bMMU)
+	{
+		Interpreter::getInstance()->Run();
+		return;
+	}
+
+	while (!PowerPC::GetState())
+	{
+		// Timing is only looked at between blocks
+		while (CoreTiming::downcount > 0)
+			CoreTiming::downcount -= ExecuteBlock();
+
+		CoreTiming::Advance();
+
+		if (PowerPC::ppcState.Exceptions)
+		{
+			PowerPC::CheckExceptions();
+			PC = NPC;
+		}
+	}
+}
+
+void CachedInterpreter::SingleStep()
+{
+	Interpreter::getInstance()->SingleStep();
+}
+
+const char *CachedInterpreter::GetName()
+{
+	return "CachedInterpreter";
+}
+
+CachedInterpreter *CachedInterpreter::getInstance()
+{
+	static CachedInterpreter instance;
+	return &instance;
+}
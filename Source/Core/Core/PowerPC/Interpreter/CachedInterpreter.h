@@ -0,0 +1,90 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+// Interpreter that decodes every basic block once, into an array of handler
+// and instruction records, and from then on only walks that array. Blocks are
+// dropped through the same InvalidateICache and ClearCache hooks as JIT blocks.
+// The per instruction work left is the call to the handler and the DSI check;
+// HLE hooks, the FPU unavailable check and the cycle count are resolved once
+// per block.
+
+#ifndef _CACHEDINTERPRETER_H
+#define _CACHEDINTERPRETER_H
+
+#include <map>
+#include <vector>
+
+#include "Interpreter.h"
+
+class CachedInterpreter : public CPUCoreBase
+{
+public:
+	void Init() override;
+	void Shutdown() override;
+	void ClearCache() override;
+	void Run() override;
+	void SingleStep() override;
+	const char *GetName() override;
+
+	void InvalidateICache(u32 address, u32 size);
+
+	// singleton
+	static CachedInterpreter *getInstance();
+
+private:
+	CachedInterpreter() { }
+	~CachedInterpreter() { }
+	CachedInterpreter(const CachedInterpreter &);
+	CachedInterpreter & operator=(const CachedInterpreter &);
+
+	enum
+	{
+		MAX_BLOCK_INSTRUCTIONS = 64,
+		MAX_BLOCKS = 0x10000,
+		MAX_INSTRUCTIONS = 0x100000,
+		FAST_LOOKUP_SIZE = 0x4000,
+
+		// Never the address of an instruction
+		INVALID_ADDRESS = 1,
+	};
+
+	struct Instruction
+	{
+		Interpreter::_interpreterInstruction func;
+		UGeckoInstruction inst;
+		u32 cycles;
+	};
+
+	struct Block
+	{
+		// Physical address, or INVALID_ADDRESS once the block was invalidated
+		u32 address;
+		// Bytes of guest code the block was decoded from
+		u32 length;
+		u32 first;
+		u32 num_instructions;
+		u32 cycles;
+		bool uses_fpu;
+	};
+
+	int GetBlock(u32 address);
+	int CompileBlock(u32 address);
+	int ExecuteBlock();
+	int InterpretBlock();
+
+	// Records are never freed while the core runs, a block can invalidate
+	// itself (icbi, dcbi) and finish running from its old records
+	std::vector<Instruction> m_code;
+	std::vector<Block> m_blocks;
+	u32 m_num_instructions;
+	int m_num_blocks;
+
+	// Physical start address -> block, ordered so invalidation can find
+	// every block overlapping a range
+	std::map<u32, int> m_block_map;
+	// Indexed by address, checked against Block::address
+	std::vector<int> m_fast_lookup;
+};
+
+#endif  // _CACHEDINTERPRETER_H
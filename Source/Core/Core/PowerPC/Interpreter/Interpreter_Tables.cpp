@@ -34,7 +34,7 @@ static GekkoOPTemplate primarytable[] =
 	{10, Interpreter::cmpli,        {"cmpli",    OPTYPE_INTEGER, FL_IN_A | FL_SET_CRn, 0, 0, 0, 0}},
 	{11, Interpreter::cmpi,         {"cmpi",     OPTYPE_INTEGER, FL_IN_A | FL_SET_CRn, 0, 0, 0, 0}},
 	{12, Interpreter::addic,        {"addic",    OPTYPE_INTEGER, FL_OUT_D | FL_IN_A | FL_SET_CA, 0, 0, 0, 0}},
-	{13, Interpreter::addic_rc,     {"addic_rc", OPTYPE_INTEGER, FL_OUT_D | FL_IN_A | FL_SET_CR0, 0, 0, 0, 0}},
+	{13, Interpreter::addic_rc,     {"addic_rc", OPTYPE_INTEGER, FL_OUT_D | FL_IN_A | FL_SET_CA | FL_SET_CR0, 0, 0, 0, 0}},
 	{14, Interpreter::addi,         {"addi",     OPTYPE_INTEGER, FL_OUT_D | FL_IN_A0, 0, 0, 0, 0}},
 	{15, Interpreter::addis,        {"addis",    OPTYPE_INTEGER, FL_OUT_D | FL_IN_A0, 0, 0, 0, 0}},
 
@@ -180,8 +180,8 @@ static GekkoOPTemplate table31[] =
 	{922, Interpreter::extshx,      {"extshx", OPTYPE_INTEGER, FL_OUT_A | FL_IN_S | FL_RC_BIT, 0, 0, 0, 0}},
 	{954, Interpreter::extsbx,      {"extsbx", OPTYPE_INTEGER, FL_OUT_A | FL_IN_S | FL_RC_BIT, 0, 0, 0, 0}},
 	{536, Interpreter::srwx,        {"srwx",   OPTYPE_INTEGER, FL_OUT_A | FL_IN_B | FL_IN_S | FL_RC_BIT, 0, 0, 0, 0}},
-	{792, Interpreter::srawx,       {"srawx",  OPTYPE_INTEGER, FL_OUT_A | FL_IN_B | FL_IN_S | FL_RC_BIT, 0, 0, 0, 0}},
-	{824, Interpreter::srawix,      {"srawix", OPTYPE_INTEGER, FL_OUT_A | FL_IN_B | FL_IN_S | FL_RC_BIT, 0, 0, 0, 0}},
+	{792, Interpreter::srawx,       {"srawx",  OPTYPE_INTEGER, FL_OUT_A | FL_IN_B | FL_IN_S | FL_SET_CA | FL_RC_BIT, 0, 0, 0, 0}},
+	{824, Interpreter::srawix,      {"srawix", OPTYPE_INTEGER, FL_OUT_A | FL_IN_S | FL_SET_CA | FL_RC_BIT, 0, 0, 0, 0}},
 	{24,  Interpreter::slwx,        {"slwx",   OPTYPE_INTEGER, FL_OUT_A | FL_IN_B | FL_IN_S | FL_RC_BIT, 0, 0, 0, 0}},
 
 	{54,   Interpreter::dcbst,      {"dcbst",  OPTYPE_DCACHE, 0, 4, 0, 0, 0}},
@@ -221,34 +221,34 @@ static GekkoOPTemplate table31[] =
 	{597, Interpreter::lswi,        {"lswi",  OPTYPE_LOAD, FL_EVIL | FL_IN_AB | FL_OUT_D | FL_LOADSTORE, 0, 0, 0, 0}},
 
 	//store word
-	{151, Interpreter::stwx,        {"stwx",   OPTYPE_STORE, FL_IN_A0 | FL_IN_B | FL_LOADSTORE, 0, 0, 0, 0}},
-	{183, Interpreter::stwux,       {"stwux",  OPTYPE_STORE, FL_OUT_A | FL_IN_A | FL_IN_B | FL_LOADSTORE, 0, 0, 0, 0}},
+	{151, Interpreter::stwx,        {"stwx",   OPTYPE_STORE, FL_IN_A0 | FL_IN_B | FL_IN_S | FL_LOADSTORE, 0, 0, 0, 0}},
+	{183, Interpreter::stwux,       {"stwux",  OPTYPE_STORE, FL_OUT_A | FL_IN_A | FL_IN_B | FL_IN_S | FL_LOADSTORE, 0, 0, 0, 0}},
 
 	//store halfword
-	{407, Interpreter::sthx,        {"sthx",   OPTYPE_STORE, FL_IN_A0 | FL_IN_B | FL_LOADSTORE, 0, 0, 0, 0}},
-	{439, Interpreter::sthux,       {"sthux",  OPTYPE_STORE, FL_OUT_A | FL_IN_A | FL_IN_B | FL_LOADSTORE, 0, 0, 0, 0}},
+	{407, Interpreter::sthx,        {"sthx",   OPTYPE_STORE, FL_IN_A0 | FL_IN_B | FL_IN_S | FL_LOADSTORE, 0, 0, 0, 0}},
+	{439, Interpreter::sthux,       {"sthux",  OPTYPE_STORE, FL_OUT_A | FL_IN_A | FL_IN_B | FL_IN_S | FL_LOADSTORE, 0, 0, 0, 0}},
 
 	//store byte
-	{215, Interpreter::stbx,        {"stbx",   OPTYPE_STORE, FL_IN_A0 | FL_IN_B | FL_LOADSTORE, 0, 0, 0, 0}},
-	{247, Interpreter::stbux,       {"stbux",  OPTYPE_STORE, FL_OUT_A | FL_IN_A | FL_IN_B | FL_LOADSTORE, 0, 0, 0, 0}},
+	{215, Interpreter::stbx,        {"stbx",   OPTYPE_STORE, FL_IN_A0 | FL_IN_B | FL_IN_S | FL_LOADSTORE, 0, 0, 0, 0}},
+	{247, Interpreter::stbux,       {"stbux",  OPTYPE_STORE, FL_OUT_A | FL_IN_A | FL_IN_B | FL_IN_S | FL_LOADSTORE, 0, 0, 0, 0}},
 
 	//store bytereverse
-	{662, Interpreter::stwbrx,      {"stwbrx", OPTYPE_STORE, FL_IN_A0 | FL_IN_B | FL_LOADSTORE, 0, 0, 0, 0}},
-	{918, Interpreter::sthbrx,      {"sthbrx", OPTYPE_STORE, FL_IN_A | FL_IN_B | FL_LOADSTORE, 0, 0, 0, 0}},
+	{662, Interpreter::stwbrx,      {"stwbrx", OPTYPE_STORE, FL_IN_A0 | FL_IN_B | FL_IN_S | FL_LOADSTORE, 0, 0, 0, 0}},
+	{918, Interpreter::sthbrx,      {"sthbrx", OPTYPE_STORE, FL_IN_A0 | FL_IN_B | FL_IN_S | FL_LOADSTORE, 0, 0, 0, 0}},
 
 	{661, Interpreter::stswx,       {"stswx",  OPTYPE_STORE, FL_EVIL | FL_LOADSTORE, 0, 0, 0, 0}},
 	{725, Interpreter::stswi,       {"stswi",  OPTYPE_STORE, FL_EVIL | FL_LOADSTORE, 0, 0, 0, 0}},
 
 	// fp load/store
 	{535, Interpreter::lfsx,        {"lfsx",  OPTYPE_LOADFP, FL_IN_A0 | FL_IN_B | FL_USE_FPU | FL_LOADSTORE, 0, 0, 0, 0}},
-	{567, Interpreter::lfsux,       {"lfsux", OPTYPE_LOADFP, FL_IN_A | FL_IN_B | FL_USE_FPU | FL_LOADSTORE, 0, 0, 0, 0}},
+	{567, Interpreter::lfsux,       {"lfsux", OPTYPE_LOADFP, FL_OUT_A | FL_IN_A | FL_IN_B | FL_USE_FPU | FL_LOADSTORE, 0, 0, 0, 0}},
 	{599, Interpreter::lfdx,        {"lfdx",  OPTYPE_LOADFP, FL_IN_A0 | FL_IN_B | FL_USE_FPU | FL_LOADSTORE, 0, 0, 0, 0}},
-	{631, Interpreter::lfdux,       {"lfdux", OPTYPE_LOADFP, FL_IN_A | FL_IN_B | FL_USE_FPU | FL_LOADSTORE, 0, 0, 0, 0}},
+	{631, Interpreter::lfdux,       {"lfdux", OPTYPE_LOADFP, FL_OUT_A | FL_IN_A | FL_IN_B | FL_USE_FPU | FL_LOADSTORE, 0, 0, 0, 0}},
 
 	{663, Interpreter::stfsx,       {"stfsx",  OPTYPE_STOREFP, FL_IN_A0 | FL_IN_B | FL_USE_FPU | FL_LOADSTORE, 0, 0, 0, 0}},
-	{695, Interpreter::stfsux,      {"stfsux", OPTYPE_STOREFP, FL_IN_A | FL_IN_B | FL_USE_FPU | FL_LOADSTORE, 0, 0, 0, 0}},
+	{695, Interpreter::stfsux,      {"stfsux", OPTYPE_STOREFP, FL_OUT_A | FL_IN_A | FL_IN_B | FL_USE_FPU | FL_LOADSTORE, 0, 0, 0, 0}},
 	{727, Interpreter::stfdx,       {"stfdx",  OPTYPE_STOREFP, FL_IN_A0 | FL_IN_B | FL_USE_FPU | FL_LOADSTORE, 0, 0, 0, 0}},
-	{759, Interpreter::stfdux,      {"stfdux", OPTYPE_STOREFP, FL_IN_A | FL_IN_B | FL_USE_FPU | FL_LOADSTORE, 0, 0, 0, 0}},
+	{759, Interpreter::stfdux,      {"stfdux", OPTYPE_STOREFP, FL_OUT_A | FL_IN_A | FL_IN_B | FL_USE_FPU | FL_LOADSTORE, 0, 0, 0, 0}},
 	{983, Interpreter::stfiwx,      {"stfiwx", OPTYPE_STOREFP, FL_IN_A0 | FL_IN_B | FL_USE_FPU | FL_LOADSTORE, 0, 0, 0, 0}},
 
 	{19,  Interpreter::mfcr,        {"mfcr",   OPTYPE_SYSTEM, FL_OUT_D, 0, 0, 0, 0}},
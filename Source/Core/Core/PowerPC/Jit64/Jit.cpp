@@ -172,6 +172,15 @@ void Jit64::Init()
 	jo.fastInterrupts = false;
 	jo.accurateSinglePrecision = true;
 	js.memcheck = Core::g_CoreStartupParameter.bMMU;
+#ifdef _M_X64
+	// Loops keep registers in host registers across iterations, which needs
+	// more of them than x86-32 has. The MMU checks flush after every access.
+	jo.optimizeLoops = !Core::g_CoreStartupParameter.bMMU && !Core::g_CoreStartupParameter.bEnableDebugging;
+#else
+	jo.optimizeLoops = false;
+#endif
+	hot_loops.clear();
+	memset(gqr_changes, 0, sizeof(gqr_changes));
 
 	gpr.SetEmitter(this);
 	fpr.SetEmitter(this);
@@ -180,11 +189,13 @@ void Jit64::Init()
 	AllocCodeSpace(CODE_SIZE);
 
 	blocks.Init();
+	blocks.InitRegions(region, region_size);
 	asm_routines.Init();
 }
 
 void Jit64::ClearCache()
 {
+	coverageAddressAtLoc.clear();
 	blocks.Clear();
 	trampolines.ClearCodeSpace();
 	ClearCodeSpace();
@@ -209,10 +220,31 @@ void Jit64::WriteCallInterpreter(UGeckoInstruction inst)
 		MOV(32, M(&PC), Imm32(js.compilerPC));
 		MOV(32, M(&NPC), Imm32(js.compilerPC + 4));
 	}
+	CountCoverage(JitCoverage::SITE_FALLBACK);
 	Interpreter::_interpreterInstruction instr = GetInterpreterOp(inst);
 	ABI_CallFunctionC((void*)instr, inst.hex);
 }
 
+void Jit64::WriteFPUnavailableCheck(u32 address)
+{
+	gpr.Flush(FLUSH_ALL);
+	fpr.Flush(FLUSH_ALL);
+
+	//This instruction uses FPU - needs to add FP exception bailout
+	TEST(32, M(&PowerPC::ppcState.msr), Imm32(1 << 13)); // Test FP enabled bit
+	FixupBranch b1 = J_CC(CC_NZ, true);
+
+	// If a FPU exception occurs, the exception handler will read
+	// from PC.  Update PC with the latest value in case that happens.
+	MOV(32, M(&PC), Imm32(address));
+	OR(32, M((void *)&PowerPC::ppcState.Exceptions), Imm32(EXCEPTION_FPU_UNAVAILABLE));
+	WriteExceptionExit();
+
+	SetJumpTarget(b1);
+
+	js.firstFPInstructionFound = true;
+}
+
 void Jit64::unknown_instruction(UGeckoInstruction inst)
 {
 	PanicAlert("unknown_instruction %08x - Fix me ;)", inst.hex);
@@ -285,6 +317,10 @@ void Jit64::WriteExit(u32 destination, int exit_num)
 	//If nobody has taken care of this yet (this can be removed when all branches are done)
 	JitBlock *b = js.curBlock;
 	b->exitAddress[exit_num] = destination;
+
+	// Set the PC even when linking, the block cache may evict the destination
+	// and point the jump back at the dispatcher
+	MOV(32, M(&PC), Imm32(destination));
 	b->exitPtrs[exit_num] = GetWritableCodePtr();
 
 	// Link opportunity!
@@ -299,10 +335,18 @@ void Jit64::WriteExit(u32 destination, int exit_num)
 			return;
 		}
 	}
-	MOV(32, M(&PC), Imm32(destination));
 	JMP(asm_routines.dispatcher, true);
 }
 
+// Taken branch of an idle loop. Nothing can change before the next event, so
+// skip to it, then check for the interrupts it may have raised.
+void Jit64::WriteIdleExit(u32 destination)
+{
+	ABI_CallFunctionC((void *)&PowerPC::OnIdleLoop, destination);
+	MOV(32, M(&PC), Imm32(destination));
+	WriteExceptionExit();
+}
+
 void Jit64::WriteExitDestInEAX()
 {
 	MOV(32, M(&PC), R(EAX));
@@ -384,16 +428,101 @@ void Jit64::Trace()
 
 void STACKALIGN Jit64::Jit(u32 em_address)
 {
-	if (GetSpaceLeft() < 0x10000 || blocks.IsFull() || Core::g_CoreStartupParameter.bJITNoBlockCache)
+	if (trampolines.GetSpaceLeft() < 0x10000 || Core::g_CoreStartupParameter.bJITNoBlockCache)
 	{
 		ClearCache();
 	}
 
+	// Evicts the coldest code when the code space or the block table is full
+	SetCodePtr(blocks.AllocateCode(em_address, GetWritableCodePtr()));
+
 	int block_num = blocks.AllocateBlock(em_address);
 	JitBlock *b = blocks.GetBlock(block_num);
 	blocks.FinalizeBlock(block_num, jo.enableBlocklink, DoJit(em_address, &code_buffer, b));
 }
 
+// A block ending in a conditional branch back to its own start, bdnz or bne
+// for example, which is how most inner loops look after Flatten.
+static bool IsSelfLoop(const PPCAnalyst::CodeOp *ops, int size, u32 em_address)
+{
+	if (size == 0)
+		return false;
+
+	const PPCAnalyst::CodeOp &last = ops[size - 1];
+	UGeckoInstruction inst = last.inst;
+	return inst.OPCD == 16 && !inst.LK && !inst.AA && !last.skip &&
+		last.address + SignExt16(inst.BD << 2) == em_address;
+}
+
+// Loads what the loop uses most into host registers before its header. The
+// branch at the end keeps them there when it jumps back to the header, so the
+// values a loop carries from one iteration to the next, and the ones it only
+// reads, are never stored or reloaded while it runs.
+void Jit64::StartLoop(PPCAnalyst::CodeOp *ops, int size)
+{
+	int gpr_uses[32] = {0};
+	int fpr_uses[32] = {0};
+	u32 gpr_written = 0;
+	u32 fpr_written = 0;
+	bool uses_fpu = false;
+
+	for (int i = 0; i < size; i++)
+	{
+		const PPCAnalyst::CodeOp &op = ops[i];
+		if (op.skip)
+			continue;
+
+		for (int j = 0; j < 3; j++)
+		{
+			if (op.regsIn[j] >= 0)
+				gpr_uses[op.regsIn[j]]++;
+		}
+		for (int j = 0; j < 2; j++)
+		{
+			if (op.regsOut[j] >= 0)
+			{
+				gpr_uses[op.regsOut[j]]++;
+				gpr_written |= 1 << op.regsOut[j];
+			}
+		}
+
+		// The analyst doesn't track FPRs. FD and FS share their field, take it
+		// as both read and written; the other fields are GPRs for loads and stores.
+		const int flags = op.opinfo->flags;
+		if (flags & FL_USE_FPU)
+		{
+			uses_fpu = true;
+			fpr_uses[op.inst.FD]++;
+			fpr_written |= 1 << op.inst.FD;
+			if (!(flags & FL_LOADSTORE))
+			{
+				fpr_uses[op.inst.FA]++;
+				fpr_uses[op.inst.FB]++;
+				fpr_uses[op.inst.FC]++;
+			}
+		}
+	}
+
+	// The loop can't change MSR, so checking once before it is enough
+	if (uses_fpu)
+		WriteFPUnavailableCheck(js.blockStart);
+
+	gpr.StartLoop(gpr_uses, gpr_written);
+	fpr.StartLoop(fpr_uses, fpr_written);
+
+	js.loopHeader = GetCodePtr();
+}
+
+void Jit64::PromoteLoop(u32 em_address)
+{
+	INFO_LOG(DYNA_REC, "Hot loop at %08x, recompiling it", em_address);
+	hot_loops.insert(em_address);
+
+	// The block that called this is destroyed here, but its code stays in place
+	// until it exits back to the dispatcher, which then compiles the loop.
+	blocks.InvalidateICache(em_address, 4);
+}
+
 const u8* Jit64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer *code_buf, JitBlock *b)
 {
 	int blockSize = code_buf->GetSize();
@@ -451,13 +580,33 @@ const u8* Jit64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer *code_buf, JitBloc
 	{
 		// If there is a memory exception inside a block (broken_block==true), compile up to that instruction.
 		nextPC = PPCAnalyst::Flatten(em_address, &size, &js.st, &js.gpa, &js.fpa, broken_block, code_buf, blockSize, merged_addresses, capacity_of_merged_addresses, size_of_merged_addresses);
+		if (!Core::g_CoreStartupParameter.bEnableDebugging)
+			PPCAnalyst::OptimizeBlock(code_buf->codebuffer, size);
 	}
 
 	PPCAnalyst::CodeOp *ops = code_buf->codebuffer;
 
+	js.countLoop = false;
+	js.isLoop = false;
+	js.loopHeader = NULL;
+	js.isIdleLoop = false;
+	if (SConfig::GetInstance().m_LocalCoreStartupParameter.bSkipIdle && !memory_exception && !broken_block &&
+		PPCAnalyst::IsIdleLoop(ops, size, em_address))
+	{
+		js.isIdleLoop = true;
+	}
+	else if (jo.optimizeLoops && !memory_exception && !broken_block && IsSelfLoop(ops, size, em_address))
+	{
+		if (hot_loops.find(em_address) != hot_loops.end())
+			js.isLoop = true;
+		else
+			js.countLoop = true;
+	}
+
 	const u8 *start = AlignCode4(); // TODO: Test if this or AlignCode16 make a difference from GetCodePtr
 	b->checkedEntry = start;
 	b->runCount = 0;
+	b->loopCount = 0;
 
 	// Downcount flag check. The last block decremented downcounter, and the flag should still be available.
 	FixupBranch skip = J_CC(CC_NBE);
@@ -504,7 +653,11 @@ const u8* Jit64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer *code_buf, JitBloc
 		}
 	}
 
+	if (js.isLoop)
+		StartLoop(ops, size);
+
 	js.skipnext = false;
+	js.deferredCR0Reg = -1;
 	js.blockSize = size;
 	js.compilerPC = nextPC;
 	// Translate instructions
@@ -572,24 +725,7 @@ const u8* Jit64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer *code_buf, JitBloc
 		if (!ops[i].skip)
 		{
 			if ((opinfo->flags & FL_USE_FPU) && !js.firstFPInstructionFound)
-			{
-				gpr.Flush(FLUSH_ALL);
-				fpr.Flush(FLUSH_ALL);
-
-				//This instruction uses FPU - needs to add FP exception bailout
-				TEST(32, M(&PowerPC::ppcState.msr), Imm32(1 << 13)); // Test FP enabled bit
-				FixupBranch b1 = J_CC(CC_NZ, true);
-
-				// If a FPU exception occurs, the exception handler will read
-				// from PC.  Update PC with the latest value in case that happens.
-				MOV(32, M(&PC), Imm32(ops[i].address));
-				OR(32, M((void *)&PowerPC::ppcState.Exceptions), Imm32(EXCEPTION_FPU_UNAVAILABLE));
-				WriteExceptionExit();
-
-				SetJumpTarget(b1);
-
-				js.firstFPInstructionFound = true;
-			}
+				WriteFPUnavailableCheck(ops[i].address);
 
 			// Add an external exception check if the instruction writes to the FIFO.
 			if (jit->js.fifoWriteAddresses.find(ops[i].address) != jit->js.fifoWriteAddresses.end())
@@ -629,7 +765,10 @@ const u8* Jit64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer *code_buf, JitBloc
 				SetJumpTarget(noBreakpoint);
 			}
 
-			Jit64Tables::CompileInstruction(ops[i]);
+			if (ops[i].outputIsConstant)
+				gpr.SetImmediate32(ops[i].regsOut[0], ops[i].constantValue);
+			else
+				Jit64Tables::CompileInstruction(ops[i]);
 
 			if (js.memcheck && (opinfo->flags & FL_LOADSTORE))
 			{
@@ -713,6 +852,8 @@ const u8* Jit64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer *code_buf, JitBloc
 	b->flags = js.block_flags;
 	b->codeSize = (u32)(GetCodePtr() - normalEntry);
 	b->originalSize = size;
+	b->lookaheadStart = js.st.crLookaheadStart;
+	b->lookaheadEnd = js.st.crLookaheadEnd;
 
 #ifdef JIT_LOG_X86
 	LogGeneratedX86(size, code_buf, normalEntry, b);
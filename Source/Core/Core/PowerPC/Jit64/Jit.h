@@ -19,6 +19,8 @@
 #ifndef _JIT64_H
 #define _JIT64_H
 
+#include <set>
+
 #include "../JitCommon/JitBackpatch.h"
 #include "../JitCommon/JitBase.h"
 #include "../JitCommon/JitCache.h"
@@ -58,6 +60,20 @@ private:
 	PPCAnalyst::CodeBuffer code_buffer;
 	Jit64AsmRoutineManager asm_routines;
 
+	// Start addresses of the loops that took enough back-edges to be recompiled
+	// with registers kept live across them. Kept over cache clears.
+	std::set<u32> hot_loops;
+
+	void StartLoop(PPCAnalyst::CodeOp *ops, int size);
+
+	// How often a change of each GQR destroyed the blocks specialized on it.
+	// psq_l and psq_st stop specializing on GQRs that keep changing.
+	int gqr_changes[8];
+
+	bool SpecializeGQR(int gqr);
+	void GenQuantizedLoad(bool single, EQuantizeType type, int scale);
+	void GenQuantizedStore(bool single, EQuantizeType type, int scale);
+
 public:
 	Jit64() : code_buffer(32000) {}
 	~Jit64() {}
@@ -76,6 +92,12 @@ public:
 
 	void Trace();
 
+	// Called from a counting loop block once it is hot
+	void PromoteLoop(u32 em_address);
+
+	// Called from mtspr when it changed a GQR
+	void GQRChanged(int gqr);
+
 	void ClearCache() override;
 
 	const u8 *GetDispatcher() {
@@ -100,11 +122,15 @@ public:
 	// Utilities for use by opcodes
 
 	void WriteExit(u32 destination, int exit_num);
+	void WriteIdleExit(u32 destination);
 	void WriteExitDestInEAX();
 	void WriteExceptionExit();
 	void WriteExternalExceptionExit();
 	void WriteRfiExitDestInEAX();
 	void WriteCallInterpreter(UGeckoInstruction _inst);
+	void WriteFPUnavailableCheck(u32 address);
+	void WriteLoopCounter();
+	void WriteLoopBackEdge();
 	void Cleanup();
 
 	void GenerateConstantOverflow(bool overflow);
@@ -115,6 +141,8 @@ public:
 	void GenerateCarry();
 	void GenerateRC();
 	void ComputeRC(const Gen::OpArg & arg);
+	bool CanSkipCRField(int field);
+	Gen::FixupBranch JumpIfCRBit(int bit, bool jump_if_set);
 
 	void tri_op(int d, int a, int b, bool reversible, void (XEmitter::*op)(Gen::X64Reg, Gen::OpArg));
 	typedef u32 (*Operation)(u32 a, u32 b);
@@ -19,6 +19,9 @@ RegCache::RegCache() : emit(0)
 	memset(xregs, 0, sizeof(xregs));
 	memset(saved_regs, 0, sizeof(saved_regs));
 	memset(saved_xregs, 0, sizeof(saved_xregs));
+	memset(loop_dirty, 0, sizeof(loop_dirty));
+	for (auto& xr : loop_xregs)
+		xr = INVALID_REG;
 }
 
 void RegCache::Start(PPCAnalyst::BlockRegStats &stats)
@@ -33,6 +36,7 @@ void RegCache::Start(PPCAnalyst::BlockRegStats &stats)
 	{
 		regs[i].location = GetDefaultLocation(i);
 		regs[i].away = false;
+		loop_xregs[i] = INVALID_REG;
 	}
 
 	// todo: sort to find the most popular regs
@@ -133,6 +137,58 @@ void RegCache::LoadState()
 	memcpy(xregs, saved_xregs, sizeof(xregs));
 }
 
+void RegCache::StartLoop(const int *uses, u32 written)
+{
+	// Leave some host registers to the temporaries of the loop body
+	int count;
+	GetAllocationOrder(count);
+	const int max_loop_regs = count - 4;
+
+	for (int n = 0; n < max_loop_regs; n++)
+	{
+		int best = -1;
+		for (int i = 0; i < 32; i++)
+		{
+			if (uses[i] && loop_xregs[i] == INVALID_REG && (best < 0 || uses[i] > uses[best]))
+				best = i;
+		}
+		if (best < 0)
+			break;
+
+		// Registers the loop writes are dirty at the header, as they will be on the back-edge
+		BindToRegister(best, true, false);
+		loop_xregs[best] = RX(best);
+		loop_dirty[best] = (written & (1 << best)) != 0;
+		xregs[loop_xregs[best]].dirty = loop_dirty[best];
+	}
+}
+
+void RegCache::SyncLoop()
+{
+	for (int i = 0; i < 32; i++)
+	{
+		if (!regs[i].away)
+			continue;
+
+		// Keep what is already in place. A register the loop wasn't thought to
+		// write is stored and reloaded, so that it is clean again.
+		if (IsBound(i) && RX(i) == loop_xregs[i] && (loop_dirty[i] || !xregs[RX(i)].dirty))
+			continue;
+
+		StoreFromRegister(i);
+	}
+
+	for (int i = 0; i < 32; i++)
+	{
+		if (loop_xregs[i] == INVALID_REG)
+			continue;
+
+		if (!regs[i].away)
+			LoadToX64(i, loop_xregs[i]);
+		xregs[loop_xregs[i]].dirty = loop_dirty[i];
+	}
+}
+
 void RegCache::FlushR(X64Reg reg)
 {
 	if (reg >= NUMXREGS)
@@ -314,6 +370,19 @@ void GPRRegCache::StoreFromRegister(int i)
 	}
 }
 
+void GPRRegCache::LoadToX64(int i, X64Reg xr)
+{
+	if (!xregs[xr].free || regs[i].away)
+		PanicAlert("LoadToX64: r%i or its host register %i is in use", i, xr);
+
+	xregs[xr].free = false;
+	xregs[xr].ppcReg = i;
+	xregs[xr].dirty = false;
+	emit->MOV(32, ::Gen::R(xr), regs[i].location);
+	regs[i].away = true;
+	regs[i].location = ::Gen::R(xr);
+}
+
 void FPURegCache::BindToRegister(int i, bool doLoad, bool makeDirty)
 {
 	_assert_msg_(DYNA_REC, !regs[i].location.IsImm(), "WTF - load - imm");
@@ -366,6 +435,19 @@ void FPURegCache::StoreFromRegister(int i)
 	}
 }
 
+void FPURegCache::LoadToX64(int i, X64Reg xr)
+{
+	if (!xregs[xr].free || regs[i].away)
+		PanicAlert("LoadToX64: f%i or its host register %i is in use", i, xr);
+
+	xregs[xr].free = false;
+	xregs[xr].ppcReg = i;
+	xregs[xr].dirty = false;
+	emit->MOVAPD(xr, regs[i].location);
+	regs[i].away = true;
+	regs[i].location = ::Gen::R(xr);
+}
+
 void RegCache::Flush(FlushMode mode)
 {
 	for (int i = 0; i < NUMXREGS; i++)
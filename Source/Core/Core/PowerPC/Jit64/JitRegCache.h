@@ -57,6 +57,10 @@ protected:
 	PPCCachedReg saved_regs[32];
 	X64CachedReg saved_xregs[NUMXREGS];
 
+	// Where each PPC register lives at the header of a loop block, INVALID_REG if in memory
+	X64Reg loop_xregs[32];
+	bool loop_dirty[32];
+
 	virtual const int *GetAllocationOrder(int &count) = 0;
 
 	XEmitter *emit;
@@ -89,6 +93,8 @@ public:
 	//read only will not set dirty flag
 	virtual void BindToRegister(int preg, bool doLoad = true, bool makeDirty = true) = 0;
 	virtual void StoreFromRegister(int preg) = 0;
+	// Loads preg into xr, which must be free
+	virtual void LoadToX64(int preg, X64Reg xr) = 0;
 
 	const OpArg &R(int preg) const {return regs[preg].location;}
 	X64Reg RX(int preg) const
@@ -121,6 +127,12 @@ public:
 
 	void SaveState();
 	void LoadState();
+
+	// Binds the most used registers of a loop for its whole run. uses counts the
+	// accesses to each register, written has a bit set for each one the loop writes.
+	void StartLoop(const int *uses, u32 written);
+	// Puts every register back where StartLoop left it, so the back-edge can jump to the header
+	void SyncLoop();
 };
 
 class GPRRegCache : public RegCache
@@ -129,6 +141,7 @@ public:
 	void Start(PPCAnalyst::BlockRegStats &stats) override;
 	void BindToRegister(int preg, bool doLoad = true, bool makeDirty = true) override;
 	void StoreFromRegister(int preg) override;
+	void LoadToX64(int preg, X64Reg xr) override;
 	OpArg GetDefaultLocation(int reg) const override;
 	const int *GetAllocationOrder(int &count) override;
 	void SetImmediate32(int preg, u32 immValue);
@@ -141,6 +154,7 @@ public:
 	void Start(PPCAnalyst::BlockRegStats &stats) override;
 	void BindToRegister(int preg, bool doLoad = true, bool makeDirty = true) override;
 	void StoreFromRegister(int preg) override;
+	void LoadToX64(int preg, X64Reg xr) override;
 	const int *GetAllocationOrder(int &count) override;
 	OpArg GetDefaultLocation(int reg) const override;
 };
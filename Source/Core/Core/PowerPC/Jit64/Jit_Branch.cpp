@@ -83,11 +83,13 @@ void Jit64::bx(UGeckoInstruction inst)
 	if (inst.LK)
 		AND(32, M(&PowerPC::ppcState.cr), Imm32(~(0xFF000000)));
 #endif
+	if (js.isIdleLoop && destination == js.blockStart)
+	{
+		WriteIdleExit(destination);
+		return;
+	}
 	if (destination == js.compilerPC)
 	{
-		//PanicAlert("Idle loop detected at %08x", destination);
-		//	CALL(ProtectFunction(&CoreTiming::Idle, 0));
-		//	JMP(Asm::testExceptions, true);
 		// make idle loops go faster
 		js.downcountAmount += 8;
 	}
@@ -95,6 +97,26 @@ void Jit64::bx(UGeckoInstruction inst)
 }
 
 // TODO - optimize to hell and beyond
+// Jumps if the CR bit is set, or if it is clear. A record form right before
+// the branch may have left CR0 unwritten, then its result is compared instead.
+FixupBranch Jit64::JumpIfCRBit(int bit, bool jump_if_set)
+{
+	const int field = bit >> 2;
+	const int mask = 8 >> (bit & 3);
+	if (field == 0 && js.deferredCR0Reg >= 0)
+	{
+		_assert_msg_(DYNA_REC, mask != 1, "SO of a deferred CR0 tested");
+		CMP(32, gpr.R(js.deferredCR0Reg), Imm8(0));
+		js.deferredCR0Reg = -1;
+		CCFlags cc = mask == 8 ? CC_L : (mask == 4 ? CC_G : CC_E);
+		// The conditions come in pairs that differ in the lowest bit
+		return J_CC(jump_if_set ? cc : (CCFlags)(cc ^ 1));
+	}
+
+	TEST(8, M(&PowerPC::ppcState.cr_fast[field]), Imm8(mask));
+	return J_CC(jump_if_set ? CC_NZ : CC_Z);
+}
+
 // TODO - make nice easy to optimize special cases for the most common
 // variants of this instruction.
 void Jit64::bcx(UGeckoInstruction inst)
@@ -105,8 +127,25 @@ void Jit64::bcx(UGeckoInstruction inst)
 	// USES_CR
 	_assert_msg_(DYNA_REC, js.isLastInstruction, "bcx not last instruction of block");
 
-	gpr.Flush(FLUSH_ALL);
-	fpr.Flush(FLUSH_ALL);
+	u32 destination;
+	if(inst.AA)
+		destination = SignExt16(inst.BD << 2);
+	else
+		destination = js.compilerPC + SignExt16(inst.BD << 2);
+
+	// Registers stay where the loop header expects them on both paths, the
+	// exits flush them once the branch is decided.
+	const bool loop = js.isLoop && destination == js.blockStart;
+	if (loop)
+	{
+		gpr.SyncLoop();
+		fpr.SyncLoop();
+	}
+	else
+	{
+		gpr.Flush(FLUSH_ALL);
+		fpr.Flush(FLUSH_ALL);
+	}
 
 	FixupBranch pCTRDontBranch;
 	if ((inst.BO & BO_DONT_DECREMENT_FLAG) == 0)  // Decrement and test CTR
@@ -120,31 +159,89 @@ void Jit64::bcx(UGeckoInstruction inst)
 
 	FixupBranch pConditionDontBranch;
 	if ((inst.BO & BO_DONT_CHECK_CONDITION) == 0)  // Test a CR bit
-	{
-		TEST(8, M(&PowerPC::ppcState.cr_fast[inst.BI >> 2]), Imm8(8 >> (inst.BI & 3)));
-		if (inst.BO & BO_BRANCH_IF_TRUE)  // Conditional branch
-			pConditionDontBranch = J_CC(CC_Z);
-		else
-			pConditionDontBranch = J_CC(CC_NZ);
-	}
+		pConditionDontBranch = JumpIfCRBit(inst.BI, !(inst.BO & BO_BRANCH_IF_TRUE));
 
 	if (inst.LK)
 		MOV(32, M(&LR), Imm32(js.compilerPC + 4));
 
-	u32 destination;
-	if(inst.AA)
-		destination = SignExt16(inst.BD << 2);
+	if (loop)
+	{
+		WriteLoopBackEdge();
+	}
+	else if (js.isIdleLoop && destination == js.blockStart)
+	{
+		WriteIdleExit(destination);
+	}
 	else
-		destination = js.compilerPC + SignExt16(inst.BD << 2);
-	WriteExit(destination, 0);
+	{
+		if (js.countLoop && destination == js.blockStart)
+			WriteLoopCounter();
+		WriteExit(destination, 0);
+	}
 
 	if ((inst.BO & BO_DONT_CHECK_CONDITION) == 0)
 		SetJumpTarget( pConditionDontBranch );
 	if ((inst.BO & BO_DONT_DECREMENT_FLAG) == 0)
 		SetJumpTarget( pCTRDontBranch );
+	if (loop)
+	{
+		gpr.Flush(FLUSH_ALL);
+		fpr.Flush(FLUSH_ALL);
+	}
 	WriteExit(js.compilerPC + 4, 1);
 }
 
+// Back-edges a loop takes before it is recompiled with its registers kept live
+static const int LOOP_PROMOTION_THRESHOLD = 1000;
+
+static void PromoteHotLoop(u32 em_address)
+{
+	static_cast<Jit64 *>(jit)->PromoteLoop(em_address);
+}
+
+// Hands the loop over to PromoteLoop after LOOP_PROMOTION_THRESHOLD
+// iterations. Registers are flushed at this point.
+void Jit64::WriteLoopCounter()
+{
+#ifdef _M_IX86
+	OpArg counter = M(&js.curBlock->loopCount);
+#else
+	MOV(64, R(RAX), ImmPtr(&js.curBlock->loopCount));
+	OpArg counter = MatR(RAX);
+#endif
+	ADD(32, counter, Imm8(1));
+	CMP(32, counter, Imm32(LOOP_PROMOTION_THRESHOLD));
+	FixupBranch cold = J_CC(CC_NE);
+	ABI_CallFunctionC((void *)&PromoteHotLoop, js.blockStart);
+	SetJumpTarget(cold);
+}
+
+// Taken back-edge of a hot loop, with the registers in their header locations
+void Jit64::WriteLoopBackEdge()
+{
+	if ((jo.optimizeGatherPipe && js.fifoBytesThisBlock > 0) || MMCR0.Hex || MMCR1.Hex)
+	{
+		u32 registersInUse = RegistersInUse();
+		ABI_PushRegistersAndAdjustStack(registersInUse, false);
+		Cleanup();
+		ABI_PopRegistersAndAdjustStack(registersInUse, false);
+	}
+
+	SUB(32, M(&CoreTiming::downcount), js.downcountAmount > 127 ? Imm32(js.downcountAmount) : Imm8(js.downcountAmount));
+	J_CC(CC_NBE, js.loopHeader, true);
+
+	// Out of cycles, leave through doTiming like the check at the top of the
+	// block does. The not taken path still needs the registers as they are.
+	gpr.SaveState();
+	fpr.SaveState();
+	gpr.Flush(FLUSH_ALL);
+	fpr.Flush(FLUSH_ALL);
+	MOV(32, M(&PC), Imm32(js.blockStart));
+	JMP(asm_routines.doTiming, true);
+	gpr.LoadState();
+	fpr.LoadState();
+}
+
 void Jit64::bcctrx(UGeckoInstruction inst)
 {
 	INSTRUCTION_START
@@ -221,13 +318,7 @@ void Jit64::bclrx(UGeckoInstruction inst)
 
 	FixupBranch pConditionDontBranch;
 	if ((inst.BO & BO_DONT_CHECK_CONDITION) == 0)  // Test a CR bit
-	{
-		TEST(8, M(&PowerPC::ppcState.cr_fast[inst.BI >> 2]), Imm8(8 >> (inst.BI & 3)));
-		if (inst.BO & BO_BRANCH_IF_TRUE)  // Conditional branch
-			pConditionDontBranch = J_CC(CC_Z);
-		else
-			pConditionDontBranch = J_CC(CC_NZ);
-	}
+		pConditionDontBranch = JumpIfCRBit(inst.BI, !(inst.BO & BO_BRANCH_IF_TRUE));
 
 		// This below line can be used to prove that blr "eats flags" in practice.
 		// This observation will let us do a lot of fun observations.
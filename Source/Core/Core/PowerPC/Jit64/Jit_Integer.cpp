@@ -5,6 +5,7 @@
 #include "Jit.h"
 #include "JitRegCache.h"
 #include "JitAsm.h"
+#include "../../HLE/HLE.h"
 
 void Jit64::GenerateConstantOverflow(bool overflow)
 {
@@ -53,7 +54,7 @@ void Jit64::FinalizeCarryOverflow(bool oe, bool inv)
 		SetJumpTarget(carry2);
 		SetJumpTarget(exit);
 	}
-	else
+	else if (js.op->wantsCA)
 	{
 		// Do carry
 		FixupBranch carry1 = J_CC(inv ? CC_C : CC_NC);
@@ -106,6 +107,8 @@ void Jit64::FinalizeCarryGenerateOverflowEAX(bool oe, bool inv)
 void Jit64::GenerateCarry()
 {
 	// USES_XER
+	if (!js.op->wantsCA)
+		return;
 	FixupBranch pNoCarry = J_CC(CC_NC);
 	OR(32, M(&PowerPC::ppcState.spr[SPR_XER]), Imm32(XER_CA_MASK));
 	FixupBranch pContinue = J();
@@ -114,9 +117,36 @@ void Jit64::GenerateCarry()
 	SetJumpTarget(pContinue);
 }
 
+// True if the next instruction is a conditional branch on a bit of the CR
+// field, other than SO, that the JIT compiles itself, and nothing after that
+// branch reads the field. The field then only has to reach the branch.
+bool Jit64::CanSkipCRField(int field)
+{
+	if (js.isLastInstruction || Core::g_CoreStartupParameter.bEnableDebugging ||
+		Core::g_CoreStartupParameter.bJITOff || Core::g_CoreStartupParameter.bJITBranchOff)
+		return false;
+
+	const PPCAnalyst::CodeOp &branch = js.op[1];
+	const UGeckoInstruction next = branch.inst;
+	if (branch.skip || !(next.OPCD == 16 || (next.OPCD == 19 && next.SUBOP10 == 16)))
+		return false;
+	if ((next.BO & BO_DONT_CHECK_CONDITION) || (next.BI >> 2) != field || (next.BI & 3) == 3)
+		return false;
+	if (HLE::GetFunctionIndex(branch.address))
+		return false;
+
+	return !(branch.crFieldsWanted & (1 << field));
+}
+
 // Assumes that Sign and Zero flags were set by the last operation. Preserves all flags and registers.
 void Jit64::GenerateRC()
 {
+	if (js.op->regsOut[0] >= 0 && CanSkipCRField(0))
+	{
+		js.deferredCR0Reg = js.op->regsOut[0];
+		return;
+	}
+
 	FixupBranch pZero  = J_CC(CC_Z);
 	FixupBranch pNegative = J_CC(CC_S);
 	MOV(8, M(&PowerPC::ppcState.cr_fast[0]), Imm8(0x4)); // Result > 0
@@ -145,6 +175,11 @@ void Jit64::ComputeRC(const Gen::OpArg & arg)
 		else
 			MOV(8, M(&PowerPC::ppcState.cr_fast[0]), Imm8(0x2));
 	}
+	else if (js.op->regsOut[0] >= 0 && CanSkipCRField(0))
+	{
+		// The branch compares the result itself
+		js.deferredCR0Reg = js.op->regsOut[0];
+	}
 	else
 	{
 		if (arg.IsSimpleReg())
@@ -376,7 +411,8 @@ void Jit64::cmpXX(UGeckoInstruction inst)
 			else
 				compareResult = 0x8;
 		}
-		MOV(8, M(&PowerPC::ppcState.cr_fast[crf]), Imm8(compareResult));
+		if (!merge_branch || !CanSkipCRField(crf))
+			MOV(8, M(&PowerPC::ppcState.cr_fast[crf]), Imm8(compareResult));
 		gpr.UnlockAll();
 
 		if (merge_branch)
@@ -482,21 +518,34 @@ void Jit64::cmpXX(UGeckoInstruction inst)
 
 			gpr.Flush(FLUSH_ALL);
 			fpr.Flush(FLUSH_ALL);
-			FixupBranch pLesser  = J_CC(less_than);
-			FixupBranch pGreater = J_CC(greater_than);
-			MOV(8, M(&PowerPC::ppcState.cr_fast[crf]), Imm8(0x2));  //  == 0
-			FixupBranch continue1 = J();
-
-			SetJumpTarget(pGreater);
-			MOV(8, M(&PowerPC::ppcState.cr_fast[crf]), Imm8(0x4));  //  > 0
-			FixupBranch continue2 = J();
 
-			SetJumpTarget(pLesser);
-			MOV(8, M(&PowerPC::ppcState.cr_fast[crf]), Imm8(0x8));  //  < 0
-			FixupBranch continue3;
-			if (!!(8 & test_bit) == condition) continue3 = J();
-			if (!!(4 & test_bit) != condition) SetJumpTarget(continue2);
-			if (!!(2 & test_bit) != condition) SetJumpTarget(continue1);
+			// If nothing after the branch reads the field, it never gets
+			// written and the branch goes straight off the flags.
+			const bool skip_cr = CanSkipCRField(crf);
+			FixupBranch pDontBranch, continue1, continue2, continue3;
+			if (skip_cr)
+			{
+				Gen::CCFlags cc = test_bit == 8 ? less_than : (test_bit == 4 ? greater_than : CC_E);
+				// The conditions come in pairs that differ in the lowest bit
+				pDontBranch = J_CC(condition ? cc : (Gen::CCFlags)(cc ^ 1));
+			}
+			else
+			{
+				FixupBranch pLesser  = J_CC(less_than);
+				FixupBranch pGreater = J_CC(greater_than);
+				MOV(8, M(&PowerPC::ppcState.cr_fast[crf]), Imm8(0x2));  //  == 0
+				continue1 = J();
+
+				SetJumpTarget(pGreater);
+				MOV(8, M(&PowerPC::ppcState.cr_fast[crf]), Imm8(0x4));  //  > 0
+				continue2 = J();
+
+				SetJumpTarget(pLesser);
+				MOV(8, M(&PowerPC::ppcState.cr_fast[crf]), Imm8(0x8));  //  < 0
+				if (!!(8 & test_bit) == condition) continue3 = J();
+				if (!!(4 & test_bit) != condition) SetJumpTarget(continue2);
+				if (!!(2 & test_bit) != condition) SetJumpTarget(continue1);
+			}
 			if (js.next_inst.OPCD == 16) // bcx
 			{
 				if (js.next_inst.LK)
@@ -530,9 +579,16 @@ void Jit64::cmpXX(UGeckoInstruction inst)
 				PanicAlert("WTF invalid branch");
 			}
 
-			if (!!(8 & test_bit) == condition) SetJumpTarget(continue3);
-			if (!!(4 & test_bit) == condition) SetJumpTarget(continue2);
-			if (!!(2 & test_bit) == condition) SetJumpTarget(continue1);
+			if (skip_cr)
+			{
+				SetJumpTarget(pDontBranch);
+			}
+			else
+			{
+				if (!!(8 & test_bit) == condition) SetJumpTarget(continue3);
+				if (!!(4 & test_bit) == condition) SetJumpTarget(continue2);
+				if (!!(2 & test_bit) == condition) SetJumpTarget(continue1);
+			}
 
 			WriteExit(js.next_compilerPC + 4, 1);
 
@@ -2090,6 +2146,17 @@ void Jit64::srawix(UGeckoInstruction inst)
 	{
 		gpr.Lock(a, s);
 		gpr.BindToRegister(a, a == s, true);
+		if (!js.op->wantsCA)
+		{
+			// Just the shift when nothing reads the carry
+			if (a != s)
+				MOV(32, gpr.R(a), gpr.R(s));
+			SAR(32, gpr.R(a), Imm8(amount));
+			if (inst.Rc)
+				GenerateRC();
+			gpr.UnlockAll();
+			return;
+		}
 		JitClearCA();
 		MOV(32, R(EAX), gpr.R(s));
 		if (a != s)
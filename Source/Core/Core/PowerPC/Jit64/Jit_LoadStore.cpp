@@ -90,50 +90,6 @@ void Jit64::lXXx(UGeckoInstruction inst)
 		PanicAlert("Invalid instruction");
 	}
 
-	// TODO(ector): Make it dynamically enable/disable idle skipping where appropriate
-	// Will give nice boost to dual core mode
-	// (mb2): I agree,
-	// IMHO those Idles should always be skipped and replaced by a more controllable "native" Idle methode
-	// ... maybe the throttle one already do that :p
-	// if (CommandProcessor::AllowIdleSkipping() && PixelEngine::AllowIdleSkipping())
-	if (SConfig::GetInstance().m_LocalCoreStartupParameter.bSkipIdle &&
-		inst.OPCD == 32 &&
-		(inst.hex & 0xFFFF0000) == 0x800D0000 &&
-		(Memory::ReadUnchecked_U32(js.compilerPC + 4) == 0x28000000 ||
-		(SConfig::GetInstance().m_LocalCoreStartupParameter.bWii && Memory::ReadUnchecked_U32(js.compilerPC + 4) == 0x2C000000)) &&
-		Memory::ReadUnchecked_U32(js.compilerPC + 8) == 0x4182fff8)
-	{
-		// TODO(LinesPrower):
-		// - Rewrite this!
-		// It seems to be ugly and inefficient, but I don't know JIT stuff enough to make it right
-		// It only demonstrates the idea
-
-		// do our job at first
-		s32 offset = (s32)(s16)inst.SIMM_16;
-		gpr.BindToRegister(d, false, true);
-		SafeLoadToReg(gpr.RX(d), gpr.R(a), accessSize, offset, RegistersInUse(), signExtend);
-
-		// if it's still 0, we can wait until the next event
-		TEST(32, gpr.R(d), gpr.R(d));
-		FixupBranch noIdle = J_CC(CC_NZ);
-
-		u32 registersInUse = RegistersInUse();
-		ABI_PushRegistersAndAdjustStack(registersInUse, false);
-
-		ABI_CallFunctionC((void *)&PowerPC::OnIdle, PowerPC::ppcState.gpr[a] + (s32)(s16)inst.SIMM_16);
-
-		ABI_PopRegistersAndAdjustStack(registersInUse, false);
-
-		// ! we must continue executing of the loop after exception handling, maybe there is still 0 in r0
-		//MOV(32, M(&PowerPC::ppcState.pc), Imm32(js.compilerPC));
-		WriteExceptionExit();
-
-		SetJumpTarget(noIdle);
-
-		//js.compilerPC += 8;
-		return;
-	}
-
 	// Determine whether this instruction updates inst.RA
 	bool update;
 	if (inst.OPCD == 31)
@@ -12,8 +12,21 @@
 #include "JitAsm.h"
 #include "JitRegCache.h"
 
+const u8 GC_ALIGNED16(pbswapShuffle1x4[16]) = {3, 2, 1, 0, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
 const u8 GC_ALIGNED16(pbswapShuffle2x4[16]) = {3, 2, 1, 0, 7, 6, 5, 4, 8, 9, 10, 11, 12, 13, 14, 15};
 
+static const float GC_ALIGNED16(m_one[]) = {1.0f, 0.0f, 0.0f, 0.0f};
+static const float GC_ALIGNED16(m_65535) = 65535.0f;
+static const float GC_ALIGNED16(m_32767) = 32767.0f;
+static const float GC_ALIGNED16(m_m32768) = -32768.0f;
+static const float GC_ALIGNED16(m_255) = 255.0f;
+static const float GC_ALIGNED16(m_127) = 127.0f;
+static const float GC_ALIGNED16(m_m128) = -128.0f;
+
+// Times a GQR may change under blocks specialized on it before psq_l and
+// psq_st go back to the generic routines for it
+static const int MAX_GQR_CHANGES = 16;
+
 //static u64 GC_ALIGNED16(temp64); // unused?
 
 // TODO(ector): Improve 64-bit version
@@ -85,6 +98,29 @@ void Jit64::psq_st(UGeckoInstruction inst)
 		ADD(32, R(ECX), Imm32((u32)offset));
 	if (update && offset)
 		MOV(32, gpr.R(a), R(ECX));
+	if (inst.W) {
+		// One value
+		XORPS(XMM0, R(XMM0));  // TODO: See if we can get rid of this cheaply by tweaking the code in the singleStore* functions.
+		CVTSD2SS(XMM0, fpr.R(s));
+	} else {
+		// Pair of values
+		CVTPD2PS(XMM0, fpr.R(s));
+	}
+
+	// Speculate that the GQR still holds the value it has now, and fall back
+	// to the generic routines if it doesn't
+	const EQuantizeType stType = static_cast<EQuantizeType>(gqr.ST_TYPE);
+	bool specialized = (stType == QUANTIZE_FLOAT || stType >= QUANTIZE_U8) && SpecializeGQR(inst.I);
+	FixupBranch done;
+	if (specialized)
+	{
+		CMP(16, M(&PowerPC::ppcState.spr[SPR_GQR0 + inst.I]), Imm16(gqr.Hex & 0xFFFF));
+		FixupBranch generic = J_CC(CC_NE, true);
+		GenQuantizedStore(inst.W, stType, gqr.ST_SCALE);
+		done = J(true);
+		SetJumpTarget(generic);
+	}
+
 	MOVZX(32, 16, EAX, M(&PowerPC::ppcState.spr[SPR_GQR0 + inst.I]));
 	MOVZX(32, 8, EDX, R(AL));
 	// FIXME: Fix ModR/M encoding to allow [EDX*4+disp32] without a base register!
@@ -93,16 +129,13 @@ void Jit64::psq_st(UGeckoInstruction inst)
 #else
 	int addr_scale = SCALE_8;
 #endif
-	if (inst.W) {
-		// One value
-		XORPS(XMM0, R(XMM0));  // TODO: See if we can get rid of this cheaply by tweaking the code in the singleStore* functions.
-		CVTSD2SS(XMM0, fpr.R(s));
+	if (inst.W)
 		CALLptr(MScaled(EDX, addr_scale, (u32)(u64)asm_routines.singleStoreQuantized));
-	} else {
-		// Pair of values
-		CVTPD2PS(XMM0, fpr.R(s));
+	else
 		CALLptr(MScaled(EDX, addr_scale, (u32)(u64)asm_routines.pairedStoreQuantized));
-	}
+
+	if (specialized)
+		SetJumpTarget(done);
 	gpr.UnlockAll();
 	gpr.UnlockAllX();
 }
@@ -135,6 +168,20 @@ void Jit64::psq_l(UGeckoInstruction inst)
 		MOV(32, R(ECX), gpr.R(inst.RA));
 	if (update && offset)
 		MOV(32, gpr.R(inst.RA), R(ECX));
+
+	// Same speculation as in psq_st
+	const EQuantizeType ldType = static_cast<EQuantizeType>(gqr.LD_TYPE);
+	bool specialized = (ldType == QUANTIZE_FLOAT || ldType >= QUANTIZE_U8) && SpecializeGQR(inst.I);
+	FixupBranch done;
+	if (specialized)
+	{
+		CMP(16, M(((char *)&GQR(inst.I)) + 2), Imm16(gqr.Hex >> 16));
+		FixupBranch generic = J_CC(CC_NE, true);
+		GenQuantizedLoad(inst.W, ldType, gqr.LD_SCALE);
+		done = J(true);
+		SetJumpTarget(generic);
+	}
+
 	MOVZX(32, 16, EAX, M(((char *)&GQR(inst.I)) + 2));
 	MOVZX(32, 8, EDX, R(AL));
 	if (inst.W)
@@ -148,6 +195,9 @@ void Jit64::psq_l(UGeckoInstruction inst)
 	CALLptr(MScaled(EDX, addr_scale, (u32)(u64)asm_routines.pairedLoadQuantized));
 	ABI_RestoreStack(0);
 
+	if (specialized)
+		SetJumpTarget(done);
+
 //	MEMCHECK_START // FIXME: MMU does not work here because of unsafe memory access
 
 	CVTPS2PD(fpr.RX(inst.RS), R(XMM0));
@@ -157,3 +207,229 @@ void Jit64::psq_l(UGeckoInstruction inst)
 	gpr.UnlockAll();
 	gpr.UnlockAllX();
 }
+
+// Only x64 has the inline versions of the quantized loads and stores
+bool Jit64::SpecializeGQR(int gqr)
+{
+#ifdef _M_X64
+	if (gqr_changes[gqr] >= MAX_GQR_CHANGES)
+		return false;
+	js.block_flags |= BLOCK_USE_GQR0 << gqr;
+	return true;
+#else
+	return false;
+#endif
+}
+
+// Blocks specialized on the old value would only take their generic paths
+// from now on, so have them compiled again
+void Jit64::GQRChanged(int gqr)
+{
+	if (gqr_changes[gqr] >= MAX_GQR_CHANGES)
+		return;
+	if (blocks.DestroyBlocksWithFlag((BlockFlag)(BLOCK_USE_GQR0 << gqr)))
+		gqr_changes[gqr]++;
+}
+
+// The pairedLoadQuantized routines for a known type and scale.
+// In: ECX: Address to read from. Out: XMM0. Trashes: ECX XMM1
+void Jit64::GenQuantizedLoad(bool single, EQuantizeType type, int scale)
+{
+#ifdef _M_X64
+	if (type == QUANTIZE_FLOAT)
+	{
+		if (cpu_info.bSSSE3) {
+			if (single) {
+				MOVD_xmm(XMM0, MComplex(RBX, RCX, 1, 0));
+				PSHUFB(XMM0, M((void *)pbswapShuffle1x4));
+			} else {
+				MOVQ_xmm(XMM0, MComplex(RBX, RCX, 1, 0));
+				PSHUFB(XMM0, M((void *)pbswapShuffle2x4));
+			}
+		} else {
+			if (single) {
+				MOV(32, R(RCX), MComplex(RBX, RCX, 1, 0));
+				BSWAP(32, RCX);
+				MOVD_xmm(XMM0, R(RCX));
+			} else {
+				MOV(64, R(RCX), MComplex(RBX, RCX, 1, 0));
+				BSWAP(64, RCX);
+				ROL(64, R(RCX), Imm8(32));
+				MOVQ_xmm(XMM0, R(RCX));
+			}
+		}
+		if (single)
+			UNPCKLPS(XMM0, M((void*)m_one));
+		return;
+	}
+
+	switch (type)
+	{
+	case QUANTIZE_U8:
+		UnsafeLoadRegToRegNoSwap(ECX, ECX, single ? 8 : 16, 0);
+		MOVD_xmm(XMM0, R(ECX));
+		if (!single) {
+			PXOR(XMM1, R(XMM1));
+			PUNPCKLBW(XMM0, R(XMM1));
+			PUNPCKLWD(XMM0, R(XMM1));
+		}
+		break;
+	case QUANTIZE_S8:
+		if (single) {
+			UnsafeLoadRegToRegNoSwap(ECX, ECX, 8, 0);
+			SHL(32, R(ECX), Imm8(24));
+			SAR(32, R(ECX), Imm8(24));
+			MOVD_xmm(XMM0, R(ECX));
+		} else {
+			UnsafeLoadRegToRegNoSwap(ECX, ECX, 16, 0);
+			MOVD_xmm(XMM0, R(ECX));
+			PUNPCKLBW(XMM0, R(XMM0));
+			PUNPCKLWD(XMM0, R(XMM0));
+			PSRAD(XMM0, 24);
+		}
+		break;
+	case QUANTIZE_U16:
+		UnsafeLoadRegToReg(ECX, ECX, 32, 0, false);
+		if (single) {
+			SHR(32, R(ECX), Imm8(16));
+			MOVD_xmm(XMM0, R(ECX));
+		} else {
+			ROL(32, R(ECX), Imm8(16));
+			MOVD_xmm(XMM0, R(ECX));
+			PXOR(XMM1, R(XMM1));
+			PUNPCKLWD(XMM0, R(XMM1));
+		}
+		break;
+	case QUANTIZE_S16:
+		UnsafeLoadRegToReg(ECX, ECX, 32, 0, false);
+		if (single) {
+			SAR(32, R(ECX), Imm8(16));
+			MOVD_xmm(XMM0, R(ECX));
+		} else {
+			ROL(32, R(ECX), Imm8(16));
+			MOVD_xmm(XMM0, R(ECX));
+			PUNPCKLWD(XMM0, R(XMM0));
+			PSRAD(XMM0, 16);
+		}
+		break;
+	default:
+		_assert_msg_(DYNA_REC, 0, "GenQuantizedLoad - illegal type %d", type);
+		break;
+	}
+	CVTDQ2PS(XMM0, R(XMM0));
+
+	// Scale 0 multiplies by one
+	if (scale) {
+		MOVSS(XMM1, M((void *)&m_dequantizeTableS[scale]));
+		if (single) {
+			MULSS(XMM0, R(XMM1));
+		} else {
+			PUNPCKLDQ(XMM1, R(XMM1));
+			MULPS(XMM0, R(XMM1));
+		}
+	}
+	if (single)
+		UNPCKLPS(XMM0, M((void*)m_one));
+#endif
+}
+
+// The pairedStoreQuantized and singleStoreQuantized routines for a known type
+// and scale, writing through the block's own fast path.
+// In: ECX: Address to write to. In: XMM0. Trashes: EAX ECX EDX XMM1
+void Jit64::GenQuantizedStore(bool single, EQuantizeType type, int scale)
+{
+#ifdef _M_X64
+	u32 registersInUse = RegistersInUse();
+
+	if (type == QUANTIZE_FLOAT)
+	{
+		// Pairs of floats are what games write to the FIFO, leave that to the routine
+		if (single)
+			SafeWriteFloatToReg(XMM0, ECX, registersInUse, 0);
+		else
+			CALL((void *)asm_routines.pairedStoreQuantized[QUANTIZE_FLOAT]);
+		return;
+	}
+
+	if (scale) {
+		MOVSS(XMM1, M((void *)&m_quantizeTableS[scale]));
+		if (single) {
+			MULSS(XMM0, R(XMM1));
+		} else {
+			PUNPCKLDQ(XMM1, R(XMM1));
+			MULPS(XMM0, R(XMM1));
+		}
+	}
+
+	if (single)
+	{
+		switch (type)
+		{
+		case QUANTIZE_U8:
+			PXOR(XMM1, R(XMM1));
+			MAXSS(XMM0, R(XMM1));
+			MINSS(XMM0, M((void *)&m_255));
+			break;
+		case QUANTIZE_S8:
+			MAXSS(XMM0, M((void *)&m_m128));
+			MINSS(XMM0, M((void *)&m_127));
+			break;
+		case QUANTIZE_U16:
+			PXOR(XMM1, R(XMM1));
+			MAXSS(XMM0, R(XMM1));
+			MINSS(XMM0, M((void *)&m_65535));
+			break;
+		case QUANTIZE_S16:
+			MAXSS(XMM0, M((void *)&m_m32768));
+			MINSS(XMM0, M((void *)&m_32767));
+			break;
+		default:
+			_assert_msg_(DYNA_REC, 0, "GenQuantizedStore - illegal type %d", type);
+			break;
+		}
+		CVTTSS2SI(EAX, R(XMM0));
+		SafeWriteRegToReg(EAX, ECX, (type == QUANTIZE_U8 || type == QUANTIZE_S8) ? 8 : 16, 0, registersInUse);
+		return;
+	}
+
+	// Same clamping as the routines, so both paths store the same values
+	if (type == QUANTIZE_U16) {
+		PXOR(XMM1, R(XMM1));
+		MAXPS(XMM0, R(XMM1));
+	}
+	MOVSS(XMM1, M((void *)&m_65535));
+	PUNPCKLDQ(XMM1, R(XMM1));
+	MINPS(XMM0, R(XMM1));
+	CVTTPS2DQ(XMM0, R(XMM0));
+
+	switch (type)
+	{
+	case QUANTIZE_U8:
+	case QUANTIZE_S8:
+		PACKSSDW(XMM0, R(XMM0));
+		if (type == QUANTIZE_U8)
+			PACKUSWB(XMM0, R(XMM0));
+		else
+			PACKSSWB(XMM0, R(XMM0));
+		MOVD_xmm(R(EAX), XMM0);
+		// ps0 goes to the lower address
+		ROL(16, R(EAX), Imm8(8));
+		SafeWriteRegToReg(EAX, ECX, 16, 0, registersInUse);
+		break;
+	case QUANTIZE_U16:
+		// Sign extend the low halves, so the signed pack keeps them as they are
+		PSLLD(XMM0, 16);
+		PSRAD(XMM0, 16);
+		// fall through
+	case QUANTIZE_S16:
+		PACKSSDW(XMM0, R(XMM0));
+		MOVD_xmm(R(EAX), XMM0);
+		ROL(32, R(EAX), Imm8(16));
+		SafeWriteRegToReg(EAX, ECX, 32, 0, registersInUse);
+		break;
+	default:
+		_assert_msg_(DYNA_REC, 0, "GenQuantizedStore - illegal type %d", type);
+		break;
+	}
+#endif
+}
@@ -10,6 +10,11 @@
 #include "Jit.h"
 #include "JitRegCache.h"
 
+static void HandleGQRChange(u32 gqr)
+{
+	static_cast<Jit64 *>(jit)->GQRChanged(gqr);
+}
+
 void Jit64::mtspr(UGeckoInstruction inst)
 {
 	INSTRUCTION_START
@@ -50,16 +55,21 @@ void Jit64::mtspr(UGeckoInstruction inst)
 		// If the value changed, destroy all blocks using this quantizer
 		// This will create a little bit of block churn, but hopefully not too bad.
 		{
-			/*
-			MOV(32, R(EAX), M(&PowerPC::ppcState.spr[iIndex]));  // Load old value
-			CMP(32, R(EAX), gpr.R(inst.RD));
-			FixupBranch skip_destroy = J_CC(CC_E, false);
-			int gqr = iIndex - SPR_GQR0;
-			ABI_CallFunctionC(ProtectFunction(&Jit64::DestroyBlocksWithFlag, 1), (u32)BLOCK_USE_GQR0 << gqr);
-			SetJumpTarget(skip_destroy);*/
+			if (!gpr.R(d).IsImm())
+			{
+				gpr.Lock(d);
+				gpr.BindToRegister(d, true, false);
+			}
+			CMP(32, M(&PowerPC::ppcState.spr[iIndex]), gpr.R(d));
+			FixupBranch skip_destroy = J_CC(CC_E, true);
+			MOV(32, M(&PowerPC::ppcState.spr[iIndex]), gpr.R(d));
+			u32 registersInUse = RegistersInUse();
+			ABI_PushRegistersAndAdjustStack(registersInUse, false);
+			ABI_CallFunctionC((void *)&HandleGQRChange, iIndex - SPR_GQR0);
+			ABI_PopRegistersAndAdjustStack(registersInUse, false);
+			SetJumpTarget(skip_destroy);
 		}
 		break;
-		// TODO - break block if quantizers are written to.
 	default:
 		Default(inst);
 		return;
@@ -351,6 +351,8 @@ const u8* JitArm::DoJit(u32 em_address, PPCAnalyst::CodeBuffer *code_buf, JitBlo
 	{
 		// If there is a memory exception inside a block (broken_block==true), compile up to that instruction.
 		nextPC = PPCAnalyst::Flatten(em_address, &size, &js.st, &js.gpa, &js.fpa, broken_block, code_buf, blockSize, merged_addresses, capacity_of_merged_addresses, size_of_merged_addresses);
+		if (!Core::g_CoreStartupParameter.bEnableDebugging)
+			PPCAnalyst::OptimizeBlock(code_buf->codebuffer, size);
 	}
 	PPCAnalyst::CodeOp *ops = code_buf->codebuffer;
 
@@ -482,7 +484,10 @@ const u8* JitArm::DoJit(u32 em_address, PPCAnalyst::CodeBuffer *code_buf, JitBlo
 					// Don't do this yet
 					BKPT(0x7777);
 				}
-				JitArmTables::CompileInstruction(ops[i]);
+				if (ops[i].outputIsConstant)
+					gpr.SetImmediate(ops[i].regsOut[0], ops[i].constantValue);
+				else
+					JitArmTables::CompileInstruction(ops[i]);
 				fpr.Flush();
 				if (js.memcheck && (opinfo->flags & FL_LOADSTORE))
 				{
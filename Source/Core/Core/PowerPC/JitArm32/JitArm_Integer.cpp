@@ -68,6 +68,8 @@ void JitArm::ComputeRC(s32 value, int cr) {
 
 void JitArm::ComputeCarry()
 {
+	if (!js.op->wantsCA)
+		return;
 	ARMReg tmp = gpr.GetReg();
 	Operand2 mask = Operand2(2, 2); // XER_CA_MASK
 	LDR(tmp, R9, PPCSTATE_OFF(spr[SPR_XER]));
@@ -81,6 +83,8 @@ void JitArm::ComputeCarry()
 }
 void JitArm::ComputeCarry(bool Carry)
 {
+	if (!js.op->wantsCA)
+		return;
 	ARMReg tmp = gpr.GetReg();
 	Operand2 mask = Operand2(2, 2); // XER_CA_MASK
 	LDR(tmp, R9, PPCSTATE_OFF(spr[SPR_XER]));
@@ -105,6 +109,8 @@ void JitArm::GetCarryAndClear(ARMReg reg)
 
 void JitArm::FinalizeCarry(ARMReg reg)
 {
+	if (!js.op->wantsCA)
+		return;
 	ARMReg tmp = gpr.GetReg();
 	Operand2 mask = Operand2(2, 2); // XER_CA_MASK
 	SetCC(CC_CS);
@@ -75,7 +75,7 @@ void CommonAsmRoutines::GenFifoXmm64Write()
 static const u8 GC_ALIGNED16(pbswapShuffle1x4[16]) = {3, 2, 1, 0, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
 static const u8 GC_ALIGNED16(pbswapShuffle2x4[16]) = {3, 2, 1, 0, 7, 6, 5, 4, 8, 9, 10, 11, 12, 13, 14, 15};
 
-static const float GC_ALIGNED16(m_quantizeTableS[]) =
+const float GC_ALIGNED16(m_quantizeTableS[]) =
 {
 	(1 <<  0),	(1 <<  1),	(1 <<  2),	(1 <<  3),
 	(1 <<  4),	(1 <<  5),	(1 <<  6),	(1 <<  7),
@@ -95,7 +95,7 @@ static const float GC_ALIGNED16(m_quantizeTableS[]) =
 	1.0 / (1 <<  4),	1.0 / (1 <<  3),	1.0 / (1 <<  2),	1.0 / (1 <<  1),
 };
 
-static const float GC_ALIGNED16(m_dequantizeTableS[]) =
+const float GC_ALIGNED16(m_dequantizeTableS[]) =
 {
 	1.0 / (1 <<  0),	1.0 / (1 <<  1),	1.0 / (1 <<  2),	1.0 / (1 <<  3),
 	1.0 / (1 <<  4),	1.0 / (1 <<  5),	1.0 / (1 <<  6),	1.0 / (1 <<  7),
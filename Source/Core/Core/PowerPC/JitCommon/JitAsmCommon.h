@@ -7,6 +7,10 @@
 
 #include "Jit_Util.h"
 
+// Scale factors of the quantized loads and stores, indexed by the GQR scale
+extern const float m_quantizeTableS[];
+extern const float m_dequantizeTableS[];
+
 class CommonAsmRoutinesBase  {
 public:
 
@@ -9,6 +9,7 @@
 #include "disasm.h"
 #include "JitBase.h"
 #include "JitBackpatch.h"
+#include "../Profiler.h"
 
 #include "StringUtil.h"
 #ifdef _WIN32
@@ -50,7 +51,7 @@ void TrampolineCache::Shutdown()
 }
 
 // Extremely simplistic - just generate the requested trampoline. May reuse them in the future.
-const u8 *TrampolineCache::GetReadTrampoline(const InstructionInfo &info, u32 registersInUse)
+const u8 *TrampolineCache::GetReadTrampoline(const InstructionInfo &info, u32 registersInUse, u64 *counter)
 {
 	if (GetSpaceLeft() < 1024)
 		PanicAlert("Trampoline cache full");
@@ -60,6 +61,9 @@ const u8 *TrampolineCache::GetReadTrampoline(const InstructionInfo &info, u32 re
 	X64Reg addrReg = (X64Reg)info.scaledReg;
 	X64Reg dataReg = (X64Reg)info.regOperandReg;
 
+	if (counter)
+		ADD(64, M(counter), Imm8(1));
+
 	// It's a read. Easy.
 	// It ought to be necessary to align the stack here.  Since it seems to not
 	// affect anybody, I'm not going to add it just to be completely safe about
@@ -97,7 +101,7 @@ const u8 *TrampolineCache::GetReadTrampoline(const InstructionInfo &info, u32 re
 }
 
 // Extremely simplistic - just generate the requested trampoline. May reuse them in the future.
-const u8 *TrampolineCache::GetWriteTrampoline(const InstructionInfo &info, u32 registersInUse)
+const u8 *TrampolineCache::GetWriteTrampoline(const InstructionInfo &info, u32 registersInUse, u64 *counter)
 {
 	if (GetSpaceLeft() < 1024)
 		PanicAlert("Trampoline cache full");
@@ -108,6 +112,9 @@ const u8 *TrampolineCache::GetWriteTrampoline(const InstructionInfo &info, u32 r
 	X64Reg dataReg = (X64Reg)info.regOperandReg;
 	X64Reg addrReg = (X64Reg)info.scaledReg;
 
+	if (counter)
+		ADD(64, M(counter), Imm8(1));
+
 	// It's a write. Yay. Remember that we don't have to be super efficient since it's "just" a
 	// hardware access - we can take shortcuts.
 	// Don't treat FIFO writes specially for now because they require a burst
@@ -194,6 +201,17 @@ const u8 *Jitx86Base::BackPatch(u8 *codePtr, u32 emAddress, void *ctx_void)
 
 	u32 registersInUse = it->second;
 
+	u64 *counter = NULL;
+	if (Profiler::g_ProfileCoverage)
+	{
+		auto coverage = coverageAddressAtLoc.find(codePtr);
+		if (coverage != coverageAddressAtLoc.end())
+		{
+			u32 address = coverage->second;
+			counter = JitCoverage::GetCounter(JitCoverage::SITE_BACKPATCH, address, Memory::ReadUnchecked_U32(address));
+		}
+	}
+
 	if (!info.isMemoryWrite)
 	{
 		XEmitter emitter(codePtr);
@@ -204,7 +222,7 @@ const u8 *Jitx86Base::BackPatch(u8 *codePtr, u32 emAddress, void *ctx_void)
 		else
 			bswapNopCount = 2;
 
-		const u8 *trampoline = trampolines.GetReadTrampoline(info, registersInUse);
+		const u8 *trampoline = trampolines.GetReadTrampoline(info, registersInUse, counter);
 		emitter.CALL((void *)trampoline);
 		emitter.NOP((int)info.instructionSize + bswapNopCount - 5);
 		return codePtr;
@@ -236,7 +254,7 @@ const u8 *Jitx86Base::BackPatch(u8 *codePtr, u32 emAddress, void *ctx_void)
 
 		u8 *start = codePtr - bswapSize;
 		XEmitter emitter(start);
-		const u8 *trampoline = trampolines.GetWriteTrampoline(info, registersInUse);
+		const u8 *trampoline = trampolines.GetWriteTrampoline(info, registersInUse, counter);
 		emitter.CALL((void *)trampoline);
 		emitter.NOP((int)(codePtr + info.instructionSize - emitter.GetCodePtr()));
 		return start;
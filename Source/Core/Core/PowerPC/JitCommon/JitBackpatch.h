@@ -245,8 +245,9 @@ public:
 	void Init();
 	void Shutdown();
 
-	const u8 *GetReadTrampoline(const InstructionInfo &info, u32 registersInUse);
-	const u8 *GetWriteTrampoline(const InstructionInfo &info, u32 registersInUse);
+	// counter, if not NULL, is incremented every time the trampoline runs
+	const u8 *GetReadTrampoline(const InstructionInfo &info, u32 registersInUse, u64 *counter = NULL);
+	const u8 *GetWriteTrampoline(const InstructionInfo &info, u32 registersInUse, u64 *counter = NULL);
 };
 
 #endif
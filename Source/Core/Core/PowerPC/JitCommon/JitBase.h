@@ -38,6 +38,7 @@ protected:
 		bool optimizeGatherPipe;
 		bool fastInterrupts;
 		bool accurateSinglePrecision;
+		bool optimizeLoops;
 	};
 	struct JitState
 	{
@@ -62,6 +63,18 @@ protected:
 
 		int fifoBytesThisBlock;
 
+		// A block that branches back to its own start first counts how often it
+		// does (countLoop). Once hot it is recompiled with registers kept live
+		// across the back-edge, which then jumps straight to loopHeader (isLoop).
+		bool countLoop;
+		bool isLoop;
+		const u8 *loopHeader;
+		// The block is a loop PPCAnalyst::IsIdleLoop proved to be idle waiting
+		bool isIdleLoop;
+		// A record form followed by the only branch that reads CR0 leaves its
+		// result in this guest register instead of writing CR0, -1 otherwise
+		int deferredCR0Reg;
+
 		PPCAnalyst::BlockStats st;
 		PPCAnalyst::BlockRegStats gpa;
 		PPCAnalyst::BlockRegStats fpa;
@@ -87,6 +100,9 @@ public:
 	virtual const CommonAsmRoutinesBase *GetAsmRoutines() = 0;
 
 	virtual bool IsInCodeSpace(u8 *ptr) = 0;
+
+	// Called when the block cache throws away the code in [start, end)
+	virtual void ForgetCode(const u8 *start, const u8 *end) {}
 };
 
 class Jitx86Base : public JitBase, public EmuCodeBlock
@@ -100,6 +116,8 @@ public:
 	const u8 *BackPatch(u8 *codePtr, u32 em_address, void *ctx) override;
 
 	bool IsInCodeSpace(u8 *ptr) override { return IsInSpace(ptr); }
+
+	void ForgetCode(const u8 *start, const u8 *end) override { ClearCoverageSites(start, end); }
 };
 
 extern JitBase *jit;
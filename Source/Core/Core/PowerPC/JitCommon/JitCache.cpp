@@ -15,8 +15,11 @@
 #include <windows.h>
 #endif
 
+#include <cinttypes>
+
 #include "JitBase.h"
 #include "MemoryUtil.h"
+#include "Timer.h"
 #include "disasm.h"
 
 #include "../JitInterface.h"
@@ -39,7 +42,7 @@ using namespace Gen;
 
 	bool JitBaseBlockCache::IsFull() const
 	{
-		return GetNumBlocks() >= MAX_NUM_BLOCKS - 1;
+		return GetNumBlocks() >= MAX_NUM_BLOCKS - 1 && free_blocks.empty();
 	}
 
 	void JitBaseBlockCache::Init()
@@ -49,6 +52,9 @@ using namespace Gen;
 #endif
 		blocks = new JitBlock[MAX_NUM_BLOCKS];
 		blockCodePointers = new const u8*[MAX_NUM_BLOCKS];
+		blocks_in_page.resize(NUM_PAGES);
+		exits_to_page.resize(NUM_PAGES);
+		memset(&stats, 0, sizeof(stats));
 		if (iCache == 0 && iCacheEx == 0 && iCacheVMEM == 0)
 		{
 			iCache = new u8[JIT_ICACHE_SIZE];
@@ -71,6 +77,14 @@ using namespace Gen;
 
 	void JitBaseBlockCache::Shutdown()
 	{
+		if (stats.evictions || stats.fullClears)
+		{
+			NOTICE_LOG(DYNA_REC, "JIT cache: %" PRIu64 " region evictions, %" PRIu64 " blocks evicted, "
+				"%" PRIu64 " of them recompiled in %" PRIu64 " ms, %" PRIu64 " full clears",
+				stats.evictions, stats.evictedBlocks, stats.recompiledBlocks,
+				stats.recompileTime / 1000000, stats.fullClears);
+		}
+
 		delete[] blocks;
 		delete[] blockCodePointers;
 		if (iCache != 0)
@@ -85,6 +99,9 @@ using namespace Gen;
 		blocks = 0;
 		blockCodePointers = 0;
 		num_blocks = 0;
+		std::vector<std::vector<int>>().swap(blocks_in_page);
+		std::vector<int>().swap(exits_to_page);
+		std::vector<JitCodeRegion>().swap(regions);
 #if defined USE_OPROFILE && USE_OPROFILE
 		op_close_agent(agent);
 #endif
@@ -105,15 +122,28 @@ using namespace Gen;
 			Core::DisplayMessage("Clearing code cache.", 3000);
 #endif
 
+		// Drop the page lists first, so that destroying the blocks doesn't walk them
+		for (auto& page : blocks_in_page)
+			page.clear();
+		std::fill(exits_to_page.begin(), exits_to_page.end(), -1);
 		for (int i = 0; i < num_blocks; i++)
 		{
+			blocks[i].nextExit[0] = blocks[i].nextExit[1] = -1;
+			blocks[i].prevExit[0] = blocks[i].prevExit[1] = -1;
 			DestroyBlock(i, false);
 		}
-		links_to.clear();
-		block_map.clear();
+		if (num_blocks)
+			stats.fullClears++;
 		valid_block.reset();
 		num_blocks = 0;
+		memset(blocks_with_flag, 0, sizeof(blocks_with_flag));
 		memset(blockCodePointers, 0, sizeof(u8*)*MAX_NUM_BLOCKS);
+		if (jit)
+		{
+			for (const JitCodeRegion &region : regions)
+				jit->ForgetCode(region.start, region.end);
+		}
+		ResetRegions();
 	}
 
 	void JitBaseBlockCache::ClearSafe()
@@ -123,16 +153,24 @@ using namespace Gen;
 		memset(iCacheVMEM, JIT_ICACHE_INVALID_BYTE, JIT_ICACHE_SIZE);
 	}
 
-	/*void JitBaseBlockCache::DestroyBlocksWithFlag(BlockFlag death_flag)
+	int JitBaseBlockCache::DestroyBlocksWithFlag(BlockFlag death_flag)
 	{
-		for (int i = 0; i < num_blocks; i++)
+		int flag_num = 0;
+		while (!(death_flag & (1 << flag_num)))
+			flag_num++;
+
+		// Most changes of a GQR happen while no block depends on it
+		int destroyed = 0;
+		for (int i = 0; i < num_blocks && blocks_with_flag[flag_num]; i++)
 		{
-			if (blocks[i].flags & death_flag)
+			if (!blocks[i].invalid && (blocks[i].flags & death_flag))
 			{
 				DestroyBlock(i, false);
+				destroyed++;
 			}
 		}
-	}*/
+		return destroyed;
+	}
 
 	void JitBaseBlockCache::Reset()
 	{
@@ -164,17 +202,32 @@ using namespace Gen;
 
 	int JitBaseBlockCache::AllocateBlock(u32 em_address)
 	{
-		JitBlock &b = blocks[num_blocks];
+		// Reuse the slots of evicted blocks first
+		int block_num;
+		if (!free_blocks.empty())
+		{
+			block_num = free_blocks.back();
+			free_blocks.pop_back();
+		}
+		else
+		{
+			block_num = num_blocks++; //commit the current block
+		}
+
+		JitBlock &b = blocks[block_num];
 		b.invalid = false;
 		b.originalAddress = em_address;
+		b.lookaheadStart = b.lookaheadEnd = 0;
+		b.flags = 0;
 		b.exitAddress[0] = INVALID_EXIT;
 		b.exitAddress[1] = INVALID_EXIT;
 		b.exitPtrs[0] = 0;
 		b.exitPtrs[1] = 0;
 		b.linkStatus[0] = false;
 		b.linkStatus[1] = false;
-		num_blocks++; //commit the current block
-		return num_blocks - 1;
+		b.nextExit[0] = b.nextExit[1] = -1;
+		b.prevExit[0] = b.prevExit[1] = -1;
+		return block_num;
 	}
 
 	void JitBaseBlockCache::FinalizeBlock(int block_num, bool block_link, const u8 *code_ptr)
@@ -184,19 +237,33 @@ using namespace Gen;
 		u32* icp = GetICachePtr(b.originalAddress);
 		*icp = block_num;
 
-		// Convert the logical address to a physical address for the block map
-		u32 pAddr = b.originalAddress & 0x1FFFFFFF;
+		// Mark the physical cache lines the block depends on
+		u32 start, end;
+		GetBlockRange(b, &start, &end);
+		for (u32 line = start / 32; line <= (end - 1) / 32; ++line)
+			valid_block[line] = true;
 
-		for (u32 i = 0; i < (b.originalSize + 7) / 8; ++i)
-			valid_block[pAddr / 32 + i] = true;
+		AddBlockToPages(block_num);
+		for (int i = 0; i < NUM_BLOCK_FLAGS; i++)
+		{
+			if (b.flags & (1 << i))
+				blocks_with_flag[i]++;
+		}
+		if (alloc_region != -1)
+			regions[alloc_region].blocks.push_back(block_num);
+		if (recompile_start)
+		{
+			stats.recompiledBlocks++;
+			stats.recompileTime += Common::Timer::GetTimeNs() - recompile_start;
+			recompile_start = 0;
+		}
 
-		block_map[std::make_pair(pAddr + 4 * b.originalSize - 1, pAddr)] = block_num;
 		if (block_link)
 		{
 			for (int i = 0; i < 2; i++)
 			{
 				if (b.exitAddress[i] != INVALID_EXIT)
-					links_to.insert(std::pair<u32, int>(b.exitAddress[i], block_num));
+					AddExitToPage(block_num, i);
 			}
 
 			LinkBlock(block_num);
@@ -289,39 +356,278 @@ using namespace Gen;
 		}
 	}
 
-	using namespace std;
-
 	void JitBaseBlockCache::LinkBlock(int i)
 	{
 		LinkBlockExits(i);
 		JitBlock &b = blocks[i];
-		pair<multimap<u32, int>::iterator, multimap<u32, int>::iterator> ppp;
-		// equal_range(b) returns pair<iterator,iterator> representing the range
-		// of element with key b
-		ppp = links_to.equal_range(b.originalAddress);
-		if (ppp.first == ppp.second)
-			return;
-		for (multimap<u32, int>::iterator iter = ppp.first; iter != ppp.second; ++iter) {
-			// PanicAlert("Linking block %i to block %i", iter->second, i);
-			LinkBlockExits(iter->second);
+		// Only the exits into this page can point to the block
+		int exit = exits_to_page[(b.originalAddress & 0x1FFFFFFF) >> PAGE_SHIFT];
+		while (exit != -1)
+		{
+			JitBlock &sourceBlock = blocks[exit / 2];
+			if (sourceBlock.exitAddress[exit & 1] == b.originalAddress)
+				LinkBlockExits(exit / 2);
+			exit = sourceBlock.nextExit[exit & 1];
 		}
 	}
 
 	void JitBaseBlockCache::UnlinkBlock(int i)
 	{
 		JitBlock &b = blocks[i];
-		pair<multimap<u32, int>::iterator, multimap<u32, int>::iterator> ppp;
-		ppp = links_to.equal_range(b.originalAddress);
-		if (ppp.first == ppp.second)
+		int exit = exits_to_page[(b.originalAddress & 0x1FFFFFFF) >> PAGE_SHIFT];
+		while (exit != -1)
+		{
+			JitBlock &sourceBlock = blocks[exit / 2];
+			if (sourceBlock.exitAddress[exit & 1] == b.originalAddress)
+			{
+				// With regions the code of this block can be reused for another one,
+				// so the exits can't keep jumping to it
+				if (sourceBlock.linkStatus[exit & 1] && !regions.empty())
+					WriteUnlinkBlock(sourceBlock.exitPtrs[exit & 1]);
+				sourceBlock.linkStatus[exit & 1] = false;
+			}
+			exit = sourceBlock.nextExit[exit & 1];
+		}
+	}
+
+	void JitBaseBlockCache::GetBlockRange(const JitBlock &b, u32 *start, u32 *end) const
+	{
+		*start = b.originalAddress & 0x1FFFFFFF;
+		*end = *start + (b.originalSize ? 4 * b.originalSize : 4);
+		if (b.lookaheadEnd != b.lookaheadStart)
+		{
+			u32 lookahead = b.lookaheadStart & 0x1FFFFFFF;
+			*start = std::min(*start, lookahead);
+			*end = std::max(*end, lookahead + (b.lookaheadEnd - b.lookaheadStart));
+		}
+	}
+
+	void JitBaseBlockCache::GetBlockPages(const JitBlock &b, u32 *first, u32 *last) const
+	{
+		u32 start, end;
+		GetBlockRange(b, &start, &end);
+		*first = start >> PAGE_SHIFT;
+		*last = std::min<u32>((end - 1) >> PAGE_SHIFT, NUM_PAGES - 1);
+	}
+
+	void JitBaseBlockCache::AddBlockToPages(int block_num)
+	{
+		u32 first, last;
+		GetBlockPages(blocks[block_num], &first, &last);
+		for (u32 page = first; page <= last; page++)
+			blocks_in_page[page].push_back(block_num);
+	}
+
+	void JitBaseBlockCache::RemoveBlockFromPages(int block_num)
+	{
+		u32 first, last;
+		GetBlockPages(blocks[block_num], &first, &last);
+		for (u32 page = first; page <= last; page++)
+		{
+			std::vector<int> &page_blocks = blocks_in_page[page];
+			std::vector<int>::iterator it = std::find(page_blocks.begin(), page_blocks.end(), block_num);
+			if (it != page_blocks.end())
+			{
+				*it = page_blocks.back();
+				page_blocks.pop_back();
+			}
+		}
+	}
+
+	void JitBaseBlockCache::AddExitToPage(int block_num, int exit_num)
+	{
+		JitBlock &b = blocks[block_num];
+		int &head = exits_to_page[(b.exitAddress[exit_num] & 0x1FFFFFFF) >> PAGE_SHIFT];
+		int exit = block_num * 2 + exit_num;
+
+		b.prevExit[exit_num] = -1;
+		b.nextExit[exit_num] = head;
+		if (head != -1)
+			blocks[head / 2].prevExit[head & 1] = exit;
+		head = exit;
+	}
+
+	void JitBaseBlockCache::RemoveExitFromPage(int block_num, int exit_num)
+	{
+		JitBlock &b = blocks[block_num];
+		int &head = exits_to_page[(b.exitAddress[exit_num] & 0x1FFFFFFF) >> PAGE_SHIFT];
+		int exit = block_num * 2 + exit_num;
+		int prev = b.prevExit[exit_num];
+		int next = b.nextExit[exit_num];
+
+		// Not in a list
+		if (prev == -1 && head != exit)
 			return;
-		for (multimap<u32, int>::iterator iter = ppp.first; iter != ppp.second; ++iter) {
-			JitBlock &sourceBlock = blocks[iter->second];
-			for (int e = 0; e < 2; e++)
+
+		if (prev == -1)
+			head = next;
+		else
+			blocks[prev / 2].nextExit[prev & 1] = next;
+		if (next != -1)
+			blocks[next / 2].prevExit[next & 1] = prev;
+		b.prevExit[exit_num] = -1;
+		b.nextExit[exit_num] = -1;
+	}
+
+	void JitBaseBlockCache::InitRegions(u8 *code_space, size_t size)
+	{
+		size_t region_size = size / NUM_CODE_REGIONS;
+		regions.resize(NUM_CODE_REGIONS);
+		for (int i = 0; i < NUM_CODE_REGIONS; i++)
+		{
+			regions[i].start = code_space + i * region_size;
+			regions[i].end = regions[i].start + region_size;
+		}
+		ResetRegions();
+	}
+
+	void JitBaseBlockCache::ResetRegions()
+	{
+		for (auto& region : regions)
+		{
+			region.ptr = region.start;
+			region.generation = JitCodeRegion::EMPTY;
+			region.opened = 0;
+			region.blocks.clear();
+		}
+		open_region[0] = open_region[1] = -1;
+		alloc_region = -1;
+		region_serial = 0;
+		recompile_start = 0;
+		free_blocks.clear();
+		evicted_addresses.clear();
+	}
+
+	// Blocks that come back after their region was evicted are the ones worth
+	// keeping, so they go to the tenured regions. Everything else starts out in
+	// the nursery, which is evicted oldest first. That way a game's working set
+	// ends up tenured, and the code it ran once is what gets thrown out.
+	u8 *JitBaseBlockCache::AllocateCode(u32 em_address, u8 *code_ptr)
+	{
+		if (regions.empty())
+			return code_ptr;
+
+		if (alloc_region != -1)
+			regions[alloc_region].ptr = code_ptr;
+
+		int generation = JitCodeRegion::NURSERY;
+		std::unordered_set<u32>::iterator evicted = evicted_addresses.find(em_address);
+		if (evicted != evicted_addresses.end())
+		{
+			evicted_addresses.erase(evicted);
+			generation = JitCodeRegion::TENURED;
+			recompile_start = Common::Timer::GetTimeNs();
+		}
+
+		int region = open_region[generation];
+		if (region == -1 || regions[region].end - regions[region].ptr < MAX_BLOCK_CODE_SIZE)
+			region = OpenRegion(generation);
+
+		// Out of blocks, the oldest code makes room
+		if (IsFull())
+		{
+			int victim = FindOldestRegion(JitCodeRegion::NURSERY);
+			if (victim == -1)
+				victim = FindOldestRegion(JitCodeRegion::TENURED);
+			if (victim != -1)
+			{
+				EvictRegion(victim);
+			}
+			else
+			{
+				Clear();
+				region = OpenRegion(generation);
+			}
+		}
+
+		alloc_region = region;
+		return regions[region].ptr;
+	}
+
+	int JitBaseBlockCache::FindVictimRegion(int generation) const
+	{
+		int tenured = 0;
+		for (int i = 0; i < NUM_CODE_REGIONS; i++)
+		{
+			if (regions[i].generation == JitCodeRegion::EMPTY)
+				return i;
+			if (regions[i].generation == JitCodeRegion::TENURED)
+				tenured++;
+		}
+
+		// The tenured regions grow at the expense of the nursery up to a limit,
+		// then they replace each other
+		int victim_generation = JitCodeRegion::NURSERY;
+		if (generation == JitCodeRegion::TENURED && tenured >= MAX_TENURED_REGIONS)
+			victim_generation = JitCodeRegion::TENURED;
+
+		int victim = FindOldestRegion(victim_generation);
+		if (victim == -1)
+			victim = FindOldestRegion(!victim_generation);
+		return victim;
+	}
+
+	// The oldest region of a generation that blocks aren't currently compiled into
+	int JitBaseBlockCache::FindOldestRegion(int generation) const
+	{
+		int oldest = -1;
+		for (int i = 0; i < NUM_CODE_REGIONS; i++)
+		{
+			if (i == open_region[0] || i == open_region[1] || regions[i].generation != generation)
+				continue;
+			if (oldest == -1 || regions[i].opened < regions[oldest].opened)
+				oldest = i;
+		}
+		return oldest;
+	}
+
+	void JitBaseBlockCache::EvictRegion(int region_num)
+	{
+		JitCodeRegion &region = regions[region_num];
+		int evicted = 0;
+		for (int block_num : region.blocks)
+		{
+			JitBlock &b = blocks[block_num];
+			if (!b.invalid)
 			{
-				if (sourceBlock.exitAddress[e] == b.originalAddress)
-					sourceBlock.linkStatus[e] = false;
+				evicted_addresses.insert(b.originalAddress);
+				DestroyBlock(block_num, false);
+				evicted++;
 			}
+			free_blocks.push_back(block_num);
 		}
+
+		DEBUG_LOG(DYNA_REC, "Evicted %s code region %d with %d blocks",
+			region.generation == JitCodeRegion::TENURED ? "tenured" : "nursery", region_num, evicted);
+
+		jit->ForgetCode(region.start, region.end);
+
+		stats.evictions++;
+		stats.evictedBlocks += evicted;
+		region.blocks.clear();
+		region.ptr = region.start;
+		region.generation = JitCodeRegion::EMPTY;
+		if (alloc_region == region_num)
+			alloc_region = -1;
+	}
+
+	int JitBaseBlockCache::OpenRegion(int generation)
+	{
+		int region = FindVictimRegion(generation);
+		if (region == -1)
+		{
+			Clear();
+			region = FindVictimRegion(generation);
+		}
+		else if (regions[region].generation != JitCodeRegion::EMPTY)
+		{
+			EvictRegion(region);
+		}
+
+		regions[region].generation = generation;
+		regions[region].opened = ++region_serial;
+		open_region[generation] = region;
+		return region;
 	}
 
 	void JitBaseBlockCache::DestroyBlock(int block_num, bool invalidate)
@@ -340,8 +646,19 @@ using namespace Gen;
 		}
 		b.invalid = true;
 		*GetICachePtr(b.originalAddress) = JIT_ICACHE_INVALID_WORD;
+		for (int i = 0; i < NUM_BLOCK_FLAGS; i++)
+		{
+			if (b.flags & (1 << i))
+				blocks_with_flag[i]--;
+		}
 
 		UnlinkBlock(block_num);
+		RemoveBlockFromPages(block_num);
+		for (int e = 0; e < 2; e++)
+		{
+			if (b.exitAddress[e] != INVALID_EXIT)
+				RemoveExitFromPage(block_num, e);
+		}
 
 		// Send anyone who tries to run this block back to the dispatcher.
 		// Not entirely ideal, but .. pretty good.
@@ -364,21 +681,28 @@ using namespace Gen;
 				valid_block[pAddr / 32] = false;
 		}
 
-		// destroy JIT blocks
-		// !! this works correctly under assumption that any two overlapping blocks end at the same address
-		if (destroy_block)
-		{
-			std::map<pair<u32,u32>, u32>::iterator it1 = block_map.lower_bound(std::make_pair(pAddr, 0)), it2 = it1;
-			while (it2 != block_map.end() && it2->first.second < pAddr + length)
+		// destroy JIT blocks, looking only at the ones in the pages the range touches
+		if (destroy_block && length != 0)
 		{
-				JitBlock &b = blocks[it2->second];
-				*GetICachePtr(b.originalAddress) = JIT_ICACHE_INVALID_WORD;
-				DestroyBlock(it2->second, true);
-				it2++;
-			}
-			if (it1 != it2)
+			u32 first = pAddr >> PAGE_SHIFT;
+			u32 last = std::min<u32>((pAddr + length - 1) >> PAGE_SHIFT, NUM_PAGES - 1);
+			for (u32 page = first; page <= last; page++)
 			{
-				block_map.erase(it1, it2);
+				std::vector<int> &page_blocks = blocks_in_page[page];
+				for (size_t i = 0; i < page_blocks.size();)
+				{
+					u32 start, end;
+					GetBlockRange(blocks[page_blocks[i]], &start, &end);
+					if (start < pAddr + length && end > pAddr)
+					{
+						// Removes the block from page_blocks
+						DestroyBlock(page_blocks[i], true);
+					}
+					else
+					{
+						i++;
+					}
+				}
 			}
 		}
 
@@ -417,3 +741,8 @@ using namespace Gen;
 		emit.MOV(32, M(&PC), Imm32(address));
 		emit.JMP(jit->GetAsmRoutines()->dispatcher, true);
 	}
+	void JitBlockCache::WriteUnlinkBlock(u8* location)
+	{
+		XEmitter emit(location);
+		emit.JMP(jit->GetAsmRoutines()->dispatcher, true);
+	}
@@ -7,6 +7,7 @@
 
 #include <bitset>
 #include <map>
+#include <unordered_set>
 #include <vector>
 
 #include "../Gekko.h"
@@ -30,6 +31,20 @@
 #define JIT_ICACHE_INVALID_BYTE 0x80
 #define JIT_ICACHE_INVALID_WORD 0x80808080
 
+// Set in JitBlock::flags for the GQRs the block's code was specialized on
+enum BlockFlag
+{
+	BLOCK_USE_GQR0 = 0x1,
+	BLOCK_USE_GQR1 = 0x2,
+	BLOCK_USE_GQR2 = 0x4,
+	BLOCK_USE_GQR3 = 0x8,
+	BLOCK_USE_GQR4 = 0x10,
+	BLOCK_USE_GQR5 = 0x20,
+	BLOCK_USE_GQR6 = 0x40,
+	BLOCK_USE_GQR7 = 0x80,
+	NUM_BLOCK_FLAGS = 8,
+};
+
 struct JitBlock
 {
 	const u8 *checkedEntry;
@@ -41,12 +56,21 @@ struct JitBlock
 	u32 originalAddress;
 	u32 codeSize;
 	u32 originalSize;
+	// Guest code past the block that its compilation depended on, [start, end)
+	u32 lookaheadStart;
+	u32 lookaheadEnd;
 	int runCount;  // for profiling.
+	int loopCount; // back-edges taken by a block that branches to its own start
 	int flags;
 
 	bool invalid;
 	bool linkStatus[2];
 
+	// Intrusive, doubly linked list of the exits that branch into the same
+	// guest page. Entries are block_num * 2 + exit_num, -1 ends the list.
+	int nextExit[2];
+	int prevExit[2];
+
 #ifdef _WIN32
 	// we don't really need to save start and stop
 	// TODO (mb2): ticStart and ticStop -> "local var" mean "in block" ... low priority ;)
@@ -62,33 +86,104 @@ struct JitBlock
 
 typedef void (*CompiledCode)();
 
+// A slice of the code space. Blocks are compiled into the open region of their
+// generation, and when the code space runs out a whole region is evicted.
+struct JitCodeRegion
+{
+	enum
+	{
+		EMPTY = -1,
+		NURSERY = 0,  // blocks compiled for the first time
+		TENURED = 1,  // blocks that were compiled again after being evicted
+	};
+
+	u8 *start;
+	u8 *end;
+	u8 *ptr;         // where the next block in this region goes
+	int generation;
+	u64 opened;      // when the region was last opened, to find the oldest one
+	std::vector<int> blocks;
+};
+
+struct JitEvictionStats
+{
+	u64 evictions;
+	u64 evictedBlocks;
+	u64 recompiledBlocks;
+	u64 recompileTime;  // in nanoseconds
+	u64 fullClears;
+};
 
 class JitBaseBlockCache
 {
+	enum
+	{
+		MAX_NUM_BLOCKS = 65536*2,
+		PAGE_SHIFT = 12,
+		NUM_PAGES = 0x20000000 >> PAGE_SHIFT,
+		NUM_CODE_REGIONS = 16,
+		// Tenured regions may take at most this many, the rest stay for new code
+		MAX_TENURED_REGIONS = NUM_CODE_REGIONS / 2,
+		// Room a region must have left before a block is compiled into it
+		MAX_BLOCK_CODE_SIZE = 0x10000,
+	};
+
 	const u8 **blockCodePointers;
 	JitBlock *blocks;
 	int num_blocks;
-	std::multimap<u32, int> links_to;
-	std::map<std::pair<u32,u32>, u32> block_map; // (end_addr, start_addr) -> number
+	// Per physical 4 KB page, the blocks whose code overlaps it
+	std::vector<std::vector<int>> blocks_in_page;
+	// Per physical 4 KB page, the head of the list of exits branching into it
+	std::vector<int> exits_to_page;
 	std::bitset<0x20000000 / 32> valid_block;
-	enum
-	{
-		MAX_NUM_BLOCKS = 65536*2
-	};
+
+	// Only set up by the JITs that support eviction, empty otherwise
+	std::vector<JitCodeRegion> regions;
+	int open_region[2];
+	int alloc_region;
+	u64 region_serial;
+	std::vector<int> free_blocks;
+	std::unordered_set<u32> evicted_addresses;
+	u64 recompile_start;
+	JitEvictionStats stats;
+	// Per BlockFlag bit, the number of valid blocks that have it set
+	int blocks_with_flag[NUM_BLOCK_FLAGS];
 
 	bool RangeIntersect(int s1, int e1, int s2, int e2) const;
 	void LinkBlockExits(int i);
 	void LinkBlock(int i);
 	void UnlinkBlock(int i);
 
+	// The physical range and pages of the code a block depends on
+	void GetBlockRange(const JitBlock &b, u32 *start, u32 *end) const;
+	void GetBlockPages(const JitBlock &b, u32 *first, u32 *last) const;
+	void AddBlockToPages(int block_num);
+	void RemoveBlockFromPages(int block_num);
+	void AddExitToPage(int block_num, int exit_num);
+	void RemoveExitFromPage(int block_num, int exit_num);
+
+	void ResetRegions();
+	int FindVictimRegion(int generation) const;
+	int FindOldestRegion(int generation) const;
+	void EvictRegion(int region);
+	int OpenRegion(int generation);
+
 	// Virtual for overloaded
 	virtual void WriteLinkBlock(u8* location, const u8* address) = 0;
 	virtual void WriteDestroyBlock(const u8* location, u32 address) = 0;
+	// Points a linked exit back at the dispatcher. Only used once regions are
+	// set up, by JITs that store the PC before the jump of every exit.
+	virtual void WriteUnlinkBlock(u8* location) {}
 
 public:
 	JitBaseBlockCache() :
 		blockCodePointers(0), blocks(0), num_blocks(0),
-		iCache(0), iCacheEx(0), iCacheVMEM(0) {}
+		alloc_region(-1), region_serial(0), recompile_start(0),
+		iCache(0), iCacheEx(0), iCacheVMEM(0)
+	{
+		open_region[0] = open_region[1] = -1;
+		memset(blocks_with_flag, 0, sizeof(blocks_with_flag));
+	}
 	int AllocateBlock(u32 em_address);
 	void FinalizeBlock(int block_num, bool block_link, const u8 *code_ptr);
 
@@ -100,6 +195,14 @@ public:
 
 	bool IsFull() const;
 
+	// Splits the code space into regions. From then on, running out of code
+	// space or blocks evicts the coldest region instead of everything.
+	void InitRegions(u8 *code_space, size_t size);
+	// Returns where to compile the block at em_address, evicting as needed.
+	// code_ptr is where the previous block ended.
+	u8 *AllocateCode(u32 em_address, u8 *code_ptr);
+	const JitEvictionStats &GetEvictionStats() const { return stats; }
+
 	// Code Cache
 	JitBlock *GetBlock(int block_num);
 	int GetNumBlocks() const;
@@ -120,8 +223,8 @@ public:
 	void InvalidateICache(u32 address, const u32 length);
 	void DestroyBlock(int block_num, bool invalidate);
 
-	// Not currently used
-	//void DestroyBlocksWithFlag(BlockFlag death_flag);
+	// Returns the number of blocks destroyed
+	int DestroyBlocksWithFlag(BlockFlag death_flag);
 };
 
 // x86 BlockCache
@@ -130,5 +233,6 @@ class JitBlockCache : public JitBaseBlockCache
 private:
 	void WriteLinkBlock(u8* location, const u8* address) override;
 	void WriteDestroyBlock(const u8* location, u32 address) override;
+	void WriteUnlinkBlock(u8* location) override;
 };
 #endif
@@ -0,0 +1,136 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cinttypes>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Common.h"
+#include "FileUtil.h"
+
+#include "JitCoverage.h"
+#include "../PPCSymbolDB.h"
+#include "../PPCTables.h"
+
+namespace JitCoverage
+{
+
+enum
+{
+	MAX_SITES = 0x10000,
+};
+
+struct Site
+{
+	SiteType type;
+	u32 address;
+	UGeckoInstruction inst;
+};
+
+// The compiled code increments these directly, so they must never move
+static u64 s_counters[MAX_SITES];
+static u64 s_overflow_counter;
+static std::vector<Site> s_sites;
+static std::map<u64, int> s_site_map;
+
+static const char *const s_site_names[NUM_SITE_TYPES] = {
+	"Interpreter fallbacks",
+	"Slow path loads",
+	"Slow path stores",
+	"Backpatched accesses",
+};
+
+u64 *GetCounter(SiteType type, u32 address, UGeckoInstruction inst)
+{
+	u64 key = ((u64)type << 32) | address;
+	std::map<u64, int>::iterator it = s_site_map.find(key);
+	if (it != s_site_map.end())
+		return &s_counters[it->second];
+
+	if (s_sites.size() == MAX_SITES)
+		return &s_overflow_counter;
+
+	Site site = {type, address, inst};
+	s_site_map[key] = (int)s_sites.size();
+	s_sites.push_back(site);
+	return &s_counters[s_sites.size() - 1];
+}
+
+void Clear()
+{
+	memset(s_counters, 0, sizeof(s_counters));
+	s_overflow_counter = 0;
+	s_sites.clear();
+	s_site_map.clear();
+}
+
+struct SiteStat
+{
+	SiteStat(int s, u64 c) : site(s), count(c) {}
+	int site;
+	u64 count;
+
+	bool operator <(const SiteStat &other) const
+	{ return count > other.count; }
+};
+
+void WriteResults(const char *filename)
+{
+	File::IOFile f(filename, "w");
+	if (!f)
+	{
+		PanicAlert("Failed to open %s", filename);
+		return;
+	}
+
+	std::vector<SiteStat> stats[NUM_SITE_TYPES];
+	u64 totals[NUM_SITE_TYPES] = {0};
+	std::map<std::string, u64> fallbacks_by_opcode;
+	for (size_t i = 0; i < s_sites.size(); i++)
+	{
+		const Site &site = s_sites[i];
+		if (!s_counters[i])
+			continue;
+		stats[site.type].push_back(SiteStat((int)i, s_counters[i]));
+		totals[site.type] += s_counters[i];
+		if (site.type == SITE_FALLBACK)
+			fallbacks_by_opcode[PPCTables::GetInstructionName(site.inst)] += s_counters[i];
+	}
+
+	fprintf(f.GetHandle(), "JIT coverage, %u sites\n", (u32)s_sites.size());
+	if (s_overflow_counter)
+		fprintf(f.GetHandle(), "%" PRIu64 " hits on sites past the first %d were not attributed\n", s_overflow_counter, MAX_SITES);
+	for (int type = 0; type < NUM_SITE_TYPES; type++)
+		fprintf(f.GetHandle(), "%s: %" PRIu64 "\n", s_site_names[type], totals[type]);
+
+	// What to implement in the JIT first
+	std::vector<std::pair<u64, std::string>> opcodes;
+	for (auto& opcode : fallbacks_by_opcode)
+		opcodes.push_back(std::make_pair(opcode.second, opcode.first));
+	std::sort(opcodes.rbegin(), opcodes.rend());
+	fprintf(f.GetHandle(), "\nInterpreter fallbacks by opcode\ncount\tpercent\topcode\n");
+	for (auto& opcode : opcodes)
+	{
+		fprintf(f.GetHandle(), "%" PRIu64 "\t%.2lf\t%s\n", opcode.first,
+			100.0 * (double)opcode.first / (double)totals[SITE_FALLBACK], opcode.second.c_str());
+	}
+
+	for (int type = 0; type < NUM_SITE_TYPES; type++)
+	{
+		std::sort(stats[type].begin(), stats[type].end());
+		fprintf(f.GetHandle(), "\n%s by site\ncount\tpercent\taddress\topcode\tfunction\n", s_site_names[type]);
+		for (auto& stat : stats[type])
+		{
+			const Site &site = s_sites[stat.site];
+			std::string name = g_symbolDB.GetDescription(site.address);
+			fprintf(f.GetHandle(), "%" PRIu64 "\t%.2lf\t%08x\t%s\t%s\n", stat.count,
+				100.0 * (double)stat.count / (double)totals[type], site.address,
+				PPCTables::GetInstructionName(site.inst), name.c_str());
+		}
+	}
+}
+
+}  // namespace
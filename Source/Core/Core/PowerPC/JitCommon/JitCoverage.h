@@ -0,0 +1,37 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+// Counts, per guest instruction, how often compiled code leaves its fast path:
+// calls into the interpreter, memory accesses that take the slow path to the
+// hardware registers, and accesses that were backpatched to a trampoline.
+// Only compiled in while Profiler::g_ProfileCoverage is set.
+
+#ifndef _JITCOVERAGE_H
+#define _JITCOVERAGE_H
+
+#include "Common.h"
+#include "../Gekko.h"
+
+namespace JitCoverage
+{
+
+enum SiteType
+{
+	SITE_FALLBACK = 0,
+	SITE_SLOW_LOAD,
+	SITE_SLOW_STORE,
+	SITE_BACKPATCH,
+	NUM_SITE_TYPES,
+};
+
+// Returns the counter the code compiled for the instruction at address should
+// increment. Recompiling the same instruction returns the same counter.
+u64 *GetCounter(SiteType type, u32 address, UGeckoInstruction inst);
+
+void Clear();
+void WriteResults(const char *filename);
+
+}  // namespace
+
+#endif  // _JITCOVERAGE_H
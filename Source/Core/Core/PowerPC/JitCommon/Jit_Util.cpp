@@ -7,6 +7,7 @@
 #include "CPUDetect.h"
 #include "JitBase.h"
 #include "Jit_Util.h"
+#include "../Profiler.h"
 
 using namespace Gen;
 
@@ -136,6 +137,8 @@ void EmuCodeBlock::SafeLoadToReg(X64Reg reg_value, const Gen::OpArg & opAddress,
 		u8 *mov = UnsafeLoadToReg(reg_value, opAddress, accessSize, offset, signExtend);
 
 		registersInUseAtLoc[mov] = registersInUse;
+		if (Profiler::g_ProfileCoverage)
+			coverageAddressAtLoc[mov] = jit->js.compilerPC;
 	}
 	else
 #endif
@@ -162,6 +165,7 @@ void EmuCodeBlock::SafeLoadToReg(X64Reg reg_value, const Gen::OpArg & opAddress,
 			}
 			else
 			{
+				CountCoverage(JitCoverage::SITE_SLOW_LOAD);
 				ABI_PushRegistersAndAdjustStack(registersInUse, false);
 				switch (accessSize)
 				{
@@ -195,6 +199,7 @@ void EmuCodeBlock::SafeLoadToReg(X64Reg reg_value, const Gen::OpArg & opAddress,
 				TEST(32, R(EAX), Imm32(mem_mask));
 				FixupBranch fast = J_CC(CC_Z, true);
 
+				CountCoverage(JitCoverage::SITE_SLOW_LOAD);
 				ABI_PushRegistersAndAdjustStack(registersInUse, false);
 				switch (accessSize)
 				{
@@ -228,6 +233,7 @@ void EmuCodeBlock::SafeLoadToReg(X64Reg reg_value, const Gen::OpArg & opAddress,
 				TEST(32, opAddress, Imm32(mem_mask));
 				FixupBranch fast = J_CC(CC_Z, true);
 
+				CountCoverage(JitCoverage::SITE_SLOW_LOAD);
 				ABI_PushRegistersAndAdjustStack(registersInUse, false);
 				switch (accessSize)
 				{
@@ -300,6 +306,8 @@ void EmuCodeBlock::SafeWriteRegToReg(X64Reg reg_value, X64Reg reg_addr, int acce
 		}
 
 		registersInUseAtLoc[mov] = registersInUse;
+		if (Profiler::g_ProfileCoverage)
+			coverageAddressAtLoc[mov] = jit->js.compilerPC;
 		return;
 	}
 #endif
@@ -324,6 +332,7 @@ void EmuCodeBlock::SafeWriteRegToReg(X64Reg reg_value, X64Reg reg_addr, int acce
 	MOV(32, M(&PC), Imm32(jit->js.compilerPC)); // Helps external systems know which instruction triggered the write
 	TEST(32, R(reg_addr), Imm32(mem_mask));
 	FixupBranch fast = J_CC(CC_Z, true);
+	CountCoverage(JitCoverage::SITE_SLOW_STORE);
 	bool noProlog = (0 != (flags & SAFE_LOADSTORE_NO_PROLOG));
 	bool swap = !(flags & SAFE_LOADSTORE_NO_SWAP);
 	ABI_PushRegistersAndAdjustStack(registersInUse, noProlog);
@@ -433,3 +442,29 @@ void EmuCodeBlock::JitClearCAOV(bool oe)
 	else
 		AND(32, M(&PowerPC::ppcState.spr[SPR_XER]), Imm32(~XER_CA_MASK)); //XER.CA = 0
 }
+
+void EmuCodeBlock::CountCoverage(JitCoverage::SiteType type)
+{
+	if (!Profiler::g_ProfileCoverage)
+		return;
+
+	u32 address = jit->js.compilerPC;
+	u64 *counter = JitCoverage::GetCounter(type, address, Memory::ReadUnchecked_U32(address));
+#ifdef _M_X64
+	ADD(64, M(counter), Imm8(1));
+#else
+	ADD(32, M(counter), Imm8(1));
+	ADC(32, M((u8 *)counter + 4), Imm8(0));
+#endif
+}
+
+void EmuCodeBlock::ClearCoverageSites(const u8 *start, const u8 *end)
+{
+	for (auto it = coverageAddressAtLoc.begin(); it != coverageAddressAtLoc.end();)
+	{
+		if (it->first >= start && it->first < end)
+			it = coverageAddressAtLoc.erase(it);
+		else
+			++it;
+	}
+}
@@ -6,6 +6,7 @@
 #define _JITUTIL_H
 
 #include "x64Emitter.h"
+#include "JitCoverage.h"
 #include <unordered_map>
 
 #define MEMCHECK_START \
@@ -48,8 +49,15 @@ public:
 
 	void ForceSinglePrecisionS(Gen::X64Reg xmm);
 	void ForceSinglePrecisionP(Gen::X64Reg xmm);
+
+	// Counts a slow path of the instruction being compiled for the coverage report
+	void CountCoverage(JitCoverage::SiteType type);
+	// Drops the coverage sites of code in [start, end) that is thrown away
+	void ClearCoverageSites(const u8 *start, const u8 *end);
 protected:
 	std::unordered_map<u8 *, u32> registersInUseAtLoc;
+	// Guest address of every fastmem access, for the coverage report
+	std::unordered_map<u8 *, u32> coverageAddressAtLoc;
 };
 
 #endif  // _JITUTIL_H
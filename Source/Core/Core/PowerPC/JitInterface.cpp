@@ -11,6 +11,8 @@
 
 #include "JitInterface.h"
 #include "JitCommon/JitBase.h"
+#include "JitCommon/JitCoverage.h"
+#include "Interpreter/CachedInterpreter.h"
 
 #ifndef _M_GENERIC
 #include "Jit64IL/JitIL.h"
@@ -184,6 +186,10 @@ namespace JitInterface
 		}
 		#endif
 	}
+	void WriteCoverageResults(const char *filename)
+	{
+		JitCoverage::WriteResults(filename);
+	}
 	bool IsInCodeSpace(u8 *ptr)
 	{
 		return jit->IsInCodeSpace(ptr);
@@ -197,17 +203,20 @@ namespace JitInterface
 	{
 		if (jit)
 			jit->ClearCache();
+		CachedInterpreter::getInstance()->ClearCache();
 	}
 	void ClearSafe()
 	{
 		if (jit)
 			jit->GetBlockCache()->ClearSafe();
+		CachedInterpreter::getInstance()->ClearCache();
 	}
 
 	void InvalidateICache(u32 address, u32 size)
 	{
 		if (jit)
 			jit->GetBlockCache()->InvalidateICache(address, size);
+		CachedInterpreter::getInstance()->InvalidateICache(address, size);
 	}
 
 	u32 Read_Opcode_JIT(u32 _Address)
@@ -15,6 +15,7 @@ namespace JitInterface
 
 	// Debugging
 	void WriteProfileResults(const char *filename);
+	void WriteCoverageResults(const char *filename);
 
 	// Memory Utilities
 	bool IsInCodeSpace(u8 *ptr);
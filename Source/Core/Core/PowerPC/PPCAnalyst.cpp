@@ -2,6 +2,7 @@
 // Licensed under GPLv2
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include <string>
 #include <queue>
 
@@ -15,6 +16,7 @@
 #include "PPCAnalyst.h"
 #include "../ConfigManager.h"
 #include "../GeckoCode.h"
+#include "../HLE/HLE.h"
 
 // Analyzes PowerPC code in memory to find functions
 // After running, for each function we will know what functions it calls
@@ -34,6 +36,10 @@ using namespace std;
 static const int CODEBUFFER_SIZE = 32000;
 // 0 does not perform block merging
 static const int FUNCTION_FOLLOWING_THRESHOLD = 16;
+// Instructions looked at past the end of a block to find out which CR fields
+// its successors read, and how far from the block they may be
+static const int CR_LOOKAHEAD = 16;
+static const u32 CR_LOOKAHEAD_WINDOW = 0x1000;
 
 CodeBuffer::CodeBuffer(int size)
 {
@@ -268,6 +274,140 @@ bool CanSwapAdjacentOps(const CodeOp &a, const CodeOp &b)
 	return true;
 }
 
+// Conditional branches read the field holding their condition bit. Anything
+// else that touches CR in a way the tables don't describe is assumed to read
+// all of it.
+static u8 GetCRFieldsRead(UGeckoInstruction inst, const GekkoOPInfo *opinfo)
+{
+	const bool conditional_branch = inst.OPCD == 16 ||
+		(inst.OPCD == 19 && (inst.SUBOP10 == 16 || inst.SUBOP10 == 528));
+	if (conditional_branch)
+		return (inst.BO & BO_DONT_CHECK_CONDITION) ? 0 : 1 << (inst.BI >> 2);
+
+	switch (opinfo->type)
+	{
+	case OPTYPE_CR:
+	case OPTYPE_SYSTEM:
+	case OPTYPE_SYSTEMFP:
+		return 0xFF;
+	default:
+		return (opinfo->flags & FL_EVIL) ? 0xFF : 0;
+	}
+}
+
+// Only the integer compares and record forms, which set a whole field from
+// their result. Everything else that writes CR only counts as a reader.
+static u8 GetCRFieldsWritten(UGeckoInstruction inst, const GekkoOPInfo *opinfo)
+{
+	if (opinfo->flags & FL_EVIL)
+		return 0;
+	if ((inst.OPCD == 10 || inst.OPCD == 11) ||
+		(inst.OPCD == 31 && (inst.SUBOP10 == 0 || inst.SUBOP10 == 32)))
+		return 1 << inst.CRFD;
+	// mulli is marked RC_BIT too, but its low bit is part of the immediate
+	const bool record_form = (opinfo->flags & FL_RC_BIT) && inst.Rc &&
+		(inst.OPCD == 31 || (inst.OPCD >= 20 && inst.OPCD <= 23));
+	if (record_form || (opinfo->flags & FL_SET_CR0))
+		return 1;
+	return 0;
+}
+
+// The code outside of a block that the CR analysis looked at. The block is
+// compiled on the assumption that this code doesn't change, so it has to be
+// invalidated along with the block.
+struct CRLookahead
+{
+	// Only code in [low, high) is looked at
+	u32 low, high;
+	// The range of the code looked at, empty if start == end
+	u32 start, end;
+
+	CRLookahead(u32 _low, u32 _high) : low(_low), high(_high), start(0), end(0) {}
+
+	bool Visit(u32 address)
+	{
+		if (address < low || address >= high)
+			return false;
+		if (start == end)
+		{
+			start = address;
+			end = address + 4;
+		}
+		else
+		{
+			start = std::min(start, address);
+			end = std::max(end, address + 4);
+		}
+		return true;
+	}
+};
+
+// The CR fields the code at address may read before overwriting them. Follows
+// plain branches, both sides of conditional ones, and gives up on calls,
+// returns and anything it can't see through.
+static u8 GetCRFieldsWantedAt(u32 address, int budget, CRLookahead &lookahead)
+{
+	const SCoreStartupParameter &params = SConfig::GetInstance().m_LocalCoreStartupParameter;
+	if (params.bMMU || params.bEnableDebugging)
+		return 0xFF;
+
+	u8 read = 0;
+	u8 written = 0;
+	for (; budget > 0; budget--)
+	{
+		if (!Memory::IsRAMAddress(address) || !lookahead.Visit(address))
+			break;
+		UGeckoInstruction inst = Memory::ReadUnchecked_U32(address);
+		GekkoOPInfo *opinfo = GetOpInfo(inst);
+		if (inst.hex == 0 || !opinfo)
+			break;
+
+		read |= GetCRFieldsRead(inst, opinfo) & ~written;
+		written |= GetCRFieldsWritten(inst, opinfo);
+		if (written == 0xFF)
+			return read;
+
+		if (inst.OPCD == 18 && !inst.LK)
+		{
+			address = (inst.AA ? 0 : address) + SignExt26(inst.LI << 2);
+		}
+		else if (inst.OPCD == 16 && !inst.LK)
+		{
+			const u32 destination = (inst.AA ? 0 : address) + SignExt16(inst.BD << 2);
+			budget = (budget - 1) / 2;
+			u8 wanted = GetCRFieldsWantedAt(destination, budget, lookahead) |
+				GetCRFieldsWantedAt(address + 4, budget, lookahead);
+			return read | (wanted & ~written);
+		}
+		else if (opinfo->flags & FL_ENDBLOCK)
+		{
+			break;
+		}
+		else
+		{
+			address += 4;
+		}
+	}
+	return read | ~written;
+}
+
+// The CR fields the code the block exits to may read
+static u8 GetCRFieldsWantedAfter(const CodeOp &last, CRLookahead &lookahead)
+{
+	const UGeckoInstruction inst = last.inst;
+	if (inst.LK)
+		return 0xFF;
+	if (inst.OPCD == 18)
+		return GetCRFieldsWantedAt((inst.AA ? 0 : last.address) + SignExt26(inst.LI << 2), CR_LOOKAHEAD, lookahead);
+	if (inst.OPCD == 16)
+	{
+		const u32 destination = (inst.AA ? 0 : last.address) + SignExt16(inst.BD << 2);
+		return GetCRFieldsWantedAt(destination, CR_LOOKAHEAD, lookahead) |
+			GetCRFieldsWantedAt(last.address + 4, CR_LOOKAHEAD, lookahead);
+	}
+	return 0xFF;
+}
+
 // Does not yet perform inlining - although there are plans for that.
 // Returns the exit address of the next PC
 u32 Flatten(u32 address, int *realsize, BlockStats *st, BlockRegStats *gpa,
@@ -336,6 +476,11 @@ u32 Flatten(u32 address, int *realsize, BlockStats *st, BlockRegStats *gpa,
 			code[i].wantsCR1 = false;
 			code[i].wantsPS1 = false;
 
+			code[i].crFieldsIn = GetCRFieldsRead(inst, opinfo);
+			code[i].crFieldsOut = GetCRFieldsWritten(inst, opinfo);
+			code[i].regsWanted = 0xFFFFFFFF;
+			code[i].wantsCA = true;
+
 			int flags = opinfo->flags;
 
 			if (flags & FL_USE_FPU)
@@ -558,6 +703,28 @@ u32 Flatten(u32 address, int *realsize, BlockStats *st, BlockRegStats *gpa,
 		code[i].wantsPS1 = wantsPS1;
 	}
 
+	// Scan for the CR fields read later on, starting with the ones the code
+	// after the block may read
+	u8 crFieldsWanted = 0xFF;
+	if (num_inst > 0)
+	{
+		const u32 start = merged_addresses[0];
+		const u32 end = start + 4 * num_inst;
+		CRLookahead lookahead(start > CR_LOOKAHEAD_WINDOW ? start - CR_LOOKAHEAD_WINDOW : 0,
+			end <= 0xFFFFFFFF - CR_LOOKAHEAD_WINDOW ? end + CR_LOOKAHEAD_WINDOW : 0xFFFFFFFF);
+		if (foundExit)
+			crFieldsWanted = GetCRFieldsWantedAfter(code[num_inst - 1], lookahead);
+		else
+			crFieldsWanted = GetCRFieldsWantedAt(address, CR_LOOKAHEAD, lookahead);
+		st->crLookaheadStart = lookahead.start;
+		st->crLookaheadEnd = lookahead.end;
+	}
+	for (int i = num_inst - 1; i >= 0; i--)
+	{
+		code[i].crFieldsWanted = crFieldsWanted;
+		crFieldsWanted = (crFieldsWanted & ~code[i].crFieldsOut) | code[i].crFieldsIn;
+	}
+
 	*realsize = num_inst;
 	// ...
 	return address;
@@ -599,6 +766,421 @@ void FindFunctionsFromBranches(u32 startAddr, u32 endAddr, SymbolDB *func_db)
 	}
 }
 
+// Loads without update, plus the integer instructions that don't read the carry
+static bool IsSideEffectFree(const CodeOp &op)
+{
+	const GekkoOPInfo *opinfo = op.opinfo;
+	if (opinfo->flags & (FL_EVIL | FL_READ_CA))
+		return false;
+
+	switch (opinfo->type)
+	{
+	case OPTYPE_LOAD:
+		return !(opinfo->flags & FL_OUT_A);
+	case OPTYPE_INTEGER:
+		// eciwx and ecowx go to an external device
+		return !(op.inst.OPCD == 31 && (op.inst.SUBOP10 == 310 || op.inst.SUBOP10 == 438));
+	default:
+		return false;
+	}
+}
+
+bool IsIdleLoop(const CodeOp *code, int size, u32 blockStart)
+{
+	if (size == 0)
+		return false;
+
+	// The loop has to end in a branch back to the start that doesn't count CTR down or set LR
+	const CodeOp &last = code[size - 1];
+	const UGeckoInstruction branch = last.inst;
+	u32 destination;
+	if (branch.OPCD == 18)
+		destination = (branch.AA ? 0 : last.address) + SignExt26(branch.LI << 2);
+	else if (branch.OPCD == 16 && (branch.BO & BO_DONT_DECREMENT_FLAG))
+		destination = (branch.AA ? 0 : last.address) + SignExt16(branch.BD << 2);
+	else
+		return false;
+	if (branch.LK || destination != blockStart)
+		return false;
+
+	// Everything else must be free of side effects, and may not carry a
+	// register from one pass to the next: a register written in the loop must
+	// be written before it is read, or the loop is counting something.
+	u32 written = 0;
+	for (int i = 0; i < size - 1; i++)
+	{
+		for (int j = 0; j < 2; j++)
+		{
+			if (code[i].regsOut[j] >= 0)
+				written |= 1 << code[i].regsOut[j];
+		}
+	}
+
+	u32 written_this_pass = 0;
+	for (int i = 0; i < size - 1; i++)
+	{
+		const CodeOp &op = code[i];
+		if (op.skip)
+			continue;
+
+		// Calls and returns that Flatten followed only set LR to a constant,
+		// unless the return counts CTR down like the bc back-edge above
+		const bool followed_branch = op.inst.OPCD == 18 ||
+			(op.inst.OPCD == 19 && op.inst.SUBOP10 == 16 && (op.inst.BO & BO_DONT_DECREMENT_FLAG));
+		if (!followed_branch && !IsSideEffectFree(op))
+			return false;
+
+		for (int j = 0; j < 3; j++)
+		{
+			const int reg = op.regsIn[j];
+			if (reg >= 0 && (written & (1 << reg)) && !(written_this_pass & (1 << reg)))
+				return false;
+		}
+		for (int j = 0; j < 2; j++)
+		{
+			if (op.regsOut[j] >= 0)
+				written_this_pass |= 1 << op.regsOut[j];
+		}
+	}
+
+	return true;
+}
+
+// Whether regsIn and regsOut list every GPR the instruction reads and writes.
+// The tables describe the integer, load, store, floating point and branch
+// instructions completely, but not the paired single loads and stores, the
+// cache instructions or mtspr.
+static bool HasKnownRegisters(const CodeOp &op)
+{
+	if ((op.opinfo->flags & FL_EVIL) || HLE::GetFunctionIndex(op.address))
+		return false;
+
+	switch (op.opinfo->type)
+	{
+	case OPTYPE_INTEGER:
+		// eciwx and ecowx
+		return !(op.inst.OPCD == 31 && (op.inst.SUBOP10 == 310 || op.inst.SUBOP10 == 438));
+	case OPTYPE_LOAD:
+	case OPTYPE_STORE:
+	case OPTYPE_LOADFP:
+	case OPTYPE_STOREFP:
+	case OPTYPE_FPU:
+	case OPTYPE_BRANCH:
+		return true;
+	default:
+		return false;
+	}
+}
+
+// The value the instruction writes to regsOut[0], if its inputs are known and
+// it has no other effect
+static bool EvaluateConstant(UGeckoInstruction inst, const bool *known, const u32 *value, u32 &result)
+{
+	switch (inst.OPCD)
+	{
+	case 14: // addi
+	case 15: // addis
+	{
+		if (inst.RA && !known[inst.RA])
+			return false;
+		u32 imm = inst.OPCD == 14 ? (u32)inst.SIMM_16 : (u32)inst.SIMM_16 << 16;
+		result = (inst.RA ? value[inst.RA] : 0) + imm;
+		return true;
+	}
+	case 24: // ori
+	case 25: // oris
+	case 26: // xori
+	case 27: // xoris
+	{
+		if (!known[inst.RS])
+			return false;
+		u32 imm = (inst.OPCD & 1) ? inst.UIMM << 16 : inst.UIMM;
+		result = inst.OPCD < 26 ? value[inst.RS] | imm : value[inst.RS] ^ imm;
+		return true;
+	}
+	case 21: // rlwinm
+		if (inst.Rc || !known[inst.RS])
+			return false;
+		result = _rotl(value[inst.RS], inst.SH) & Interpreter::Helper_Mask(inst.MB, inst.ME);
+		return true;
+	case 31:
+		break;
+	default:
+		return false;
+	}
+
+	if (inst.Rc)
+		return false;
+
+	// add, subf and neg take RA and RB, the logical ones RS and RB
+	switch (inst.SUBOP10)
+	{
+	case 266: // add
+	case 40: // subf
+		if (!known[inst.RA] || !known[inst.RB])
+			return false;
+		result = inst.SUBOP10 == 266 ? value[inst.RA] + value[inst.RB] : value[inst.RB] - value[inst.RA];
+		return true;
+	case 104: // neg
+		if (!known[inst.RA])
+			return false;
+		result = 0 - value[inst.RA];
+		return true;
+	}
+
+	if (!known[inst.RS])
+		return false;
+	const u32 s = value[inst.RS];
+	switch (inst.SUBOP10)
+	{
+	case 922: result = (u32)(s32)(s16)s; return true; // extsh
+	case 954: result = (u32)(s32)(s8)s; return true; // extsb
+	}
+
+	if (!known[inst.RB])
+		return false;
+	const u32 b = value[inst.RB];
+	switch (inst.SUBOP10)
+	{
+	case 444: result = s | b; return true; // or
+	case 28:  result = s & b; return true; // and
+	case 316: result = s ^ b; return true; // xor
+	case 124: result = ~(s | b); return true; // nor
+	case 60:  result = s & ~b; return true; // andc
+	case 412: result = s | ~b; return true; // orc
+	case 24:  result = (b & 0x20) ? 0 : s << (b & 0x1F); return true; // slw
+	case 536: result = (b & 0x20) ? 0 : s >> (b & 0x1F); return true; // srw
+	default:
+		return false;
+	}
+}
+
+// Integer instructions that only write their GPR outputs and maybe CA
+static bool CanRemove(const CodeOp &op)
+{
+	const GekkoOPInfo *opinfo = op.opinfo;
+	if (opinfo->type != OPTYPE_INTEGER || !HasKnownRegisters(op) || op.regsOut[0] < 0)
+		return false;
+	if (opinfo->flags & (FL_SET_CRx | FL_TIMER))
+		return false;
+	if ((opinfo->flags & FL_RC_BIT) && op.inst.Rc)
+		return false;
+	// OE is only there in the X-form arithmetic, which all have RC_BIT
+	if ((opinfo->flags & FL_RC_BIT) && op.inst.OPCD == 31 && op.inst.OE)
+		return false;
+	return true;
+}
+
+enum
+{
+	MAX_FORWARDED_STORES = 8,
+};
+
+struct ForwardedStore
+{
+	int base;
+	s32 offset;
+	int size;
+	int source;
+};
+
+static bool IsForwardingBase(int reg)
+{
+	// The stack pointer and the small data area pointers are only ever
+	// pointed at RAM
+	return reg == 1 || reg == 2 || reg == 13;
+}
+
+// Rewrites lwz/lhz/lha/lbz from the slot the last stw/sth/stb to it just
+// wrote into a move from the stored register
+static void ForwardStores(CodeOp *code, int size)
+{
+	ForwardedStore stores[MAX_FORWARDED_STORES];
+	int num_stores = 0;
+
+	for (int i = 0; i < size; i++)
+	{
+		CodeOp &op = code[i];
+		if (op.skip)
+			continue;
+
+		const UGeckoInstruction inst = op.inst;
+		int store_size = 0, load_size = 0;
+		switch (inst.OPCD)
+		{
+		case 36: store_size = 4; break; // stw
+		case 44: store_size = 2; break; // sth
+		case 38: store_size = 1; break; // stb
+		case 32: load_size = 4; break; // lwz
+		case 40: load_size = 2; break; // lhz
+		case 42: load_size = 2; break; // lha
+		case 34: load_size = 1; break; // lbz
+		}
+
+		if (load_size && IsForwardingBase(inst.RA))
+		{
+			for (int j = 0; j < num_stores; j++)
+			{
+				const ForwardedStore &store = stores[j];
+				if (store.base != (int)inst.RA || store.offset != inst.SIMM_16 || store.size != load_size)
+					continue;
+
+				const u32 d = inst.RD, src = store.source;
+				u32 hex;
+				if (inst.OPCD == 32)
+					hex = (31 << 26) | (src << 21) | (d << 16) | (src << 11) | (444 << 1); // mr
+				else if (inst.OPCD == 42)
+					hex = (31 << 26) | (src << 21) | (d << 16) | (922 << 1); // extsh
+				else
+					hex = (21 << 26) | (src << 21) | (d << 16) | ((load_size == 2 ? 16 : 24) << 6) | (31 << 1); // rlwinm
+				op.inst.hex = hex;
+				op.opinfo = GetOpInfo(op.inst);
+				op.regsIn[0] = src;
+				op.regsIn[1] = -1;
+				op.regsIn[2] = -1;
+				break;
+			}
+		}
+		else if (store_size && IsForwardingBase(inst.RA))
+		{
+			// Drop whatever the store overlaps
+			for (int j = 0; j < num_stores;)
+			{
+				const ForwardedStore &store = stores[j];
+				if (store.base == (int)inst.RA &&
+					store.offset < inst.SIMM_16 + store_size && inst.SIMM_16 < store.offset + store.size)
+					stores[j] = stores[--num_stores];
+				else
+					j++;
+			}
+			if (num_stores == MAX_FORWARDED_STORES)
+				num_stores--;
+			ForwardedStore store = {(int)inst.RA, inst.SIMM_16, store_size, (int)inst.RS};
+			// The oldest is dropped when full
+			memmove(&stores[1], &stores[0], num_stores * sizeof(ForwardedStore));
+			stores[0] = store;
+			num_stores++;
+			continue;
+		}
+		else if (!HasKnownRegisters(op) ||
+			((op.opinfo->flags & FL_LOADSTORE) && op.opinfo->type != OPTYPE_LOAD && op.opinfo->type != OPTYPE_LOADFP))
+		{
+			// Any other store may alias the slots
+			num_stores = 0;
+			continue;
+		}
+
+		for (int j = 0; j < 2; j++)
+		{
+			const int reg = op.regsOut[j];
+			if (reg < 0)
+				continue;
+			for (int k = 0; k < num_stores;)
+			{
+				if (stores[k].base == reg || stores[k].source == reg)
+					stores[k] = stores[--num_stores];
+				else
+					k++;
+			}
+		}
+	}
+}
+
+static void PropagateConstants(CodeOp *code, int size)
+{
+	bool known[32] = {false};
+	u32 value[32];
+
+	for (int i = 0; i < size; i++)
+	{
+		CodeOp &op = code[i];
+		if (op.skip)
+			continue;
+
+		if (!HasKnownRegisters(op))
+		{
+			memset(known, 0, sizeof(known));
+			continue;
+		}
+
+		u32 result;
+		if (op.opinfo->type == OPTYPE_INTEGER && EvaluateConstant(op.inst, known, value, result))
+		{
+			op.outputIsConstant = true;
+			op.constantValue = result;
+			known[op.regsOut[0]] = true;
+			value[op.regsOut[0]] = result;
+			continue;
+		}
+
+		for (int j = 0; j < 2; j++)
+		{
+			if (op.regsOut[j] >= 0)
+				known[op.regsOut[j]] = false;
+		}
+	}
+}
+
+// Backwards liveness of the GPRs and CA, skipping the instructions that only
+// compute something nobody reads. Everything is assumed to be read after the
+// block.
+static void RemoveDeadCode(CodeOp *code, int size)
+{
+	u32 regsWanted = 0xFFFFFFFF;
+	bool wantsCA = true;
+
+	for (int i = size - 1; i >= 0; i--)
+	{
+		CodeOp &op = code[i];
+		op.regsWanted = regsWanted;
+		op.wantsCA = wantsCA;
+		if (op.skip)
+			continue;
+
+		if (!HasKnownRegisters(op))
+		{
+			regsWanted = 0xFFFFFFFF;
+			wantsCA = true;
+			continue;
+		}
+
+		const int flags = op.opinfo->flags;
+		u32 regsOut = 0;
+		for (int j = 0; j < 2; j++)
+		{
+			if (op.regsOut[j] >= 0)
+				regsOut |= 1 << op.regsOut[j];
+		}
+
+		if (CanRemove(op) && !(regsOut & regsWanted) && (!(flags & FL_SET_CA) || !wantsCA))
+		{
+			op.skip = true;
+			continue;
+		}
+
+		regsWanted &= ~regsOut;
+		if (flags & FL_SET_CA)
+			wantsCA = false;
+		if (flags & FL_READ_CA)
+			wantsCA = true;
+		if (!op.outputIsConstant)
+		{
+			for (int j = 0; j < 3; j++)
+			{
+				if (op.regsIn[j] >= 0)
+					regsWanted |= 1 << op.regsIn[j];
+			}
+		}
+	}
+}
+
+void OptimizeBlock(CodeOp *code, int size)
+{
+	ForwardStores(code, size);
+	PropagateConstants(code, size);
+	RemoveDeadCode(code, size);
+}
+
 void FindFunctionsAfterBLR(PPCSymbolDB *func_db)
 {
 	vector<u32> funcAddrs;
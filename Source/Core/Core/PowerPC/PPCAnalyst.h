@@ -39,6 +39,20 @@ struct CodeOp //16B
 	bool outputCR0;
 	bool outputCR1;
 	bool outputPS1;
+	// CR fields, one bit per field with CR0 in bit 0: the ones the instruction
+	// reads, the ones it overwrites completely, and the ones something after
+	// it may still read, looking past the end of the block.
+	u8 crFieldsIn;
+	u8 crFieldsOut;
+	u8 crFieldsWanted;
+	// GPRs, one bit per register, and XER[CA] that something after the
+	// instruction may still read. Filled in by OptimizeBlock.
+	u32 regsWanted;
+	bool wantsCA;
+	// OptimizeBlock proved the only effect of the instruction is setting
+	// regsOut[0] to constantValue
+	bool outputIsConstant;
+	u32 constantValue;
 	bool skip;  // followed BL-s for example
 };
 
@@ -47,6 +61,10 @@ struct BlockStats
 	bool isFirstBlockOfFunction;
 	bool isLastBlockOfFunction;
 	int numCycles;
+	// The code past the block that the CR analysis read, [start, end). The
+	// block must be invalidated when it changes.
+	u32 crLookaheadStart;
+	u32 crLookaheadEnd;
 };
 
 struct BlockRegStats
@@ -100,6 +118,16 @@ u32 Flatten(u32 address, int *realsize, BlockStats *st, BlockRegStats *gpa,
 			BlockRegStats *fpa, bool &broken_block, CodeBuffer *buffer,
 			int blockSize, u32* merged_addresses,
 			int capacity_of_merged_addresses, int& size_of_merged_addresses);
+// True if the block only reads memory and branches back to its start at
+// blockStart, so that another pass can't change anything until an interrupt or
+// a scheduled event does. Such a loop can skip straight to the next event.
+bool IsIdleLoop(const CodeOp *code, int size, u32 blockStart);
+// Backend independent optimizations over a block Flatten produced: loads of a
+// stack or small data slot a store in the block just wrote become register
+// moves, results known at compile time are marked outputIsConstant, and
+// integer instructions whose results nobody reads are skipped. Fills in
+// regsWanted and wantsCA on the way.
+void OptimizeBlock(CodeOp *code, int size);
 void LogFunctionCall(u32 addr);
 void FindFunctions(u32 startAddr, u32 endAddr, PPCSymbolDB *func_db);
 bool AnalyzeFunction(u32 startAddr, Symbol &func, int max_size = 0);
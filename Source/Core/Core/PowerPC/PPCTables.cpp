@@ -136,8 +136,9 @@ void InitTables(int cpu_core)
 	switch (cpu_core)
 	{
 	case 0:
+	case 5:
 		{
-			// Interpreter
+			// Interpreter, cached interpreter
 			break;
 		}
 	default:
@@ -2,6 +2,9 @@
 // Licensed under GPLv2
 // Refer to the license.txt file included.
 
+#include <cinttypes>
+#include <map>
+
 #include "Common.h"
 #include "Atomic.h"
 #include "MathUtil.h"
@@ -14,11 +17,13 @@
 #include "../HW/SystemTimers.h"
 
 #include "Interpreter/Interpreter.h"
+#include "Interpreter/CachedInterpreter.h"
 #include "PowerPC.h"
 #include "PPCTables.h"
 #include "CPUCoreBase.h"
 #include "JitInterface.h"
 
+#include "../ConfigManager.h"
 #include "../Host.h"
 #include "HW/EXI.h"
 
@@ -32,12 +37,24 @@ PowerPCState GC_ALIGNED16(ppcState);
 volatile CPUState state = CPU_STEPPING;
 
 Interpreter * const interpreter = Interpreter::getInstance();
+CachedInterpreter * const cached_interpreter = CachedInterpreter::getInstance();
 CoreMode mode;
+// The core MODE_JIT runs, a JIT or the cached interpreter
+static CPUCoreBase *fast_core_base;
 
 BreakPoints breakpoints;
 MemChecks memchecks;
 PPCDebugInterface debug_interface;
 
+struct IdleLoopStats
+{
+	u64 skips;
+	u64 cycles;
+};
+
+// Per loop address, for the game that is running
+static std::map<u32, IdleLoopStats> idle_loops;
+
 void CompactCR()
 {
 	u32 new_cr = ppcState.cr_fast[0] << 28;
@@ -129,6 +146,7 @@ void Init(int cpu_core)
 
 	ResetRegisters();
 	PPCTables::InitTables(cpu_core);
+	idle_loops.clear();
 
 	// We initialize the interpreter because
 	// it is used on boot and code window independently.
@@ -141,6 +159,12 @@ void Init(int cpu_core)
 			cpu_core_base = interpreter;
 			break;
 		}
+		case 5:
+		{
+			cached_interpreter->Init();
+			cpu_core_base = cached_interpreter;
+			break;
+		}
 		default:
 			cpu_core_base = JitInterface::InitJitCore(cpu_core);
 			if (!cpu_core_base) // Handle Situations where JIT core isn't available
@@ -150,6 +174,7 @@ void Init(int cpu_core)
 			}
 		break;
 	}
+	fast_core_base = cpu_core_base;
 
 	if (cpu_core_base != interpreter)
 	{
@@ -164,11 +189,33 @@ void Init(int cpu_core)
 	ppcState.iCache.Init();
 }
 
+static void LogIdleLoops()
+{
+	if (idle_loops.empty())
+		return;
+
+	const double ticks_per_second = SystemTimers::GetTicksPerSecond();
+	u64 total_cycles = 0;
+	for (auto& loop : idle_loops)
+		total_cycles += loop.second.cycles;
+
+	NOTICE_LOG(POWERPC, "Idle loops of %s skipped %.2f s of emulated time:",
+		SConfig::GetInstance().m_LocalCoreStartupParameter.GetUniqueID().c_str(), total_cycles / ticks_per_second);
+	for (auto& loop : idle_loops)
+	{
+		NOTICE_LOG(POWERPC, "  %08x: %" PRIu64 " times, %.2f s", loop.first, loop.second.skips,
+			loop.second.cycles / ticks_per_second);
+	}
+}
+
 void Shutdown()
 {
+	LogIdleLoops();
 	JitInterface::Shutdown();
+	cached_interpreter->Shutdown();
 	interpreter->Shutdown();
 	cpu_core_base = NULL;
+	fast_core_base = NULL;
 	state = CPU_POWERDOWN;
 }
 
@@ -192,7 +239,7 @@ void SetMode(CoreMode new_mode)
 
 	case MODE_JIT:  // Switching from interpreter to JIT.
 		// Don't really need to do much. It'll work, the cache will refill itself.
-		cpu_core_base = JitInterface::GetCore();
+		cpu_core_base = fast_core_base;
 		if (!cpu_core_base) // Has a chance to not get a working JIT core if one isn't active on host
 			cpu_core_base = interpreter;
 		break;
@@ -511,6 +558,16 @@ void OnIdleIL()
 	CoreTiming::Idle();
 }
 
+void OnIdleLoop(u32 loop_address)
+{
+	const u64 idle_ticks = CoreTiming::GetIdleTicks();
+	CoreTiming::Idle();
+
+	IdleLoopStats &stats = idle_loops[loop_address];
+	stats.skips++;
+	stats.cycles += CoreTiming::GetIdleTicks() - idle_ticks;
+}
+
 }  // namespace
 
 
@@ -73,6 +73,8 @@ struct GC_ALIGNED64(PowerPCState)
 enum CPUState
 {
 	CPU_RUNNING = 0,
+	// Only stopped until the CPU thread ran the callback of CCPU::RunAtSafePoint
+	CPU_SAFE_POINT = 1,
 	CPU_STEPPING = 2,
 	CPU_POWERDOWN = 3,
 };
@@ -106,6 +108,8 @@ void ExpandCR();
 
 void OnIdle(u32 _uThreadAddr);
 void OnIdleIL();
+// Called by a loop PPCAnalyst::IsIdleLoop found, each time it goes around
+void OnIdleLoop(u32 loop_address);
 
 void UpdatePerformanceMonitor(u32 cycles, u32 num_load_stores, u32 num_fp_inst);
 
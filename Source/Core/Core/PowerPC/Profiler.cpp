@@ -9,10 +9,16 @@ namespace Profiler
 
 bool g_ProfileBlocks;
 bool g_ProfileInstructions;
+bool g_ProfileCoverage;
 
 void WriteProfileResults(const char *filename)
 {
 	JitInterface::WriteProfileResults(filename);
 }
 
+void WriteCoverageResults(const char *filename)
+{
+	JitInterface::WriteCoverageResults(filename);
+}
+
 }  // namespace
@@ -58,8 +58,11 @@ namespace Profiler
 {
 extern bool g_ProfileBlocks;
 extern bool g_ProfileInstructions;
+// Count interpreter fallbacks and slow memory accesses, see JitCoverage.h
+extern bool g_ProfileCoverage;
 
 void WriteProfileResults(const char *filename);
+void WriteCoverageResults(const char *filename);
 }
 
 #endif  // _PROFILER_H
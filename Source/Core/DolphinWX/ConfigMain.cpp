@@ -41,6 +41,7 @@ struct CPUCore
 };
 const CPUCore CPUCores[] = {
 	{0, wxTRANSLATE("Interpreter (VERY slow)")},
+	{5, wxTRANSLATE("Cached Interpreter (slow)")},
 #ifdef _M_ARM
 	{3, wxTRANSLATE("Arm JIT (experimental)")},
 	{4, wxTRANSLATE("Arm JITIL (experimental)")},
@@ -38,6 +38,7 @@
 #include "PowerPC/SignatureDB.h"
 #include "PowerPC/PPCTables.h"
 #include "PowerPC/JitCommon/JitBase.h"
+#include "PowerPC/JitCommon/JitCoverage.h"
 #include "PowerPC/JitCommon/JitCache.h" // for ClearCache()
 
 #include "ConfigManager.h"
@@ -159,11 +160,29 @@ void CCodeWindow::CreateMenuSymbols(wxMenuBar *pMenuBar)
 
 	wxMenu *pProfilerMenu = new wxMenu;
 	pProfilerMenu->Append(IDM_PROFILEBLOCKS, _("&Profile blocks"), wxEmptyString, wxITEM_CHECK);
+	pProfilerMenu->Append(IDM_PROFILECOVERAGE, _("Profile JIT &coverage"), wxEmptyString, wxITEM_CHECK);
 	pProfilerMenu->AppendSeparator();
 	pProfilerMenu->Append(IDM_WRITEPROFILE, _("&Write to profile.txt, show"));
+	pProfilerMenu->Append(IDM_WRITECOVERAGE, _("Write JIT coverage to coverage.txt, show"));
 	pMenuBar->Append(pProfilerMenu, _("&Profiler"));
 }
 
+static void ShowTextFile(const std::string& filename)
+{
+	wxFileType* filetype = NULL;
+	if (!(filetype = wxTheMimeTypesManager->GetFileTypeFromExtension(_T("txt"))))
+	{
+		// From extension failed, trying with MIME type now
+		if (!(filetype = wxTheMimeTypesManager->GetFileTypeFromMimeType(_T("text/plain"))))
+			// MIME type failed, aborting mission
+			return;
+	}
+	wxString OpenCommand;
+	OpenCommand = filetype->GetOpenCommand(StrToWxStr(filename));
+	if(!OpenCommand.IsEmpty())
+		wxExecute(OpenCommand, wxEXEC_SYNC);
+}
+
 void CCodeWindow::OnProfilerMenu(wxCommandEvent& event)
 {
 	switch (event.GetId())
@@ -175,7 +194,17 @@ void CCodeWindow::OnProfilerMenu(wxCommandEvent& event)
 		Profiler::g_ProfileBlocks = GetMenuBar()->IsChecked(IDM_PROFILEBLOCKS);
 		Core::SetState(Core::CORE_RUN);
 		break;
+	case IDM_PROFILECOVERAGE:
+		// The counting is compiled into the blocks, start over with it
+		Core::SetState(Core::CORE_PAUSE);
+		if (jit != NULL)
+			jit->ClearCache();
+		JitCoverage::Clear();
+		Profiler::g_ProfileCoverage = GetMenuBar()->IsChecked(IDM_PROFILECOVERAGE);
+		Core::SetState(Core::CORE_RUN);
+		break;
 	case IDM_WRITEPROFILE:
+	case IDM_WRITECOVERAGE:
 		if (Core::GetState() == Core::CORE_RUN)
 			Core::SetState(Core::CORE_PAUSE);
 
@@ -183,22 +212,20 @@ void CCodeWindow::OnProfilerMenu(wxCommandEvent& event)
 		{
 			if (jit != NULL)
 			{
-				std::string filename = File::GetUserPath(D_DUMP_IDX) + "Debug/profiler.txt";
-				File::CreateFullPath(filename);
-				Profiler::WriteProfileResults(filename.c_str());
-
-				wxFileType* filetype = NULL;
-				if (!(filetype = wxTheMimeTypesManager->GetFileTypeFromExtension(_T("txt"))))
+				std::string filename;
+				if (event.GetId() == IDM_WRITECOVERAGE)
+				{
+					filename = File::GetUserPath(D_DUMP_IDX) + "Debug/coverage.txt";
+					File::CreateFullPath(filename);
+					Profiler::WriteCoverageResults(filename.c_str());
+				}
+				else
 				{
-					// From extension failed, trying with MIME type now
-					if (!(filetype = wxTheMimeTypesManager->GetFileTypeFromMimeType(_T("text/plain"))))
-						// MIME type failed, aborting mission
-						break;
+					filename = File::GetUserPath(D_DUMP_IDX) + "Debug/profiler.txt";
+					File::CreateFullPath(filename);
+					Profiler::WriteProfileResults(filename.c_str());
 				}
-				wxString OpenCommand;
-				OpenCommand = filetype->GetOpenCommand(StrToWxStr(filename));
-				if(!OpenCommand.IsEmpty())
-					wxExecute(OpenCommand, wxEXEC_SYNC);
+				ShowTextFile(filename);
 			}
 		}
 		break;
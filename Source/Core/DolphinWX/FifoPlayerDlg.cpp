@@ -461,7 +461,7 @@ void FifoPlayerDlg::OnBeginSearch(wxCommandEvent& event)
 	int const frame_idx = m_framesList->GetSelection();
 	FifoPlayer& player = FifoPlayer::GetInstance();
 	const AnalyzedFrameInfo& frame = player.GetAnalyzedFrameInfo(frame_idx);
-	const FifoFrameInfo& fifo_frame = player.GetFile()->GetFrame(frame_idx);
+	std::shared_ptr<const FifoFrameInfo> fifo_frame = player.GetFile()->GetFrame(frame_idx);
 
 	// TODO: Support searching through the last object... How do we know were the cmd data ends?
 	// TODO: Support searching for bit patterns
@@ -472,8 +472,8 @@ void FifoPlayerDlg::OnBeginSearch(wxCommandEvent& event)
 		return;
 	}
 
-	const u8* const start_ptr = &fifo_frame.fifoData[frame.objectStarts[obj_idx]];
-	const u8* const end_ptr = &fifo_frame.fifoData[frame.objectStarts[obj_idx+1]];
+	const u8* const start_ptr = &fifo_frame->fifoData[frame.objectStarts[obj_idx]];
+	const u8* const end_ptr = &fifo_frame->fifoData[frame.objectStarts[obj_idx+1]];
 
 	for (const u8* ptr = start_ptr; ptr < end_ptr-val_length+1; ++ptr)
 	{
@@ -623,11 +623,11 @@ void FifoPlayerDlg::OnObjectListSelectionChanged(wxCommandEvent& event)
 	if (frame_idx != -1 && object_idx != -1)
 	{
 		const AnalyzedFrameInfo& frame = player.GetAnalyzedFrameInfo(frame_idx);
-		const FifoFrameInfo& fifo_frame = player.GetFile()->GetFrame(frame_idx);
-		const u8* objectdata_start = &fifo_frame.fifoData[frame.objectStarts[object_idx]];
-		const u8* objectdata_end = &fifo_frame.fifoData[frame.objectEnds[object_idx]];
+		std::shared_ptr<const FifoFrameInfo> fifo_frame = player.GetFile()->GetFrame(frame_idx);
+		const u8* objectdata_start = &fifo_frame->fifoData[frame.objectStarts[object_idx]];
+		const u8* objectdata_end = &fifo_frame->fifoData[frame.objectEnds[object_idx]];
 		u8* objectdata = (u8*)objectdata_start;
-		const int obj_offset = objectdata_start - &fifo_frame.fifoData[frame.objectStarts[0]];
+		const int obj_offset = objectdata_start - &fifo_frame->fifoData[frame.objectStarts[0]];
 
 		int cmd = *objectdata++;
 		int stream_size = Common::swap16(objectdata);
@@ -647,11 +647,11 @@ void FifoPlayerDlg::OnObjectListSelectionChanged(wxCommandEvent& event)
 		// Between objectdata_end and next_objdata_start, there are register setting commands
 		if (object_idx + 1 < (int)frame.objectStarts.size())
 		{
-			const u8* next_objdata_start = &fifo_frame.fifoData[frame.objectStarts[object_idx+1]];
+			const u8* next_objdata_start = &fifo_frame->fifoData[frame.objectStarts[object_idx+1]];
 			while (objectdata < next_objdata_start)
 			{
 				m_objectCmdOffsets.push_back(objectdata - objectdata_start);
-				int new_offset = objectdata - &fifo_frame.fifoData[frame.objectStarts[0]];
+				int new_offset = objectdata - &fifo_frame->fifoData[frame.objectStarts[0]];
 				int command = *objectdata++;
 				switch (command)
 				{
@@ -753,8 +753,8 @@ void FifoPlayerDlg::OnObjectCmdListSelectionChanged(wxCommandEvent& event)
 
 	FifoPlayer& player = FifoPlayer::GetInstance();
 	const AnalyzedFrameInfo& frame = player.GetAnalyzedFrameInfo(frame_idx);
-	const FifoFrameInfo& fifo_frame = player.GetFile()->GetFrame(frame_idx);
-	const u8* cmddata = &fifo_frame.fifoData[frame.objectStarts[object_idx]] + m_objectCmdOffsets[event.GetInt()];
+	std::shared_ptr<const FifoFrameInfo> fifo_frame = player.GetFile()->GetFrame(frame_idx);
+	const u8* cmddata = &fifo_frame->fifoData[frame.objectStarts[object_idx]] + m_objectCmdOffsets[event.GetInt()];
 
 	// TODO: Not sure whether we should bother translating the descriptions
 	wxString newLabel;
@@ -899,7 +899,7 @@ wxString FifoPlayerDlg::CreateRecordingFifoSizeLabel() const
 	{
 		int fifoBytes = 0;
 		for (int i = 0; i < file->GetFrameCount(); ++i)
-			fifoBytes += file->GetFrame(i).fifoDataSize;
+			fifoBytes += file->GetFrame(i)->fifoDataSize;
 
 		return CreateIntegerLabel(fifoBytes, _("FIFO Byte"));
 	}
@@ -916,8 +916,8 @@ wxString FifoPlayerDlg::CreateRecordingMemSizeLabel() const
 		int memBytes = 0;
 		for (int frameNum = 0; frameNum < file->GetFrameCount(); ++frameNum)
 		{
-			const vector<MemoryUpdate>& memUpdates = file->GetFrame(frameNum).memoryUpdates;
-			for (auto& memUpdate : memUpdates)
+			std::shared_ptr<const FifoFrameInfo> frame = file->GetFrame(frameNum);
+			for (auto& memUpdate : frame->memoryUpdates)
 				memBytes += memUpdate.size;
 		}
 
@@ -197,6 +197,8 @@ enum
 
 	// Profiler
 	IDM_PROFILEBLOCKS,
+	IDM_PROFILECOVERAGE,
+	IDM_WRITECOVERAGE,
 	IDM_WRITEPROFILE,
 	// --------------------------------------------------------------
 
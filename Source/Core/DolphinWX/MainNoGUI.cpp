@@ -36,6 +36,8 @@
 #include "ConfigManager.h"
 #include "LogManager.h"
 #include "BootManager.h"
+#include "FifoPlayer/FifoBenchmark.h"
+#include "MovieBenchmark.h"
 
 bool rendererHasFocus = true;
 bool running = true;
@@ -288,14 +290,20 @@ int main(int argc, char* argv[])
 	[NSApp finishLaunching];
 #endif
 	int ch, help = 0;
+	int benchmark_runs = 0;
+	std::string benchmark_output, benchmark_movie, video_backend;
 	struct option longopts[] = {
 		{ "exec",	no_argument,	NULL,	'e' },
 		{ "help",	no_argument,	NULL,	'h' },
 		{ "version",	no_argument,	NULL,	'v' },
+		{ "benchmark",	required_argument,	NULL,	'b' },
+		{ "movie",	required_argument,	NULL,	'm' },
+		{ "output",	required_argument,	NULL,	'o' },
+		{ "video_backend",	required_argument,	NULL,	'V' },
 		{ NULL,		0,		NULL,	0 }
 	};
 
-	while ((ch = getopt_long(argc, argv, "eh?v", longopts, 0)) != -1) {
+	while ((ch = getopt_long(argc, argv, "eh?vb:m:o:V:", longopts, 0)) != -1) {
 		switch (ch) {
 		case 'e':
 			break;
@@ -303,27 +311,82 @@ int main(int argc, char* argv[])
 		case '?':
 			help = 1;
 			break;
+		case 'b':
+			benchmark_runs = atoi(optarg);
+			if (benchmark_runs <= 0)
+				help = 1;
+			break;
+		case 'm':
+			benchmark_movie = optarg;
+			break;
+		case 'o':
+			benchmark_output = optarg;
+			break;
+		case 'V':
+			video_backend = optarg;
+			break;
 		case 'v':
 			fprintf(stderr, "%s\n", scm_rev_str);
 			return 1;
 		}
 	}
 
+	if (benchmark_runs && !benchmark_movie.empty())
+		help = 1;
+
 	if (help == 1 || argc == optind) {
 		fprintf(stderr, "%s\n\n", scm_rev_str);
 		fprintf(stderr, "A multi-platform Gamecube/Wii emulator\n\n");
-		fprintf(stderr, "Usage: %s [-e <file>] [-h] [-v]\n", argv[0]);
+		fprintf(stderr, "Usage: %s [-e <file>] [-h] [-v] [-b <runs> | -m <movie>] [-o <file>] [-V <backend>]\n", argv[0]);
 		fprintf(stderr, "  -e, --exec	Load the specified file\n");
 		fprintf(stderr, "  -h, --help	Show this help message\n");
 		fprintf(stderr, "  -v, --help	Print version and exit\n");
+		fprintf(stderr, "  -b, --benchmark	Replay a FIFO log <runs> times as fast as possible\n");
+		fprintf(stderr, "  -m, --movie	Play a DTM input recording of the game as fast as possible\n");
+		fprintf(stderr, "  -o, --output	Write the benchmark results to <file> instead of stdout\n");
+		fprintf(stderr, "  -V, --video_backend	Use the specified video backend\n");
+		return 1;
+	}
+
+	const char *extension = strrchr(argv[optind], '.');
+	if (benchmark_runs && (!extension || strcasecmp(extension, ".dff")))
+	{
+		fprintf(stderr, "Benchmarking requires a FIFO log (.dff)\n");
 		return 1;
 	}
 
 	LogManager::Init();
 	SConfig::Init();
+
+	// Command line overrides are only for this session, restore the user's
+	// settings before they are saved on exit
+	SCoreStartupParameter& StartUp = SConfig::GetInstance().m_LocalCoreStartupParameter;
+	std::string saved_video_backend = StartUp.m_strVideoBackend;
+	if (!video_backend.empty())
+		StartUp.m_strVideoBackend = video_backend;
+
+	if (!benchmark_movie.empty() && !MovieBenchmark::Init(benchmark_movie))
+	{
+		fprintf(stderr, "Failed to play %s\n", benchmark_movie.c_str());
+		StartUp.m_strVideoBackend = saved_video_backend;
+		SConfig::Shutdown();
+		LogManager::Shutdown();
+		return 1;
+	}
+
+	bool saved_cpu_thread = StartUp.bCPUThread;
+	unsigned int saved_framelimit = SConfig::GetInstance().m_Framelimit;
+	if (benchmark_runs || !benchmark_movie.empty())
+	{
+		// Single core so every frame's video work is done by the time it is timed
+		StartUp.bCPUThread = false;
+		SConfig::GetInstance().m_Framelimit = 0;
+		if (benchmark_runs)
+			FifoBenchmark::Init(benchmark_runs);
+	}
+
 	VideoBackend::PopulateList();
-	VideoBackend::ActivateBackend(SConfig::GetInstance().
-		m_LocalCoreStartupParameter.m_strVideoBackend);
+	VideoBackend::ActivateBackend(StartUp.m_strVideoBackend);
 	WiimoteReal::LoadSettings();
 
 #if USE_EGL
@@ -381,10 +444,25 @@ int main(int argc, char* argv[])
 #endif
 	}
 
+	int ret = 0;
+	if (benchmark_runs || !benchmark_movie.empty())
+	{
+		bool written = benchmark_runs ? FifoBenchmark::Shutdown(benchmark_output) :
+			MovieBenchmark::Shutdown(benchmark_output);
+		if (!written)
+		{
+			fprintf(stderr, "Failed to write benchmark results\n");
+			ret = 1;
+		}
+		StartUp.bCPUThread = saved_cpu_thread;
+		SConfig::GetInstance().m_Framelimit = saved_framelimit;
+	}
+	StartUp.m_strVideoBackend = saved_video_backend;
+
 	WiimoteReal::Shutdown();
 	VideoBackend::ClearList();
 	SConfig::Shutdown();
 	LogManager::Shutdown();
 
-	return 0;
+	return ret;
 }
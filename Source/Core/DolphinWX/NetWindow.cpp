@@ -356,6 +356,9 @@ NetPlayDiag::NetPlayDiag(wxWindow* const parent, const CGameListCtrl* const game
 
 		m_memcard_write = new wxCheckBox(panel, wxID_ANY, _("Write memcards (GC)"));
 		bottom_szr->Add(m_memcard_write, 0, wxCENTER);
+
+		m_rollback_chkbox = new wxCheckBox(panel, wxID_ANY, _("Rollback (GC)"));
+		bottom_szr->Add(m_rollback_chkbox, 0, wxCENTER);
 	}
 
 	m_record_chkbox = new wxCheckBox(panel, wxID_ANY, _("Record input"));
@@ -415,6 +418,7 @@ void NetPlayDiag::GetNetSettings(NetSettings &settings)
 	settings.m_WriteToMemcard = m_memcard_write->GetValue();
 	settings.m_EXIDevice[0] = instance.m_EXIDevice[0];
 	settings.m_EXIDevice[1] = instance.m_EXIDevice[1];
+	settings.m_Rollback = m_rollback_chkbox->GetValue();
 }
 
 std::string NetPlayDiag::FindGame()
@@ -99,6 +99,7 @@ private:
 	wxTextCtrl*		m_chat_text;
 	wxTextCtrl*		m_chat_msg_text;
 	wxCheckBox*		m_memcard_write;
+	wxCheckBox*		m_rollback_chkbox;
 	wxCheckBox*		m_record_chkbox;
 
 	std::string		m_selected_game;
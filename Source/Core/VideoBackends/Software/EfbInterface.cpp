@@ -10,6 +10,9 @@
 #include "SWPixelEngine.h"
 #include "HW/Memmap.h"
 
+#if (defined(_M_X64) || defined(_M_IX86)) && !defined(_M_GENERIC)
+#include <emmintrin.h>
+#endif
 
 u8 efb[EFB_WIDTH*EFB_HEIGHT*6];
 
@@ -574,49 +577,120 @@ namespace EfbInterface
 		}
 	}
 
+	static inline bool DepthTest(u32 z, u32 depth)
+	{
+		switch (bpmem.zmode.func)
+		{
+			case COMPARE_NEVER:
+				return false;
+			case COMPARE_LESS:
+				return z < depth;
+			case COMPARE_EQUAL:
+				return z == depth;
+			case COMPARE_LEQUAL:
+				return z <= depth;
+			case COMPARE_GREATER:
+				return z > depth;
+			case COMPARE_NEQUAL:
+				return z != depth;
+			case COMPARE_GEQUAL:
+				return z >= depth;
+			case COMPARE_ALWAYS:
+				return true;
+			default:
+				ERROR_LOG(VIDEO, "Bad Z compare mode %i", bpmem.zmode.func);
+				return false;
+		}
+	}
+
 	bool ZCompare(u16 x, u16 y, u32 z)
 	{
 		u32 offset = GetDepthOffset(x, y);
 		u32 depth = GetPixelDepth(offset);
 
-		bool pass;
+		bool pass = DepthTest(z, depth);
+
+		if (pass && bpmem.zmode.updateenable)
+		{
+			SetPixelDepth(offset, z);
+		}
+
+		return pass;
+	}
+
+	u32 ZCompareQuad(u16 x, u16 y, const u32 *z, u32 mask)
+	{
+		u32 offset[4];
+		u32 depth[4] = {};
+		for (u32 n = 0; n < 4; n++)
+		{
+			offset[n] = GetDepthOffset(x + (n & 1), y + (n >> 1));
+			if (mask & (1 << n))
+				depth[n] = GetPixelDepth(offset[n]);
+		}
+
+#if (defined(_M_X64) || defined(_M_IX86)) && !defined(_M_GENERIC)
+		// Both sides are 24 bit, so the signed compares work
+		const __m128i vz = _mm_loadu_si128((const __m128i*)z);
+		const __m128i vdepth = _mm_loadu_si128((const __m128i*)depth);
+		__m128i pass;
+		bool invert = false;
 
 		switch (bpmem.zmode.func)
 		{
 			case COMPARE_NEVER:
-				pass = false;
+				pass = _mm_setzero_si128();
 				break;
 			case COMPARE_LESS:
-				pass = z < depth;
+				pass = _mm_cmpgt_epi32(vdepth, vz);
 				break;
 			case COMPARE_EQUAL:
-				pass = z == depth;
+				pass = _mm_cmpeq_epi32(vz, vdepth);
 				break;
 			case COMPARE_LEQUAL:
-				pass = z <= depth;
+				pass = _mm_cmpgt_epi32(vz, vdepth);
+				invert = true;
 				break;
 			case COMPARE_GREATER:
-				pass = z > depth;
+				pass = _mm_cmpgt_epi32(vz, vdepth);
 				break;
 			case COMPARE_NEQUAL:
-				pass = z != depth;
+				pass = _mm_cmpeq_epi32(vz, vdepth);
+				invert = true;
 				break;
 			case COMPARE_GEQUAL:
-				pass = z >= depth;
+				pass = _mm_cmpgt_epi32(vdepth, vz);
+				invert = true;
 				break;
 			case COMPARE_ALWAYS:
-				pass = true;
+				pass = _mm_set1_epi32(-1);
 				break;
 			default:
-				pass = false;
+				pass = _mm_setzero_si128();
 				ERROR_LOG(VIDEO, "Bad Z compare mode %i", bpmem.zmode.func);
 		}
 
-		if (pass && bpmem.zmode.updateenable)
+		u32 passed = _mm_movemask_ps(_mm_castsi128_ps(pass));
+		if (invert)
+			passed ^= 0xF;
+		mask &= passed;
+#else
+		for (u32 n = 0; n < 4; n++)
 		{
-			SetPixelDepth(offset, z);
+			if ((mask & (1 << n)) && !DepthTest(z[n], depth[n]))
+				mask &= ~(1 << n);
 		}
+#endif
 
-		return pass;
+		if (bpmem.zmode.updateenable)
+		{
+			for (u32 n = 0; n < 4; n++)
+			{
+				if (mask & (1 << n))
+					SetPixelDepth(offset[n], z[n]);
+			}
+		}
+
+		return mask;
 	}
 }
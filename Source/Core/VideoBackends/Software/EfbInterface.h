@@ -38,6 +38,11 @@ namespace EfbInterface
 	// returns result of compare.
 	bool ZCompare(u16 x, u16 y, u32 z);
 
+	// ZCompare of the pixels of the 2x2 block at x,y selected by mask, bit n
+	// is the pixel at (x + (n & 1), y + (n >> 1)) and z[n] its depth.
+	// returns the mask of the pixels that passed.
+	u32 ZCompareQuad(u16 x, u16 y, const u32 *z, u32 mask);
+
 	// sets the color and alpha
 	void SetColor(u16 x, u16 y, u8 *color);
 	void SetDepth(u16 x, u16 y, u32 depth);
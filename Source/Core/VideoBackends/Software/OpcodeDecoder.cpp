@@ -4,6 +4,8 @@
 
 #include "Common.h"
 
+#include <algorithm>
+
 #include "DataReader.h"
 
 #include "OpcodeDecoder.h"
@@ -12,6 +14,7 @@
 #include "XFMemLoader.h"
 #include "SWVertexLoader.h"
 #include "SWStatistics.h"
+#include "VideoTimings.h"
 #include "DebugUtil.h"
 #include "SWCommandProcessor.h"
 #include "CPMemLoader.h"
@@ -65,12 +68,13 @@ void DecodePrimitiveStream(u32 iBufferSize)
 	}
 	else
 	{
-		while (streamSize > 0 && iBufferSize >= vertexSize)
-		{
-			vertexLoader.LoadVertex();
-			iBufferSize -= vertexSize;
-			streamSize--;
-		}
+		VideoTimingScope timing(g_video_timings.vertexLoad);
+		u32 count = streamSize;
+		if (vertexSize)
+			count = std::min<u32>(count, iBufferSize / vertexSize);
+		vertexLoader.LoadVertices(count);
+		iBufferSize -= count * vertexSize;
+		streamSize -= count;
 	}
 
 	if (streamSize == 0)
@@ -299,6 +303,7 @@ bool CommandRunnable(u32 iBufferSize)
 
 void Run(u32 iBufferSize)
 {
+	VideoTimingScope timing(g_video_timings.decode);
 	currentFunction(iBufferSize);
 }
 
@@ -14,6 +14,9 @@
 #include "SWStatistics.h"
 #include "SWVideoConfig.h"
 
+#if (defined(_M_X64) || defined(_M_IX86)) && !defined(_M_GENERIC)
+#include <emmintrin.h>
+#endif
 
 #define BLOCK_SIZE 2
 
@@ -50,6 +53,16 @@ s32 scissorBottom = 0;
 Tev tev;
 RasterBlock rasterBlock;
 
+// Per pixel values of the current block, built with it and not part of the
+// state. Lane n is the pixel at (n & 1, n >> 1) in the block.
+static struct
+{
+	s32 Z[4];
+	u32 ZInRange; // lane mask
+	u8 Color[2][4][4]; // channel, lane, component
+	s32 Uv[8][2][4]; // texgen, s/t, lane; s17.7
+} quad;
+
 void DoState(PointerWrap &p)
 {
 	ZSlope.DoState(p);
@@ -124,56 +137,21 @@ void SetTevReg(int reg, int comp, bool konst, s16 color)
 	tev.SetRegColor(reg, comp, konst, color);
 }
 
-inline void Draw(s32 x, s32 y, s32 xi, s32 yi)
+inline void Draw(s32 x, s32 y, u32 lane)
 {
-	INCSTAT(swstats.thisFrame.rasterizedPixels);
-
-	float dx = vertexOffsetX + (float)(x - vertex0X);
-	float dy = vertexOffsetY + (float)(y - vertex0Y);
-
-	s32 z = (s32)ZSlope.GetValue(dx, dy);
-	if (z < 0 || z > 0x00ffffff)
-		return;
-
-	if (bpmem.UseEarlyDepthTest() && g_SWVideoConfig.bZComploc)
-	{
-		// TODO: Test if perf regs are incremented even if test is disabled
-		SWPixelEngine::pereg.IncZInputQuadCount(true);
-		if (bpmem.zmode.testenable)
-		{
-			// early z
-			if (!EfbInterface::ZCompare(x, y, z))
-				return;
-		}
-		SWPixelEngine::pereg.IncZOutputQuadCount(true);
-	}
-
-	RasterBlockPixel& pixel = rasterBlock.Pixel[xi][yi];
-
 	tev.Position[0] = x;
 	tev.Position[1] = y;
-	tev.Position[2] = z;
+	tev.Position[2] = quad.Z[lane];
 
 	//  colors
 	for (unsigned int i = 0; i < bpmem.genMode.numcolchans; i++)
-	{
-		for(int comp = 0; comp < 4; comp++)
-		{
-			u16 color = (u16)ColorSlopes[i][comp].GetValue(dx, dy);
-
-			// clamp color value to 0
-			u16 mask = ~(color >> 8);
-
-			tev.Color[i][comp] = color & mask;
-		}
-	}
+		memcpy(tev.Color[i], quad.Color[i][lane], 4);
 
 	// tex coords
 	for (unsigned int i = 0; i < bpmem.genMode.numtexgens; i++)
 	{
-		// multiply by 128 because TEV stores UVs as s17.7
-		tev.Uv[i].s = (s32)(pixel.Uv[i][0] * 128);
-		tev.Uv[i].t = (s32)(pixel.Uv[i][1] * 128);
+		tev.Uv[i].s = quad.Uv[i][0][lane];
+		tev.Uv[i].t = quad.Uv[i][1][lane];
 	}
 
 	for (unsigned int i = 0; i < bpmem.genMode.numindstages; i++)
@@ -191,6 +169,45 @@ inline void Draw(s32 x, s32 y, s32 xi, s32 yi)
 	tev.Draw();
 }
 
+// Draws the covered pixels of the block at x,y, bit n of mask is lane n
+static void DrawQuad(s32 x, s32 y, u32 mask)
+{
+	for (u32 n = 0; n < 4; n++)
+	{
+		if (mask & (1 << n))
+			INCSTAT(swstats.thisFrame.rasterizedPixels);
+	}
+
+	mask &= quad.ZInRange;
+	if (!mask)
+		return;
+
+	if (bpmem.UseEarlyDepthTest() && g_SWVideoConfig.bZComploc)
+	{
+		// TODO: Test if perf regs are incremented even if test is disabled
+		for (u32 n = 0; n < 4; n++)
+		{
+			if (mask & (1 << n))
+				SWPixelEngine::pereg.IncZInputQuadCount(true);
+		}
+
+		// early z
+		mask = EfbInterface::ZCompareQuad(x, y, (u32*)quad.Z, mask);
+
+		for (u32 n = 0; n < 4; n++)
+		{
+			if (mask & (1 << n))
+				SWPixelEngine::pereg.IncZOutputQuadCount(true);
+		}
+	}
+
+	for (u32 n = 0; n < 4; n++)
+	{
+		if (mask & (1 << n))
+			Draw(x + (n & 1), y + (n >> 1), n);
+	}
+}
+
 void InitTriangle(float X1, float Y1, s32 xi, s32 yi)
 {
 	vertex0X = xi;
@@ -261,37 +278,9 @@ inline void CalculateLOD(s32 &lod, bool &linear, u32 texmap, u32 texcoord)
 	lod = CLAMP(lod, (s32)tm1.min_lod, (s32)tm1.max_lod);
 }
 
-void BuildBlock(s32 blockX, s32 blockY)
+// The LOD of a block comes from the differences of its pixels' tex coords
+static void BuildBlockLOD()
 {
-	for (s32 yi = 0; yi < BLOCK_SIZE; yi++)
-	{
-		for (s32 xi = 0; xi < BLOCK_SIZE; xi++)
-		{
-			RasterBlockPixel& pixel = rasterBlock.Pixel[xi][yi];
-
-			float dx = vertexOffsetX + (float)(xi + blockX - vertex0X);
-			float dy = vertexOffsetY + (float)(yi + blockY - vertex0Y);
-
-			float invW = 1.0f / WSlope.GetValue(dx, dy);
-			pixel.InvW = invW;
-
-			// tex coords
-			for (unsigned int i = 0; i < bpmem.genMode.numtexgens; i++)
-			{
-				float projection = invW;
-				if (swxfregs.texMtxInfo[i].projection)
-				{
-					float q = TexSlopes[i][2].GetValue(dx, dy) * invW;
-					if (q != 0.0f)
-						projection = invW / q;
-				}
-
-				pixel.Uv[i][0] = TexSlopes[i][0].GetValue(dx, dy) * projection;
-				pixel.Uv[i][1] = TexSlopes[i][1].GetValue(dx, dy) * projection;
-			}
-		}
-	}
-
 	u32 indref = bpmem.tevindref.hex;
 	for (unsigned int i = 0; i < bpmem.genMode.numindstages; i++)
 	{
@@ -317,6 +306,137 @@ void BuildBlock(s32 blockX, s32 blockY)
 	}
 }
 
+#if (defined(_M_X64) || defined(_M_IX86)) && !defined(_M_GENERIC)
+// Slope::GetValue of the four lanes, in the same order of operations so the
+// results match it bit for bit
+static inline __m128 GetQuadValue(const Slope &slope, __m128 dx, __m128 dy)
+{
+	__m128 value = _mm_add_ps(_mm_set1_ps(slope.f0), _mm_mul_ps(_mm_set1_ps(slope.dfdx), dx));
+	return _mm_add_ps(value, _mm_mul_ps(_mm_set1_ps(slope.dfdy), dy));
+}
+
+void BuildBlock(s32 blockX, s32 blockY)
+{
+	const __m128 dx = _mm_add_ps(_mm_set1_ps(vertexOffsetX),
+		_mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(blockX - vertex0X), _mm_setr_epi32(0, 1, 0, 1))));
+	const __m128 dy = _mm_add_ps(_mm_set1_ps(vertexOffsetY),
+		_mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(blockY - vertex0Y), _mm_setr_epi32(0, 0, 1, 1))));
+
+	const __m128 invW = _mm_div_ps(_mm_set1_ps(1.0f), GetQuadValue(WSlope, dx, dy));
+	float lanes[4];
+	_mm_storeu_ps(lanes, invW);
+	for (u32 n = 0; n < 4; n++)
+		rasterBlock.Pixel[n & 1][n >> 1].InvW = lanes[n];
+
+	const __m128i z = _mm_cvttps_epi32(GetQuadValue(ZSlope, dx, dy));
+	_mm_storeu_si128((__m128i*)quad.Z, z);
+	quad.ZInRange = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_srli_epi32(z, 24), _mm_setzero_si128())));
+
+	//  colors
+	for (unsigned int i = 0; i < bpmem.genMode.numcolchans; i++)
+	{
+		__m128 r = GetQuadValue(ColorSlopes[i][0], dx, dy);
+		__m128 g = GetQuadValue(ColorSlopes[i][1], dx, dy);
+		__m128 b = GetQuadValue(ColorSlopes[i][2], dx, dy);
+		__m128 a = GetQuadValue(ColorSlopes[i][3], dx, dy);
+		_MM_TRANSPOSE4_PS(r, g, b, a);
+
+		// now one pixel per register, clamp the u16 color value to 0 and keep
+		// the low byte
+		__m128i color[4];
+		const __m128 pixels[4] = { r, g, b, a };
+		for (u32 n = 0; n < 4; n++)
+		{
+			__m128i c = _mm_and_si128(_mm_cvttps_epi32(pixels[n]), _mm_set1_epi32(0xffff));
+			color[n] = _mm_and_si128(_mm_andnot_si128(_mm_srli_epi32(c, 8), c), _mm_set1_epi32(0xff));
+		}
+		__m128i packed = _mm_packus_epi16(_mm_packs_epi32(color[0], color[1]), _mm_packs_epi32(color[2], color[3]));
+		_mm_storeu_si128((__m128i*)quad.Color[i], packed);
+	}
+
+	// tex coords
+	for (unsigned int i = 0; i < bpmem.genMode.numtexgens; i++)
+	{
+		__m128 projection = invW;
+		if (swxfregs.texMtxInfo[i].projection)
+		{
+			__m128 q = _mm_mul_ps(GetQuadValue(TexSlopes[i][2], dx, dy), invW);
+			__m128 valid = _mm_cmpneq_ps(q, _mm_setzero_ps());
+			projection = _mm_or_ps(_mm_and_ps(valid, _mm_div_ps(invW, q)), _mm_andnot_ps(valid, invW));
+		}
+
+		for (int comp = 0; comp < 2; comp++)
+		{
+			__m128 uv = _mm_mul_ps(GetQuadValue(TexSlopes[i][comp], dx, dy), projection);
+			_mm_storeu_ps(lanes, uv);
+			for (u32 n = 0; n < 4; n++)
+				rasterBlock.Pixel[n & 1][n >> 1].Uv[i][comp] = lanes[n];
+
+			// multiply by 128 because TEV stores UVs as s17.7
+			_mm_storeu_si128((__m128i*)quad.Uv[i][comp], _mm_cvttps_epi32(_mm_mul_ps(uv, _mm_set1_ps(128.0f))));
+		}
+	}
+
+	BuildBlockLOD();
+}
+#else
+void BuildBlock(s32 blockX, s32 blockY)
+{
+	quad.ZInRange = 0;
+
+	for (s32 n = 0; n < 4; n++)
+	{
+		RasterBlockPixel& pixel = rasterBlock.Pixel[n & 1][n >> 1];
+
+		float dx = vertexOffsetX + (float)((n & 1) + blockX - vertex0X);
+		float dy = vertexOffsetY + (float)((n >> 1) + blockY - vertex0Y);
+
+		float invW = 1.0f / WSlope.GetValue(dx, dy);
+		pixel.InvW = invW;
+
+		s32 z = (s32)ZSlope.GetValue(dx, dy);
+		quad.Z[n] = z;
+		if (z >= 0 && z <= 0x00ffffff)
+			quad.ZInRange |= 1 << n;
+
+		//  colors
+		for (unsigned int i = 0; i < bpmem.genMode.numcolchans; i++)
+		{
+			for (int comp = 0; comp < 4; comp++)
+			{
+				u16 color = (u16)ColorSlopes[i][comp].GetValue(dx, dy);
+
+				// clamp color value to 0
+				u16 mask = ~(color >> 8);
+
+				quad.Color[i][n][comp] = color & mask;
+			}
+		}
+
+		// tex coords
+		for (unsigned int i = 0; i < bpmem.genMode.numtexgens; i++)
+		{
+			float projection = invW;
+			if (swxfregs.texMtxInfo[i].projection)
+			{
+				float q = TexSlopes[i][2].GetValue(dx, dy) * invW;
+				if (q != 0.0f)
+					projection = invW / q;
+			}
+
+			pixel.Uv[i][0] = TexSlopes[i][0].GetValue(dx, dy) * projection;
+			pixel.Uv[i][1] = TexSlopes[i][1].GetValue(dx, dy) * projection;
+
+			// multiply by 128 because TEV stores UVs as s17.7
+			quad.Uv[i][0][n] = (s32)(pixel.Uv[i][0] * 128);
+			quad.Uv[i][1][n] = (s32)(pixel.Uv[i][1] * 128);
+		}
+	}
+
+	BuildBlockLOD();
+}
+#endif
+
 void DrawTriangleFrontFace(OutputVertexData *v0, OutputVertexData *v1, OutputVertexData *v2)
 {
 	INCSTAT(swstats.thisFrame.numTrianglesDrawn);
@@ -327,6 +447,8 @@ void DrawTriangleFrontFace(OutputVertexData *v0, OutputVertexData *v1, OutputVer
 		return;
 	}
 
+	tev.SetupStages();
+
 	// adapted from http://www.devmaster.net/forums/showthread.php?t=1884
 
 	// 28.4 fixed-pou32 coordinates. rounded to nearest and adjusted to match hardware output
@@ -457,13 +579,7 @@ void DrawTriangleFrontFace(OutputVertexData *v0, OutputVertexData *v1, OutputVer
 			// Accept whole block when totally covered
 			if(a == 0xF && b == 0xF && c == 0xF)
 			{
-				for(s32 iy = 0; iy < BLOCK_SIZE; iy++)
-				{
-					for(s32 ix = 0; ix < BLOCK_SIZE; ix++)
-					{
-						Draw(x + ix, y + iy, ix, iy);
-					}
-				}
+				DrawQuad(x, y, 0xF);
 			}
 			else // Partially covered block
 			{
@@ -471,6 +587,7 @@ void DrawTriangleFrontFace(OutputVertexData *v0, OutputVertexData *v1, OutputVer
 				s32 CY2 = C2 + DX23 * y0 - DY23 * x0;
 				s32 CY3 = C3 + DX31 * y0 - DY31 * x0;
 
+				u32 mask = 0;
 				for(s32 iy = 0; iy < BLOCK_SIZE; iy++)
 				{
 					s32 CX1 = CY1;
@@ -481,7 +598,7 @@ void DrawTriangleFrontFace(OutputVertexData *v0, OutputVertexData *v1, OutputVer
 					{
 						if(CX1 > 0 && CX2 > 0 && CX3 > 0)
 						{
-							Draw(x + ix, y + iy, ix, iy);
+							mask |= 1 << (ix + iy * BLOCK_SIZE);
 						}
 
 						CX1 -= FDY12;
@@ -493,6 +610,8 @@ void DrawTriangleFrontFace(OutputVertexData *v0, OutputVertexData *v1, OutputVer
 					CY2 += FDX23;
 					CY3 += FDX31;
 				}
+
+				DrawQuad(x, y, mask);
 			}
 		}
 	}
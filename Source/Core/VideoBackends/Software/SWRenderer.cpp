@@ -11,9 +11,14 @@
 #include "SWRenderer.h"
 #include "SWStatistics.h"
 #include "SWCommandProcessor.h"
+#include "WorkerPool.h"
 
 #include "OnScreenDisplay.h"
 
+#if (defined(_M_X64) || defined(_M_IX86)) && !defined(_M_GENERIC)
+#include <emmintrin.h>
+#endif
+
 static GLuint s_RenderTarget = 0;
 
 static GLint attr_pos = -1, attr_tex = -1;
@@ -135,6 +140,7 @@ void SWRenderer::DrawDebugText()
 		p+=sprintf(p,"Objects: %i\n",swstats.thisFrame.numDrawnObjects);
 		p+=sprintf(p,"Primitives: %i\n",swstats.thisFrame.numPrimatives);
 		p+=sprintf(p,"Vertices Loaded: %i\n",swstats.thisFrame.numVerticesLoaded);
+		p+=sprintf(p,"Vertices/s: %.0f\n",swstats.GetVerticesPerSecond());
 
 		p+=sprintf(p,"Triangles Input:   %i\n",swstats.thisFrame.numTrianglesIn);
 		p+=sprintf(p,"Triangles Rejected:   %i\n",swstats.thisFrame.numTrianglesRejected);
@@ -160,19 +166,71 @@ void SWRenderer::swapColorTexture() {
 	s_currentColorTexture = !s_currentColorTexture;
 }
 
-void SWRenderer::UpdateColorTexture(EfbInterface::yuv422_packed *xfb, u32 fbWidth, u32 fbHeight)
+struct ColorTextureJob
 {
-	if(fbWidth*fbHeight > 640*568) {
-		ERROR_LOG(VIDEO, "Framebuffer is too large: %ix%i", fbWidth, fbHeight);
-		return;
-	}
-
-	u32 offset = 0;
-	u8 *TexturePointer = getColorTexture();
+	EfbInterface::yuv422_packed *xfb;
+	u32 fbWidth;
+	u32 fbHeight;
+	u8 *texture;
+	bool simd;
+};
+
+// Converts the rows of the XFB of one job to RGBA
+static void ConvertColorTextureRows(void *arg, int job, int jobs)
+{
+	const ColorTextureJob *colorJob = (const ColorTextureJob*)arg;
+	const u32 fbWidth = colorJob->fbWidth;
+	// Every color sample makes 2 pixels, even if the last one is outside of the row
+	const u32 rowSize = ((fbWidth + 1) & ~1) * 4;
 
-	for (u16 y = 0; y < fbHeight; y++)
+	for (u32 y = colorJob->fbHeight * job / jobs; y < colorJob->fbHeight * (job + 1) / jobs; y++)
 	{
-		for (u16 x = 0; x < fbWidth; x+=2)
+		const EfbInterface::yuv422_packed *xfb = colorJob->xfb + y * fbWidth;
+		u8 *TexturePointer = colorJob->texture + y * rowSize;
+		u32 offset = 0;
+		u32 x = 0;
+
+#if (defined(_M_X64) || defined(_M_IX86)) && !defined(_M_GENERIC)
+		// Four color samples at a time, the same single precision math as below
+		for (; colorJob->simd && x + 8 <= fbWidth; x += 8)
+		{
+			const __m128i packed = _mm_loadu_si128((const __m128i*)&xfb[x]);
+			const __m128i even = _mm_and_si128(packed, _mm_set1_epi32(0xffff));
+			const __m128i odd = _mm_srli_epi32(packed, 16);
+
+			const __m128 Y1 = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_and_si128(even, _mm_set1_epi32(0xff)), _mm_set1_epi32(16)));
+			const __m128 Y2 = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_and_si128(odd, _mm_set1_epi32(0xff)), _mm_set1_epi32(16)));
+			const __m128 U = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(even, 8), _mm_set1_epi32(128)));
+			const __m128 V = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(odd, 8), _mm_set1_epi32(128)));
+
+			const __m128 rV = _mm_mul_ps(_mm_set1_ps(1.596f), V);
+			const __m128 gU = _mm_mul_ps(_mm_set1_ps(0.392f), U);
+			const __m128 gV = _mm_mul_ps(_mm_set1_ps(0.813f), V);
+			const __m128 bU = _mm_mul_ps(_mm_set1_ps(2.017f), U);
+
+			__m128i rgba[2];
+			for (int i = 0; i < 2; i++)
+			{
+				const __m128 Y = _mm_mul_ps(_mm_set1_ps(1.164f), i ? Y2 : Y1);
+				const __m128 R = _mm_add_ps(Y, rV);
+				const __m128 G = _mm_sub_ps(_mm_sub_ps(Y, gU), gV);
+				const __m128 B = _mm_add_ps(Y, bU);
+
+				const __m128 zero = _mm_setzero_ps();
+				const __m128 limit = _mm_set1_ps(255.0f);
+				const __m128i r = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(R, zero), limit));
+				const __m128i g = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(G, zero), limit));
+				const __m128i b = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(B, zero), limit));
+				rgba[i] = _mm_or_si128(_mm_or_si128(r, _mm_slli_epi32(g, 8)), _mm_or_si128(_mm_slli_epi32(b, 16), _mm_set1_epi32(0xff000000)));
+			}
+
+			_mm_storeu_si128((__m128i*)&TexturePointer[offset], _mm_unpacklo_epi32(rgba[0], rgba[1]));
+			_mm_storeu_si128((__m128i*)&TexturePointer[offset + 16], _mm_unpackhi_epi32(rgba[0], rgba[1]));
+			offset += 32;
+		}
+#endif
+
+		for (; x < fbWidth; x+=2)
 		{
 			// We do this one color sample (aka 2 RGB pixles) at a time
 			int Y1 = xfb[x].Y - 16;
@@ -192,11 +250,29 @@ void SWRenderer::UpdateColorTexture(EfbInterface::yuv422_packed *xfb, u32 fbWidt
 			TexturePointer[offset++] = min(255.0f, max(0.0f, 1.164f * Y2 + 2.017f * U             ));
 			TexturePointer[offset++] = 255;
 		}
-		xfb += fbWidth;
 	}
+}
+
+void SWRenderer::UpdateColorTexture(EfbInterface::yuv422_packed *xfb, u32 fbWidth, u32 fbHeight)
+{
+	if(fbWidth*fbHeight > 640*568) {
+		ERROR_LOG(VIDEO, "Framebuffer is too large: %ix%i", fbWidth, fbHeight);
+		return;
+	}
+
+	ConvertColorTexture(getColorTexture(), xfb, fbWidth, fbHeight);
 	swapColorTexture();
 }
 
+void SWRenderer::ConvertColorTexture(u8 *texture, EfbInterface::yuv422_packed *xfb, u32 fbWidth, u32 fbHeight, bool use_simd, int jobs)
+{
+	if (jobs <= 0)
+		jobs = std::min<int>(WorkerPool::GetMaxJobs(), fbHeight / 32 + 1);
+
+	ColorTextureJob colorJob = { xfb, fbWidth, fbHeight, texture, use_simd };
+	WorkerPool::Run(ConvertColorTextureRows, &colorJob, jobs);
+}
+
 // Called on the GPU thread
 void SWRenderer::Swap(u32 fbWidth, u32 fbHeight)
 {
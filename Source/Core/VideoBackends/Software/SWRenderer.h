@@ -22,6 +22,10 @@ namespace SWRenderer
 	u8* getColorTexture();
 	void swapColorTexture();
 	void UpdateColorTexture(EfbInterface::yuv422_packed *xfb, u32 fbWidth, u32 fbHeight);
+	// Converts the XFB to RGBA rows of fbWidth rounded up to even pixels.
+	// use_simd and jobs are only changed to compare the SSE and parallel
+	// conversion against the scalar loop, jobs <= 0 picks the number of jobs.
+	void ConvertColorTexture(u8 *texture, EfbInterface::yuv422_packed *xfb, u32 fbWidth, u32 fbHeight, bool use_simd = true, int jobs = 0);
 	void DrawTexture(u8 *texture, int width, int height);
 
 	void Swap(u32 fbWidth, u32 fbHeight);
@@ -23,3 +23,10 @@ void SWStatistics::ResetFrame()
 {
 	memset(&thisFrame, 0, sizeof(ThisFrame));
 }
+
+double SWStatistics::GetVerticesPerSecond() const
+{
+	if (!thisFrame.vertexLoadTime)
+		return 0.0;
+	return thisFrame.numVerticesLoaded * 1000000000.0 / thisFrame.vertexLoadTime;
+}
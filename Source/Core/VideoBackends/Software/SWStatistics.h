@@ -15,6 +15,7 @@ struct SWStatistics
 		u32 numDrawnObjects;
 		u32 numPrimatives;
 		u32 numVerticesLoaded;
+		u64 vertexLoadTime; // host ns spent loading and transforming, only while the stats are shown
 		u32 numVerticesOut;
 
 		u32 numTrianglesIn;
@@ -33,6 +34,8 @@ struct SWStatistics
 
 	ThisFrame thisFrame;
 	void ResetFrame();
+
+	double GetVerticesPerSecond() const;
 };
 
 extern SWStatistics swstats;
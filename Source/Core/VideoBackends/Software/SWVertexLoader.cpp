@@ -18,6 +18,7 @@
 #include "SWStatistics.h"
 #include "VertexManagerBase.h"
 #include "DataReader.h"
+#include "Timer.h"
 
 // Vertex loaders read these
 extern int tcIndex;
@@ -249,28 +250,60 @@ void SWVertexLoader::SetFormat(u8 attributeIndex, u8 primitiveType)
 }
 
 
-void SWVertexLoader::LoadVertex()
+void SWVertexLoader::LoadVertices(u32 count)
 {
-	for (int i = 0; i < m_NumAttributeLoaders; i++)
-		m_AttributeLoaders[i].loader(this, &m_Vertex, m_AttributeLoaders[i].index);
+	const bool timed = g_SWVideoConfig.bShowStats;
+	const u64 start = timed ? Common::Timer::GetTimeNs() : 0;
 
-	OutputVertexData* outVertex = m_SetupUnit->GetVertex();
+	while (count)
+	{
+		const u32 batchSize = std::min<u32>(count, TransformUnit::MAX_BATCH_VERTICES);
 
-	// transform input data
-	TransformUnit::TransformPosition(&m_Vertex, outVertex);
+		for (u32 v = 0; v < batchSize; v++)
+		{
+			for (int i = 0; i < m_NumAttributeLoaders; i++)
+				m_AttributeLoaders[i].loader(this, &m_Vertex, m_AttributeLoaders[i].index);
 
-	if (g_VtxDesc.Normal != NOT_PRESENT)
-	{
-		TransformUnit::TransformNormal(&m_Vertex, m_CurrentVat->g0.NormalElements, outVertex);
-	}
+			m_InputBatch[v] = m_Vertex;
+		}
 
-	TransformUnit::TransformColor(&m_Vertex, outVertex);
+		// transform input data
+		const bool hasNormal = g_VtxDesc.Normal != NOT_PRESENT;
+		const bool nbt = m_CurrentVat->g0.NormalElements;
+
+		if (TransformUnit::ReadsMissingNormals(hasNormal, nbt))
+		{
+			for (u32 v = 0; v < batchSize; v++)
+			{
+				TransformUnit::TransformBatch(&m_InputBatch[v], m_SetupUnit->GetVertex(), 1, hasNormal, nbt, m_TexGenSpecialCase);
+				m_SetupUnit->SetupVertex();
+			}
+		}
+		else
+		{
+			TransformUnit::TransformBatch(m_InputBatch, m_OutputBatch, batchSize, hasNormal, nbt, m_TexGenSpecialCase);
 
-	TransformUnit::TransformTexCoord(&m_Vertex, outVertex, m_TexGenSpecialCase);
+			// keep the normals the vertices don't have as the setup unit had them
+			const int firstMissing = hasNormal ? 1 : 0;
+			for (u32 v = 0; v < batchSize; v++)
+			{
+				OutputVertexData *vertex = m_SetupUnit->GetVertex();
+				if (!nbt)
+				{
+					for (int i = firstMissing; i < 3; i++)
+						m_OutputBatch[v].normal[i] = vertex->normal[i];
+				}
+				*vertex = m_OutputBatch[v];
+				m_SetupUnit->SetupVertex();
+			}
+		}
 
-	m_SetupUnit->SetupVertex();
+		count -= batchSize;
+		ADDSTAT(swstats.thisFrame.numVerticesLoaded, batchSize);
+	}
 
-	INCSTAT(swstats.thisFrame.numVerticesLoaded)
+	if (timed)
+		ADDSTAT(swstats.thisFrame.vertexLoadTime, Common::Timer::GetTimeNs() - start);
 }
 
 void SWVertexLoader::AddAttributeLoader(AttributeLoader loader, u8 index)
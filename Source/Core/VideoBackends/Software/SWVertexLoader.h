@@ -10,6 +10,7 @@
 #include "NativeVertexFormat.h"
 #include "CPMemLoader.h"
 #include "ChunkFile.h"
+#include "TransformUnit.h"
 
 class SetupUnit;
 
@@ -26,6 +27,10 @@ class SWVertexLoader
 
 	InputVertexData m_Vertex;
 
+	// Vertices are decoded into the batch and transformed together
+	InputVertexData m_InputBatch[TransformUnit::MAX_BATCH_VERTICES];
+	OutputVertexData m_OutputBatch[TransformUnit::MAX_BATCH_VERTICES];
+
 	typedef void (*AttributeLoader)(SWVertexLoader*, InputVertexData*, u8);
 	struct AttrLoaderCall
 	{
@@ -56,7 +61,8 @@ public:
 
 	u32 GetVertexSize() { return m_VertexSize; }
 
-	void LoadVertex();
+	// Loads, transforms and sets up count vertices of the current primitive
+	void LoadVertices(u32 count);
 	void DoState(PointerWrap &p);
 };
 
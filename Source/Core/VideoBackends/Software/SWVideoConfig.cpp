@@ -16,6 +16,7 @@ SWVideoConfig::SWVideoConfig()
 
 	bHwRasterizer = false;
 	bBypassXFB = false;
+	bTevJit = true;
 
 	bShowStats = false;
 
@@ -43,6 +44,7 @@ void SWVideoConfig::Load(const char* ini_file)
 
 	iniFile.Get("Rendering", "HwRasterizer", &bHwRasterizer, false);
 	iniFile.Get("Rendering", "BypassXFB", &bBypassXFB, false);
+	iniFile.Get("Rendering", "TevJit", &bTevJit, true);
 	iniFile.Get("Rendering", "ZComploc", &bZComploc, true);
 	iniFile.Get("Rendering", "ZFreeze", &bZFreeze, true);
 
@@ -68,6 +70,7 @@ void SWVideoConfig::Save(const char* ini_file)
 
 	iniFile.Set("Rendering", "HwRasterizer", bHwRasterizer);
 	iniFile.Set("Rendering", "BypassXFB", bBypassXFB);
+	iniFile.Set("Rendering", "TevJit", bTevJit);
 	iniFile.Set("Rendering", "ZComploc", bZComploc);
 	iniFile.Set("Rendering", "ZFreeze", bZFreeze);
 
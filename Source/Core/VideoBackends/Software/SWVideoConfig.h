@@ -23,6 +23,7 @@ struct SWVideoConfig : NonCopyable
 
 	bool bHwRasterizer;
 	bool bBypassXFB;
+	bool bTevJit;
 
 	// Emulation features
 	bool bZComploc;
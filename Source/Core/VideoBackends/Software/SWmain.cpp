@@ -21,6 +21,8 @@
 #include "Rasterizer.h"
 #include "SWRenderer.h"
 #include "HwRasterizer.h"
+#include "TevJit.h"
+#include "WorkerPool.h"
 #include "LogManager.h"
 #include "EfbInterface.h"
 #include "DebugUtil.h"
@@ -90,6 +92,8 @@ bool VideoSoftware::Initialize(void *&window_handle)
 	OpcodeDecoder::Init();
 	Clipper::Init();
 	Rasterizer::Init();
+	TevJit::Init();
+	WorkerPool::Init();
 	HwRasterizer::Init();
 	SWRenderer::Init();
 	DebugUtil::Init();
@@ -161,6 +165,8 @@ void VideoSoftware::EmuStateChange(EMUSTATE_CHANGE newState)
 void VideoSoftware::Shutdown()
 {
 	// TODO: should be in Video_Cleanup
+	TevJit::Shutdown();
+	WorkerPool::Shutdown();
 	HwRasterizer::Shutdown();
 	SWRenderer::Shutdown();
 
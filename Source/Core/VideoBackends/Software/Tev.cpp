@@ -110,6 +110,8 @@ void Tev::Init()
 	m_ScaleRShiftLUT[1] = 0;
 	m_ScaleRShiftLUT[2] = 0;
 	m_ScaleRShiftLUT[3] = 1;
+
+	m_CompiledStages = NULL;
 }
 
 inline s16 Clamp255(s16 in)
@@ -570,40 +572,42 @@ void Tev::Indirect(unsigned int stageNum, s32 s, s32 t)
 	}
 }
 
-void Tev::Draw()
+void Tev::SampleStage(unsigned int stageNum)
 {
-	_assert_(Position[0] >= 0 && Position[0] < EFB_WIDTH);
-	_assert_(Position[1] >= 0 && Position[1] < EFB_HEIGHT);
-
-	INCSTAT(swstats.thisFrame.tevPixelsIn);
+	TwoTevStageOrders &order = bpmem.tevorders[stageNum >> 1];
+	TevStageCombiner::AlphaCombiner &ac = bpmem.combiners[stageNum].alphaC;
+	int stageOdd = stageNum&1;
 
-	for (unsigned int stageNum = 0; stageNum < bpmem.genMode.numindstages; stageNum++)
-	{
-		int stageNum2 = stageNum >> 1;
-		int stageOdd = stageNum&1;
+	int texcoordSel = order.getTexCoord(stageOdd);
+	int texmap = order.getTexMap(stageOdd);
 
-		u32 texcoordSel = bpmem.tevindref.getTexCoord(stageNum);
-		u32 texmap = bpmem.tevindref.getTexMap(stageNum);
+	Indirect(stageNum, Uv[texcoordSel].s, Uv[texcoordSel].t);
 
-		const TEXSCALE& texscale = bpmem.texscale[stageNum2];
-		s32 scaleS = stageOdd ? texscale.ss1:texscale.ss0;
-		s32 scaleT = stageOdd ? texscale.ts1:texscale.ts0;
+	// sample texture
+	if (order.getEnable(stageOdd))
+	{
+		// RGBA
+		u8 texel[4];
 
-		TextureSampler::Sample(Uv[texcoordSel].s >> scaleS, Uv[texcoordSel].t >> scaleT,
-			IndirectLod[stageNum], IndirectLinear[stageNum], texmap, IndirectTex[stageNum]);
+		TextureSampler::Sample(TexCoord.s, TexCoord.t, TextureLod[stageNum], TextureLinear[stageNum], texmap, texel);
 
 #if ALLOW_TEV_DUMPS
-		if (g_SWVideoConfig.bDumpTevStages)
-		{
-			u8 stage[4] = { IndirectTex[stageNum][TextureSampler::ALP_SMP],
-							IndirectTex[stageNum][TextureSampler::BLU_SMP],
-							IndirectTex[stageNum][TextureSampler::GRN_SMP],
-							255};
-			DebugUtil::DrawTempBuffer(stage, INDIRECT + stageNum);
-		}
+		if (g_SWVideoConfig.bDumpTevTextureFetches)
+			DebugUtil::DrawTempBuffer(texel, DIRECT_TFETCH + stageNum);
 #endif
+
+		int swaptable = ac.tswap * 2;
+
+		TexColor[RED_C] = texel[bpmem.tevksel[swaptable].swap1];
+		TexColor[GRN_C] = texel[bpmem.tevksel[swaptable].swap2];
+		swaptable++;
+		TexColor[BLU_C] = texel[bpmem.tevksel[swaptable].swap1];
+		TexColor[ALP_C] = texel[bpmem.tevksel[swaptable].swap2];
 	}
+}
 
+void Tev::DrawStages()
+{
 	for (unsigned int stageNum = 0; stageNum <= bpmem.genMode.numtevstages; stageNum++)
 	{
 		int stageNum2 = stageNum >> 1;
@@ -615,32 +619,7 @@ void Tev::Draw()
 		TevStageCombiner::ColorCombiner &cc = bpmem.combiners[stageNum].colorC;
 		TevStageCombiner::AlphaCombiner &ac = bpmem.combiners[stageNum].alphaC;
 
-		int texcoordSel = order.getTexCoord(stageOdd);
-		int texmap = order.getTexMap(stageOdd);
-
-		Indirect(stageNum, Uv[texcoordSel].s, Uv[texcoordSel].t);
-
-		// sample texture
-		if (order.getEnable(stageOdd))
-		{
-			// RGBA
-			u8 texel[4];
-
-			TextureSampler::Sample(TexCoord.s, TexCoord.t, TextureLod[stageNum], TextureLinear[stageNum], texmap, texel);
-
-#if ALLOW_TEV_DUMPS
-			if (g_SWVideoConfig.bDumpTevTextureFetches)
-				DebugUtil::DrawTempBuffer(texel, DIRECT_TFETCH + stageNum);
-#endif
-
-			int swaptable = ac.tswap * 2;
-
-			TexColor[RED_C] = texel[bpmem.tevksel[swaptable].swap1];
-			TexColor[GRN_C] = texel[bpmem.tevksel[swaptable].swap2];
-			swaptable++;
-			TexColor[BLU_C] = texel[bpmem.tevksel[swaptable].swap1];
-			TexColor[ALP_C] = texel[bpmem.tevksel[swaptable].swap2];
-		}
+		SampleStage(stageNum);
 
 		// set konst for this stage
 		int kc = kSel.getKC(stageOdd);
@@ -690,6 +669,64 @@ void Tev::Draw()
 		}
 #endif
 	}
+}
+
+void Tev::SetupStages()
+{
+	m_CompiledStages = NULL;
+
+	// the dumps are only written by the interpreter
+	if (!g_SWVideoConfig.bTevJit || (ALLOW_TEV_DUMPS && (g_SWVideoConfig.bDumpTevStages || g_SWVideoConfig.bDumpTevTextureFetches)))
+		return;
+
+	m_CompiledStages = TevJit::GetCompiledStages(*this);
+}
+
+void Tev::Draw()
+{
+	_assert_(Position[0] >= 0 && Position[0] < EFB_WIDTH);
+	_assert_(Position[1] >= 0 && Position[1] < EFB_HEIGHT);
+
+	INCSTAT(swstats.thisFrame.tevPixelsIn);
+
+	for (unsigned int stageNum = 0; stageNum < bpmem.genMode.numindstages; stageNum++)
+	{
+		int stageNum2 = stageNum >> 1;
+		int stageOdd = stageNum&1;
+
+		u32 texcoordSel = bpmem.tevindref.getTexCoord(stageNum);
+		u32 texmap = bpmem.tevindref.getTexMap(stageNum);
+
+		const TEXSCALE& texscale = bpmem.texscale[stageNum2];
+		s32 scaleS = stageOdd ? texscale.ss1:texscale.ss0;
+		s32 scaleT = stageOdd ? texscale.ts1:texscale.ts0;
+
+		TextureSampler::Sample(Uv[texcoordSel].s >> scaleS, Uv[texcoordSel].t >> scaleT,
+			IndirectLod[stageNum], IndirectLinear[stageNum], texmap, IndirectTex[stageNum]);
+
+#if ALLOW_TEV_DUMPS
+		if (g_SWVideoConfig.bDumpTevStages)
+		{
+			u8 stage[4] = { IndirectTex[stageNum][TextureSampler::ALP_SMP],
+							IndirectTex[stageNum][TextureSampler::BLU_SMP],
+							IndirectTex[stageNum][TextureSampler::GRN_SMP],
+							255};
+			DebugUtil::DrawTempBuffer(stage, INDIRECT + stageNum);
+		}
+#endif
+	}
+
+	// the compiled stages include the alpha test
+	bool compiled = m_CompiledStages != NULL;
+	if (compiled)
+	{
+		if (!m_CompiledStages(this))
+			return;
+	}
+	else
+	{
+		DrawStages();
+	}
 
 	// convert to 8 bits per component
 	// the results of the last tev stage are put onto the screen,
@@ -698,7 +735,7 @@ void Tev::Draw()
 	u32 alpha_index = bpmem.combiners[bpmem.genMode.numtevstages].alphaC.dest;
 	u8 output[4] = {(u8)Reg[alpha_index][ALP_C], (u8)Reg[color_index][BLU_C], (u8)Reg[color_index][GRN_C], (u8)Reg[color_index][RED_C]};
 
-	if (!TevAlphaTest(output[ALP_C]))
+	if (!compiled && !TevAlphaTest(output[ALP_C]))
 		return;
 
 	// z texture
@@ -7,6 +7,7 @@
 
 #include "BPMemLoader.h"
 #include "ChunkFile.h"
+#include "TevJit.h"
 
 class Tev
 {
@@ -44,6 +45,8 @@ class Tev
 	u8 m_ScaleLShiftLUT[4];
 	u8 m_ScaleRShiftLUT[4];
 
+	TevJit::CompiledStages m_CompiledStages;
+
 	// enumeration for color input LUT
 	enum
 	{
@@ -67,6 +70,11 @@ class Tev
 	void DrawAlphaCompare(TevStageCombiner::AlphaCombiner &ac);
 
 	void Indirect(unsigned int stageNum, s32 s, s32 t);
+	void SampleStage(unsigned int stageNum);
+	void DrawStages();
+
+	// the compiled stages access the registers and call SampleStage
+	friend class TevCompiler;
 
 public:
 	s32 Position[3];
@@ -79,6 +87,8 @@ public:
 
 	void Init();
 
+	// Picks the compiled stages for the current bpmem state, called once per triangle
+	void SetupStages();
 	void Draw();
 
 	void SetRegColor(int reg, int comp, bool konst, s16 color);
@@ -0,0 +1,561 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <map>
+
+#include "Common.h"
+#include "x64Emitter.h"
+#include "x64ABI.h"
+
+#include "TevJit.h"
+#include "Tev.h"
+#include "BPMemLoader.h"
+
+#if defined(_M_X64) && !defined(_M_GENERIC)
+#define USE_JIT
+#endif
+
+// One function per config, even 16 stages stay well below MAX_FUNCTION_SIZE
+#define CODE_SIZE (1024 * 1024)
+#define MAX_FUNCTION_SIZE (16 * 1024)
+
+using namespace Gen;
+
+// Everything the compiled code depends on, unused stages are zero
+struct TevJitUid
+{
+	u32 numTevStages;
+	u32 colorC[16];
+	u32 alphaC[16];
+	u32 tevorders[8];
+	u32 tevksel[8];
+	u32 keepsPrev; // bit n is set if stage n leaves the previous TexCoord to add to or keep
+	u32 alphaTest;
+
+	bool operator<(const TevJitUid &other) const { return memcmp(this, &other, sizeof(*this)) < 0; }
+	bool operator==(const TevJitUid &other) const { return memcmp(this, &other, sizeof(*this)) == 0; }
+};
+
+#ifdef USE_JIT
+
+// Mirrors the cases in which Tev::Indirect doesn't overwrite TexCoord. The
+// two bit fmt is always one of the four formats it handles.
+static bool KeepsPrevTexCoord(const TevStageIndirect &indirect)
+{
+	return indirect.fb_addprev || ((indirect.mid & 3) && (indirect.mid & 12) == 12);
+}
+
+static void GetUid(TevJitUid &uid)
+{
+	memset(&uid, 0, sizeof(uid));
+
+	uid.numTevStages = bpmem.genMode.numtevstages;
+	for (unsigned int i = 0; i <= uid.numTevStages; i++)
+	{
+		uid.colorC[i] = bpmem.combiners[i].colorC.hex;
+		uid.alphaC[i] = bpmem.combiners[i].alphaC.hex;
+		uid.tevorders[i >> 1] = bpmem.tevorders[i >> 1].hex;
+		uid.keepsPrev |= KeepsPrevTexCoord(bpmem.tevind[i]) << i;
+	}
+
+	// the swap tables are shared by all stages
+	for (int i = 0; i < 8; i++)
+		uid.tevksel[i] = bpmem.tevksel[i].hex;
+
+	uid.alphaTest = bpmem.alpha_test.hex;
+}
+
+// The code keeps the Tev pointer in RBX, everything else lives in the Tev
+// object, so the generated code works on any instance. Scratch registers are
+// EAX, ECX, EDX and R8-R11, none of them survive a call to SampleStage.
+class TevCompiler : public XCodeBlock
+{
+public:
+	TevJit::CompiledStages Compile(const Tev &tev, const TevJitUid &uid);
+
+private:
+	const Tev *m_tev;
+
+	static void SampleStage(Tev *tev, u32 stageNum) { tev->SampleStage(stageNum); }
+
+	OpArg TevArg(const void *ptr) const { return MDisp(RBX, (int)((const u8*)ptr - (const u8*)m_tev)); }
+
+	void LoadU8(X64Reg reg, const s16 *src);
+	void LoadS11(X64Reg reg, const s16 *src);
+	void LoadCompareValue(X64Reg reg, const s16 *const *srcs, int count);
+	void ClampAndStore(s16 *dest, bool clamp);
+
+	void EmitStage(unsigned int stageNum, const TevJitUid &uid);
+	void EmitRasColor(int colorChan, int swaptable, const TevJitUid &uid);
+	void EmitRegular(const s16 *a, const s16 *b, const s16 *c, const s16 *d,
+		int op, int bias, int shift, s16 *dest, bool clamp);
+	void EmitCompare(const s16 *const *a, const s16 *const *b, int count, bool equal);
+	void EmitCompareResult(const s16 *c, const s16 *d, s16 *dest, bool clamp);
+	void EmitAlphaCompare(X64Reg reg, int ref, int comp);
+	void EmitAlphaTest(const TevJitUid &uid);
+};
+
+// InputRegType.a, b and c
+void TevCompiler::LoadU8(X64Reg reg, const s16 *src)
+{
+	MOVZX(32, 8, reg, TevArg(src));
+}
+
+// InputRegType.d
+void TevCompiler::LoadS11(X64Reg reg, const s16 *src)
+{
+	MOVSX(32, 16, reg, TevArg(src));
+	SHL(32, R(reg), Imm8(21));
+	SAR(32, R(reg), Imm8(21));
+}
+
+// Packs the low bytes of srcs, most significant first, uses R9
+void TevCompiler::LoadCompareValue(X64Reg reg, const s16 *const *srcs, int count)
+{
+	LoadU8(reg, srcs[0]);
+	for (int i = 1; i < count; i++)
+	{
+		SHL(32, R(reg), Imm8(8));
+		LoadU8(R9, srcs[i]);
+		OR(32, R(reg), R(R9));
+	}
+}
+
+// Truncates EAX to a TEV register like the interpreter's store does, then clamps it
+void TevCompiler::ClampAndStore(s16 *dest, bool clamp)
+{
+	MOVSX(32, 16, EAX, R(EAX));
+	MOV(32, R(ECX), Imm32(clamp ? 255 : 1023));
+	CMP(32, R(EAX), R(ECX));
+	CMOVcc(32, EAX, R(ECX), CC_G);
+	MOV(32, R(ECX), Imm32(clamp ? 0 : -1024));
+	CMP(32, R(EAX), R(ECX));
+	CMOVcc(32, EAX, R(ECX), CC_L);
+	MOV(16, TevArg(dest), R(EAX));
+}
+
+// Tev::DrawColorRegular and Tev::DrawAlphaRegular for one component
+void TevCompiler::EmitRegular(const s16 *a, const s16 *b, const s16 *c, const s16 *d,
+	int op, int bias, int shift, s16 *dest, bool clamp)
+{
+	// c += c >> 7
+	LoadU8(ECX, c);
+	MOV(32, R(EDX), R(ECX));
+	SHR(32, R(EDX), Imm8(7));
+	ADD(32, R(ECX), R(EDX));
+
+	// a * (256 - c) + b * c
+	LoadU8(EAX, a);
+	MOV(32, R(EDX), Imm32(256));
+	SUB(32, R(EDX), R(ECX));
+	IMUL(32, EAX, R(EDX));
+	LoadU8(EDX, b);
+	IMUL(32, EDX, R(ECX));
+	ADD(32, R(EAX), R(EDX));
+
+	if (op)
+		NEG(32, R(EAX));
+	SAR(32, R(EAX), Imm8(8));
+
+	LoadS11(ECX, d);
+	ADD(32, R(EAX), R(ECX));
+
+	const s16 bias_value = m_tev->m_BiasLUT[bias];
+	if (bias_value)
+		ADD(32, R(EAX), Imm32(bias_value));
+	if (m_tev->m_ScaleLShiftLUT[shift])
+		SHL(32, R(EAX), Imm8(m_tev->m_ScaleLShiftLUT[shift]));
+	if (m_tev->m_ScaleRShiftLUT[shift])
+		SAR(32, R(EAX), Imm8(m_tev->m_ScaleRShiftLUT[shift]));
+
+	ClampAndStore(dest, clamp);
+}
+
+// Leaves 0 or ~0 in R8 for the compare modes
+void TevCompiler::EmitCompare(const s16 *const *a, const s16 *const *b, int count, bool equal)
+{
+	LoadCompareValue(R10, a, count);
+	LoadCompareValue(R11, b, count);
+	XOR(32, R(R8), R(R8));
+	MOV(32, R(R9), Imm32(0xFFFFFFFF));
+	CMP(32, R(R10), R(R11));
+	CMOVcc(32, R8, R(R9), equal ? CC_E : CC_A);
+}
+
+// d + (compare ? c : 0) with the mask from EmitCompare
+void TevCompiler::EmitCompareResult(const s16 *c, const s16 *d, s16 *dest, bool clamp)
+{
+	LoadU8(EAX, c);
+	AND(32, R(EAX), R(R8));
+	LoadS11(ECX, d);
+	ADD(32, R(EAX), R(ECX));
+	ClampAndStore(dest, clamp);
+}
+
+// Tev::SetRasColor
+void TevCompiler::EmitRasColor(int colorChan, int swaptable, const TevJitUid &uid)
+{
+	s16 *const ras = (s16*)m_tev->RasColor;
+
+	switch (colorChan)
+	{
+	case 0: // Color0
+	case 1: // Color1
+		{
+			TevKSel swap0, swap1;
+			swap0.hex = uid.tevksel[swaptable];
+			swap1.hex = uid.tevksel[swaptable + 1];
+
+			const u8 *color = m_tev->Color[colorChan];
+			MOVZX(32, 8, EAX, TevArg(&color[swap0.swap1]));
+			MOV(16, TevArg(&ras[Tev::RED_C]), R(EAX));
+			MOVZX(32, 8, EAX, TevArg(&color[swap0.swap2]));
+			MOV(16, TevArg(&ras[Tev::GRN_C]), R(EAX));
+			MOVZX(32, 8, EAX, TevArg(&color[swap1.swap1]));
+			MOV(16, TevArg(&ras[Tev::BLU_C]), R(EAX));
+			MOVZX(32, 8, EAX, TevArg(&color[swap1.swap2]));
+			MOV(16, TevArg(&ras[Tev::ALP_C]), R(EAX));
+		}
+		break;
+	case 5: // alpha bump
+	case 6: // alpha bump normalized
+		MOVZX(32, 8, EAX, TevArg(&m_tev->AlphaBump));
+		if (colorChan == 6)
+		{
+			MOV(32, R(ECX), R(EAX));
+			SHR(32, R(ECX), Imm8(5));
+			OR(32, R(EAX), R(ECX));
+		}
+		for (int i = 0; i < 4; i++)
+			MOV(16, TevArg(&ras[i]), R(EAX));
+		break;
+	default: // zero
+		for (int i = 0; i < 4; i++)
+			MOV(16, TevArg(&ras[i]), Imm16(0));
+		break;
+	}
+}
+
+void TevCompiler::EmitStage(unsigned int stageNum, const TevJitUid &uid)
+{
+	int stageOdd = stageNum & 1;
+
+	TwoTevStageOrders order;
+	TevKSel kSel;
+	TevStageCombiner::ColorCombiner cc;
+	TevStageCombiner::AlphaCombiner ac;
+	order.hex = uid.tevorders[stageNum >> 1];
+	kSel.hex = uid.tevksel[stageNum >> 1];
+	cc.hex = uid.colorC[stageNum];
+	ac.hex = uid.alphaC[stageNum];
+
+	int colorChan = order.getColorChan(stageOdd);
+
+	// Tev::Indirect is only observable through the texture fetch, the bump
+	// alpha and the coordinates the next stage adds to or keeps. Those of the
+	// last stage are kept for stage 0 of the next pixel, which may have
+	// another config.
+	bool lastStage = stageNum == uid.numTevStages;
+	bool nextKeepsPrev = !lastStage && ((uid.keepsPrev >> (stageNum + 1)) & 1);
+	if (order.getEnable(stageOdd) || colorChan == 5 || colorChan == 6 || lastStage || nextKeepsPrev)
+	{
+		MOV(64, R(ABI_PARAM1), R(RBX));
+		MOV(32, R(ABI_PARAM2), Imm32(stageNum));
+		ABI_CallFunction((void*)&SampleStage);
+	}
+
+	// konst for this stage
+	int kc = kSel.getKC(stageOdd);
+	int ka = kSel.getKA(stageOdd);
+	s16 *const konst = (s16*)m_tev->StageKonst;
+	for (int i = Tev::BLU_C; i <= Tev::RED_C; i++)
+	{
+		MOV(16, R(EAX), TevArg(m_tev->m_KonstLUT[kc][i]));
+		MOV(16, TevArg(&konst[i]), R(EAX));
+	}
+	MOV(16, R(EAX), TevArg(m_tev->m_KonstLUT[ka][Tev::ALP_C]));
+	MOV(16, TevArg(&konst[Tev::ALP_C]), R(EAX));
+
+	EmitRasColor(colorChan, ac.rswap * 2, uid);
+
+	// color combiner, the components are written in the interpreter's order
+	// as one of them may be an input of the next
+	s16 *const *colorA = m_tev->m_ColorInputLUT[cc.a];
+	s16 *const *colorB = m_tev->m_ColorInputLUT[cc.b];
+	s16 *const *colorC = m_tev->m_ColorInputLUT[cc.c];
+	s16 *const *colorD = m_tev->m_ColorInputLUT[cc.d];
+	s16 *const colorDest = (s16*)m_tev->Reg[cc.dest];
+
+	if (cc.bias != 3)
+	{
+		for (int i = 0; i < 3; i++)
+			EmitRegular(colorA[i], colorB[i], colorC[i], colorD[i], cc.op, cc.bias, cc.shift, &colorDest[Tev::BLU_C + i], cc.clamp);
+	}
+	else
+	{
+		int cmp = (cc.shift << 1) | cc.op | 8;
+		bool equal = cmp & 1;
+
+		if (cmp == TEVCMP_RGB8_GT || cmp == TEVCMP_RGB8_EQ)
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				EmitCompare(&colorA[i], &colorB[i], 1, equal);
+				EmitCompareResult(colorC[i], colorD[i], &colorDest[Tev::BLU_C + i], cc.clamp);
+			}
+		}
+		else
+		{
+			// the same components Tev::DrawColorCompare packs
+			static const int r8[] = { Tev::RED_INP };
+			static const int gr16_gt[] = { Tev::GRN_INP, Tev::RED_INP };
+			static const int gr16_eq[] = { Tev::GRN_C, Tev::RED_INP };
+			static const int bgr24[] = { Tev::BLU_C, Tev::GRN_C, Tev::RED_INP };
+
+			const int *slots;
+			int count;
+			switch (cmp)
+			{
+			case TEVCMP_R8_GT:
+			case TEVCMP_R8_EQ:
+				slots = r8; count = 1;
+				break;
+			case TEVCMP_GR16_GT:
+				slots = gr16_gt; count = 2;
+				break;
+			case TEVCMP_GR16_EQ:
+				slots = gr16_eq; count = 2;
+				break;
+			default:
+				slots = bgr24; count = 3;
+				break;
+			}
+
+			const s16 *a[3], *b[3];
+			for (int i = 0; i < count; i++)
+			{
+				a[i] = colorA[slots[i]];
+				b[i] = colorB[slots[i]];
+			}
+
+			EmitCompare(a, b, count, equal);
+			for (int i = 0; i < 3; i++)
+				EmitCompareResult(colorC[i], colorD[i], &colorDest[Tev::BLU_C + i], cc.clamp);
+		}
+	}
+
+	// alpha combiner
+	const s16 *alphaA = m_tev->m_AlphaInputLUT[ac.a];
+	const s16 *alphaB = m_tev->m_AlphaInputLUT[ac.b];
+	const s16 *alphaC = m_tev->m_AlphaInputLUT[ac.c];
+	const s16 *alphaD = m_tev->m_AlphaInputLUT[ac.d];
+	s16 *const alphaDest = (s16*)&m_tev->Reg[ac.dest][Tev::ALP_C];
+
+	if (ac.bias != 3)
+	{
+		EmitRegular(&alphaA[Tev::ALP_C], &alphaB[Tev::ALP_C], &alphaC[Tev::ALP_C], &alphaD[Tev::ALP_C],
+			ac.op, ac.bias, ac.shift, alphaDest, ac.clamp);
+	}
+	else
+	{
+		int cmp = (ac.shift << 1) | ac.op | 8;
+		bool equal = cmp & 1;
+
+		// the same components Tev::DrawAlphaCompare packs
+		static const int r8[] = { Tev::RED_C };
+		static const int gr16[] = { Tev::GRN_C, Tev::RED_C };
+		static const int bgr24[] = { Tev::BLU_C, Tev::GRN_C, Tev::RED_C };
+		static const int a8[] = { Tev::ALP_C };
+
+		const int *slots;
+		int count;
+		switch (cmp)
+		{
+		case TEVCMP_R8_GT:
+		case TEVCMP_R8_EQ:
+			slots = r8; count = 1;
+			break;
+		case TEVCMP_GR16_GT:
+		case TEVCMP_GR16_EQ:
+			slots = gr16; count = 2;
+			break;
+		case TEVCMP_BGR24_GT:
+		case TEVCMP_BGR24_EQ:
+			slots = bgr24; count = 3;
+			break;
+		default:
+			slots = a8; count = 1;
+			break;
+		}
+
+		const s16 *a[3], *b[3];
+		for (int i = 0; i < count; i++)
+		{
+			a[i] = &alphaA[slots[i]];
+			b[i] = &alphaB[slots[i]];
+		}
+
+		EmitCompare(a, b, count, equal);
+		EmitCompareResult(&alphaC[Tev::ALP_C], &alphaD[Tev::ALP_C], alphaDest, ac.clamp);
+	}
+}
+
+// Sets reg to AlphaCompare(EAX, ref, comp)
+void TevCompiler::EmitAlphaCompare(X64Reg reg, int ref, int comp)
+{
+	CCFlags flag;
+	switch (comp)
+	{
+	case ALPHACMP_ALWAYS:  MOV(32, R(reg), Imm32(1)); return;
+	case ALPHACMP_NEVER:   MOV(32, R(reg), Imm32(0)); return;
+	case ALPHACMP_LEQUAL:  flag = CC_LE; break;
+	case ALPHACMP_LESS:    flag = CC_L; break;
+	case ALPHACMP_GEQUAL:  flag = CC_GE; break;
+	case ALPHACMP_GREATER: flag = CC_G; break;
+	case ALPHACMP_EQUAL:   flag = CC_E; break;
+	default:               flag = CC_NE; break;
+	}
+
+	MOV(32, R(reg), Imm32(0));
+	CMP(32, R(EAX), Imm32(ref));
+	SETcc(flag, R(reg));
+}
+
+// TevAlphaTest on the alpha Tev::Draw outputs, the result is returned in EAX
+void TevCompiler::EmitAlphaTest(const TevJitUid &uid)
+{
+	TevStageCombiner::AlphaCombiner ac;
+	AlphaTest alphaTest;
+	ac.hex = uid.alphaC[uid.numTevStages];
+	alphaTest.hex = uid.alphaTest;
+
+	LoadU8(EAX, &m_tev->Reg[ac.dest][Tev::ALP_C]);
+	EmitAlphaCompare(ECX, alphaTest.ref0, alphaTest.comp0);
+	EmitAlphaCompare(EDX, alphaTest.ref1, alphaTest.comp1);
+
+	switch (alphaTest.logic)
+	{
+	case 0: // and
+		AND(32, R(ECX), R(EDX));
+		break;
+	case 1: // or
+		OR(32, R(ECX), R(EDX));
+		break;
+	case 2: // xor
+		XOR(32, R(ECX), R(EDX));
+		break;
+	case 3: // xnor
+		XOR(32, R(ECX), R(EDX));
+		XOR(32, R(ECX), Imm32(1));
+		break;
+	}
+
+	MOV(32, R(EAX), R(ECX));
+}
+
+TevJit::CompiledStages TevCompiler::Compile(const Tev &tev, const TevJitUid &uid)
+{
+	m_tev = &tev;
+
+	// The interpreter would dereference a NULL konst for the reserved selections
+	for (unsigned int i = 0; i <= uid.numTevStages; i++)
+	{
+		TevKSel kSel;
+		kSel.hex = uid.tevksel[i >> 1];
+		if (!tev.m_KonstLUT[kSel.getKC(i & 1)][Tev::RED_C] || !tev.m_KonstLUT[kSel.getKA(i & 1)][Tev::ALP_C])
+			return NULL;
+	}
+
+	const u8 *start = AlignCode16();
+	ABI_PushAllCalleeSavedRegsAndAdjustStack();
+	MOV(64, R(RBX), R(ABI_PARAM1));
+
+	for (unsigned int i = 0; i <= uid.numTevStages; i++)
+		EmitStage(i, uid);
+
+	EmitAlphaTest(uid);
+
+	ABI_PopAllCalleeSavedRegsAndAdjustStack();
+	RET();
+
+	if (GetCodePtr() - start > MAX_FUNCTION_SIZE)
+		PanicAlert("TevJit: compiled stages are bigger than MAX_FUNCTION_SIZE");
+
+	return (TevJit::CompiledStages)start;
+}
+
+static TevCompiler s_compiler;
+
+#endif
+
+namespace TevJit
+{
+
+static bool s_initialized = false;
+static std::map<TevJitUid, CompiledStages> s_cache;
+
+// Most triangles use the same config as the previous one
+static TevJitUid s_lastUid;
+static CompiledStages s_lastStages;
+
+void Init()
+{
+#ifdef USE_JIT
+	s_compiler.AllocCodeSpace(CODE_SIZE);
+	s_initialized = true;
+#endif
+	s_cache.clear();
+	memset(&s_lastUid, 0, sizeof(s_lastUid));
+	s_lastStages = NULL;
+}
+
+void Shutdown()
+{
+#ifdef USE_JIT
+	if (s_initialized)
+		s_compiler.FreeCodeSpace();
+#endif
+	s_initialized = false;
+	s_cache.clear();
+	s_lastStages = NULL;
+}
+
+CompiledStages GetCompiledStages(const Tev &tev)
+{
+	if (!s_initialized)
+		return NULL;
+
+#ifdef USE_JIT
+	TevJitUid uid;
+	GetUid(uid);
+	if (s_lastStages && uid == s_lastUid)
+		return s_lastStages;
+
+	CompiledStages stages;
+	std::map<TevJitUid, CompiledStages>::iterator iter = s_cache.find(uid);
+	if (iter != s_cache.end())
+	{
+		stages = iter->second;
+	}
+	else
+	{
+		if (s_compiler.GetSpaceLeft() < MAX_FUNCTION_SIZE)
+		{
+			s_compiler.ClearCodeSpace();
+			s_cache.clear();
+		}
+
+		stages = s_compiler.Compile(tev, uid);
+		s_cache[uid] = stages;
+	}
+
+	s_lastUid = uid;
+	s_lastStages = stages;
+	return stages;
+#else
+	return NULL;
+#endif
+}
+
+}
@@ -0,0 +1,28 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#ifndef _TEVJIT_H_
+#define _TEVJIT_H_
+
+#include "CommonTypes.h"
+
+class Tev;
+
+// Compiles the TEV stages and the alpha test of the current bpmem state to x64
+// code, cached by the registers they depend on. Texture and indirect fetches
+// call back into Tev, z texturing, fog, the late z test and blending are left
+// to Tev::Draw. The interpreter in Tev is the reference the code must match.
+namespace TevJit
+{
+	// Runs all stages for the pixel in tev, returns whether it passed the alpha test
+	typedef bool (*CompiledStages)(Tev *tev);
+
+	void Init();
+	void Shutdown();
+
+	// Returns NULL if the stages have to be interpreted
+	CompiledStages GetCompiledStages(const Tev &tev);
+}
+
+#endif
@@ -8,11 +8,19 @@
 
 #include "LookUpTables.h"
 #include "TextureDecoder.h"
+#include "WorkerPool.h"
+
+#if (defined(_M_X64) || defined(_M_IX86)) && !defined(_M_GENERIC)
+#include <emmintrin.h>
+#endif
 
 
 namespace TextureEncoder
 {
 
+// Copies with fewer texels are encoded on the GPU thread alone
+#define MIN_PARALLEL_TEXELS (64 * 64)
+
 inline void RGBA_to_RGBA8(u8 *src, u8 &r, u8 &g, u8 &b, u8 &a)
 {
 	u32 srcColor = *(u32*)src;
@@ -211,22 +219,269 @@ void SetBlockDimensions(int blkWidthLog2, int blkHeightLog2, u16 &sBlkCount, u16
 
 void SetSpans(int sBlkSize, int tBlkSize, s32 &tSpan, s32 &sBlkSpan, s32 &tBlkSpan, s32 &writeStride)
 {
-	// width is 1 less than the number of pixels of width
-	u32 width = bpmem.copyTexSrcWH.x >> bpmem.triggerEFBCopy.half_scale;
-	u32 alignedWidth = (width + sBlkSize) & (~(sBlkSize-1));
-
 	u32 readStride = 3 << bpmem.triggerEFBCopy.half_scale;
 
 	tSpan = (640 - sBlkSize) * readStride; // bytes to advance src pointer after each row of texels in a block
 	sBlkSpan = ((-640 * tBlkSize) + sBlkSize) * readStride; // bytes to advance src pointer after each block
-	tBlkSpan = ((640 * tBlkSize) - alignedWidth) * readStride; // bytes to advance src pointer after each row of blocks
+	tBlkSpan = 640 * tBlkSize * readStride; // bytes between the first texels of two rows of blocks
 
 	writeStride = bpmem.copyMipMapStrideChannels * 32;
 }
 
+#if (defined(_M_X64) || defined(_M_IX86)) && !defined(_M_GENERIC)
+// The intensity and color formats are encoded a row of four texels at a time.
+// The loaders return the texels as a, r, g, b bytes, the 6 bit components of
+// RGBA6 are scaled to 8 bit like Convert6To8 and the box filter does the same
+// sums and shifts as the scalar filters above.
+typedef __m128i (*TexelLoader)(const u8 *src);
+
+// Moves the a, b, g, r fields of four RGBA6 pixels to a, r, g, b bytes
+static inline __m128i UnpackRGBA6(const u8 *src, int pixelStride)
+{
+	const __m128i v = _mm_set_epi32(*(u32*)(src + 3 * pixelStride), *(u32*)(src + 2 * pixelStride),
+		*(u32*)(src + pixelStride), *(u32*)src);
+
+	const __m128i a = _mm_and_si128(v, _mm_set1_epi32(0x3f));
+	const __m128i r = _mm_and_si128(_mm_srli_epi32(v, 10), _mm_set1_epi32(0x3f00));
+	const __m128i g = _mm_and_si128(_mm_slli_epi32(v, 4), _mm_set1_epi32(0x3f0000));
+	const __m128i b = _mm_and_si128(_mm_slli_epi32(v, 18), _mm_set1_epi32(0x3f000000));
+	return _mm_or_si128(_mm_or_si128(a, r), _mm_or_si128(g, b));
+}
+
+static __m128i LoadRGBA6(const u8 *src)
+{
+	const __m128i x = UnpackRGBA6(src, 3);
+	return _mm_or_si128(_mm_slli_epi16(x, 2), _mm_and_si128(_mm_srli_epi16(x, 4), _mm_set1_epi8(0x03)));
+}
+
+static __m128i LoadRGBA6halfscale(const u8 *src)
+{
+	// The sums of four 6 bit components still fit in a byte
+	__m128i x = _mm_add_epi32(UnpackRGBA6(src, 6), UnpackRGBA6(src + 3, 6));
+	x = _mm_add_epi32(x, UnpackRGBA6(src + 640 * 3, 6));
+	x = _mm_add_epi32(x, UnpackRGBA6(src + 640 * 3 + 3, 6));
+	return _mm_add_epi8(x, _mm_and_si128(_mm_srli_epi16(x, 6), _mm_set1_epi8(0x03)));
+}
+
+static __m128i LoadRGB8(const u8 *src)
+{
+	const __m128i v = _mm_set_epi32(*(u32*)(src + 9), *(u32*)(src + 6), *(u32*)(src + 3), *(u32*)src);
+
+	const __m128i r = _mm_and_si128(_mm_srli_epi32(v, 8), _mm_set1_epi32(0xff00));
+	const __m128i g = _mm_and_si128(_mm_slli_epi32(v, 8), _mm_set1_epi32(0xff0000));
+	const __m128i b = _mm_slli_epi32(v, 24);
+	return _mm_or_si128(_mm_or_si128(_mm_set1_epi32(0xff), r), _mm_or_si128(g, b));
+}
+
+static __m128i LoadRGB8halfscale(const u8 *src)
+{
+	// b and r are summed in the low and high halves of br, g in the low half of g16
+	__m128i br = _mm_setzero_si128();
+	__m128i g16 = _mm_setzero_si128();
+	for (int i = 0; i < 4; i++)
+	{
+		const u8 *p = src + (i >> 1) * 640 * 3 + (i & 1) * 3;
+		const __m128i v = _mm_set_epi32(*(u32*)(p + 18), *(u32*)(p + 12), *(u32*)(p + 6), *(u32*)p);
+		br = _mm_add_epi32(br, _mm_and_si128(v, _mm_set1_epi32(0x00ff00ff)));
+		g16 = _mm_add_epi32(g16, _mm_and_si128(_mm_srli_epi32(v, 8), _mm_set1_epi32(0xff)));
+	}
+
+	const __m128i r = _mm_and_si128(_mm_srli_epi32(br, 10), _mm_set1_epi32(0xff00));
+	const __m128i g = _mm_and_si128(_mm_slli_epi32(g16, 14), _mm_set1_epi32(0xff0000));
+	const __m128i b = _mm_slli_epi32(_mm_srli_epi32(_mm_slli_epi32(br, 16), 18), 24);
+	return _mm_or_si128(_mm_or_si128(_mm_set1_epi32(0xff), r), _mm_or_si128(g, b));
+}
+
+// RGB8_to_I of every texel as a 32 bit lane
+static inline __m128i TexelsToI(__m128i argb)
+{
+	const __m128i r = _mm_and_si128(_mm_srli_epi32(argb, 8), _mm_set1_epi32(0xff));
+	const __m128i g = _mm_and_si128(_mm_srli_epi32(argb, 16), _mm_set1_epi32(0xff));
+	const __m128i b = _mm_srli_epi32(argb, 24);
+
+	__m128i val = _mm_add_epi32(_mm_mullo_epi16(r, _mm_set1_epi32(66)), _mm_mullo_epi16(g, _mm_set1_epi32(129)));
+	val = _mm_add_epi32(val, _mm_mullo_epi16(b, _mm_set1_epi32(25)));
+	return _mm_srli_epi32(_mm_add_epi32(val, _mm_set1_epi32(4096)), 8);
+}
+
+// Packs the low 16 bits of every lane
+static inline __m128i Pack16(__m128i val)
+{
+	val = _mm_srai_epi32(_mm_slli_epi32(val, 16), 16);
+	return _mm_packs_epi32(val, val);
+}
+
+static inline __m128i Swap16(__m128i val)
+{
+	return _mm_or_si128(_mm_slli_epi16(val, 8), _mm_srli_epi16(val, 8));
+}
+
+// Stores the low bytes of the lanes of lo and hi
+static inline void StoreBytes8(u8 *dst, __m128i lo, __m128i hi)
+{
+	const __m128i val = _mm_packs_epi32(lo, hi);
+	_mm_storel_epi64((__m128i*)dst, _mm_packus_epi16(val, val));
+}
+
+template <TexelLoader Load, int readStride>
+static void EncodeBlockI4(u8 *dst, const u8 *src)
+{
+	for (int t = 0; t < 8; t++, src += 640 * readStride, dst += 4)
+	{
+		// Pairs of intensities in the halves of 32 bit lanes
+		const __m128i i = _mm_packs_epi32(TexelsToI(Load(src)), TexelsToI(Load(src + 4 * readStride)));
+		__m128i val = _mm_or_si128(_mm_and_si128(i, _mm_set1_epi32(0xf0)), _mm_and_si128(_mm_srli_epi32(i, 20), _mm_set1_epi32(0x0f)));
+		val = _mm_packs_epi32(val, val);
+		*(u32*)dst = _mm_cvtsi128_si32(_mm_packus_epi16(val, val));
+	}
+}
+
+template <TexelLoader Load, int readStride>
+static void EncodeBlockI8(u8 *dst, const u8 *src)
+{
+	for (int t = 0; t < 4; t++, src += 640 * readStride, dst += 8)
+		StoreBytes8(dst, TexelsToI(Load(src)), TexelsToI(Load(src + 4 * readStride)));
+}
+
+template <TexelLoader Load, int readStride>
+static void EncodeBlockIA4(u8 *dst, const u8 *src)
+{
+	for (int t = 0; t < 4; t++, src += 640 * readStride, dst += 8)
+	{
+		const __m128i argb0 = Load(src);
+		const __m128i argb1 = Load(src + 4 * readStride);
+		const __m128i val0 = _mm_or_si128(_mm_and_si128(argb0, _mm_set1_epi32(0xf0)), _mm_srli_epi32(TexelsToI(argb0), 4));
+		const __m128i val1 = _mm_or_si128(_mm_and_si128(argb1, _mm_set1_epi32(0xf0)), _mm_srli_epi32(TexelsToI(argb1), 4));
+		StoreBytes8(dst, val0, val1);
+	}
+}
+
+template <TexelLoader Load, int readStride>
+static void EncodeBlockIA8(u8 *dst, const u8 *src)
+{
+	for (int t = 0; t < 4; t++, src += 640 * readStride, dst += 8)
+	{
+		const __m128i argb = Load(src);
+		const __m128i val = _mm_or_si128(_mm_and_si128(argb, _mm_set1_epi32(0xff)), _mm_slli_epi32(TexelsToI(argb), 8));
+		_mm_storel_epi64((__m128i*)dst, Pack16(val));
+	}
+}
+
+template <TexelLoader Load, int readStride>
+static void EncodeBlockRGB565(u8 *dst, const u8 *src)
+{
+	for (int t = 0; t < 4; t++, src += 640 * readStride, dst += 8)
+	{
+		const __m128i argb = Load(src);
+		const __m128i r = _mm_and_si128(argb, _mm_set1_epi32(0xf800));
+		const __m128i g = _mm_and_si128(_mm_srli_epi32(argb, 13), _mm_set1_epi32(0x07e0));
+		const __m128i b = _mm_and_si128(_mm_srli_epi32(argb, 27), _mm_set1_epi32(0x001e));
+		_mm_storel_epi64((__m128i*)dst, Swap16(Pack16(_mm_or_si128(_mm_or_si128(r, g), b))));
+	}
+}
+
+template <TexelLoader Load, int readStride>
+static void EncodeBlockRGB5A3(u8 *dst, const u8 *src)
+{
+	for (int t = 0; t < 4; t++, src += 640 * readStride, dst += 8)
+	{
+		const __m128i argb = Load(src);
+		const __m128i b = _mm_srli_epi32(argb, 27);
+
+		__m128i val555 = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(argb, 1), _mm_set1_epi32(0x7c00)), _mm_and_si128(_mm_srli_epi32(argb, 14), _mm_set1_epi32(0x03e0)));
+		val555 = _mm_or_si128(_mm_or_si128(val555, _mm_and_si128(b, _mm_set1_epi32(0x001e))), _mm_set1_epi32(0x8000));
+
+		__m128i val4443 = _mm_or_si128(_mm_and_si128(_mm_slli_epi32(argb, 7), _mm_set1_epi32(0x7000)), _mm_and_si128(_mm_srli_epi32(argb, 4), _mm_set1_epi32(0x0f00)));
+		val4443 = _mm_or_si128(_mm_or_si128(val4443, _mm_and_si128(_mm_srli_epi32(argb, 16), _mm_set1_epi32(0x00f0))), _mm_srli_epi32(b, 1));
+
+		const __m128i opaque = _mm_cmpgt_epi32(_mm_and_si128(argb, _mm_set1_epi32(0xff)), _mm_set1_epi32(223));
+		const __m128i val = _mm_or_si128(_mm_and_si128(opaque, val555), _mm_andnot_si128(opaque, val4443));
+		_mm_storel_epi64((__m128i*)dst, Swap16(Pack16(val)));
+	}
+}
+
+template <TexelLoader Load, int readStride>
+static void EncodeBlockRGBA8(u8 *dst, const u8 *src)
+{
+	for (int t = 0; t < 4; t++, src += 640 * readStride, dst += 8)
+	{
+		// The ar and gb halves of the texels go to the two 32 byte halves of the block
+		__m128i argb = Load(src);
+		argb = _mm_shufflelo_epi16(argb, _MM_SHUFFLE(3, 1, 2, 0));
+		argb = _mm_shufflehi_epi16(argb, _MM_SHUFFLE(3, 1, 2, 0));
+		argb = _mm_shuffle_epi32(argb, _MM_SHUFFLE(3, 1, 2, 0));
+		_mm_storel_epi64((__m128i*)dst, argb);
+		_mm_storel_epi64((__m128i*)(dst + 32), _mm_unpackhi_epi64(argb, argb));
+	}
+}
+
+// Returns false if the format has to be encoded by the scalar loops
+template <TexelLoader Load, int readStride>
+static bool EncodeSSE(u8 *dstStart, u8 *srcStart, u32 format, int job, int jobs)
+{
+	u16 sBlkCount, tBlkCount, sBlkSize, tBlkSize;
+	s32 tSpan, sBlkSpan, tBlkSpan, writeStride;
+	void (*encodeBlock)(u8 *dst, const u8 *src);
+	u32 blockSize = 32;
+
+	switch (format)
+	{
+	case GX_TF_I4:
+		SetBlockDimensions(3, 3, sBlkCount, tBlkCount, sBlkSize, tBlkSize);
+		encodeBlock = EncodeBlockI4<Load, readStride>;
+		break;
+	case GX_TF_I8:
+		SetBlockDimensions(3, 2, sBlkCount, tBlkCount, sBlkSize, tBlkSize);
+		encodeBlock = EncodeBlockI8<Load, readStride>;
+		break;
+	case GX_TF_IA4:
+		SetBlockDimensions(3, 2, sBlkCount, tBlkCount, sBlkSize, tBlkSize);
+		encodeBlock = EncodeBlockIA4<Load, readStride>;
+		break;
+	case GX_TF_IA8:
+		SetBlockDimensions(2, 2, sBlkCount, tBlkCount, sBlkSize, tBlkSize);
+		encodeBlock = EncodeBlockIA8<Load, readStride>;
+		break;
+	case GX_TF_RGB565:
+		SetBlockDimensions(2, 2, sBlkCount, tBlkCount, sBlkSize, tBlkSize);
+		encodeBlock = EncodeBlockRGB565<Load, readStride>;
+		break;
+	case GX_TF_RGB5A3:
+		SetBlockDimensions(2, 2, sBlkCount, tBlkCount, sBlkSize, tBlkSize);
+		encodeBlock = EncodeBlockRGB5A3<Load, readStride>;
+		break;
+	case GX_TF_RGBA8:
+		SetBlockDimensions(2, 2, sBlkCount, tBlkCount, sBlkSize, tBlkSize);
+		encodeBlock = EncodeBlockRGBA8<Load, readStride>;
+		blockSize = 64;
+		break;
+	default:
+		return false;
+	}
+	SetSpans(sBlkSize, tBlkSize, tSpan, sBlkSpan, tBlkSpan, writeStride);
+
+	for (int tBlk = tBlkCount * job / jobs; tBlk < tBlkCount * (job + 1) / jobs; tBlk++)
+	{
+		const u8 *src = srcStart + tBlk * tBlkSpan;
+		u8 *dst = dstStart + tBlk * writeStride;
+		for (int sBlk = 0; sBlk < sBlkCount; sBlk++)
+		{
+			encodeBlock(dst, src);
+			src += sBlkSize * readStride;
+			dst += blockSize;
+		}
+	}
+
+	return true;
+}
+#endif
+
+// Every job encodes its own range of block rows, so the rows can be split
+// across the worker pool
 #define ENCODE_LOOP_BLOCKS									\
-		for (int tBlk = 0; tBlk < tBlkCount; tBlk++) {		\
-			dst = dstBlockStart;							\
+		for (int tBlk = tBlkCount * job / jobs; tBlk < tBlkCount * (job + 1) / jobs; tBlk++) {	\
+			src = srcStart + tBlk * tBlkSpan;				\
+			dst = dstStart + tBlk * writeStride;			\
 			for (int sBlk = 0; sBlk < sBlkCount; sBlk++) {	\
 				for (int t = 0; t < tBlkSize; t++) {		\
 					for (int s = 0; s < sBlkSize; s++) {	\
@@ -238,8 +493,6 @@ void SetSpans(int sBlkSize, int tBlkSize, s32 &tSpan, s32 &sBlkSpan, s32 &tBlkSp
 				}											\
 				src += sBlkSpan;							\
 			}												\
-			src += tBlkSpan;								\
-			dstBlockStart += writeStride;					\
 		}													\
 
 #define ENCODE_LOOP_SPANS2									\
@@ -249,17 +502,15 @@ void SetSpans(int sBlkSize, int tBlkSize, s32 &tSpan, s32 &sBlkSpan, s32 &tBlkSp
 				src += sBlkSpan;							\
 				dst += 32;									\
 			}												\
-			src += tBlkSpan;								\
-			dstBlockStart += writeStride;					\
 		}													\
 
-void EncodeRGBA6(u8 *dst, u8 *src, u32 format)
+void EncodeRGBA6(u8 *dstStart, u8 *srcStart, u32 format, int job, int jobs)
 {
 	u16 sBlkCount, tBlkCount, sBlkSize, tBlkSize;
 	s32 tSpan, sBlkSpan, tBlkSpan, writeStride;
 	u8 r, g, b, a;
 	u32 readStride = 3;
-	u8 *dstBlockStart = dst;
+	u8 *dst, *src;
 
 	switch(format)
 	{
@@ -484,19 +735,20 @@ void EncodeRGBA6(u8 *dst, u8 *src, u32 format)
 		break;
 
 	default:
-		PanicAlert("Unknown texture copy format: 0x%x\n", format);
+		if (job == 0)
+			PanicAlert("Unknown texture copy format: 0x%x\n", format);
 		break;
 	}
 }
 
 
-void EncodeRGBA6halfscale(u8 *dst, u8 *src, u32 format)
+void EncodeRGBA6halfscale(u8 *dstStart, u8 *srcStart, u32 format, int job, int jobs)
 {
 	u16 sBlkCount, tBlkCount, sBlkSize, tBlkSize;
 	s32 tSpan, sBlkSpan, tBlkSpan, writeStride;
 	u8 r, g, b, a;
 	u32 readStride = 6;
-	u8 *dstBlockStart = dst;
+	u8 *dst, *src;
 
 	switch(format)
 	{
@@ -720,17 +972,18 @@ void EncodeRGBA6halfscale(u8 *dst, u8 *src, u32 format)
 		break;
 
 	default:
-		PanicAlert("Unknown texture copy format: 0x%x\n", format);
+		if (job == 0)
+			PanicAlert("Unknown texture copy format: 0x%x\n", format);
 		break;
 	}
 }
 
-void EncodeRGB8(u8 *dst, u8 *src, u32 format)
+void EncodeRGB8(u8 *dstStart, u8 *srcStart, u32 format, int job, int jobs)
 {
 	u16 sBlkCount, tBlkCount, sBlkSize, tBlkSize;
 	s32 tSpan, sBlkSpan, tBlkSpan, writeStride;
 	u32 readStride = 3;
-	u8 *dstBlockStart = dst;
+	u8 *dst, *src;
 
 	switch(format)
 	{
@@ -934,18 +1187,19 @@ void EncodeRGB8(u8 *dst, u8 *src, u32 format)
 		break;
 
 	default:
-		PanicAlert("Unknown texture copy format: 0x%x\n", format);
+		if (job == 0)
+			PanicAlert("Unknown texture copy format: 0x%x\n", format);
 		break;
 	}
 }
 
-void EncodeRGB8halfscale(u8 *dst, u8 *src, u32 format)
+void EncodeRGB8halfscale(u8 *dstStart, u8 *srcStart, u32 format, int job, int jobs)
 {
 	u16 sBlkCount, tBlkCount, sBlkSize, tBlkSize;
 	s32 tSpan, sBlkSpan, tBlkSpan, writeStride;
 	u8 r, g, b;
 	u32 readStride = 6;
-	u8 *dstBlockStart = dst;
+	u8 *dst, *src;
 
 	switch(format)
 	{
@@ -1165,17 +1419,18 @@ void EncodeRGB8halfscale(u8 *dst, u8 *src, u32 format)
 		break;
 
 	default:
-		PanicAlert("Unknown texture copy format: 0x%x\n", format);
+		if (job == 0)
+			PanicAlert("Unknown texture copy format: 0x%x\n", format);
 		break;
 	}
 }
 
-void EncodeZ24(u8 *dst, u8 *src, u32 format)
+void EncodeZ24(u8 *dstStart, u8 *srcStart, u32 format, int job, int jobs)
 {
 	u16 sBlkCount, tBlkCount, sBlkSize, tBlkSize;
 	s32 tSpan, sBlkSpan, tBlkSpan, writeStride;
 	u32 readStride = 3;
-	u8 *dstBlockStart = dst;
+	u8 *dst, *src;
 
 	switch(format)
 	{
@@ -1269,18 +1524,19 @@ void EncodeZ24(u8 *dst, u8 *src, u32 format)
 		break;
 
 	default:
-		PanicAlert("Unknown texture copy format: 0x%x\n", format);
+		if (job == 0)
+			PanicAlert("Unknown texture copy format: 0x%x\n", format);
 		break;
 	}
 }
 
-void EncodeZ24halfscale(u8 *dst, u8 *src, u32 format)
+void EncodeZ24halfscale(u8 *dstStart, u8 *srcStart, u32 format, int job, int jobs)
 {
 	u16 sBlkCount, tBlkCount, sBlkSize, tBlkSize;
 	s32 tSpan, sBlkSpan, tBlkSpan, writeStride;
 	u32 readStride = 6;
 	u8 r, g, b;
-	u8 *dstBlockStart = dst;
+	u8 *dst, *src;
 
 	switch(format)
 	{
@@ -1379,12 +1635,44 @@ void EncodeZ24halfscale(u8 *dst, u8 *src, u32 format)
 		break;
 
 	default:
-		PanicAlert("Unknown texture copy format: 0x%x\n", format);
+		if (job == 0)
+			PanicAlert("Unknown texture copy format: 0x%x\n", format);
 		break;
 	}
 }
 
-void Encode(u8 *dest_ptr)
+struct EncodeJob
+{
+	void (*encoder)(u8 *dstStart, u8 *srcStart, u32 format, int job, int jobs);
+	// Tried first, returns false for the formats it doesn't handle
+	bool (*sseEncoder)(u8 *dstStart, u8 *srcStart, u32 format, int job, int jobs);
+	u8 *dst;
+	u8 *src;
+	u32 format;
+};
+
+static void RunEncodeJob(void *arg, int job, int jobs)
+{
+	EncodeJob *encodeJob = (EncodeJob*)arg;
+	if (encodeJob->sseEncoder && encodeJob->sseEncoder(encodeJob->dst, encodeJob->src, encodeJob->format, job, jobs))
+		return;
+	encodeJob->encoder(encodeJob->dst, encodeJob->src, encodeJob->format, job, jobs);
+}
+
+// Bytes the encoders write for a row of blocks
+static u32 GetBlockRowSize(u32 format)
+{
+	u32 width = bpmem.copyTexSrcWH.x >> bpmem.triggerEFBCopy.half_scale;
+	int texelSize = TexDecoder_GetTexelSizeInNibbles(format);
+
+	// 4 and 8 bit formats use blocks of 8 texels per row, 16 and 32 bit formats
+	// blocks of 4 texels per row. Only 32 bit blocks are 64 bytes.
+	int blkWidthLog2 = texelSize <= 2 ? 3 : 2;
+	u32 blockSize = texelSize == 8 ? 64 : 32;
+	return ((width >> blkWidthLog2) + 1) * blockSize;
+}
+
+void Encode(u8 *dest_ptr, bool use_simd, int jobs)
 {
 	int pixelformat = bpmem.zcontrol.pixel_format;
 	bool bFromZBuffer = pixelformat == PIXELFMT_Z24;
@@ -1407,28 +1695,57 @@ void Encode(u8 *dest_ptr)
 
 	u8 *src = EfbInterface::GetPixelPointer(bpmem.copyTexSrcXY.x, bpmem.copyTexSrcXY.y, bFromZBuffer);
 
+	EncodeJob encodeJob = { NULL, NULL, dest_ptr, src, format };
 	if (bpmem.triggerEFBCopy.half_scale)
 	{
 		if (pixelformat == PIXELFMT_RGBA6_Z24)
-			EncodeRGBA6halfscale(dest_ptr, src, format);
+			encodeJob.encoder = EncodeRGBA6halfscale;
 		else if (pixelformat == PIXELFMT_RGB8_Z24)
-			EncodeRGB8halfscale(dest_ptr, src, format);
+			encodeJob.encoder = EncodeRGB8halfscale;
 		else if (pixelformat == PIXELFMT_RGB565_Z16)  // not supported
-			EncodeRGB8halfscale(dest_ptr, src, format);
+			encodeJob.encoder = EncodeRGB8halfscale;
 		else if (pixelformat == PIXELFMT_Z24)
-			EncodeZ24halfscale(dest_ptr, src, format);
+			encodeJob.encoder = EncodeZ24halfscale;
 	}
 	else
 	{
 		if (pixelformat == PIXELFMT_RGBA6_Z24)
-			EncodeRGBA6(dest_ptr, src, format);
+			encodeJob.encoder = EncodeRGBA6;
 		else if (pixelformat == PIXELFMT_RGB8_Z24)
-			EncodeRGB8(dest_ptr, src, format);
+			encodeJob.encoder = EncodeRGB8;
 		else if (pixelformat == PIXELFMT_RGB565_Z16)  // not supported
-			EncodeRGB8(dest_ptr, src, format);
+			encodeJob.encoder = EncodeRGB8;
 		else if (pixelformat == PIXELFMT_Z24)
-			EncodeZ24(dest_ptr, src, format);
+			encodeJob.encoder = EncodeZ24;
 	}
+
+	if (!encodeJob.encoder)
+		return;
+
+#if (defined(_M_X64) || defined(_M_IX86)) && !defined(_M_GENERIC)
+	if (use_simd)
+	{
+		if (encodeJob.encoder == EncodeRGBA6halfscale)
+			encodeJob.sseEncoder = EncodeSSE<LoadRGBA6halfscale, 6>;
+		else if (encodeJob.encoder == EncodeRGB8halfscale)
+			encodeJob.sseEncoder = EncodeSSE<LoadRGB8halfscale, 6>;
+		else if (encodeJob.encoder == EncodeRGBA6)
+			encodeJob.sseEncoder = EncodeSSE<LoadRGBA6, 3>;
+		else if (encodeJob.encoder == EncodeRGB8)
+			encodeJob.sseEncoder = EncodeSSE<LoadRGB8, 3>;
+	}
+#endif
+
+	// Small copies aren't worth waking the workers, and rows of blocks that
+	// overlap in memory have to be written in order
+	u32 width = bpmem.copyTexSrcWH.x >> bpmem.triggerEFBCopy.half_scale;
+	u32 height = bpmem.copyTexSrcWH.y >> bpmem.triggerEFBCopy.half_scale;
+	if (bpmem.copyMipMapStrideChannels * 32 < GetBlockRowSize(format))
+		jobs = 1;
+	else if (jobs <= 0)
+		jobs = (width + 1) * (height + 1) >= MIN_PARALLEL_TEXELS ? std::min<int>(WorkerPool::GetMaxJobs(), (height >> 3) + 1) : 1;
+
+	WorkerPool::Run(RunEncodeJob, &encodeJob, jobs);
 }
 
 
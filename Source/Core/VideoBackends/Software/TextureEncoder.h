@@ -9,7 +9,9 @@
 
 namespace TextureEncoder
 {
-	void Encode(u8 *dest_ptr);
+	// use_simd and jobs are only changed to compare the SSE and parallel
+	// encoders against the scalar loops, jobs <= 0 picks the number of jobs
+	void Encode(u8 *dest_ptr, bool use_simd = true, int jobs = 0);
 }
 
 #endif
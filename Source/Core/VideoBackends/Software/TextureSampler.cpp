@@ -10,6 +10,10 @@
 
 #include <cmath>
 
+#if (defined(_M_X64) || defined(_M_IX86)) && !defined(_M_GENERIC)
+#include <emmintrin.h>
+#endif
+
 #define ALLOW_MIPMAP 1
 
 namespace TextureSampler
@@ -54,6 +58,24 @@ inline void AddTexel(u8 *inTexel, u32 *outTexel, u32 fract)
 	outTexel[3] += inTexel[3] * fract;
 }
 
+#if (defined(_M_X64) || defined(_M_IX86)) && !defined(_M_GENERIC)
+// The channels of texels a and b interleaved as 16 bit pairs and weighted by
+// one pmaddwd. The weights must fit in 15 bits.
+static inline __m128i WeighTexels(const u8 *a, const u8 *b, u32 fractA, u32 fractB)
+{
+	__m128i ab = _mm_unpacklo_epi8(_mm_cvtsi32_si128(*(const u32*)a), _mm_cvtsi32_si128(*(const u32*)b));
+	ab = _mm_unpacklo_epi8(ab, _mm_setzero_si128());
+	return _mm_madd_epi16(ab, _mm_set1_epi32(fractA | (fractB << 16)));
+}
+
+static inline void StoreTexel(__m128i texel, int shift, u8 *sample)
+{
+	texel = _mm_srli_epi32(texel, shift);
+	texel = _mm_packs_epi32(texel, texel);
+	*(u32*)sample = _mm_cvtsi128_si32(_mm_packus_epi16(texel, texel));
+}
+#endif
+
 void Sample(s32 s, s32 t, s32 lod, bool linear, u8 texmap, u8 *sample)
 {
 	int baseMip = 0;
@@ -77,19 +99,23 @@ void Sample(s32 s, s32 t, s32 lod, bool linear, u8 texmap, u8 *sample)
 
 	if (mipLinear)
 	{
-		u8 sampledTex[4];
-		u32 texel[4];
+		u8 sampledTex[2][4];
 
-		SampleMip(s, t, baseMip, linear, texmap, sampledTex);
-		SetTexel(sampledTex, texel, (16 - lodFract));
+		SampleMip(s, t, baseMip, linear, texmap, sampledTex[0]);
+		SampleMip(s, t, baseMip + 1, linear, texmap, sampledTex[1]);
 
-		SampleMip(s, t, baseMip + 1, linear, texmap, sampledTex);
-		AddTexel(sampledTex, texel, lodFract);
+#if (defined(_M_X64) || defined(_M_IX86)) && !defined(_M_GENERIC)
+		StoreTexel(WeighTexels(sampledTex[0], sampledTex[1], 16 - lodFract, lodFract), 4, sample);
+#else
+		u32 texel[4];
+		SetTexel(sampledTex[0], texel, (16 - lodFract));
+		AddTexel(sampledTex[1], texel, lodFract);
 
 		sample[0] = (u8)(texel[0] >> 4);
 		sample[1] = (u8)(texel[1] >> 4);
 		sample[2] = (u8)(texel[2] >> 4);
 		sample[3] = (u8)(texel[3] >> 4);
+#endif
 	}
 	else
 #endif
@@ -171,8 +197,8 @@ void SampleMip(s32 s, s32 t, s32 mip, bool linear, u8 texmap, u8 *sample)
 		int imageTPlus1 = imageT + 1;
 		int fractT = t & 0x7f;
 
-		u8 sampledTex[4];
-		u32 texel[4];
+		// the four texels in the order s,t / s+1,t / s,t+1 / s+1,t+1
+		u8 sampledTex[4][4];
 
 		WrapCoord(imageS, tm0.wrap_s, imageWidth);
 		WrapCoord(imageT, tm0.wrap_t, imageHeight);
@@ -181,37 +207,36 @@ void SampleMip(s32 s, s32 t, s32 mip, bool linear, u8 texmap, u8 *sample)
 
 		if (!(ti0.format == GX_TF_RGBA8 && texUnit.texImage1[subTexmap].image_type))
 		{
-			TexDecoder_DecodeTexel(sampledTex, imageSrc, imageS, imageT, imageWidth, ti0.format, tlutAddress, texTlut.tlut_format);
-			SetTexel(sampledTex, texel, (128 - fractS) * (128 - fractT));
-
-			TexDecoder_DecodeTexel(sampledTex, imageSrc, imageSPlus1, imageT, imageWidth, ti0.format, tlutAddress, texTlut.tlut_format);
-			AddTexel(sampledTex, texel, (fractS) * (128 - fractT));
-
-			TexDecoder_DecodeTexel(sampledTex, imageSrc, imageS, imageTPlus1, imageWidth, ti0.format, tlutAddress, texTlut.tlut_format);
-			AddTexel(sampledTex, texel, (128 - fractS) * (fractT));
-
-			TexDecoder_DecodeTexel(sampledTex, imageSrc, imageSPlus1, imageTPlus1, imageWidth, ti0.format, tlutAddress, texTlut.tlut_format);
-			AddTexel(sampledTex, texel, (fractS) * (fractT));
+			TexDecoder_DecodeTexel(sampledTex[0], imageSrc, imageS, imageT, imageWidth, ti0.format, tlutAddress, texTlut.tlut_format);
+			TexDecoder_DecodeTexel(sampledTex[1], imageSrc, imageSPlus1, imageT, imageWidth, ti0.format, tlutAddress, texTlut.tlut_format);
+			TexDecoder_DecodeTexel(sampledTex[2], imageSrc, imageS, imageTPlus1, imageWidth, ti0.format, tlutAddress, texTlut.tlut_format);
+			TexDecoder_DecodeTexel(sampledTex[3], imageSrc, imageSPlus1, imageTPlus1, imageWidth, ti0.format, tlutAddress, texTlut.tlut_format);
 		}
 		else
 		{
-			TexDecoder_DecodeTexelRGBA8FromTmem(sampledTex, imageSrc, imageSrcOdd, imageS, imageT, imageWidth);
-			SetTexel(sampledTex, texel, (128 - fractS) * (128 - fractT));
-
-			TexDecoder_DecodeTexelRGBA8FromTmem(sampledTex, imageSrc, imageSrcOdd, imageSPlus1, imageT, imageWidth);
-			AddTexel(sampledTex, texel, (fractS) * (128 - fractT));
-
-			TexDecoder_DecodeTexelRGBA8FromTmem(sampledTex, imageSrc, imageSrcOdd, imageS, imageTPlus1, imageWidth);
-			AddTexel(sampledTex, texel, (128 - fractS) * (fractT));
-
-			TexDecoder_DecodeTexelRGBA8FromTmem(sampledTex, imageSrc, imageSrcOdd, imageSPlus1, imageTPlus1, imageWidth);
-			AddTexel(sampledTex, texel, (fractS) * (fractT));
+			TexDecoder_DecodeTexelRGBA8FromTmem(sampledTex[0], imageSrc, imageSrcOdd, imageS, imageT, imageWidth);
+			TexDecoder_DecodeTexelRGBA8FromTmem(sampledTex[1], imageSrc, imageSrcOdd, imageSPlus1, imageT, imageWidth);
+			TexDecoder_DecodeTexelRGBA8FromTmem(sampledTex[2], imageSrc, imageSrcOdd, imageS, imageTPlus1, imageWidth);
+			TexDecoder_DecodeTexelRGBA8FromTmem(sampledTex[3], imageSrc, imageSrcOdd, imageSPlus1, imageTPlus1, imageWidth);
 		}
 
+#if (defined(_M_X64) || defined(_M_IX86)) && !defined(_M_GENERIC)
+		// the weights are at most 128 * 128, the sums of the products are exact
+		__m128i texel = WeighTexels(sampledTex[0], sampledTex[1], (128 - fractS) * (128 - fractT), (fractS) * (128 - fractT));
+		texel = _mm_add_epi32(texel, WeighTexels(sampledTex[2], sampledTex[3], (128 - fractS) * (fractT), (fractS) * (fractT)));
+		StoreTexel(texel, 14, sample);
+#else
+		u32 texel[4];
+		SetTexel(sampledTex[0], texel, (128 - fractS) * (128 - fractT));
+		AddTexel(sampledTex[1], texel, (fractS) * (128 - fractT));
+		AddTexel(sampledTex[2], texel, (128 - fractS) * (fractT));
+		AddTexel(sampledTex[3], texel, (fractS) * (fractT));
+
 		sample[0] = (u8)(texel[0] >> 14);
 		sample[1] = (u8)(texel[1] >> 14);
 		sample[2] = (u8)(texel[2] >> 14);
 		sample[3] = (u8)(texel[3] >> 14);
+#endif
 	}
 	else
 	{
@@ -14,6 +14,10 @@
 
 #include "Vec3.h"
 
+#if (defined(_M_X64) || defined(_M_IX86)) && !defined(_M_GENERIC)
+#include <emmintrin.h>
+#endif
+
 
 namespace TransformUnit
 {
@@ -460,54 +464,662 @@ void TransformColor(const InputVertexData *src, OutputVertexData *dst)
 	}
 }
 
+void TransformTexGen(const TexMtxInfo &texinfo, u32 coordNum, bool specialCase, const InputVertexData *src, OutputVertexData *dst)
+{
+	switch (texinfo.texgentype)
+	{
+	case XF_TEXGEN_REGULAR:
+		TransformTexCoordRegular(texinfo, coordNum, specialCase, src, dst);
+		break;
+	case XF_TEXGEN_EMBOSS_MAP:
+		{
+			const LightPointer *light = (const LightPointer*)&swxfregs.lights[0x10*texinfo.embosslightshift];
+
+			Vec3 ldir = (light->pos - dst->mvPosition).normalized();
+			float d1 = ldir * dst->normal[1];
+			float d2 = ldir * dst->normal[2];
+
+			dst->texCoords[coordNum].x = dst->texCoords[texinfo.embosssourceshift].x + d1;
+			dst->texCoords[coordNum].y = dst->texCoords[texinfo.embosssourceshift].y + d2;
+			dst->texCoords[coordNum].z = dst->texCoords[texinfo.embosssourceshift].z;
+		}
+		break;
+	case XF_TEXGEN_COLOR_STRGBC0:
+		_assert_(texinfo.sourcerow == XF_SRCCOLORS_INROW);
+		_assert_(texinfo.inputform == XF_TEXINPUT_AB11);
+		dst->texCoords[coordNum].x = (float)dst->color[0][0] / 255.0f;
+		dst->texCoords[coordNum].y = (float)dst->color[0][1] / 255.0f;
+		dst->texCoords[coordNum].z = 1.0f;
+		break;
+	case XF_TEXGEN_COLOR_STRGBC1:
+		_assert_(texinfo.sourcerow == XF_SRCCOLORS_INROW);
+		_assert_(texinfo.inputform == XF_TEXINPUT_AB11);
+		dst->texCoords[coordNum].x = (float)dst->color[1][0] / 255.0f;
+		dst->texCoords[coordNum].y = (float)dst->color[1][1] / 255.0f;
+		dst->texCoords[coordNum].z = 1.0f;
+		break;
+	default:
+		ERROR_LOG(VIDEO, "Bad tex gen type %i", texinfo.texgentype);
+	}
+}
+
+void ScaleTexCoords(OutputVertexData *dst)
+{
+	for (u32 coordNum = 0; coordNum < swxfregs.numTexGens; coordNum++)
+	{
+		dst->texCoords[coordNum][0] *= (bpmem.texcoords[coordNum].s.scale_minus_1 + 1);
+		dst->texCoords[coordNum][1] *= (bpmem.texcoords[coordNum].t.scale_minus_1 + 1);
+	}
+}
+
 void TransformTexCoord(const InputVertexData *src, OutputVertexData *dst, bool specialCase)
 {
+	for (u32 coordNum = 0; coordNum < swxfregs.numTexGens; coordNum++)
+		TransformTexGen(swxfregs.texMtxInfo[coordNum], coordNum, specialCase, src, dst);
+
+	ScaleTexCoords(dst);
+}
+
+bool ReadsMissingNormals(bool hasNormal, bool nbt)
+{
+	if (hasNormal && nbt)
+		return false;
+
 	for (u32 coordNum = 0; coordNum < swxfregs.numTexGens; coordNum++)
 	{
-		const TexMtxInfo &texinfo = swxfregs.texMtxInfo[coordNum];
+		if (swxfregs.texMtxInfo[coordNum].texgentype == XF_TEXGEN_EMBOSS_MAP)
+			return true;
+	}
+
+	if (hasNormal)
+		return false;
+
+	for (u32 chan = 0; chan < swxfregs.nNumChans; chan++)
+	{
+		if ((swxfregs.color[chan].enablelighting && swxfregs.color[chan].GetFullLightMask()) ||
+			(swxfregs.alpha[chan].enablelighting && swxfregs.alpha[chan].GetFullLightMask()))
+			return true;
+	}
+
+	return false;
+}
+
+#if (defined(_M_X64) || defined(_M_IX86)) && !defined(_M_GENERIC)
 
-		switch (texinfo.texgentype)
+// A group of four vertices in structure of arrays form. Every operation below
+// is the per vertex one above with the same order of float operations, so the
+// batch gives bit-identical results as long as the normals it doesn't
+// transform aren't read (see ReadsMissingNormals).
+struct Vec3x4
+{
+	__m128 x, y, z;
+};
+
+// The matrices of the four vertices of a group, usually the same one
+struct Mat4
+{
+	const float *mat[4];
+	bool uniform;
+
+	void Set(const float *m0, const float *m1, const float *m2, const float *m3)
+	{
+		mat[0] = m0; mat[1] = m1; mat[2] = m2; mat[3] = m3;
+		uniform = m0 == m1 && m0 == m2 && m0 == m3;
+	}
+
+	__m128 operator [] (int i) const
+	{
+		if (uniform)
+			return _mm_set1_ps(mat[0][i]);
+		return _mm_setr_ps(mat[0][i], mat[1][i], mat[2][i], mat[3][i]);
+	}
+};
+
+// The batch, one entry per group
+static Vec3x4 s_mvPosition[MAX_BATCH_VERTICES / 4];
+static Vec3x4 s_normal[3][MAX_BATCH_VERTICES / 4];
+static __m128 s_lightCol[4][MAX_BATCH_VERTICES / 4]; // x, y, z, alpha
+
+static inline __m128 Dot(const Vec3x4 &a, const Vec3x4 &b)
+{
+	return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a.x, b.x), _mm_mul_ps(a.y, b.y)), _mm_mul_ps(a.z, b.z));
+}
+
+static inline __m128 Dot(const Vec3 &a, const Vec3x4 &b)
+{
+	return _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(a.x), b.x), _mm_mul_ps(_mm_set1_ps(a.y), b.y)), _mm_mul_ps(_mm_set1_ps(a.z), b.z));
+}
+
+static inline Vec3x4 Scale(const Vec3x4 &v, __m128 f)
+{
+	Vec3x4 result = { _mm_mul_ps(v.x, f), _mm_mul_ps(v.y, f), _mm_mul_ps(v.z, f) };
+	return result;
+}
+
+// Vec3::normalized, divides by multiplying with the reciprocal as well
+static inline Vec3x4 Normalized(const Vec3x4 &v)
+{
+	return Scale(v, _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(Dot(v, v))));
+}
+
+static inline Vec3x4 Sub(const Vec3 &a, const Vec3x4 &b)
+{
+	Vec3x4 result = { _mm_sub_ps(_mm_set1_ps(a.x), b.x), _mm_sub_ps(_mm_set1_ps(a.y), b.y), _mm_sub_ps(_mm_set1_ps(a.z), b.z) };
+	return result;
+}
+
+// max(0.0f, v), _mm_max_ps picks its second operand on NaN like max does
+static inline __m128 Max0(__m128 v)
+{
+	return _mm_max_ps(_mm_setzero_ps(), v);
+}
+
+static inline __m128 Select(__m128 mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static inline __m128 SafeDivide(__m128 n, __m128 d)
+{
+	__m128 zero = _mm_setzero_ps();
+	__m128 sign = _mm_and_ps(_mm_cmpgt_ps(n, zero), _mm_set1_ps(1.0f));
+	return Select(_mm_cmpeq_ps(d, zero), sign, _mm_div_ps(n, d));
+}
+
+static inline Vec3x4 Load(const Vec3 *v[4])
+{
+	Vec3x4 result = {
+		_mm_setr_ps(v[0]->x, v[1]->x, v[2]->x, v[3]->x),
+		_mm_setr_ps(v[0]->y, v[1]->y, v[2]->y, v[3]->y),
+		_mm_setr_ps(v[0]->z, v[1]->z, v[2]->z, v[3]->z)
+	};
+	return result;
+}
+
+static inline void Store(const Vec3x4 &v, Vec3 *dst[4], int count)
+{
+	GC_ALIGNED16(float x[4]);
+	GC_ALIGNED16(float y[4]);
+	GC_ALIGNED16(float z[4]);
+	_mm_store_ps(x, v.x);
+	_mm_store_ps(y, v.y);
+	_mm_store_ps(z, v.z);
+	for (int i = 0; i < count; i++)
+		dst[i]->set(x[i], y[i], z[i]);
+}
+
+static inline Vec3x4 MultiplyVec3Mat34(const Vec3x4 &v, const Mat4 &mat, int row)
+{
+	// row is 0 for the x, y and z rows of a 3x4 matrix, 1 to skip z
+	Vec3x4 result;
+	__m128 *out[3] = { &result.x, &result.y, &result.z };
+	for (int i = 0; i < 3 - row; i++)
+	{
+		__m128 r = _mm_add_ps(_mm_mul_ps(mat[i*4], v.x), _mm_mul_ps(mat[i*4+1], v.y));
+		r = _mm_add_ps(r, _mm_mul_ps(mat[i*4+2], v.z));
+		*out[i] = _mm_add_ps(r, mat[i*4+3]);
+	}
+	if (row)
+		result.z = _mm_set1_ps(1.0f);
+	return result;
+}
+
+static inline Vec3x4 MultiplyVec2Mat34(const Vec3x4 &v, const Mat4 &mat, int row)
+{
+	Vec3x4 result;
+	__m128 *out[3] = { &result.x, &result.y, &result.z };
+	for (int i = 0; i < 3 - row; i++)
+	{
+		__m128 r = _mm_add_ps(_mm_mul_ps(mat[i*4], v.x), _mm_mul_ps(mat[i*4+1], v.y));
+		r = _mm_add_ps(r, mat[i*4+2]);
+		*out[i] = _mm_add_ps(r, mat[i*4+3]);
+	}
+	if (row)
+		result.z = _mm_set1_ps(1.0f);
+	return result;
+}
+
+static inline Vec3x4 MultiplyVec3Mat33(const Vec3x4 &v, const Mat4 &mat)
+{
+	Vec3x4 result;
+	__m128 *out[3] = { &result.x, &result.y, &result.z };
+	for (int i = 0; i < 3; i++)
+	{
+		__m128 r = _mm_add_ps(_mm_mul_ps(mat[i*3], v.x), _mm_mul_ps(mat[i*3+1], v.y));
+		*out[i] = _mm_add_ps(r, _mm_mul_ps(mat[i*3+2], v.z));
+	}
+	return result;
+}
+
+static void TransformPositionBatch(const InputVertexData *src, OutputVertexData *dst, int count)
+{
+	const float *proj = swxfregs.projection.rawProjection;
+	const bool perspective = swxfregs.projection.type == GX_PERSPECTIVE;
+
+	for (int g = 0; g * 4 < count; g++)
+	{
+		const InputVertexData *in[4];
+		const Vec3 *pos[4];
+		Vec3 *mvPos[4];
+		for (int i = 0; i < 4; i++)
 		{
-		case XF_TEXGEN_REGULAR:
-			TransformTexCoordRegular(texinfo, coordNum, specialCase, src, dst);
-			break;
-		case XF_TEXGEN_EMBOSS_MAP:
+			in[i] = &src[std::min(g * 4 + i, count - 1)];
+			pos[i] = &in[i]->position;
+			mvPos[i] = &dst[std::min(g * 4 + i, count - 1)].mvPosition;
+		}
+
+		Mat4 mat;
+		mat.Set((const float*)&swxfregs.posMatrices[in[0]->posMtx * 4], (const float*)&swxfregs.posMatrices[in[1]->posMtx * 4],
+			(const float*)&swxfregs.posMatrices[in[2]->posMtx * 4], (const float*)&swxfregs.posMatrices[in[3]->posMtx * 4]);
+
+		const Vec3x4 mv = MultiplyVec3Mat34(Load(pos), mat, 0);
+		s_mvPosition[g] = mv;
+		const int n = std::min(count - g * 4, 4);
+		Store(mv, mvPos, n);
+
+		__m128 projected[4];
+		if (perspective)
+		{
+			projected[0] = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(proj[0]), mv.x), _mm_mul_ps(_mm_set1_ps(proj[1]), mv.z));
+			projected[1] = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(proj[2]), mv.y), _mm_mul_ps(_mm_set1_ps(proj[3]), mv.z));
+			projected[2] = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(proj[4]), mv.z), _mm_set1_ps(proj[5])), _mm_set1_ps(1.0f - (float)1e-7));
+			projected[3] = _mm_xor_ps(mv.z, _mm_set1_ps(-0.0f));
+		}
+		else
+		{
+			projected[0] = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(proj[0]), mv.x), _mm_set1_ps(proj[1]));
+			projected[1] = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(proj[2]), mv.y), _mm_set1_ps(proj[3]));
+			projected[2] = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(proj[4]), mv.z), _mm_set1_ps(proj[5]));
+			projected[3] = _mm_set1_ps(1.0f);
+		}
+
+		// transposed, one vertex per register
+		_MM_TRANSPOSE4_PS(projected[0], projected[1], projected[2], projected[3]);
+		for (int i = 0; i < n; i++)
+			_mm_storeu_ps(&dst[g * 4 + i].projectedPosition.x, projected[i]);
+	}
+}
+
+static void TransformNormalBatch(const InputVertexData *src, bool nbt, OutputVertexData *dst, int count)
+{
+	for (int g = 0; g * 4 < count; g++)
+	{
+		const InputVertexData *in[4];
+		OutputVertexData *out[4];
+		for (int i = 0; i < 4; i++)
+		{
+			in[i] = &src[std::min(g * 4 + i, count - 1)];
+			out[i] = &dst[std::min(g * 4 + i, count - 1)];
+		}
+		const int n = std::min(count - g * 4, 4);
+
+		Mat4 mat;
+		mat.Set((const float*)&swxfregs.normalMatrices[(in[0]->posMtx & 31) * 3], (const float*)&swxfregs.normalMatrices[(in[1]->posMtx & 31) * 3],
+			(const float*)&swxfregs.normalMatrices[(in[2]->posMtx & 31) * 3], (const float*)&swxfregs.normalMatrices[(in[3]->posMtx & 31) * 3]);
+
+		for (int k = 0; k < (nbt ? 3 : 1); k++)
+		{
+			const Vec3 *normal[4] = { &in[0]->normal[k], &in[1]->normal[k], &in[2]->normal[k], &in[3]->normal[k] };
+			Vec3 *outNormal[4] = { &out[0]->normal[k], &out[1]->normal[k], &out[2]->normal[k], &out[3]->normal[k] };
+
+			Vec3x4 v = MultiplyVec3Mat33(Load(normal), mat);
+			if (k == 0)
+				v = Normalized(v);
+			s_normal[k][g] = v;
+			Store(v, outNormal, n);
+		}
+	}
+}
+
+// The batch keeps whatever the output vertices had in the normals that
+// weren't transformed, like the per vertex path does
+static void LoadNormalBatch(const OutputVertexData *dst, int count, int first)
+{
+	for (int g = 0; g * 4 < count; g++)
+	{
+		for (int k = first; k < 3; k++)
+		{
+			const Vec3 *normal[4];
+			for (int i = 0; i < 4; i++)
+				normal[i] = &dst[std::min(g * 4 + i, count - 1)].normal[k];
+			s_normal[k][g] = Load(normal);
+		}
+	}
+}
+
+// Adds one light to s_lightCol, LightColor and LightAlpha for the whole batch
+static void LightBatch(u8 lightNum, const LitChannel &chan, bool alpha, int count)
+{
+	const LightPointer *light = (const LightPointer*)&swxfregs.lights[0x10*lightNum];
+
+	if (chan.diffusefunc != LIGHTDIF_NONE && chan.diffusefunc != LIGHTDIF_SIGN && chan.diffusefunc != LIGHTDIF_CLAMP)
+	{
+		_assert_(0);
+		return;
+	}
+
+	for (int g = 0; g * 4 < count; g++)
+	{
+		const Vec3x4 &pos = s_mvPosition[g];
+		const Vec3x4 &normal = s_normal[0][g];
+		__m128 scale; // of the light color, in the order of operations of LightColor
+		__m128 alphaAttn = _mm_set1_ps(1.0f);
+
+		if (!(chan.attnfunc & 1))
+		{
+			if (chan.diffusefunc == LIGHTDIF_NONE)
 			{
-				const LightPointer *light = (const LightPointer*)&swxfregs.lights[0x10*texinfo.embosslightshift];
+				// AddIntegerColor
+				if (alpha)
+				{
+					s_lightCol[3][g] = _mm_add_ps(s_lightCol[3][g], _mm_set1_ps(light->color[0]));
+				}
+				else
+				{
+					for (int c = 0; c < 3; c++)
+						s_lightCol[c][g] = _mm_add_ps(s_lightCol[c][g], _mm_set1_ps(light->color[c + 1]));
+				}
+				continue;
+			}
 
-				Vec3 ldir = (light->pos - dst->mvPosition).normalized();
-				float d1 = ldir * dst->normal[1];
-				float d2 = ldir * dst->normal[2];
+			scale = Dot(Normalized(Sub(light->pos, pos)), normal);
+			if (chan.diffusefunc == LIGHTDIF_CLAMP)
+				scale = Max0(scale);
+		}
+		else
+		{
+			Vec3x4 ldir;
+			__m128 attn;
+
+			if (chan.attnfunc == 3) // spot
+			{
+				ldir = Sub(light->pos, pos);
+				__m128 dist2 = Dot(ldir, ldir);
+				__m128 dist = _mm_sqrt_ps(dist2);
+				ldir = Scale(ldir, _mm_div_ps(_mm_set1_ps(1.0f), dist));
+				attn = Max0(Dot(light->dir, ldir));
 
-				dst->texCoords[coordNum].x = dst->texCoords[texinfo.embosssourceshift].x + d1;
-				dst->texCoords[coordNum].y = dst->texCoords[texinfo.embosssourceshift].y + d2;
-				dst->texCoords[coordNum].z = dst->texCoords[texinfo.embosssourceshift].z;
+				__m128 cosAtt = _mm_add_ps(_mm_add_ps(_mm_set1_ps(light->cosatt.x), _mm_mul_ps(_mm_set1_ps(light->cosatt.y), attn)),
+					_mm_mul_ps(_mm_mul_ps(_mm_set1_ps(light->cosatt.z), attn), attn));
+				__m128 distAtt = _mm_add_ps(_mm_add_ps(_mm_set1_ps(light->distatt.x), _mm_mul_ps(_mm_set1_ps(light->distatt.y), dist)),
+					_mm_mul_ps(_mm_set1_ps(light->distatt.z), dist2));
+				attn = SafeDivide(Max0(cosAtt), distAtt);
+			}
+			else // specular
+			{
+				// the compare is done in double precision
+				GC_ALIGNED16(float lightDot[4]);
+				_mm_store_ps(lightDot, Dot(light->pos, normal));
+				__m128 visible = _mm_castsi128_ps(_mm_setr_epi32(lightDot[0] > -655.36 ? -1 : 0, lightDot[1] > -655.36 ? -1 : 0,
+					lightDot[2] > -655.36 ? -1 : 0, lightDot[3] > -655.36 ? -1 : 0));
+				attn = _mm_and_ps(visible, Max0(Dot(light->dir, normal)));
+				ldir.x = _mm_set1_ps(1.0f);
+				ldir.y = attn;
+				ldir.z = _mm_mul_ps(attn, attn);
+
+				__m128 cosAtt = Dot(light->cosatt, ldir);
+				if (!alpha)
+					cosAtt = Max0(cosAtt);
+				attn = SafeDivide(Max0(cosAtt), Dot(light->distatt, ldir));
+			}
+
+			if (chan.diffusefunc == LIGHTDIF_NONE)
+			{
+				scale = attn;
+			}
+			else
+			{
+				__m128 difAttn = Dot(ldir, normal);
+				if (chan.diffusefunc == LIGHTDIF_CLAMP)
+					difAttn = Max0(difAttn);
+
+				if (alpha)
+				{
+					// color[0] * attn * difAttn
+					alphaAttn = difAttn;
+					scale = attn;
+				}
+				else
+				{
+					scale = _mm_mul_ps(attn, difAttn);
+				}
+			}
+		}
+
+		if (alpha)
+		{
+			__m128 add = _mm_mul_ps(_mm_set1_ps(light->color[0]), scale);
+			if (chan.attnfunc & 1 && chan.diffusefunc != LIGHTDIF_NONE)
+				add = _mm_mul_ps(add, alphaAttn);
+			s_lightCol[3][g] = _mm_add_ps(s_lightCol[3][g], add);
+		}
+		else
+		{
+			for (int c = 0; c < 3; c++)
+				s_lightCol[c][g] = _mm_add_ps(s_lightCol[c][g], _mm_mul_ps(_mm_set1_ps(light->color[c + 1]), scale));
+		}
+	}
+}
+
+static void TransformColorBatch(const InputVertexData *src, OutputVertexData *dst, int count)
+{
+	for (u32 chan = 0; chan < swxfregs.nNumChans; chan++)
+	{
+		LitChannel &colorchan = swxfregs.color[chan];
+		LitChannel &alphachan = swxfregs.alpha[chan];
+
+		if (colorchan.enablelighting || alphachan.enablelighting)
+		{
+			// ambient
+			for (int g = 0; g * 4 < count; g++)
+			{
+				GC_ALIGNED16(float amb[4][4]);
+				for (int i = 0; i < 4; i++)
+				{
+					const InputVertexData &in = src[std::min(g * 4 + i, count - 1)];
+					const u8 *ambColor = (const u8*)&swxfregs.ambColor[chan];
+					amb[0][i] = colorchan.ambsource ? in.color[chan][1] : ambColor[1];
+					amb[1][i] = colorchan.ambsource ? in.color[chan][2] : ambColor[2];
+					amb[2][i] = colorchan.ambsource ? in.color[chan][3] : ambColor[3];
+					amb[3][i] = alphachan.ambsource ? in.color[chan][0] : (float)(swxfregs.ambColor[chan] & 0xff);
+				}
+				for (int c = 0; c < 4; c++)
+					s_lightCol[c][g] = _mm_load_ps(amb[c]);
+			}
+
+			if (colorchan.enablelighting)
+			{
+				u8 mask = colorchan.GetFullLightMask();
+				for (int i = 0; i < 8; ++i)
+				{
+					if (mask&(1<<i))
+						LightBatch(i, colorchan, false, count);
+				}
+			}
+
+			if (alphachan.enablelighting)
+			{
+				u8 mask = alphachan.GetFullLightMask();
+				for (int i = 0; i < 8; ++i)
+				{
+					if (mask&(1<<i))
+						LightBatch(i, alphachan, true, count);
+				}
+			}
+		}
+
+		for (int v = 0; v < count; v++)
+		{
+			// abgr
+			u8 matcolor[4];
+			u8 chancolor[4];
+
+			// the lights of this vertex
+			const int g = v / 4;
+			GC_ALIGNED16(float lightCol[4][4]);
+			if (colorchan.enablelighting || alphachan.enablelighting)
+			{
+				for (int c = 0; c < 4; c++)
+					_mm_store_ps(lightCol[c], s_lightCol[c][g]);
+			}
+
+			// color
+			if (colorchan.matsource)
+				*(u32*)matcolor = *(u32*)src[v].color[chan];  // vertex
+			else
+				*(u32*)matcolor = swxfregs.matColor[chan];
+
+			if (colorchan.enablelighting)
+			{
+				float inv = 1.0f / 255.0f;
+				chancolor[1] = (u8)(matcolor[1] * Clamp(lightCol[0][v & 3] * inv, 0.0f, 1.0f));
+				chancolor[2] = (u8)(matcolor[2] * Clamp(lightCol[1][v & 3] * inv, 0.0f, 1.0f));
+				chancolor[3] = (u8)(matcolor[3] * Clamp(lightCol[2][v & 3] * inv, 0.0f, 1.0f));
+			}
+			else
+			{
+				*(u32*)chancolor = *(u32*)matcolor;
+			}
+
+			// alpha
+			if (alphachan.matsource)
+				matcolor[0] = src[v].color[chan][0];  // vertex
+			else
+				matcolor[0] = swxfregs.matColor[chan] & 0xff;
+
+			if (alphachan.enablelighting)
+				chancolor[0] = (u8)(matcolor[0] * Clamp(lightCol[3][v & 3] / 255.0f, 0.0f, 1.0f));
+			else
+				chancolor[0] = matcolor[0];
+
+			// abgr -> rgba
+			*(u32*)dst[v].color[chan] = Common::swap32(*(u32*)chancolor);
+		}
+	}
+}
+
+static void TransformTexCoordRegularBatch(const TexMtxInfo &texinfo, int coordNum, bool specialCase, const InputVertexData *src, OutputVertexData *dst, int count)
+{
+	for (int g = 0; g * 4 < count; g++)
+	{
+		const InputVertexData *in[4];
+		Vec3 *out[4];
+		const Vec3 *srcCoord[4];
+		for (int i = 0; i < 4; i++)
+		{
+			in[i] = &src[std::min(g * 4 + i, count - 1)];
+			out[i] = &dst[std::min(g * 4 + i, count - 1)].texCoords[coordNum];
+
+			switch (texinfo.sourcerow)
+			{
+				case XF_SRCGEOM_INROW:
+					srcCoord[i] = &in[i]->position;
+					break;
+				case XF_SRCNORMAL_INROW:
+					srcCoord[i] = &in[i]->normal[0];
+					break;
+				case XF_SRCBINORMAL_T_INROW:
+					srcCoord[i] = &in[i]->normal[1];
+					break;
+				case XF_SRCBINORMAL_B_INROW:
+					srcCoord[i] = &in[i]->normal[2];
+					break;
+				default:
+					_assert_(texinfo.sourcerow >= XF_SRCTEX0_INROW && texinfo.sourcerow <= XF_SRCTEX7_INROW);
+					srcCoord[i] = (const Vec3*)in[i]->texCoords[texinfo.sourcerow - XF_SRCTEX0_INROW];
+					break;
+			}
+		}
+
+		Mat4 mat;
+		mat.Set((const float*)&swxfregs.posMatrices[in[0]->texMtx[coordNum] * 4], (const float*)&swxfregs.posMatrices[in[1]->texMtx[coordNum] * 4],
+			(const float*)&swxfregs.posMatrices[in[2]->texMtx[coordNum] * 4], (const float*)&swxfregs.posMatrices[in[3]->texMtx[coordNum] * 4]);
+
+		const Vec3x4 coord = Load(srcCoord);
+		const bool ab11 = texinfo.inputform == XF_TEXINPUT_AB11;
+		Vec3x4 result;
+		if (texinfo.projection == XF_TEXPROJ_ST)
+			result = (ab11 || specialCase) ? MultiplyVec2Mat34(coord, mat, 1) : MultiplyVec3Mat34(coord, mat, 1);
+		else
+			result = ab11 ? MultiplyVec2Mat34(coord, mat, 0) : MultiplyVec3Mat34(coord, mat, 0);
+
+		if (swxfregs.dualTexTrans)
+		{
+			const PostMtxInfo &postInfo = swxfregs.postMtxInfo[coordNum];
+			Mat4 postMat;
+			const float *post = (const float*)&swxfregs.postMatrices[postInfo.index * 4];
+			postMat.Set(post, post, post, post);
+
+			if (specialCase)
+			{
+				// no normalization
+				// q of input is 1
+				// q of output is unknown
+				result = MultiplyVec2Mat34(result, postMat, 1);
+			}
+			else
+			{
+				if (postInfo.normalize)
+					result = Normalized(result);
+				result = MultiplyVec3Mat34(result, postMat, 0);
 			}
-			break;
-		case XF_TEXGEN_COLOR_STRGBC0:
-			_assert_(texinfo.sourcerow == XF_SRCCOLORS_INROW);
-			_assert_(texinfo.inputform == XF_TEXINPUT_AB11);
-			dst->texCoords[coordNum].x = (float)dst->color[0][0] / 255.0f;
-			dst->texCoords[coordNum].y = (float)dst->color[0][1] / 255.0f;
-			dst->texCoords[coordNum].z = 1.0f;
-			break;
-		case XF_TEXGEN_COLOR_STRGBC1:
-			_assert_(texinfo.sourcerow == XF_SRCCOLORS_INROW);
-			_assert_(texinfo.inputform == XF_TEXINPUT_AB11);
-			dst->texCoords[coordNum].x = (float)dst->color[1][0] / 255.0f;
-			dst->texCoords[coordNum].y = (float)dst->color[1][1] / 255.0f;
-			dst->texCoords[coordNum].z = 1.0f;
-			break;
-		default:
-			ERROR_LOG(VIDEO, "Bad tex gen type %i", texinfo.texgentype);
 		}
+
+		Store(result, out, std::min(count - g * 4, 4));
 	}
+}
+
+void TransformBatch(const InputVertexData *src, OutputVertexData *dst, int count, bool hasNormal, bool nbt, bool specialCase)
+{
+	_assert_(count > 0 && count <= MAX_BATCH_VERTICES);
+
+	TransformPositionBatch(src, dst, count);
+
+	if (hasNormal)
+	{
+		TransformNormalBatch(src, nbt, dst, count);
+		if (!nbt)
+			LoadNormalBatch(dst, count, 1);
+	}
+	else
+	{
+		LoadNormalBatch(dst, count, 0);
+	}
+
+	TransformColorBatch(src, dst, count);
 
 	for (u32 coordNum = 0; coordNum < swxfregs.numTexGens; coordNum++)
 	{
-		dst->texCoords[coordNum][0] *= (bpmem.texcoords[coordNum].s.scale_minus_1 + 1);
-		dst->texCoords[coordNum][1] *= (bpmem.texcoords[coordNum].t.scale_minus_1 + 1);
+		const TexMtxInfo &texinfo = swxfregs.texMtxInfo[coordNum];
+		if (texinfo.texgentype == XF_TEXGEN_REGULAR)
+		{
+			TransformTexCoordRegularBatch(texinfo, coordNum, specialCase, src, dst, count);
+		}
+		else
+		{
+			for (int v = 0; v < count; v++)
+				TransformTexGen(texinfo, coordNum, specialCase, &src[v], &dst[v]);
+		}
+	}
+
+	for (int v = 0; v < count; v++)
+		ScaleTexCoords(&dst[v]);
+}
+
+#else
+
+void TransformBatch(const InputVertexData *src, OutputVertexData *dst, int count, bool hasNormal, bool nbt, bool specialCase)
+{
+	for (int v = 0; v < count; v++)
+	{
+		TransformPosition(&src[v], &dst[v]);
+		if (hasNormal)
+			TransformNormal(&src[v], nbt, &dst[v]);
+		TransformColor(&src[v], &dst[v]);
+		TransformTexCoord(&src[v], &dst[v], specialCase);
 	}
 }
 
+#endif
+
 }
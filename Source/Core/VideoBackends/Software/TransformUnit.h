@@ -19,6 +19,14 @@ namespace TransformUnit
 	void TransformNormal(const InputVertexData *src, bool nbt, OutputVertexData *dst);
 	void TransformColor(const InputVertexData *src, OutputVertexData *dst);
 	void TransformTexCoord(const InputVertexData *src, OutputVertexData *dst, bool specialCase);
+
+	// Does all of the above for count vertices at once, with the same results
+	enum { MAX_BATCH_VERTICES = 64 };
+	void TransformBatch(const InputVertexData *src, OutputVertexData *dst, int count, bool hasNormal, bool nbt, bool specialCase);
+
+	// Lighting and emboss read the normals a vertex doesn't have from whatever
+	// the output vertex held, so those vertices have to be transformed in place
+	bool ReadsMissingNormals(bool hasNormal, bool nbt);
 }
 
 #endif
@@ -71,6 +71,9 @@ VideoConfigDialog::VideoConfigDialog(wxWindow* parent, const std::string& title,
 
 	// xfb
 	szr_rendering->Add(new SettingCheckBox(page_general, wxT("Bypass XFB"), wxT(""), vconfig.bBypassXFB));
+
+	// tev
+	szr_rendering->Add(new SettingCheckBox(page_general, wxT("Compile TEV stages"), wxT(""), vconfig.bTevJit));
 	}
 
 	// - info
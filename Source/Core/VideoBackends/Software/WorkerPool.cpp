@@ -0,0 +1,105 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include "Common.h"
+#include "CPUDetect.h"
+#include "Thread.h"
+
+#include "WorkerPool.h"
+
+#define MAX_HELPERS 7
+
+namespace WorkerPool
+{
+
+static std::thread s_threads[MAX_HELPERS];
+static Common::Event s_start[MAX_HELPERS];
+static Common::Event s_done[MAX_HELPERS];
+static int s_numHelpers = 0;
+static volatile bool s_running = false;
+// Held by the thread the helpers are working for
+static std::mutex s_runMutex;
+
+struct Job
+{
+	JobFunc func;
+	void *arg;
+	int jobs;
+};
+
+// Set by the owner of s_runMutex before it starts the helpers, which only
+// read it after s_start
+static const Job *s_job = NULL;
+
+static void HelperThread(int helper)
+{
+	char name[32];
+	sprintf(name, "SW Worker %i", helper);
+	Common::SetCurrentThreadName(name);
+
+	while (true)
+	{
+		s_start[helper].Wait();
+		if (!s_running)
+			break;
+
+		s_job->func(s_job->arg, helper + 1, s_job->jobs);
+		s_done[helper].Set();
+	}
+}
+
+void Init()
+{
+	s_numHelpers = std::min(std::max(cpu_info.num_cores - 1, 0), MAX_HELPERS);
+	s_running = true;
+
+	for (int i = 0; i < s_numHelpers; i++)
+		s_threads[i] = std::thread(HelperThread, i);
+}
+
+void Shutdown()
+{
+	s_running = false;
+
+	for (int i = 0; i < s_numHelpers; i++)
+	{
+		s_start[i].Set();
+		s_threads[i].join();
+	}
+	s_numHelpers = 0;
+}
+
+int GetMaxJobs()
+{
+	return s_numHelpers + 1;
+}
+
+void Run(JobFunc func, void *arg, int jobs)
+{
+	// The XFB is converted on the CPU thread, if the helpers are busy with the
+	// other thread the caller does all jobs itself instead of waiting
+	std::unique_lock<std::mutex> lk(s_runMutex, std::try_to_lock);
+	if (!lk.owns_lock())
+	{
+		for (int job = 0; job < jobs; job++)
+			func(arg, job, jobs);
+		return;
+	}
+
+	int helpers = std::min(jobs - 1, s_numHelpers);
+	const Job current = { func, arg, jobs };
+	s_job = &current;
+
+	for (int i = 0; i < helpers; i++)
+		s_start[i].Set();
+
+	func(arg, 0, jobs);
+	for (int job = helpers + 1; job < jobs; job++)
+		func(arg, job, jobs);
+
+	for (int i = 0; i < helpers; i++)
+		s_done[i].Wait();
+}
+
+}
@@ -0,0 +1,29 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#ifndef _WORKERPOOL_H_
+#define _WORKERPOOL_H_
+
+#include "CommonTypes.h"
+
+// Helper threads that independent slices of one operation are handed to, like
+// the rows of blocks of an EFB copy. Only one caller at a time gets the helpers.
+namespace WorkerPool
+{
+	// Processes slice job of jobs
+	typedef void (*JobFunc)(void *arg, int job, int jobs);
+
+	void Init();
+	void Shutdown();
+
+	// Number of jobs that can run at the same time, the calling thread included
+	int GetMaxJobs();
+
+	// Runs func for every job and returns when all of them are done. Job 0 and
+	// the jobs beyond GetMaxJobs() run on the calling thread, all of them do if
+	// another thread is using the helpers.
+	void Run(JobFunc func, void *arg, int jobs);
+}
+
+#endif
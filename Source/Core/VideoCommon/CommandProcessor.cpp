@@ -423,6 +423,8 @@ void Write16(const u16 _Value, const u32 _Address)
 
 	if (!IsOnThread())
 		RunGpu();
+	else
+		WakeGpuThread();
 }
 
 void Read32(u32& _rReturnValue, const u32 _Address)
@@ -472,6 +474,8 @@ void STACKALIGN GatherPipeBursted()
 
 	if (!IsOnThread())
 		RunGpu();
+	else
+		WakeGpuThread();
 
 	_assert_msg_(COMMANDPROCESSOR, fifo.CPReadWriteDistance <= fifo.CPEnd - fifo.CPBase,
 	"FIFO is overflowed by GatherPipe !\nCPU thread is too fast!");
@@ -497,6 +501,8 @@ void UpdateInterrupts(u64 userdata)
 		ProcessorInterface::SetInterrupt(INT_CAUSE_CP, false);
 	}
 	interruptWaiting = false;
+	if (IsOnThread())
+		WakeGpuThread();
 }
 
 void UpdateInterruptsFromVideoBackend(u64 userdata)
@@ -695,6 +701,9 @@ void Update()
 		Common::YieldCPU();
 
 	if (fifo.isGpuReadingData)
+	{
 		Common::AtomicAdd(VITicks, SystemTimers::GetTicksPerSecond() / 10000);
+		WakeGpuThread();
+	}
 }
 } // end of namespace CommandProcessor
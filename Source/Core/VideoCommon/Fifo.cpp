@@ -14,6 +14,7 @@
 #include "HW/Memmap.h"
 #include "Core.h"
 #include "CoreTiming.h"
+#include "Timer.h"
 
 volatile bool g_bSkipCurrentFrame = false;
 extern u8* g_pVideoData;
@@ -26,6 +27,29 @@ static std::mutex m_csHWVidOccupied;
 // STATE_TO_SAVE
 static u8 *videoBuffer;
 static int size = 0;
+
+// When the FIFO runs dry the GPU thread spins for a while, since new data
+// usually arrives within microseconds, and then parks on s_gpuWakeEvent.
+// The spin time adapts: it grows when spinning caught new work and shrinks
+// whenever the thread had to park anyway.
+enum
+{
+	GPU_SPIN_MIN_NS = 10000,
+	GPU_SPIN_MAX_NS = 1000000,
+	// Bounds the latency of anything that forgets to call WakeGpuThread and
+	// keeps the backend's message pump alive while the guest is idle
+	GPU_PARK_TIMEOUT_MS = 1,
+	// Upper limit of FIFO data handed to the decoder at once
+	GPU_MAX_READ_SIZE = 64 * 1024,
+};
+
+static volatile u32 s_gpuSleeping = 0;
+static volatile u32 s_gpuWakeRequests = 0;
+static Common::Event s_gpuWakeEvent;
+
+static u64 s_gpuBusyTime = 0;
+static u64 s_gpuIdleTime = 0;
+static u32 s_gpuParkCount = 0;
 }  // namespace
 
 void Fifo_DoState(PointerWrap &p)
@@ -95,11 +119,40 @@ void ExitGpuLoop()
 	// Terminate GPU thread loop
 	GpuRunningState = false;
 	EmuRunningState = true;
+	WakeGpuThread();
 }
 
 void EmulatorState(bool running)
 {
 	EmuRunningState = running;
+	WakeGpuThread();
+}
+
+void WakeGpuThread()
+{
+	// The increment is a full barrier, pairs with the one in ParkGpuThread
+	Common::AtomicIncrement(s_gpuWakeRequests);
+	if (Common::AtomicLoad(s_gpuSleeping))
+		s_gpuWakeEvent.Set();
+}
+
+static void ParkGpuThread(u32 wakeRequests)
+{
+	Common::AtomicIncrement(s_gpuSleeping);
+	// Anything that happened since wakeRequests was read has bumped the counter
+	if (Common::AtomicLoad(s_gpuWakeRequests) == wakeRequests)
+	{
+		++s_gpuParkCount;
+		s_gpuWakeEvent.WaitFor(GPU_PARK_TIMEOUT_MS);
+	}
+	Common::AtomicDecrement(s_gpuSleeping);
+}
+
+void Fifo_GetGpuThreadStats(u64 &busyNs, u64 &idleNs, u32 &parkCount)
+{
+	busyNs = s_gpuBusyTime;
+	idleNs = s_gpuIdleTime;
+	parkCount = s_gpuParkCount;
 }
 
 
@@ -138,8 +191,15 @@ void RunGpuLoop()
 	SCPFifoStruct &fifo = CommandProcessor::fifo;
 	u32 cyclesExecuted = 0;
 
+	u64 spinTime = GPU_SPIN_MIN_NS;
+	u64 lastTime = Common::Timer::GetTimeNs();
+	u64 idleSince = 0;
+
 	while (GpuRunningState)
 	{
+		u32 wakeRequests = Common::AtomicLoad(s_gpuWakeRequests);
+		bool didWork = false;
+
 		g_video_backend->PeekMessages();
 
 		VideoFifo_CheckAsyncRequest();
@@ -153,21 +213,30 @@ void RunGpuLoop()
 		{
 			fifo.isGpuReadingData = true;
 			CommandProcessor::isPossibleWaitingSetDrawDone = fifo.bFF_GPLinkEnable ? true : false;
+			didWork = true;
 
 			if (!Core::g_CoreStartupParameter.bSyncGPU || Common::AtomicLoad(CommandProcessor::VITicks) > CommandProcessor::m_cpClockOrigin)
 			{
 				u32 readPtr = fifo.CPReadPointer;
 				u8 *uData = Memory::GetPointer(readPtr);
 
-				if (readPtr == fifo.CPEnd)
+				// Take everything up to the end of the ring buffer in one go, unless
+				// GPU timing or a breakpoint require going 32 bytes at a time
+				u32 readSize = 32;
+				if (!Core::g_CoreStartupParameter.bSyncGPU && !fifo.bFF_BPEnable)
+				{
+					u32 distance = Common::AtomicLoad(fifo.CPReadWriteDistance);
+					readSize = std::min(std::min(distance, fifo.CPEnd - readPtr + 32), (u32)GPU_MAX_READ_SIZE);
+				}
+
+				readPtr += readSize;
+				if (readPtr > fifo.CPEnd)
 					readPtr = fifo.CPBase;
-				else
-					readPtr += 32;
 
-				_assert_msg_(COMMANDPROCESSOR, (s32)fifo.CPReadWriteDistance - 32 >= 0 ,
-					"Negative fifo.CPReadWriteDistance = %i in FIFO Loop !\nThat can produce instability in the game. Please report it.", fifo.CPReadWriteDistance - 32);
+				_assert_msg_(COMMANDPROCESSOR, (s32)fifo.CPReadWriteDistance - (s32)readSize >= 0 ,
+					"Negative fifo.CPReadWriteDistance = %i in FIFO Loop !\nThat can produce instability in the game. Please report it.", fifo.CPReadWriteDistance - readSize);
 
-				ReadDataFromFifo(uData, 32);
+				ReadDataFromFifo(uData, readSize);
 
 				cyclesExecuted = OpcodeDecoder_Run(g_bSkipCurrentFrame);
 
@@ -175,7 +244,7 @@ void RunGpuLoop()
 					Common::AtomicAdd(CommandProcessor::VITicks, -(s32)cyclesExecuted);
 
 				Common::AtomicStore(fifo.CPReadPointer, readPtr);
-				Common::AtomicAdd(fifo.CPReadWriteDistance, -32);
+				Common::AtomicAdd(fifo.CPReadWriteDistance, -(s32)readSize);
 				if((GetVideoBufferEndPtr() - g_pVideoData) == 0)
 					Common::AtomicStore(fifo.SafeCPReadPointer, fifo.CPReadPointer);
 			}
@@ -191,14 +260,35 @@ void RunGpuLoop()
 
 		fifo.isGpuReadingData = false;
 
+		u64 now = Common::Timer::GetTimeNs();
+		if (didWork)
+			s_gpuBusyTime += now - lastTime;
+		else
+			s_gpuIdleTime += now - lastTime;
+		lastTime = now;
+
 		if (EmuRunningState)
 		{
 			// NOTE(jsd): Calling SwitchToThread() on Windows 7 x64 is a hot spot, according to profiler.
 			// See https://docs.google.com/spreadsheet/ccc?key=0Ah4nh0yGtjrgdFpDeF9pS3V6RUotRVE3S3J4TGM1NlE#gid=0
 			// for benchmark details.
-#if 0
-			Common::YieldCPU();
-#endif
+			// So rather than yielding, spin for a short while and then park.
+			if (didWork)
+			{
+				if (idleSince)
+					spinTime = std::min(spinTime * 2, (u64)GPU_SPIN_MAX_NS);
+				idleSince = 0;
+			}
+			else if (!idleSince)
+			{
+				idleSince = now;
+			}
+			else if (now - idleSince > spinTime)
+			{
+				ParkGpuThread(wakeRequests);
+				spinTime = std::max(spinTime / 2, (u64)GPU_SPIN_MIN_NS);
+				idleSince = 0;
+			}
 		}
 		else
 		{
@@ -210,6 +300,8 @@ void RunGpuLoop()
 				Common::SleepCurrentThread(1);
 				m_csHWVidOccupied.lock();
 			}
+			idleSince = 0;
+			lastTime = Common::Timer::GetTimeNs();
 		}
 	}
 }
@@ -27,6 +27,9 @@ void RunGpu();
 void RunGpuLoop();
 void ExitGpuLoop();
 void EmulatorState(bool running);
+// Called whenever the GPU thread may have new work, cheap if it is running
+void WakeGpuThread();
+void Fifo_GetGpuThreadStats(u64 &busyNs, u64 &idleNs, u32 &parkCount);
 bool AtBreakpoint();
 void ResetVideoBuffer();
 void Fifo_SetRendering(bool bEnabled);
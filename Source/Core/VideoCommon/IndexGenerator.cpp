@@ -8,6 +8,11 @@
 #include "VideoConfig.h"
 #include "IndexGenerator.h"
 
+#if (defined(_M_X64) || defined(_M_IX86)) && !defined(_M_GENERIC)
+#include <emmintrin.h>
+#define INDEXGENERATOR_SSE2
+#endif
+
 //Init
 u16 *IndexGenerator::index_buffer_current;
 u16 *IndexGenerator::BASEIptr;
@@ -17,19 +22,23 @@ static const u16 s_primitive_restart = -1;
 
 static u16* (*primitive_table[8])(u16*, u32, u32);
 
-void IndexGenerator::Init()
+void IndexGenerator::Init(bool use_simd)
 {
+#ifndef INDEXGENERATOR_SSE2
+	use_simd = false;
+#endif
+
 	if(g_Config.backend_info.bSupportsPrimitiveRestart)
 	{
-		primitive_table[0] = IndexGenerator::AddQuads<true>;
-		primitive_table[2] = IndexGenerator::AddList<true>;
+		primitive_table[0] = use_simd ? IndexGenerator::AddQuadsSIMD<true> : IndexGenerator::AddQuads<true>;
+		primitive_table[2] = use_simd ? IndexGenerator::AddListSIMD<true> : IndexGenerator::AddList<true>;
 		primitive_table[3] = IndexGenerator::AddStrip<true>;
 		primitive_table[4] = IndexGenerator::AddFan<true>;
 	}
 	else
 	{
-		primitive_table[0] = IndexGenerator::AddQuads<false>;
-		primitive_table[2] = IndexGenerator::AddList<false>;
+		primitive_table[0] = use_simd ? IndexGenerator::AddQuadsSIMD<false> : IndexGenerator::AddQuads<false>;
+		primitive_table[2] = use_simd ? IndexGenerator::AddListSIMD<false> : IndexGenerator::AddList<false>;
 		primitive_table[3] = IndexGenerator::AddStrip<false>;
 		primitive_table[4] = IndexGenerator::AddFan<false>;
 	}
@@ -196,6 +205,107 @@ template <bool pr> u16* IndexGenerator::AddQuads(u16 *Iptr, u32 numVerts, u32 in
 	return Iptr;
 }
 
+/*
+ * SIMD kernels
+ *
+ * Lists and quads expand to the same index pattern for every block of
+ * primitives, only offset by the number of vertices in the block. The pattern
+ * is kept in registers and the step is added to every lane except the
+ * primitive restart ones. Whatever doesn't fill a whole block is left to the
+ * scalar code above.
+ */
+
+#ifdef INDEXGENERATOR_SSE2
+
+static const u16 RS = s_primitive_restart;
+
+// 8 triangles
+static const u16 GC_ALIGNED16(s_list_pattern[24]) = {
+	0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+	16, 17, 18, 19, 20, 21, 22, 23,
+};
+
+// 2 triangles
+static const u16 GC_ALIGNED16(s_list_pattern_pr[8]) = {
+	0, 1, 2, RS, 3, 4, 5, RS,
+};
+
+// 4 quads, as 012,023
+static const u16 GC_ALIGNED16(s_quad_pattern[24]) = {
+	0, 1, 2, 0, 2, 3, 4, 5, 6, 4, 6, 7,
+	8, 9, 10, 8, 10, 11, 12, 13, 14, 12, 14, 15,
+};
+
+// 8 quads, as strips 1203
+static const u16 GC_ALIGNED16(s_quad_pattern_pr[40]) = {
+	1, 2, 0, 3, RS, 5, 6, 4, 7, RS, 9, 10, 8, 11, RS, 13,
+	14, 12, 15, RS, 17, 18, 16, 19, RS, 21, 22, 20, 23, RS,
+	25, 26, 24, 27, RS, 29, 30, 28, 31, RS,
+};
+
+template <int vectors>
+static __forceinline u16* WritePattern(u16 *Iptr, const u16 *pattern, u32 blocks, u32 index, u32 step)
+{
+	const __m128i restart = _mm_set1_epi16(-1);
+	const __m128i base = _mm_set1_epi16((u16)index);
+	const __m128i block_step = _mm_set1_epi16((u16)step);
+
+	__m128i current[vectors];
+	__m128i increment[vectors];
+	for (int i = 0; i < vectors; ++i)
+	{
+		const __m128i p = _mm_load_si128((const __m128i*)pattern + i);
+		const __m128i is_restart = _mm_cmpeq_epi16(p, restart);
+		current[i] = _mm_add_epi16(p, _mm_andnot_si128(is_restart, base));
+		increment[i] = _mm_andnot_si128(is_restart, block_step);
+	}
+
+	for (u32 b = 0; b < blocks; ++b)
+	{
+		for (int i = 0; i < vectors; ++i)
+		{
+			_mm_storeu_si128((__m128i*)Iptr + i, current[i]);
+			current[i] = _mm_add_epi16(current[i], increment[i]);
+		}
+		Iptr += vectors * 8;
+	}
+	return Iptr;
+}
+
+template <bool pr> u16* IndexGenerator::AddListSIMD(u16 *Iptr, u32 numVerts, u32 index)
+{
+	const u32 block_verts = pr ? 6 : 24;
+	const u32 blocks = numVerts / block_verts;
+	if (blocks == 0)
+		return AddList<pr>(Iptr, numVerts, index);
+
+	if (pr)
+		Iptr = WritePattern<1>(Iptr, s_list_pattern_pr, blocks, index, block_verts);
+	else
+		Iptr = WritePattern<3>(Iptr, s_list_pattern, blocks, index, block_verts);
+
+	const u32 done = blocks * block_verts;
+	return AddList<pr>(Iptr, numVerts - done, index + done);
+}
+
+template <bool pr> u16* IndexGenerator::AddQuadsSIMD(u16 *Iptr, u32 numVerts, u32 index)
+{
+	const u32 block_verts = pr ? 32 : 16;
+	const u32 blocks = numVerts / block_verts;
+	if (blocks == 0)
+		return AddQuads<pr>(Iptr, numVerts, index);
+
+	if (pr)
+		Iptr = WritePattern<5>(Iptr, s_quad_pattern_pr, blocks, index, block_verts);
+	else
+		Iptr = WritePattern<3>(Iptr, s_quad_pattern, blocks, index, block_verts);
+
+	const u32 done = blocks * block_verts;
+	return AddQuads<pr>(Iptr, numVerts - done, index + done);
+}
+
+#endif
+
 // Lines
 u16* IndexGenerator::AddLineList(u16 *Iptr, u32 numVerts, u32 index)
 {
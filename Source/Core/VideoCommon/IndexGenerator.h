@@ -13,7 +13,8 @@ class IndexGenerator
 {
 public:
 	// Init
-	static void Init();
+	// use_simd is only turned off to compare the vector kernels against the scalar code
+	static void Init(bool use_simd = true);
 	static void Start(u16 *Indexptr);
 
 	static void AddIndices(int primitive, u32 numVertices);
@@ -32,6 +33,10 @@ private:
 	template <bool pr> static u16* AddFan(u16 *Iptr, u32 numVerts, u32 index);
 	template <bool pr> static u16* AddQuads(u16 *Iptr, u32 numVerts, u32 index);
 
+	// Same output as above, but whole blocks of primitives are written with SSE2
+	template <bool pr> static u16* AddListSIMD(u16 *Iptr, u32 numVerts, u32 index);
+	template <bool pr> static u16* AddQuadsSIMD(u16 *Iptr, u32 numVerts, u32 index);
+
 	// Lines
 	static u16* AddLineList(u16 *Iptr, u32 numVerts, u32 index);
 	static u16* AddLineStrip(u16 *Iptr, u32 numVerts, u32 index);
@@ -25,6 +25,7 @@
 #include "VertexLoaderManager.h"
 
 #include "Statistics.h"
+#include "VideoTimings.h"
 
 #include "XFMemory.h"
 #include "CPMemory.h"
@@ -485,6 +486,7 @@ void OpcodeDecoder_Shutdown()
 
 u32 OpcodeDecoder_Run(bool skipped_frame)
 {
+	VideoTimingScope timing(g_video_timings.decode);
 	u32 totalCycles = 0;
 	u32 cycles = FifoCommandRunnable();
 	while (cycles > 0)
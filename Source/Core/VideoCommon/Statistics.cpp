@@ -6,6 +6,7 @@
 
 #include "Statistics.h"
 #include "VertexLoaderManager.h"
+#include "Fifo.h"
 
 Statistics stats;
 
@@ -60,6 +61,12 @@ char *Statistics::ToString(char *ptr)
 	ptr+=sprintf(ptr,"Uniform streamed: %i kB\n",stats.thisFrame.bytesUniformStreamed/1024);
 	ptr+=sprintf(ptr,"Vertex Loaders: %i\n",stats.numVertexLoaders);
 
+	u64 gpuBusy, gpuIdle;
+	u32 gpuParks;
+	Fifo_GetGpuThreadStats(gpuBusy, gpuIdle, gpuParks);
+	if (gpuBusy + gpuIdle)
+		ptr+=sprintf(ptr,"GPU thread busy: %i%% (parked %u times)\n",(int)(gpuBusy * 100 / (gpuBusy + gpuIdle)),gpuParks);
+
 	std::string text1;
 	VertexLoaderManager::AppendListToString(&text1);
 
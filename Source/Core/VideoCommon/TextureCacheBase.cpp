@@ -6,6 +6,7 @@
 
 #include "VideoConfig.h"
 #include "Statistics.h"
+#include "VideoTimings.h"
 #include "HiresTextures.h"
 #include "RenderBase.h"
 #include "FileUtil.h"
@@ -341,6 +342,8 @@ TextureCache::TCacheEntryBase* TextureCache::Load(unsigned int const stage,
 	if (0 == address)
 		return NULL;
 
+	VideoTimingScope timing(g_video_timings.textureLoad);
+
 	// TexelSizeInNibbles(format) * width * height / 16;
 	const unsigned int bsw = TexDecoder_GetBlockWidthInTexels(texformat) - 1;
 	const unsigned int bsh = TexDecoder_GetBlockHeightInTexels(texformat) - 1;
@@ -33,7 +33,8 @@
 #endif
 #endif
 
-#define COMPILED_CODE_SIZE 4096
+// Room for the pipeline calls plus three copies of the inline translator
+#define COMPILED_CODE_SIZE 16384
 
 NativeVertexFormat *g_nativeVertexFmt;
 
@@ -468,6 +469,9 @@ void LOADERDECL TexMtx_Write_Float4()
 VertexLoader::VertexLoader(const TVtxDesc &vtx_desc, const VAT &vtx_attr)
 {
 	m_compiledCode = NULL;
+	m_inlineCode = NULL;
+	m_inlineMasks = NULL;
+	m_inlineNormalScales = NULL;
 	m_numLoadedVertices = 0;
 	m_VertexSize = 0;
 	m_numPipelineStages = 0;
@@ -790,6 +794,8 @@ void VertexLoader::CompileVertexTranslator()
 	J_CC(CC_NZ, loop_start, true);
 	ABI_PopAllCalleeSavedRegsAndAdjustStack();
 	RET();
+
+	CompileInlineTranslator(vtx_decl);
 #endif
 	m_NativeFmt = g_vertex_manager->CreateNativeVertexFormat();
 	m_NativeFmt->m_components = components;
@@ -858,6 +864,20 @@ int VertexLoader::SetupRunVertices(int vtx_attr_group, int primitive, int const
 		return 0;
 	}
 
+	LoadScaleFactors(vtx_attr_group);
+
+	// Prepare bounding box
+	s_bbox_primitive = primitive;
+	s_bbox_currPoint = 0;
+	s_bbox_loadedPoints = 0;
+
+	VertexManager::PrepareForAdditionalData(primitive, count, native_stride);
+
+	return count;
+}
+
+void VertexLoader::LoadScaleFactors(int vtx_attr_group)
+{
 	// Load position and texcoord scale factors.
 	m_VtxAttr.PosFrac				= g_VtxAttr[vtx_attr_group].g0.PosFrac;
 	m_VtxAttr.texCoord[0].Frac		= g_VtxAttr[vtx_attr_group].g0.Tex0Frac;
@@ -876,15 +896,6 @@ int VertexLoader::SetupRunVertices(int vtx_attr_group, int primitive, int const
 			tcScale[i] = fractionTable[m_VtxAttr.texCoord[i].Frac];
 	for (int i = 0; i < 2; i++)
 		colElements[i] = m_VtxAttr.color[i].Elements;
-
-	// Prepare bounding box
-	s_bbox_primitive = primitive;
-	s_bbox_currPoint = 0;
-	s_bbox_loadedPoints = 0;
-
-	VertexManager::PrepareForAdditionalData(primitive, count, native_stride);
-
-	return count;
 }
 
 void VertexLoader::RunVertices(int vtx_attr_group, int primitive, int const count)
@@ -894,13 +905,26 @@ void VertexLoader::RunVertices(int vtx_attr_group, int primitive, int const coun
 	VertexManager::AddVertices(primitive, new_count);
 }
 
-void VertexLoader::ConvertVertices ( int count )
+void VertexLoader::TranslateVertices(int vtx_attr_group, int count, bool use_inline_translator)
+{
+	LoadScaleFactors(vtx_attr_group);
+	ConvertVertices(count, use_inline_translator);
+}
+
+void VertexLoader::ConvertVertices(int count, bool use_inline_translator)
 {
 #ifdef USE_JIT
 	if (count > 0)
 	{
-		loop_counter = count;
-		((void (*)())(void*)m_compiledCode)();
+		if (m_inlineCode && use_inline_translator)
+		{
+			((void (*)(int))(void*)m_inlineCode)(count);
+		}
+		else
+		{
+			loop_counter = count;
+			((void (*)())(void*)m_compiledCode)();
+		}
 	}
 #else
 	for (int s = 0; s < count; s++)
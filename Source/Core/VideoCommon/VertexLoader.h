@@ -94,6 +94,7 @@ public:
 	~VertexLoader();
 
 	int GetVertexSize() const {return m_VertexSize;}
+	int GetNativeVertexStride() const {return native_stride;}
 
 	int SetupRunVertices(int vtx_attr_group, int primitive, int const count);
 	void RunVertices(int vtx_attr_group, int primitive, int count);
@@ -103,6 +104,12 @@ public:
 	void AppendToString(std::string *dest) const;
 	int GetNumLoadedVerts() const { return m_numLoadedVertices; }
 
+	// Converts vertices from g_pVideoData to VertexManager::s_pCurBufferPointer
+	// without involving the vertex manager, with the inline translator or the
+	// pipeline functions. Used to compare the two against each other.
+	void TranslateVertices(int vtx_attr_group, int count, bool use_inline_translator);
+	bool HasInlineTranslator() const { return m_inlineCode != NULL; }
+
 private:
 	enum
 	{
@@ -127,18 +134,35 @@ private:
 
 	const u8 *m_compiledCode;
 
+	// Straight-line translator, see VertexLoader_x64.cpp. NULL if the format
+	// or the host isn't supported, the pipeline above is used then.
+	const u8 *m_inlineCode;
+	const u8 *m_inlineMasks;
+	const u8 *m_inlineNormalScales;
+
 	int m_numLoadedVertices;
 
 	void SetVAT(u32 _group0, u32 _group1, u32 _group2);
 
+	void LoadScaleFactors(int vtx_attr_group);
+
 	void CompileVertexTranslator();
-	void ConvertVertices(int count);
+	bool CompileInlineTranslator(const PortableVertexDeclaration &vtx_decl);
+	void ConvertVertices(int count, bool use_inline_translator = true);
 
 	void WriteCall(TPipelineFunction);
 
 #ifndef _M_GENERIC
 	void WriteGetVariable(int bits, Gen::OpArg dest, void *address);
 	void WriteSetVariable(int bits, void *address, Gen::OpArg dest);
+
+	bool CanCompileInlineTranslator() const;
+	void WriteInlineData();
+	void WriteInlineIndex(Gen::X64Reg dest, int array, int index_type, int src_offset);
+	void WriteInlineRead(Gen::X64Reg xmm, Gen::OpArg src, int format, int count);
+	void WriteInlineStore(int dst_offset, Gen::X64Reg xmm, int count, bool may_overrun);
+	void WriteInlineColor(Gen::OpArg src, int format, bool kill_alpha, Gen::OpArg dst);
+	void WriteInlineVertex(int src, int dst, const PortableVertexDeclaration &vtx_decl);
 #endif
 };
 
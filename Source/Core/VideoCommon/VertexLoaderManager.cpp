@@ -8,6 +8,7 @@
 
 #include "VideoCommon.h"
 #include "Statistics.h"
+#include "VideoTimings.h"
 
 #include "VertexShaderManager.h"
 #include "VertexLoader.h"
@@ -123,6 +124,7 @@ void RunVertices(int vtx_attr_group, int primitive, int count)
 	if (!count)
 		return;
 
+	VideoTimingScope timing(g_video_timings.vertexLoad);
 	RefreshLoader(vtx_attr_group);
 	g_VertexLoaders[vtx_attr_group]->RunVertices(vtx_attr_group, primitive, count);
 }
@@ -0,0 +1,540 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+// Straight-line vertex translator.
+//
+// Instead of calling one TPipelineFunction per attribute, this emits the
+// whole conversion of a vertex format as a single block of SSSE3 code:
+// values are byte swapped and widened with PSHUFB, converted with CVTDQ2PS
+// and scaled with MULPS, index lookups are done inline and the per-vertex
+// state the pipeline functions keep in globals (tcIndex, colIndex, texture
+// matrix indices...) is resolved at compile time. Two vertices are handled
+// per loop iteration.
+//
+// The output must be bit-identical to the pipeline functions, the unit
+// tests (VertexLoaderTests.cpp) check this for every component format.
+
+#include "Common.h"
+#include "CPUDetect.h"
+#include "x64Emitter.h"
+#include "x64ABI.h"
+
+#include "VideoCommon.h"
+#include "VideoConfig.h"
+#include "VertexLoader.h"
+#include "VertexManagerBase.h"
+#include "DataReader.h"
+
+extern float posScale;
+extern float tcScale[8];
+
+using namespace Gen;
+
+#if defined(_M_X64) && !defined(__APPLE__)
+
+// Register usage of the generated code
+static const X64Reg SRC_REG = RSI;        // g_pVideoData
+static const X64Reg DST_REG = RDI;        // VertexManager::s_pCurBufferPointer
+static const X64Reg COUNT_REG = RBX;      // vertices left
+static const X64Reg BASES_REG = R8;       // cached_arraybases
+static const X64Reg STRIDES_REG = R9;     // arraystrides
+static const X64Reg TCSCALE_REG = R10;    // tcScale
+static const X64Reg POSSCALE_REG = R11;   // &posScale
+// RAX, RCX and RDX are scratch, as are XMM0 and XMM1. XMM6 and up are callee
+// saved on Windows and ABI_PushAllCalleeSavedRegsAndAdjustStack doesn't
+// preserve them, so they are left alone.
+
+static int ComponentSize(int format)
+{
+	switch (format)
+	{
+	case FORMAT_UBYTE:
+	case FORMAT_BYTE:
+		return 1;
+	case FORMAT_USHORT:
+	case FORMAT_SHORT:
+		return 2;
+	default:
+		return 4;
+	}
+}
+
+static bool ComponentIsSigned(int format)
+{
+	return format == FORMAT_BYTE || format == FORMAT_SHORT;
+}
+
+bool VertexLoader::CanCompileInlineTranslator() const
+{
+	if (!cpu_info.bSSSE3)
+		return false;
+
+	// The bounding box hack swaps the output pointer around the position loader
+	if (g_ActiveConfig.bUseBBox)
+		return false;
+
+	if (m_VtxAttr.PosFormat > FORMAT_FLOAT)
+		return false;
+	if (m_VtxDesc.Normal != NOT_PRESENT && m_VtxAttr.NormalFormat > FORMAT_FLOAT)
+		return false;
+
+	const u32 col[2] = {m_VtxDesc.Color0, m_VtxDesc.Color1};
+	for (int i = 0; i < 2; i++)
+	{
+		if (col[i] != NOT_PRESENT && m_VtxAttr.color[i].Comp > FORMAT_32B_8888)
+			return false;
+	}
+
+	for (int i = 0; i < 8; i++)
+	{
+		if (m_VtxAttr.texCoord[i].Format > FORMAT_FLOAT)
+			return false;
+	}
+
+	return true;
+}
+
+void VertexLoader::WriteInlineData()
+{
+	// PSHUFB masks which byte swap 1, 2 or 3 big endian values of 1, 2 or 4
+	// bytes and place them in the top of their own 32 bit lane, so that a
+	// shift right sign or zero extends them. Unused lanes come out as zero.
+	AlignCode16();
+	m_inlineMasks = GetCodePtr();
+	const int sizes[3] = {1, 2, 4};
+	for (int s = 0; s < 3; s++)
+	{
+		const int size = sizes[s];
+		for (int count = 1; count <= 3; count++)
+		{
+			for (int lane = 0; lane < 4; lane++)
+			{
+				for (int byte = 0; byte < 4; byte++)
+				{
+					// byte 3 is the most significant one of the lane
+					int src_byte = size - 1 - (byte - (4 - size));
+					if (lane < count && byte >= 4 - size)
+						Write8((u8)(lane * size + src_byte));
+					else
+						Write8(0x80);
+				}
+			}
+		}
+	}
+
+	// Normals use fixed scales, see FracAdjust in VertexLoader_Normal.cpp
+	m_inlineNormalScales = GetCodePtr();
+	for (int format = FORMAT_UBYTE; format <= FORMAT_SHORT; format++)
+	{
+		const float scale = 1.0f / (1u << (ComponentSize(format) * 8 - ComponentIsSigned(format) - 1));
+		for (int lane = 0; lane < 4; lane++)
+			Write32(*(const u32 *)&scale);
+	}
+}
+
+void VertexLoader::WriteInlineIndex(X64Reg dest, int array, int index_type, int src_offset)
+{
+	if (index_type == INDEX8)
+	{
+		MOVZX(32, 8, dest, MDisp(SRC_REG, src_offset));
+	}
+	else
+	{
+		MOVZX(32, 16, dest, MDisp(SRC_REG, src_offset));
+		ROL(16, R(dest), Imm8(8));
+	}
+	IMUL(32, dest, MDisp(STRIDES_REG, array * sizeof(u32)));
+	ADD(64, R(dest), MDisp(BASES_REG, array * sizeof(u8 *)));
+}
+
+void VertexLoader::WriteInlineRead(X64Reg xmm, OpArg src, int format, int count)
+{
+	const int size = ComponentSize(format);
+	const int bytes = size * count;
+
+	// This may read up to four bytes past the attribute, as the color
+	// pipeline functions already do. FIFO data and emulated RAM are padded.
+	if (bytes <= 4)
+		MOVD_xmm(xmm, src);
+	else if (bytes <= 8)
+		MOVQ_xmm(xmm, src);
+	else
+		MOVUPS(xmm, src);
+
+	const int mask = (size == 4 ? 2 : size - 1) * 3 + count - 1;
+	PSHUFB(xmm, M((void *)(m_inlineMasks + mask * 16)));
+
+	if (format != FORMAT_FLOAT)
+	{
+		if (ComponentIsSigned(format))
+			PSRAD(xmm, 32 - size * 8);
+		else
+			PSRLD(xmm, 32 - size * 8);
+		CVTDQ2PS(xmm, R(xmm));
+	}
+}
+
+void VertexLoader::WriteInlineStore(int dst_offset, X64Reg xmm, int count, bool may_overrun)
+{
+	switch (count)
+	{
+	case 1:
+		MOVSS(MDisp(DST_REG, dst_offset), xmm);
+		break;
+	case 2:
+		MOVQ_xmm(MDisp(DST_REG, dst_offset), xmm);
+		break;
+	case 3:
+		if (may_overrun)
+		{
+			MOVUPS(MDisp(DST_REG, dst_offset), xmm);
+		}
+		else
+		{
+			MOVQ_xmm(MDisp(DST_REG, dst_offset), xmm);
+			SHUFPS(xmm, R(xmm), 2);
+			MOVSS(MDisp(DST_REG, dst_offset + 8), xmm);
+		}
+		break;
+	default:
+		MOVUPS(MDisp(DST_REG, dst_offset), xmm);
+		break;
+	}
+}
+
+void VertexLoader::WriteInlineColor(OpArg src, int format, bool kill_alpha, OpArg dst)
+{
+	// Mirrors _SetCol565 and friends in VertexLoader_Color.cpp. src may be
+	// based on RDX, it is always read before any scratch register is written.
+	switch (format)
+	{
+	case FORMAT_16B_565:
+		MOVZX(32, 16, EAX, src);
+		ROL(16, R(EAX), Imm8(8));
+		MOV(32, R(ECX), R(EAX));
+		SHR(32, R(ECX), Imm8(8));
+		AND(32, R(ECX), Imm32(0xF8));
+		MOV(32, R(EDX), R(EAX));
+		SHL(32, R(EDX), Imm8(5));
+		AND(32, R(EDX), Imm32(0xFC00));
+		OR(32, R(ECX), R(EDX));
+		SHL(32, R(EAX), Imm8(19));
+		AND(32, R(EAX), Imm32(0xF80000));
+		OR(32, R(ECX), R(EAX));
+		MOV(32, R(EDX), R(ECX));
+		SHR(32, R(EDX), Imm8(5));
+		AND(32, R(EDX), Imm32(0x070007));
+		OR(32, R(ECX), R(EDX));
+		MOV(32, R(EDX), R(ECX));
+		SHR(32, R(EDX), Imm8(6));
+		AND(32, R(EDX), Imm32(0x000300));
+		OR(32, R(ECX), R(EDX));
+		OR(32, R(ECX), Imm32(0xFF000000));
+		break;
+
+	case FORMAT_24B_888:
+	case FORMAT_32B_888x:
+		MOV(32, R(ECX), src);
+		OR(32, R(ECX), Imm32(0xFF000000));
+		break;
+
+	case FORMAT_16B_4444:
+		MOVZX(32, 16, EAX, src);
+		MOV(32, R(ECX), R(EAX));
+		AND(32, R(ECX), Imm32(0xF0));
+		MOV(32, R(EDX), R(EAX));
+		AND(32, R(EDX), Imm32(0xF));
+		SHL(32, R(EDX), Imm8(12));
+		OR(32, R(ECX), R(EDX));
+		MOV(32, R(EDX), R(EAX));
+		AND(32, R(EDX), Imm32(0xF000));
+		SHL(32, R(EDX), Imm8(8));
+		OR(32, R(ECX), R(EDX));
+		AND(32, R(EAX), Imm32(0x0F00));
+		SHL(32, R(EAX), Imm8(20));
+		OR(32, R(ECX), R(EAX));
+		MOV(32, R(EDX), R(ECX));
+		SHR(32, R(EDX), Imm8(4));
+		OR(32, R(ECX), R(EDX));
+		break;
+
+	case FORMAT_24B_6666:
+		// src points one byte before the color, like swap32(DataGetPosition() - 1)
+		MOV(32, R(EAX), src);
+		BSWAP(32, EAX);
+		MOV(32, R(ECX), R(EAX));
+		SHR(32, R(ECX), Imm8(16));
+		AND(32, R(ECX), Imm32(0xFC));
+		MOV(32, R(EDX), R(EAX));
+		SHR(32, R(EDX), Imm8(2));
+		AND(32, R(EDX), Imm32(0xFC00));
+		OR(32, R(ECX), R(EDX));
+		MOV(32, R(EDX), R(EAX));
+		SHL(32, R(EDX), Imm8(12));
+		AND(32, R(EDX), Imm32(0xFC0000));
+		OR(32, R(ECX), R(EDX));
+		SHL(32, R(EAX), Imm8(26));
+		AND(32, R(EAX), Imm32(0xFC000000));
+		OR(32, R(ECX), R(EAX));
+		MOV(32, R(EDX), R(ECX));
+		SHR(32, R(EDX), Imm8(6));
+		AND(32, R(EDX), Imm32(0x03030303));
+		OR(32, R(ECX), R(EDX));
+		break;
+
+	case FORMAT_32B_8888:
+		MOV(32, R(ECX), src);
+		if (kill_alpha)
+			OR(32, R(ECX), Imm32(0xFF000000));
+		break;
+	}
+
+	MOV(32, dst, R(ECX));
+}
+
+void VertexLoader::WriteInlineVertex(int src, int dst, const PortableVertexDeclaration &vtx_decl)
+{
+	// Matrix indices come first in the GC vertex
+	int posmtx_offset = -1;
+	int texmtx_offset[8];
+	if (m_VtxDesc.PosMatIdx)
+		posmtx_offset = src++;
+
+	const u32 texmtx[8] = {
+		m_VtxDesc.Tex0MatIdx, m_VtxDesc.Tex1MatIdx, m_VtxDesc.Tex2MatIdx, m_VtxDesc.Tex3MatIdx,
+		m_VtxDesc.Tex4MatIdx, m_VtxDesc.Tex5MatIdx, m_VtxDesc.Tex6MatIdx, m_VtxDesc.Tex7MatIdx
+	};
+	for (int i = 0; i < 8; i++)
+		texmtx_offset[i] = texmtx[i] ? src++ : -1;
+
+	// Position
+	const int pos_elements = m_VtxAttr.PosElements ? 3 : 2;
+	OpArg pos_src = MDisp(SRC_REG, src);
+	if (m_VtxDesc.Position == DIRECT)
+	{
+		src += pos_elements * ComponentSize(m_VtxAttr.PosFormat);
+	}
+	else
+	{
+		WriteInlineIndex(RAX, ARRAY_POSITION, m_VtxDesc.Position, src);
+		pos_src = MatR(RAX);
+		src += m_VtxDesc.Position == INDEX8 ? 1 : 2;
+	}
+	WriteInlineRead(XMM0, pos_src, m_VtxAttr.PosFormat, pos_elements);
+	if (m_VtxAttr.PosFormat != FORMAT_FLOAT)
+	{
+		MOVSS(XMM1, MatR(POSSCALE_REG));
+		SHUFPS(XMM1, R(XMM1), 0);
+		MULPS(XMM0, R(XMM1));
+	}
+	WriteInlineStore(dst, XMM0, 3, 16 <= native_stride);
+
+	// Normals
+	if (m_VtxDesc.Normal != NOT_PRESENT)
+	{
+		const int format = m_VtxAttr.NormalFormat;
+		const int size = ComponentSize(format);
+		const int vectors = m_VtxAttr.NormalElements ? 3 : 1;
+		const bool index3 = m_VtxAttr.NormalIndex3 && m_VtxAttr.NormalElements && m_VtxDesc.Normal != DIRECT;
+		const int index_size = m_VtxDesc.Normal == INDEX8 ? 1 : 2;
+
+		if (m_VtxDesc.Normal != DIRECT && !index3)
+			WriteInlineIndex(RAX, ARRAY_NORMAL, m_VtxDesc.Normal, src);
+
+		for (int i = 0; i < vectors; i++)
+		{
+			OpArg nrm_src;
+			if (m_VtxDesc.Normal == DIRECT)
+			{
+				nrm_src = MDisp(SRC_REG, src + i * 3 * size);
+			}
+			else if (index3)
+			{
+				WriteInlineIndex(RAX, ARRAY_NORMAL, m_VtxDesc.Normal, src + i * index_size);
+				nrm_src = MDisp(RAX, i * 3 * size);
+			}
+			else
+			{
+				nrm_src = MDisp(RAX, i * 3 * size);
+			}
+
+			WriteInlineRead(XMM0, nrm_src, format, 3);
+			if (format != FORMAT_FLOAT)
+				MULPS(XMM0, M((void *)(m_inlineNormalScales + format * 16)));
+			WriteInlineStore(dst + vtx_decl.normal_offset[i], XMM0, 3,
+				vtx_decl.normal_offset[i] + 16 <= native_stride);
+		}
+
+		if (m_VtxDesc.Normal == DIRECT)
+			src += vectors * 3 * size;
+		else
+			src += index3 ? 3 * index_size : index_size;
+	}
+
+	// Colors. Like the pipeline functions, the array and the element count
+	// are picked by the number of colors loaded so far, not by the slot.
+	const u32 col[2] = {m_VtxDesc.Color0, m_VtxDesc.Color1};
+	int col_index = 0;
+	for (int i = 0; i < 2; i++)
+	{
+		if (col[i] == NOT_PRESENT)
+			continue;
+
+		const int format = m_VtxAttr.color[i].Comp;
+		const OpArg col_dst = MDisp(DST_REG, dst + vtx_decl.color_offset[i]);
+		const int back = format == FORMAT_24B_6666 ? -1 : 0;
+		if (col[i] == DIRECT)
+		{
+			WriteInlineColor(MDisp(SRC_REG, src + back), format, !m_VtxAttr.color[col_index].Elements, col_dst);
+			switch (format)
+			{
+			case FORMAT_16B_565:
+			case FORMAT_16B_4444:
+				src += 2;
+				break;
+			case FORMAT_24B_888:
+			case FORMAT_24B_6666:
+				src += 3;
+				break;
+			default:
+				src += 4;
+				break;
+			}
+		}
+		else
+		{
+			// The indexed 8888 loader never kills the alpha
+			WriteInlineIndex(RDX, ARRAY_COLOR + col_index, col[i], src);
+			WriteInlineColor(MDisp(RDX, back), format, false, col_dst);
+			src += col[i] == INDEX8 ? 1 : 2;
+		}
+		col_index++;
+	}
+
+	// Texture coordinates. tcIndex always ends up matching the coordinate
+	// number, as a dummy function is called for each missing one.
+	const u32 tc[8] = {
+		m_VtxDesc.Tex0Coord, m_VtxDesc.Tex1Coord, m_VtxDesc.Tex2Coord, m_VtxDesc.Tex3Coord,
+		m_VtxDesc.Tex4Coord, m_VtxDesc.Tex5Coord, m_VtxDesc.Tex6Coord, (const u32)((m_VtxDesc.Hex >> 31) & 3)
+	};
+	for (int i = 0; i < 8; i++)
+	{
+		const int offset = vtx_decl.texcoord_offset[i];
+		if (offset < 0)
+			continue;
+
+		const int format = m_VtxAttr.texCoord[i].Format;
+		const int elements = m_VtxAttr.texCoord[i].Elements ? 2 : 1;
+
+		if (tc[i] != NOT_PRESENT)
+		{
+			OpArg tc_src = MDisp(SRC_REG, src);
+			if (tc[i] == DIRECT)
+			{
+				src += elements * ComponentSize(format);
+			}
+			else
+			{
+				WriteInlineIndex(RAX, ARRAY_TEXCOORD0 + i, tc[i], src);
+				tc_src = MatR(RAX);
+				src += tc[i] == INDEX8 ? 1 : 2;
+			}
+			WriteInlineRead(XMM0, tc_src, format, elements);
+			if (format != FORMAT_FLOAT)
+			{
+				MOVSS(XMM1, MDisp(TCSCALE_REG, i * sizeof(float)));
+				SHUFPS(XMM1, R(XMM1), 0);
+				MULPS(XMM0, R(XMM1));
+			}
+		}
+
+		if (texmtx_offset[i] < 0)
+		{
+			WriteInlineStore(dst + offset, XMM0, elements, false);
+			continue;
+		}
+
+		// The matrix index goes into the third component, the unused second
+		// component of a single coordinate and the fourth of a missing one are zero
+		MOVZX(32, 8, EAX, MDisp(SRC_REG, texmtx_offset[i]));
+		AND(32, R(EAX), Imm8(0x3f));
+		MOVD_xmm(XMM1, R(EAX));
+		CVTDQ2PS(XMM1, R(XMM1));
+		if (tc[i] != NOT_PRESENT)
+		{
+			WriteInlineStore(dst + offset, XMM0, 2, false);
+			MOVSS(MDisp(DST_REG, dst + offset + 8), XMM1);
+		}
+		else
+		{
+			SHUFPS(XMM1, R(XMM1), 0x45);
+			MOVUPS(MDisp(DST_REG, dst + offset), XMM1);
+		}
+	}
+
+	if (m_VtxDesc.PosMatIdx)
+	{
+		MOVZX(32, 8, EAX, MDisp(SRC_REG, posmtx_offset));
+		AND(32, R(EAX), Imm8(0x3f));
+		MOV(32, MDisp(DST_REG, dst + vtx_decl.posmtx_offset), R(EAX));
+	}
+}
+
+bool VertexLoader::CompileInlineTranslator(const PortableVertexDeclaration &vtx_decl)
+{
+	if (!CanCompileInlineTranslator())
+		return false;
+
+	WriteInlineData();
+
+	m_inlineCode = AlignCode16();
+	ABI_PushAllCalleeSavedRegsAndAdjustStack();
+	MOV(32, R(COUNT_REG), R(ABI_PARAM1));
+
+	MOV(64, R(RAX), ImmPtr(&g_pVideoData));
+	MOV(64, R(SRC_REG), MatR(RAX));
+	MOV(64, R(RAX), ImmPtr(&VertexManager::s_pCurBufferPointer));
+	MOV(64, R(DST_REG), MatR(RAX));
+	MOV(64, R(BASES_REG), ImmPtr(cached_arraybases));
+	MOV(64, R(STRIDES_REG), ImmPtr(arraystrides));
+	MOV(64, R(TCSCALE_REG), ImmPtr(tcScale));
+	MOV(64, R(POSSCALE_REG), ImmPtr(&posScale));
+
+	// Do the odd vertex first, the rest goes two at a time
+	TEST(32, R(COUNT_REG), Imm32(1));
+	FixupBranch even = J_CC(CC_Z, true);
+	WriteInlineVertex(0, 0, vtx_decl);
+	ADD(64, R(SRC_REG), Imm32(m_VertexSize));
+	ADD(64, R(DST_REG), Imm32(native_stride));
+	SUB(32, R(COUNT_REG), Imm8(1));
+	FixupBranch done = J_CC(CC_Z, true);
+	SetJumpTarget(even);
+
+	const u8 *loop_start = GetCodePtr();
+	WriteInlineVertex(0, 0, vtx_decl);
+	WriteInlineVertex(m_VertexSize, native_stride, vtx_decl);
+	ADD(64, R(SRC_REG), Imm32(m_VertexSize * 2));
+	ADD(64, R(DST_REG), Imm32(native_stride * 2));
+	SUB(32, R(COUNT_REG), Imm8(2));
+	J_CC(CC_NZ, loop_start, true);
+
+	SetJumpTarget(done);
+	MOV(64, R(RAX), ImmPtr(&g_pVideoData));
+	MOV(64, MatR(RAX), R(SRC_REG));
+	MOV(64, R(RAX), ImmPtr(&VertexManager::s_pCurBufferPointer));
+	MOV(64, MatR(RAX), R(DST_REG));
+	ABI_PopAllCalleeSavedRegsAndAdjustStack();
+	RET();
+
+	return true;
+}
+
+#else
+
+bool VertexLoader::CompileInlineTranslator(const PortableVertexDeclaration &vtx_decl)
+{
+	return false;
+}
+
+#endif
@@ -2,6 +2,7 @@
 #include "Common.h"
 
 #include "Statistics.h"
+#include "VideoTimings.h"
 #include "OpcodeDecoding.h"
 #include "IndexGenerator.h"
 #include "VertexShaderManager.h"
@@ -155,6 +156,8 @@ void VertexManager::Flush()
 {
 	if (IsFlushed) return;
 
+	VideoTimingScope timing(g_video_timings.flush);
+
 	// loading a state will invalidate BP, so check for it
 	g_video_backend->CheckInvalidState();
 
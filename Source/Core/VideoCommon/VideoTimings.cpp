@@ -0,0 +1,15 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#include <string.h>
+
+#include "VideoTimings.h"
+
+VideoTimings g_video_timings;
+bool g_bGatherVideoTimings = false;
+
+void VideoTimings_Reset()
+{
+	memset(&g_video_timings, 0, sizeof(VideoTimings));
+}
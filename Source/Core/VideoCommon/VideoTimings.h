@@ -0,0 +1,46 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+#ifndef _VIDEOTIMINGS_H
+#define _VIDEOTIMINGS_H
+
+#include "CommonTypes.h"
+#include "Timer.h"
+
+// Host time spent in the stages of the video pipeline, in nanoseconds.
+// Only gathered while enabled, since reading the clock for every FIFO chunk
+// isn't free. Nothing resets these behind your back, whoever enables
+// gathering owns the counters.
+struct VideoTimings
+{
+	u64 decode;       // includes all of the below
+	u64 vertexLoad;
+	u64 textureLoad;
+	u64 flush;        // includes texture loads done while flushing
+};
+
+extern VideoTimings g_video_timings;
+extern bool g_bGatherVideoTimings;
+
+void VideoTimings_Reset();
+
+// Adds the host time spent in the enclosing scope to a VideoTimings counter
+class VideoTimingScope
+{
+public:
+	VideoTimingScope(u64 &counter)
+		: m_counter(counter), m_start(g_bGatherVideoTimings ? Common::Timer::GetTimeNs() : 0) {}
+
+	~VideoTimingScope()
+	{
+		if (m_start)
+			m_counter += Common::Timer::GetTimeNs() - m_start;
+	}
+
+private:
+	u64 &m_counter;
+	u64 m_start;
+};
+
+#endif  // _VIDEOTIMINGS_H
@@ -0,0 +1,534 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+// Runs small guest kernels on every CPU core, checks that the registers and
+// memory they leave behind match a single stepped interpreter run, and
+// measures how long each core takes per guest instruction.
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "Common.h"
+#include "Timer.h"
+#include "ConfigManager.h"
+#include "Core.h"
+#include "CoreTiming.h"
+#include "HW/Memmap.h"
+#include "PowerPC/PowerPC.h"
+#include "PowerPC/JitInterface.h"
+#include "PowerPC/Interpreter/Interpreter.h"
+#include "VideoBackendBase.h"
+
+extern int fail_count;
+
+namespace
+{
+
+enum
+{
+	CODE_ADDRESS = 0x80004000,
+	DATA_ADDRESS = 0x80100000,
+	// The kernels walk a 64KB window and access a few bytes past it
+	DATA_SIZE = 0x10040,
+	ITERATIONS = 0x40000,
+	// How often the stop check runs, about one JIT timing slice
+	STOP_CHECK_CYCLES = 20000,
+
+	// Registers the prologue sets up for every kernel
+	REG_ITERATIONS = 29,
+	REG_DATA = 30,
+	REG_OFFSET = 31,
+
+	// Constant FPRs, everything else is random
+	FREG_HALF = 20,
+	FREG_SMALL = 21,
+	FREG_QUARTER = 22,
+	FREG_THREE = 23,
+
+	NUM_CORES = 4,
+};
+
+// The cores that run everywhere come first
+const int s_core_ids[NUM_CORES] = {
+	0, 5, 1, 2,
+};
+
+const char *const s_core_names[NUM_CORES] = {
+	"Interpreter", "CachedInterpreter", "Jit64", "JitIL",
+};
+
+// Instruction encoders, only what the kernels below need
+
+u32 DForm(int op, int d, int a, s16 imm)
+{
+	return (op << 26) | (d << 21) | (a << 16) | (u16)imm;
+}
+
+u32 XForm(int op, int d, int a, int b, int xo, bool rc = false)
+{
+	return (op << 26) | (d << 21) | (a << 16) | (b << 11) | (xo << 1) | rc;
+}
+
+// frD = frA * frC + frB and friends
+u32 AForm(int op, int d, int a, int b, int c, int xo)
+{
+	return (op << 26) | (d << 21) | (a << 16) | (b << 11) | (c << 6) | (xo << 1);
+}
+
+u32 RLWINM(int a, int s, int sh, int mb, int me)
+{
+	return (21 << 26) | (s << 21) | (a << 16) | (sh << 11) | (mb << 6) | (me << 1);
+}
+
+u32 PSQ(int op, int frd, int a, s16 offset, int w, int gqr)
+{
+	return (op << 26) | (frd << 21) | (a << 16) | (w << 15) | (gqr << 12) | (offset & 0xFFF);
+}
+
+u32 PSQX(int xo, int frd, int a, int b, int w, int gqr)
+{
+	return (4 << 26) | (frd << 21) | (a << 16) | (b << 11) | (w << 10) | (gqr << 7) | (xo << 1);
+}
+
+u32 BC(int bo, int bi, int offset)
+{
+	return (16 << 26) | (bo << 21) | (bi << 16) | (offset & 0xFFFC);
+}
+
+u32 B(int offset, bool link = false)
+{
+	return (18 << 26) | (offset & 0x3FFFFFC) | link;
+}
+
+u32 MTSPR(int spr, int s)
+{
+	return XForm(31, s, spr & 0x1F, spr >> 5, 467);
+}
+
+u32 LI(int d, s16 imm) { return DForm(14, d, 0, imm); }
+u32 LIS(int d, u16 imm) { return DForm(15, d, 0, (s16)imm); }
+u32 ORI(int a, int s, u16 imm) { return DForm(24, s, a, (s16)imm); }
+u32 ADDI(int d, int a, s16 imm) { return DForm(14, d, a, imm); }
+u32 CMPWI(int crf, int a, s16 imm) { return DForm(11, crf << 2, a, imm); }
+
+const u32 BLR = 0x4E800020;
+
+enum
+{
+	BO_TRUE = 12,
+	BO_FALSE = 4,
+	BO_DNZ = 16,
+
+	CR_LT = 0,
+	CR_GT = 1,
+	CR_EQ = 2,
+};
+
+// Fixed point arithmetic, logic and rotates, with carry and record forms
+void IntegerKernel(std::vector<u32> &setup, std::vector<u32> &body)
+{
+	body.push_back(XForm(31, 3, 3, 4, 266));           // add r3, r3, r4
+	body.push_back(XForm(31, 5, 4, 6, 40));            // subf r5, r4, r6
+	body.push_back(XForm(31, 6, 6, 3, 316));           // xor r6, r6, r3
+	body.push_back(RLWINM(7, 3, 5, 0, 26));            // rlwinm r7, r3, 5, 0, 26
+	body.push_back(XForm(31, 8, 7, 5, 235));           // mullw r8, r7, r5
+	body.push_back(XForm(31, 8, 9, 3, 824));           // srawi r9, r8, 3
+	body.push_back(XForm(31, 10, 9, 0, 202));          // addze r10, r9
+	body.push_back(XForm(31, 6, 11, 10, 28, true));    // and. r11, r6, r10
+	body.push_back(XForm(31, 11, 4, 8, 444));          // or r4, r11, r8
+	body.push_back(XForm(31, 1 << 2, 3, 4, 0));        // cmpw cr1, r3, r4
+	body.push_back(DForm(12, 12, 12, 1));              // addic r12, r12, 1
+	body.push_back(ORI(14, 14, 1));                    // ori r14, r14, 1
+	body.push_back(XForm(31, 13, 3, 14, 459));         // divwu r13, r3, r14
+}
+
+// Loads and stores of every size, walking the data window
+void MemoryKernel(std::vector<u32> &setup, std::vector<u32> &body)
+{
+	setup.push_back(LI(REG_OFFSET, 0));
+
+	body.push_back(DForm(32, 3, REG_DATA, 0));                 // lwz r3, 0(r30)
+	body.push_back(DForm(40, 4, REG_DATA, 4));                 // lhz r4, 4(r30)
+	body.push_back(DForm(34, 5, REG_DATA, 6));                 // lbz r5, 6(r30)
+	body.push_back(XForm(31, 6, 3, 4, 266));                   // add r6, r3, r4
+	body.push_back(XForm(31, 7, REG_DATA, REG_OFFSET, 23));    // lwzx r7, r30, r31
+	body.push_back(XForm(31, 8, REG_DATA, REG_OFFSET, 279));   // lhzx r8, r30, r31
+	body.push_back(XForm(31, 9, 7, 6, 266));                   // add r9, r7, r6
+	body.push_back(XForm(31, 9, REG_DATA, REG_OFFSET, 151));   // stwx r9, r30, r31
+	body.push_back(DForm(36, 6, REG_DATA, 8));                 // stw r6, 8(r30)
+	body.push_back(DForm(44, 5, REG_DATA, 12));                // sth r5, 12(r30)
+	body.push_back(XForm(31, 8, REG_DATA, REG_OFFSET, 215));   // stbx r8, r30, r31
+	body.push_back(ADDI(REG_OFFSET, REG_OFFSET, 20));          // addi r31, r31, 20
+	body.push_back(RLWINM(REG_OFFSET, REG_OFFSET, 0, 16, 29)); // rlwinm r31, r31, 0, 16, 29
+}
+
+// Conditional branches, calls and returns inside the loop
+void BranchKernel(std::vector<u32> &setup, std::vector<u32> &body)
+{
+	setup.push_back(LI(28, 0));
+
+	body.push_back(ADDI(28, 28, 1));                   // addi r28, r28, 1
+	body.push_back(DForm(28, 28, 3, 3));               // andi. r3, r28, 3
+	body.push_back(BC(BO_TRUE, CR_EQ, 8));             // beq +8
+	body.push_back(ADDI(4, 4, 1));                     // addi r4, r4, 1
+	body.push_back(CMPWI(0, 3, 2));                    // cmpwi r3, 2
+	body.push_back(BC(BO_FALSE, CR_EQ, 8));            // bne +8
+	body.push_back(B(12, true));                       // bl +12
+	body.push_back(XForm(31, 6, 6, 4, 316));           // xor r6, r6, r4
+	body.push_back(B(12));                             // b +12
+	body.push_back(ADDI(5, 5, 3));                     // addi r5, r5, 3
+	body.push_back(BLR);                               // blr
+}
+
+// Double precision arithmetic, conversions and compares. The values are kept
+// finite, so the NaN handling differences between the cores don't show up.
+void FloatKernel(std::vector<u32> &setup, std::vector<u32> &body)
+{
+	body.push_back(AForm(63, 1, 1, FREG_SMALL, FREG_HALF, 29)); // fmadd f1, f1, f20, f21
+	body.push_back(AForm(63, 2, 1, 0, 1, 25));          // fmul f2, f1, f1
+	body.push_back(AForm(63, 3, 3, 2, 0, 21));          // fadd f3, f3, f2
+	body.push_back(AForm(63, 4, 3, 1, 0, 20));          // fsub f4, f3, f1
+	body.push_back(AForm(63, 5, 4, FREG_THREE, 0, 18)); // fdiv f5, f4, f23
+	body.push_back(XForm(63, 6, 0, 5, 40));             // fneg f6, f5
+	body.push_back(XForm(63, 7, 0, 6, 264));            // fabs f7, f6
+	body.push_back(XForm(63, 8, 0, 7, 12));             // frsp f8, f7
+	body.push_back(AForm(63, 9, 8, 9, FREG_QUARTER, 28)); // fmsub f9, f8, f22, f9
+	body.push_back(XForm(63, 10, 0, 5, 15));            // fctiwz f10, f5
+	body.push_back(DForm(54, 10, REG_DATA, 0));         // stfd f10, 0(r30)
+	body.push_back(XForm(63, 1 << 2, 1, 2, 0));         // fcmpu cr1, f1, f2
+	body.push_back(AForm(63, 11, 4, 2, 1, 23));         // fsel f11, f4, f1, f2
+	body.push_back(XForm(63, 12, 0, 11, 72));           // fmr f12, f11
+	body.push_back(AForm(59, 13, 12, 0, FREG_HALF, 25)); // fmuls f13, f12, f20
+	body.push_back(DForm(52, 13, REG_DATA, 8));         // stfs f13, 8(r30)
+}
+
+// Paired single math on both halves
+void PairedKernel(std::vector<u32> &setup, std::vector<u32> &body)
+{
+	body.push_back(AForm(4, 1, 1, FREG_SMALL, FREG_HALF, 29));   // ps_madd f1, f1, f20, f21
+	body.push_back(AForm(4, 2, 1, 0, FREG_QUARTER, 25));         // ps_mul f2, f1, f22
+	body.push_back(AForm(4, 3, 2, 3, 1, 10));                    // ps_sum0 f3, f2, f1, f3
+	body.push_back(XForm(4, 4, 1, 2, 592));                      // ps_merge10 f4, f1, f2
+	body.push_back(AForm(4, 5, 4, 5, FREG_HALF, 30));            // ps_nmsub f5, f4, f20, f5
+	body.push_back(AForm(4, 6, 5, 4, 0, 21));                    // ps_add f6, f5, f4
+	body.push_back(AForm(4, 7, 6, 1, 0, 20));                    // ps_sub f7, f6, f1
+	body.push_back(AForm(4, 8, 1, 0, FREG_QUARTER, 12));         // ps_muls0 f8, f1, f22
+	body.push_back(AForm(4, 9, 2, 9, FREG_QUARTER, 15));         // ps_madds1 f9, f2, f22, f9
+	body.push_back(XForm(4, 10, 8, 9, 528));                     // ps_merge00 f10, f8, f9
+}
+
+// Quantized loads and stores through float, u8, s16 and u16 GQRs
+void QuantizedKernel(std::vector<u32> &setup, std::vector<u32> &body)
+{
+	// GQR = ld_scale << 24 | ld_type << 16 | st_scale << 8 | st_type
+	setup.push_back(LI(3, 0));
+	setup.push_back(MTSPR(SPR_GQR0, 3));
+	setup.push_back(LIS(3, 0x0004));
+	setup.push_back(ORI(3, 3, 0x0004));
+	setup.push_back(MTSPR(SPR_GQR0 + 1, 3));
+	setup.push_back(LIS(3, 0x0807));
+	setup.push_back(ORI(3, 3, 0x0807));
+	setup.push_back(MTSPR(SPR_GQR0 + 2, 3));
+	setup.push_back(LIS(3, 0x0005));
+	setup.push_back(ORI(3, 3, 0x0005));
+	setup.push_back(MTSPR(SPR_GQR0 + 3, 3));
+	setup.push_back(LI(REG_OFFSET, 0));
+
+	body.push_back(PSQ(56, 1, REG_DATA, 0, 0, 0));               // psq_l f1, 0(r30), 0, 0
+	body.push_back(PSQ(56, 2, REG_DATA, 8, 0, 1));               // psq_l f2, 8(r30), 0, 1
+	body.push_back(PSQ(56, 3, REG_DATA, 16, 1, 2));              // psq_l f3, 16(r30), 1, 2
+	body.push_back(PSQX(6, 4, REG_DATA, REG_OFFSET, 0, 3));      // psq_lx f4, r30, r31, 0, 3
+	body.push_back(AForm(4, 5, 1, 2, 0, 21));                    // ps_add f5, f1, f2
+	body.push_back(AForm(4, 6, 3, 4, FREG_HALF, 29));            // ps_madd f6, f3, f20, f4
+	body.push_back(PSQ(60, 6, REG_DATA, 24, 0, 1));              // psq_st f6, 24(r30), 0, 1
+	body.push_back(PSQ(60, 5, REG_DATA, 32, 0, 0));              // psq_st f5, 32(r30), 0, 0
+	body.push_back(PSQ(60, 3, REG_DATA, 40, 1, 2));              // psq_st f3, 40(r30), 1, 2
+	body.push_back(PSQX(7, 6, REG_DATA, REG_OFFSET, 0, 3));      // psq_stx f6, r30, r31, 0, 3
+	body.push_back(ADDI(REG_OFFSET, REG_OFFSET, 12));            // addi r31, r31, 12
+	body.push_back(RLWINM(REG_OFFSET, REG_OFFSET, 0, 16, 29));   // rlwinm r31, r31, 0, 16, 29
+}
+
+struct Kernel
+{
+	const char *name;
+	void (*build)(std::vector<u32> &setup, std::vector<u32> &body);
+};
+
+const Kernel s_kernels[] = {
+	{"integer", IntegerKernel},
+	{"load/store", MemoryKernel},
+	{"branches", BranchKernel},
+	{"floating point", FloatKernel},
+	{"paired single", PairedKernel},
+	{"quantized load/store", QuantizedKernel},
+};
+
+const int NUM_KERNELS = sizeof(s_kernels) / sizeof(s_kernels[0]);
+
+struct Snapshot
+{
+	u32 gpr[32];
+	u64 ps[32][2];
+	u32 cr;
+	u32 xer;
+	u32 lr;
+	u32 ctr;
+	std::vector<u8> data;
+};
+
+int s_et_stop;
+u32 s_stop_address;
+
+// The kernels end in a branch to self, stop the core once it gets there
+void StopCheckCallback(u64 userdata, int cyclesLate)
+{
+	if (PC == s_stop_address)
+		*PowerPC::GetStatePtr() = PowerPC::CPU_STEPPING;
+	else
+		CoreTiming::ScheduleEvent(STOP_CHECK_CYCLES - cyclesLate, s_et_stop);
+}
+
+// Writes prologue, kernel and the final branch to self to guest memory
+void LoadKernel(const Kernel &kernel)
+{
+	std::vector<u32> code, setup, body;
+	kernel.build(setup, body);
+
+	code.push_back(LIS(REG_DATA, DATA_ADDRESS >> 16));
+	code.push_back(ORI(REG_DATA, REG_DATA, DATA_ADDRESS & 0xFFFF));
+	code.push_back(LIS(REG_ITERATIONS, ITERATIONS >> 16));
+	code.push_back(ORI(REG_ITERATIONS, REG_ITERATIONS, ITERATIONS & 0xFFFF));
+	code.push_back(MTSPR(SPR_CTR, REG_ITERATIONS));
+	code.insert(code.end(), setup.begin(), setup.end());
+	code.insert(code.end(), body.begin(), body.end());
+	code.push_back(BC(BO_DNZ, 0, -(int)body.size() * 4));
+	code.push_back(B(0));
+
+	for (size_t i = 0; i < code.size(); i++)
+		Memory::Write_U32(code[i], CODE_ADDRESS + (u32)i * 4);
+	s_stop_address = CODE_ADDRESS + (u32)(code.size() - 1) * 4;
+}
+
+void RandomSnapshot(Snapshot &state)
+{
+	for (int i = 0; i < 32; i++)
+	{
+		state.gpr[i] = ((u32)rand() << 16) ^ (u32)rand();
+		for (int j = 0; j < 2; j++)
+		{
+			// Single precision values, so the paired single kernels start from valid inputs
+			double value = (float)((rand() % 2001 - 1000) / 256.0);
+			memcpy(&state.ps[i][j], &value, sizeof(value));
+		}
+	}
+
+	const double constants[4] = {0.5, (rand() % 200 - 100) / 128.0, 0.25, 3.0};
+	for (int i = 0; i < 4; i++)
+	{
+		memcpy(&state.ps[FREG_HALF + i][0], &constants[i], sizeof(double));
+		memcpy(&state.ps[FREG_HALF + i][1], &constants[i], sizeof(double));
+	}
+
+	state.cr = 0;
+	state.xer = 0;
+	state.lr = 0;
+	state.ctr = 0;
+
+	// Finite floats, which also make fine integers
+	state.data.resize(DATA_SIZE);
+	for (size_t i = 0; i < DATA_SIZE; i += 4)
+	{
+		float value = (rand() % 2001 - 1000) / 8.0f;
+		u32 bits;
+		memcpy(&bits, &value, sizeof(bits));
+		bits = Common::swap32(bits);
+		memcpy(&state.data[i], &bits, sizeof(bits));
+	}
+}
+
+void LoadSnapshot(const Snapshot &state)
+{
+	memcpy(rGPR, state.gpr, sizeof(state.gpr));
+	memcpy(PowerPC::ppcState.ps, state.ps, sizeof(state.ps));
+	SetCR(state.cr);
+	SetXER(UReg_XER(state.xer));
+	LR = state.lr;
+	CTR = state.ctr;
+	memcpy(Memory::GetPointer(DATA_ADDRESS), &state.data[0], DATA_SIZE);
+
+	PowerPC::ppcState.fpscr = 0;
+	PowerPC::ppcState.Exceptions = 0;
+	MSR = 0x2000; // FP available
+	PowerPC::ppcState.spr[SPR_HID2] = 0xA0000000; // Paired singles and quantized loads and stores
+	PC = CODE_ADDRESS;
+	NPC = CODE_ADDRESS;
+}
+
+void SaveSnapshot(Snapshot &state)
+{
+	memcpy(state.gpr, rGPR, sizeof(state.gpr));
+	memcpy(state.ps, PowerPC::ppcState.ps, sizeof(state.ps));
+	state.cr = GetCR();
+	state.xer = GetXER().Hex;
+	state.lr = LR;
+	state.ctr = CTR;
+	state.data.resize(DATA_SIZE);
+	memcpy(&state.data[0], Memory::GetPointer(DATA_ADDRESS), DATA_SIZE);
+}
+
+void CompareSnapshots(const Snapshot &state, const Snapshot &expected, const char *core, const char *kernel)
+{
+	int differences = 0;
+	for (int i = 0; i < 32; i++)
+	{
+		if (state.gpr[i] != expected.gpr[i])
+		{
+			printf("  r%d is %08x, expected %08x\n", i, state.gpr[i], expected.gpr[i]);
+			differences++;
+		}
+		for (int j = 0; j < 2; j++)
+		{
+			if (state.ps[i][j] != expected.ps[i][j])
+			{
+				printf("  f%d ps%d is %016llx, expected %016llx\n", i, j,
+					(unsigned long long)state.ps[i][j], (unsigned long long)expected.ps[i][j]);
+				differences++;
+			}
+		}
+	}
+
+	const u32 sprs[4][2] = {
+		{state.cr, expected.cr}, {state.xer, expected.xer}, {state.lr, expected.lr}, {state.ctr, expected.ctr},
+	};
+	const char *const spr_names[4] = {"cr", "xer", "lr", "ctr"};
+	for (int i = 0; i < 4; i++)
+	{
+		if (sprs[i][0] != sprs[i][1])
+		{
+			printf("  %s is %08x, expected %08x\n", spr_names[i], sprs[i][0], sprs[i][1]);
+			differences++;
+		}
+	}
+
+	for (size_t i = 0; i < DATA_SIZE; i++)
+	{
+		if (state.data[i] != expected.data[i])
+		{
+			printf("  first memory difference at %08x: %02x, expected %02x\n",
+				DATA_ADDRESS + (u32)i, state.data[i], expected.data[i]);
+			differences++;
+			break;
+		}
+	}
+
+	if (differences)
+	{
+		std::cout << "FAIL (" << __FUNCTION__ << "): " << core << " differs from the interpreter on the "
+			<< kernel << " kernel" << std::endl;
+		fail_count++;
+	}
+}
+
+// Single steps the interpreter through the kernel to count the executed
+// instructions and record the state every core has to end up in
+u64 RunReference(Snapshot &result)
+{
+	u64 instructions = 0;
+	*PowerPC::GetStatePtr() = PowerPC::CPU_RUNNING;
+	while (PC != s_stop_address)
+	{
+		Interpreter::getInstance()->SingleStep();
+		instructions++;
+	}
+	*PowerPC::GetStatePtr() = PowerPC::CPU_STEPPING;
+	SaveSnapshot(result);
+	return instructions;
+}
+
+u64 RunCore()
+{
+	CoreTiming::RemoveAllEvents(s_et_stop);
+	CoreTiming::ScheduleEvent(STOP_CHECK_CYCLES, s_et_stop);
+	*PowerPC::GetStatePtr() = PowerPC::CPU_RUNNING;
+	u64 start = Common::Timer::GetTimeNs();
+	cpu_core_base->Run();
+	return Common::Timer::GetTimeNs() - start;
+}
+
+}  // namespace
+
+void CoreTests()
+{
+	SConfig::Init();
+	SCoreStartupParameter &startup = SConfig::GetInstance().m_LocalCoreStartupParameter;
+	startup.bWii = false;
+	startup.bMMU = false;
+	startup.bTLBHack = false;
+	startup.bFastmem = true;
+	startup.bSkipIdle = false;
+	startup.bEnableDebugging = false;
+	startup.bJITOff = false;
+	Core::g_CoreStartupParameter = startup;
+
+	VideoBackend::PopulateList();
+	VideoBackend::ActivateBackend("");
+	Memory::Init();
+	CoreTiming::Init();
+	s_et_stop = CoreTiming::RegisterEvent("CoreTestsStop", StopCheckCallback);
+
+	std::vector<Snapshot> initial(NUM_KERNELS), expected(NUM_KERNELS);
+	u64 instructions[NUM_KERNELS];
+	double ns_per_instruction[NUM_CORES][NUM_KERNELS] = {{0}};
+
+#ifdef _M_GENERIC
+	const int num_cores = 2;
+#else
+	const int num_cores = NUM_CORES;
+#endif
+	for (int core = 0; core < num_cores; core++)
+	{
+		PowerPC::Init(s_core_ids[core]);
+		for (int k = 0; k < NUM_KERNELS; k++)
+		{
+			LoadKernel(s_kernels[k]);
+			JitInterface::ClearCache();
+			PowerPC::ppcState.iCache.Reset();
+
+			if (core == 0)
+			{
+				RandomSnapshot(initial[k]);
+				LoadSnapshot(initial[k]);
+				instructions[k] = RunReference(expected[k]);
+			}
+
+			// The first run compiles, the second one is timed
+			LoadSnapshot(initial[k]);
+			RunCore();
+			LoadSnapshot(initial[k]);
+			u64 time = RunCore();
+			ns_per_instruction[core][k] = (double)time / instructions[k];
+
+			Snapshot result;
+			SaveSnapshot(result);
+			CompareSnapshots(result, expected[k], s_core_names[core], s_kernels[k].name);
+		}
+		PowerPC::Shutdown();
+	}
+
+	printf("CPU cores, host ns per guest instruction:\n");
+	for (int k = 0; k < NUM_KERNELS; k++)
+	{
+		printf("  %-24s %9llu instructions", s_kernels[k].name, (unsigned long long)instructions[k]);
+		for (int core = 0; core < num_cores; core++)
+			printf("  %s %6.2f", s_core_names[core], ns_per_instruction[core][k]);
+		printf("\n");
+	}
+
+	CoreTiming::Shutdown();
+	Memory::Shutdown();
+	VideoBackend::ClearList();
+	SConfig::Shutdown();
+}
@@ -0,0 +1,179 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+// Checks the SSE and parallel versions of the software renderer's EFB to
+// texture copies and XFB to RGBA conversion against the scalar code running
+// as a single job.
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "Common.h"
+#include "BPMemory.h"
+#include "../Core/VideoBackends/Software/EfbInterface.h"
+#include "../Core/VideoBackends/Software/SWRenderer.h"
+#include "../Core/VideoBackends/Software/TextureEncoder.h"
+#include "../Core/VideoBackends/Software/WorkerPool.h"
+
+extern int fail_count;
+
+namespace
+{
+
+enum
+{
+	NUM_COPIES = 500,
+	NUM_CONVERSIONS = 50,
+	// Job counts the fast paths run with, beyond the number of helper threads
+	MAX_JOBS = 5,
+	// EFB rows of the tallest blocks, the 8 rows of 4 bit formats at half scale
+	BLOCK_ROWS = 16,
+	// Big enough for the largest stride the copies get
+	TEXTURE_SIZE = 2 << 20,
+	XFB_WIDTH = 640,
+	XFB_HEIGHT = 576,
+};
+
+// The copy formats the encoders know, I8 (1) only as an intensity format
+const u32 s_colorFormats[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12 };
+const u32 s_depthFormats[] = { 0, 1, 3, 6, 9, 10, 11, 12 };
+
+u32 Random()
+{
+	return (u32)rand() << 16 ^ (u32)rand();
+}
+
+void FillRandom(u8 *data, u32 size)
+{
+	for (u32 i = 0; i < size; i++)
+		data[i] = rand();
+}
+
+void RandomCopy()
+{
+	memset(&bpmem, 0, sizeof(bpmem));
+
+	// RGB8, RGBA6, RGB565 or Z24
+	bpmem.zcontrol.pixel_format = Random() % 4;
+	bpmem.triggerEFBCopy.intensity_fmt = Random() & 1;
+	bpmem.triggerEFBCopy.half_scale = Random() & 1;
+
+	u32 copyfmt;
+	if (bpmem.zcontrol.pixel_format == PIXELFMT_Z24)
+	{
+		copyfmt = s_depthFormats[Random() % ArraySize(s_depthFormats)];
+	}
+	else
+	{
+		copyfmt = s_colorFormats[Random() % ArraySize(s_colorFormats)];
+		if (copyfmt == 1)
+			bpmem.triggerEFBCopy.intensity_fmt = 1;
+	}
+	bpmem.triggerEFBCopy.target_pixel_format = copyfmt < 8 ? copyfmt * 2 : (copyfmt - 8) * 2 + 1;
+
+	// Mostly full sized copies, but also small ones that leave blocks half empty.
+	// The encoders read whole blocks, which mustn't go past the end of the EFB.
+	const u32 width = (Random() & 3) ? Random() % EFB_WIDTH : Random() % 32;
+	const u32 height = (Random() & 3) ? Random() % (EFB_HEIGHT - BLOCK_ROWS) : Random() % 32;
+	bpmem.copyTexSrcXY.x = Random() % (EFB_WIDTH - width);
+	bpmem.copyTexSrcXY.y = Random() % (EFB_HEIGHT - BLOCK_ROWS - height);
+	bpmem.copyTexSrcWH.x = width;
+	bpmem.copyTexSrcWH.y = height;
+
+	// Strides that are too small make rows of blocks overlap
+	const u32 stride = ((width >> bpmem.triggerEFBCopy.half_scale) / 4 + 1) * 2;
+	bpmem.copyMipMapStrideChannels = (Random() % 3) ? stride + Random() % 3 : 1 + Random() % (stride + 4);
+}
+
+void EncoderTests()
+{
+	std::vector<u8> expected(TEXTURE_SIZE);
+	std::vector<u8> result(TEXTURE_SIZE);
+
+	u8 *efb = EfbInterface::GetPixelPointer(0, 0, false);
+	FillRandom(efb, EFB_WIDTH * EFB_HEIGHT * 6);
+
+	for (int copy = 0; copy < NUM_COPIES; copy++)
+	{
+		RandomCopy();
+
+		const u8 fill = Random();
+		memset(&expected[0], fill, TEXTURE_SIZE);
+		TextureEncoder::Encode(&expected[0], false, 1);
+
+		for (int simd = 0; simd < 2; simd++)
+		{
+			for (int jobs = 1; jobs <= MAX_JOBS; jobs++)
+			{
+				memset(&result[0], fill, TEXTURE_SIZE);
+				TextureEncoder::Encode(&result[0], simd != 0, jobs);
+
+				if (memcmp(&expected[0], &result[0], TEXTURE_SIZE))
+				{
+					std::cout << "FAIL (" << __FUNCTION__ << "): copy " << copy
+						<< " pixel format " << bpmem.zcontrol.pixel_format
+						<< " target format " << bpmem.triggerEFBCopy.target_pixel_format
+						<< " intensity " << bpmem.triggerEFBCopy.intensity_fmt
+						<< " half scale " << bpmem.triggerEFBCopy.half_scale
+						<< " size " << bpmem.copyTexSrcWH.x + 1 << "x" << bpmem.copyTexSrcWH.y + 1
+						<< " stride " << bpmem.copyMipMapStrideChannels
+						<< " simd " << simd << " jobs " << jobs << std::endl;
+					fail_count++;
+					return;
+				}
+			}
+		}
+	}
+}
+
+void ColorTextureTests()
+{
+	// The conversion reads one sample beyond odd widths
+	std::vector<EfbInterface::yuv422_packed> xfb(XFB_WIDTH * XFB_HEIGHT + 1);
+	FillRandom((u8*)&xfb[0], (u32)xfb.size() * sizeof(xfb[0]));
+
+	const u32 textureSize = XFB_WIDTH * XFB_HEIGHT * 4;
+	std::vector<u8> expected(textureSize);
+	std::vector<u8> result(textureSize);
+
+	for (int conversion = 0; conversion < NUM_CONVERSIONS; conversion++)
+	{
+		const u32 width = 1 + Random() % XFB_WIDTH;
+		const u32 height = 1 + Random() % XFB_HEIGHT;
+
+		memset(&expected[0], 0, textureSize);
+		SWRenderer::ConvertColorTexture(&expected[0], &xfb[0], width, height, false, 1);
+
+		for (int simd = 0; simd < 2; simd++)
+		{
+			for (int jobs = 1; jobs <= MAX_JOBS; jobs++)
+			{
+				memset(&result[0], 0, textureSize);
+				SWRenderer::ConvertColorTexture(&result[0], &xfb[0], width, height, simd != 0, jobs);
+
+				if (memcmp(&expected[0], &result[0], textureSize))
+				{
+					std::cout << "FAIL (" << __FUNCTION__ << "): XFB of " << width << "x" << height
+						<< " simd " << simd << " jobs " << jobs << std::endl;
+					fail_count++;
+					return;
+				}
+			}
+		}
+	}
+}
+
+}  // namespace
+
+void EfbCopyTests()
+{
+	WorkerPool::Init();
+
+	EncoderTests();
+	ColorTextureTests();
+
+	WorkerPool::Shutdown();
+}
@@ -0,0 +1,192 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+// Checks the vector index kernels against the scalar ones for every primitive
+// and measures both on a few representative primitive mixes.
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "Common.h"
+#include "Timer.h"
+#include "VideoConfig.h"
+#include "IndexGenerator.h"
+
+extern int fail_count;
+
+namespace
+{
+
+enum
+{
+	PRIM_QUADS = 0,
+	PRIM_TRIANGLES = 2,
+	PRIM_TRIANGLE_STRIP = 3,
+	PRIM_TRIANGLE_FAN = 4,
+	PRIM_LINES = 5,
+	PRIM_LINE_STRIP = 6,
+	PRIM_POINTS = 7,
+
+	MAX_TEST_VERTICES = 100,
+	// Worst case is a primitive restart fan, plus some slack to catch overruns
+	INDEX_BUFFER_SIZE = 65536 * 3 + 64,
+};
+
+const char *const s_primitive_names[8] = {
+	"quads", "", "triangles", "triangle strip", "triangle fan", "lines", "line strip", "points",
+};
+
+struct Draw
+{
+	int primitive;
+	u32 num_verts;
+};
+
+std::vector<u16> s_output[2];
+
+// Runs the draws through the index generator and returns the number of indices written
+u32 Generate(bool use_simd, const Draw *draws, size_t num_draws, std::vector<u16> &output)
+{
+	IndexGenerator::Init(use_simd);
+	IndexGenerator::Start(&output[0]);
+	for (size_t i = 0; i < num_draws; i++)
+		IndexGenerator::AddIndices(draws[i].primitive, draws[i].num_verts);
+	return IndexGenerator::GetIndexLen();
+}
+
+void TestDraws(const Draw *draws, size_t num_draws, const char *what)
+{
+	u32 len[2];
+	for (int i = 0; i < 2; i++)
+	{
+		s_output[i].assign(s_output[i].size(), 0xCDCD);
+		len[i] = Generate(i == 1, draws, num_draws, s_output[i]);
+	}
+
+	if (len[0] != len[1] || memcmp(&s_output[0][0], &s_output[1][0], s_output[0].size() * sizeof(u16)))
+	{
+		std::cout << "FAIL (" << __FUNCTION__ << "): " << what
+			<< (g_Config.backend_info.bSupportsPrimitiveRestart ? " with" : " without")
+			<< " primitive restart, " << len[1] << " indices, expected " << len[0] << std::endl;
+		for (size_t i = 0; i < s_output[0].size(); i++)
+		{
+			if (s_output[0][i] != s_output[1][i])
+			{
+				std::cout << "First difference at index " << i << ": " << s_output[1][i]
+					<< ", expected " << s_output[0][i] << std::endl;
+				break;
+			}
+		}
+		fail_count++;
+	}
+}
+
+void PrimitiveTests()
+{
+	for (int primitive = PRIM_QUADS; primitive <= PRIM_POINTS; primitive++)
+	{
+		if (primitive == 1)
+			continue;
+
+		for (u32 num_verts = 0; num_verts <= MAX_TEST_VERTICES; num_verts++)
+		{
+			// Put another draw in front, so the kernels don't always start at index 0
+			const Draw draws[2] = {
+				{PRIM_TRIANGLES, (u32)(rand() % 64)},
+				{primitive, num_verts},
+			};
+			TestDraws(draws, 2, s_primitive_names[primitive]);
+		}
+	}
+
+	// A full buffer, the indices wrap close to the primitive restart index
+	const Draw full[1] = {{PRIM_QUADS, IndexGenerator::GetRemainingIndices() / 4 * 4}};
+	TestDraws(full, 1, "full buffer of quads");
+}
+
+void BenchmarkMix(const char *name, const Draw *draws, size_t num_draws)
+{
+	const int runs = 2000;
+	double rates[2];
+	for (int i = 0; i < 2; i++)
+	{
+		u64 indices = 0;
+		u64 start = Common::Timer::GetTimeNs();
+		for (int run = 0; run < runs; run++)
+			indices += Generate(i == 1, draws, num_draws, s_output[i]);
+		u64 time = Common::Timer::GetTimeNs() - start;
+		rates[i] = time ? (double)indices * 1e9 / time : 0;
+	}
+	printf("%-40s scalar %7.1f Midx/s  simd %7.1f Midx/s\n", name, rates[0] / 1e6, rates[1] / 1e6);
+}
+
+void Benchmarks()
+{
+	// Character models, mostly long triangle lists with a few strips
+	std::vector<Draw> models;
+	for (int i = 0; i < 64; i++)
+	{
+		Draw draw = {PRIM_TRIANGLES, 3 * (16 + (u32)(rand() % 128))};
+		models.push_back(draw);
+		Draw strip = {PRIM_TRIANGLE_STRIP, 4 + (u32)(rand() % 32)};
+		models.push_back(strip);
+	}
+
+	// 2D games and UI, lots of small quads
+	std::vector<Draw> sprites;
+	for (int i = 0; i < 1024; i++)
+	{
+		Draw draw = {PRIM_QUADS, 4};
+		sprites.push_back(draw);
+	}
+
+	// Particles and text, a few huge quad batches
+	std::vector<Draw> particles;
+	for (int i = 0; i < 16; i++)
+	{
+		Draw draw = {PRIM_QUADS, 4 * (256 + (u32)(rand() % 256))};
+		particles.push_back(draw);
+	}
+
+	// Terrain, strips and fans
+	std::vector<Draw> terrain;
+	for (int i = 0; i < 128; i++)
+	{
+		Draw strip = {PRIM_TRIANGLE_STRIP, 16 + (u32)(rand() % 64)};
+		terrain.push_back(strip);
+		Draw fan = {PRIM_TRIANGLE_FAN, 3 + (u32)(rand() % 8)};
+		terrain.push_back(fan);
+	}
+
+	for (int pr = 0; pr < 2; pr++)
+	{
+		g_Config.backend_info.bSupportsPrimitiveRestart = pr != 0;
+		printf("Index generation %s primitive restart:\n", pr ? "with" : "without");
+		BenchmarkMix("  triangle lists and strips", &models[0], models.size());
+		BenchmarkMix("  small quads", &sprites[0], sprites.size());
+		BenchmarkMix("  large quad batches", &particles[0], particles.size());
+		BenchmarkMix("  strips and fans", &terrain[0], terrain.size());
+	}
+}
+
+}  // namespace
+
+void IndexGeneratorTests()
+{
+	const bool primitive_restart = g_Config.backend_info.bSupportsPrimitiveRestart;
+
+	s_output[0].resize(INDEX_BUFFER_SIZE);
+	s_output[1].resize(INDEX_BUFFER_SIZE);
+
+	g_Config.backend_info.bSupportsPrimitiveRestart = false;
+	PrimitiveTests();
+	g_Config.backend_info.bSupportsPrimitiveRestart = true;
+	PrimitiveTests();
+
+	Benchmarks();
+
+	g_Config.backend_info.bSupportsPrimitiveRestart = primitive_restart;
+}
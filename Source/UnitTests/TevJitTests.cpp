@@ -0,0 +1,216 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+// Runs random TEV configs through the software renderer's TEV JIT and its
+// interpreter and checks that both draw the same pixels. The registers and
+// texture coordinates carry over to the next pixel, so a difference in them
+// shows up in a later one.
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "Common.h"
+#include "ConfigManager.h"
+#include "Core.h"
+#include "HW/Memmap.h"
+#include "BPMemory.h"
+#include "../Core/VideoBackends/Software/EfbInterface.h"
+#include "../Core/VideoBackends/Software/SWVideoConfig.h"
+#include "../Core/VideoBackends/Software/Tev.h"
+#include "../Core/VideoBackends/Software/TevJit.h"
+
+extern int fail_count;
+
+namespace
+{
+
+enum
+{
+	NUM_CONFIGS = 20000,
+	PIXELS_PER_CONFIG = 8,
+	// The textures are small and all start at address 0
+	TEXTURE_DATA_SIZE = 0x10000,
+};
+
+// Indices into s_tev
+enum
+{
+	INTERPRETER = 0,
+	JIT = 1,
+};
+
+Tev s_tev[2];
+
+u32 Random()
+{
+	return (u32)rand() << 16 ^ (u32)rand();
+}
+
+void RandomConfig()
+{
+	memset(&bpmem, 0, sizeof(bpmem));
+
+	bpmem.genMode.numtevstages = Random() % 16;
+	bpmem.genMode.numindstages = Random() % 5;
+	bpmem.tevindref.hex = Random();
+
+	for (int i = 0; i < 16; i++)
+	{
+		bpmem.combiners[i].colorC.hex = Random() & 0xFFFFFF;
+		bpmem.combiners[i].alphaC.hex = Random() & 0xFFFFFF;
+		// Half of the stages don't use indirect texturing at all
+		bpmem.tevind[i].hex = (Random() & 1) ? Random() & 0x1FFFFF : 0;
+	}
+
+	for (int i = 0; i < 8; i++)
+	{
+		bpmem.tevorders[i].hex = Random() & 0xFFFFFF;
+		bpmem.tevksel[i].hex = Random() & 0xFFFFFF;
+
+		// Konst selections 8-11 are reserved
+		TevKSel &ksel = bpmem.tevksel[i];
+		if (ksel.kcsel0 >= 8 && ksel.kcsel0 < 12)
+			ksel.kcsel0 = 0;
+		if (ksel.kcsel1 >= 8 && ksel.kcsel1 < 12)
+			ksel.kcsel1 = 0;
+		if (ksel.kasel0 >= 8 && ksel.kasel0 < 12)
+			ksel.kasel0 = 0;
+		if (ksel.kasel1 >= 8 && ksel.kasel1 < 12)
+			ksel.kasel1 = 0;
+
+		// I4 textures of up to 64x64 texels
+		bpmem.tex[i >> 2].texImage0[i & 3].width = Random() & 63;
+		bpmem.tex[i >> 2].texImage0[i & 3].height = Random() & 63;
+	}
+
+	for (int i = 0; i < 3; i++)
+	{
+		bpmem.indmtx[i].col0.hex = Random();
+		bpmem.indmtx[i].col1.hex = Random();
+		bpmem.indmtx[i].col2.hex = Random();
+	}
+
+	bpmem.alpha_test.hex = Random() & 0x3FFFFF;
+
+	bpmem.zcontrol.pixel_format = PIXELFMT_RGBA6_Z24;
+	bpmem.blendmode.colorupdate = 1;
+	bpmem.blendmode.alphaupdate = 1;
+}
+
+// Returns false after reporting the first difference
+bool DrawPixel(int config)
+{
+	const u16 x = Random() % EFB_WIDTH;
+	const u16 y = Random() % EFB_HEIGHT;
+	const s32 z = Random() & 0xFFFFFF;
+
+	u8 color[2][4];
+	for (int i = 0; i < 2; i++)
+		for (int c = 0; c < 4; c++)
+			color[i][c] = Random();
+
+	s32 uv[8][2];
+	for (int i = 0; i < 8; i++)
+	{
+		uv[i][0] = Random();
+		uv[i][1] = Random();
+	}
+
+	u8 pixel[2][4];
+	for (int t = 0; t < 2; t++)
+	{
+		Tev &tev = s_tev[t];
+		tev.Position[0] = x;
+		tev.Position[1] = y;
+		tev.Position[2] = z;
+		memcpy(tev.Color, color, sizeof(color));
+		for (int i = 0; i < 8; i++)
+		{
+			tev.Uv[i].s = uv[i][0];
+			tev.Uv[i].t = uv[i][1];
+		}
+		memset(tev.TextureLod, 0, sizeof(tev.TextureLod));
+		memset(tev.TextureLinear, 0, sizeof(tev.TextureLinear));
+		memset(tev.IndirectLod, 0, sizeof(tev.IndirectLod));
+		memset(tev.IndirectLinear, 0, sizeof(tev.IndirectLinear));
+
+		// A pixel that fails the alpha test keeps this color
+		u8 background[4] = { 0x12, 0x34, 0x56, 0x78 };
+		EfbInterface::SetColor(x, y, background);
+		tev.Draw();
+		EfbInterface::GetColor(x, y, pixel[t]);
+	}
+
+	if (memcmp(pixel[INTERPRETER], pixel[JIT], sizeof(pixel[0])))
+	{
+		std::cout << "FAIL (" << __FUNCTION__ << "): config " << config << " with "
+			<< bpmem.genMode.numtevstages + 1 << " stages, pixel " << std::hex
+			<< *(u32*)pixel[JIT] << ", expected " << *(u32*)pixel[INTERPRETER] << std::dec << std::endl;
+		for (unsigned int i = 0; i <= bpmem.genMode.numtevstages; i++)
+		{
+			std::cout << "Stage " << i << ": order " << std::hex << bpmem.tevorders[i >> 1].hex
+				<< " color " << bpmem.combiners[i].colorC.hex << " alpha " << bpmem.combiners[i].alphaC.hex
+				<< " indirect " << bpmem.tevind[i].hex << std::dec << std::endl;
+		}
+		fail_count++;
+		return false;
+	}
+
+	return true;
+}
+
+}  // namespace
+
+void TevJitTests()
+{
+	SConfig::Init();
+	SCoreStartupParameter &startup = SConfig::GetInstance().m_LocalCoreStartupParameter;
+	startup.bWii = false;
+	Core::g_CoreStartupParameter = startup;
+	Memory::Init();
+
+	u8 *textures = Memory::GetPointer(0);
+	for (int i = 0; i < TEXTURE_DATA_SIZE; i++)
+		textures[i] = rand();
+
+	const bool use_jit = g_SWVideoConfig.bTevJit;
+	TevJit::Init();
+	s_tev[INTERPRETER].Init();
+	s_tev[JIT].Init();
+
+	for (int config = 0; config < NUM_CONFIGS; config++)
+	{
+		RandomConfig();
+		for (int r = 0; r < 4; r++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				const s16 value = (s16)(Random() % 2048) - 1024;
+				const s16 konst = Random() & 0xFF;
+				for (int t = 0; t < 2; t++)
+				{
+					s_tev[t].SetRegColor(r, c, false, value);
+					s_tev[t].SetRegColor(r, c, true, konst);
+				}
+			}
+		}
+
+		g_SWVideoConfig.bTevJit = false;
+		s_tev[INTERPRETER].SetupStages();
+		g_SWVideoConfig.bTevJit = true;
+		s_tev[JIT].SetupStages();
+
+		bool passed = true;
+		for (int pixel = 0; pixel < PIXELS_PER_CONFIG && passed; pixel++)
+			passed = DrawPixel(config);
+		if (!passed)
+			break;
+	}
+
+	g_SWVideoConfig.bTevJit = use_jit;
+	TevJit::Shutdown();
+	Memory::Shutdown();
+	SConfig::Shutdown();
+}
@@ -24,6 +24,11 @@
 #include "HW/SI_DeviceGCController.h"
 
 void AudioJitTests();
+void CoreTests();
+void EfbCopyTests();
+void IndexGeneratorTests();
+void TevJitTests();
+void VertexLoaderTests();
 
 using namespace std;
 int fail_count = 0;
@@ -49,10 +54,6 @@ int fail_count = 0;
 		fail_count++; \
 	}
 
-void CoreTests()
-{
-}
-
 void MathTests()
 {
 	// Tests that our fp classifier is correct.
@@ -137,6 +138,10 @@ int main(int argc, char* argv[])
 	CoreTests();
 	MathTests();
 	StringTests();
+	IndexGeneratorTests();
+	VertexLoaderTests();
+	TevJitTests();
+	EfbCopyTests();
 	if (fail_count == 0)
 	{
 		printf("All tests passed.\n");
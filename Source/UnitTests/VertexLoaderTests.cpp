@@ -0,0 +1,344 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2
+// Refer to the license.txt file included.
+
+// Checks the inline vertex translator against the pipeline functions for
+// every component format and measures both.
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "Common.h"
+#include "CPUDetect.h"
+#include "Timer.h"
+#include "VideoConfig.h"
+#include "CPMemory.h"
+#include "DataReader.h"
+#include "NativeVertexFormat.h"
+#include "VertexLoader.h"
+#include "VertexManagerBase.h"
+
+extern int fail_count;
+
+namespace
+{
+
+class TestNativeVertexFormat : public NativeVertexFormat
+{
+public:
+	void Initialize(const PortableVertexDeclaration &vtx_decl) { vertex_stride = vtx_decl.stride; }
+	void SetupVertexPointers() {}
+};
+
+class TestVertexManager : public VertexManager
+{
+public:
+	NativeVertexFormat* CreateNativeVertexFormat() { return new TestNativeVertexFormat; }
+
+protected:
+	void ResetBuffer(u32 stride) {}
+
+private:
+	void vFlush() {}
+};
+
+enum
+{
+	NUM_VERTICES = 1024,
+	// Large enough for any vertex, plus the bytes the loaders may read or write past it
+	MAX_VERTEX_SIZE = 256,
+	ARRAY_STRIDE = 40,
+	ARRAY_SIZE = 0x10000 * ARRAY_STRIDE + 64,
+};
+
+std::vector<u8> s_source;
+std::vector<u8> s_arrays;
+std::vector<u8> s_output[2];
+
+void FillRandom(std::vector<u8> &buffer)
+{
+	for (size_t i = 0; i < buffer.size(); i++)
+		buffer[i] = (u8)rand();
+}
+
+void Translate(VertexLoader &loader, int count, bool use_inline, std::vector<u8> &output)
+{
+	g_pVideoData = &s_source[16];
+	VertexManager::s_pCurBufferPointer = &output[0];
+	loader.TranslateVertices(0, count, use_inline);
+}
+
+// Returns the number of vertices per second each translator managed
+void Benchmark(VertexLoader &loader, double *rates)
+{
+	const int runs = 200;
+	for (int i = 0; i < 2; i++)
+	{
+		u64 start = Common::Timer::GetTimeNs();
+		for (int run = 0; run < runs; run++)
+			Translate(loader, NUM_VERTICES, i == 1, s_output[i]);
+		u64 time = Common::Timer::GetTimeNs() - start;
+		rates[i] = time ? (double)runs * NUM_VERTICES * 1e9 / time : 0;
+	}
+}
+
+void TestFormat(const TVtxDesc &desc, VAT vat, const char *what, bool benchmark = false)
+{
+	// Fractions are not part of the loader, use a random one for every run
+	vat.g0.PosFrac = rand() & 31;
+	vat.g0.Tex0Frac = rand() & 31;
+	vat.g1.Tex1Frac = rand() & 31;
+	vat.g1.Tex2Frac = rand() & 31;
+	vat.g1.Tex3Frac = rand() & 31;
+	vat.g2.Tex4Frac = rand() & 31;
+	vat.g2.Tex5Frac = rand() & 31;
+	vat.g2.Tex6Frac = rand() & 31;
+	vat.g2.Tex7Frac = rand() & 31;
+	vat.g0.ByteDequant = 1;
+	g_VtxAttr[0] = vat;
+
+	VertexLoader loader(desc, vat);
+	std::string name;
+	loader.AppendToString(&name);
+	name.erase(name.find(" - "));
+
+	if (!loader.HasInlineTranslator())
+	{
+		std::cout << "FAIL (" << __FUNCTION__ << "): no inline translator for " << what << ": " << name << std::endl;
+		fail_count++;
+		return;
+	}
+
+	FillRandom(s_source);
+	s_output[0].assign(s_output[0].size(), 0xCD);
+	s_output[1].assign(s_output[1].size(), 0xCD);
+
+	// Odd count, so that both the single vertex and the unrolled path run
+	const int count = NUM_VERTICES - 1;
+	Translate(loader, count, false, s_output[0]);
+	u8 *pipeline_end = g_pVideoData;
+	Translate(loader, count, true, s_output[1]);
+	u8 *inline_end = g_pVideoData;
+
+	const size_t size = count * loader.GetNativeVertexStride();
+	if (pipeline_end != inline_end || memcmp(&s_output[0][0], &s_output[1][0], size))
+	{
+		std::cout << "FAIL (" << __FUNCTION__ << "): " << what << ": " << name << std::endl;
+		for (size_t i = 0; i < size; i++)
+		{
+			if (s_output[0][i] != s_output[1][i])
+			{
+				std::cout << "First difference at byte " << i << " of " << size << ", stride "
+					<< loader.GetNativeVertexStride() << std::endl;
+				break;
+			}
+		}
+		fail_count++;
+		return;
+	}
+
+	if (benchmark)
+	{
+		double rates[2];
+		Benchmark(loader, rates);
+		printf("%-60s pipeline %7.1f Mvtx/s  inline %7.1f Mvtx/s\n", name.c_str(), rates[0] / 1e6, rates[1] / 1e6);
+	}
+}
+
+TVtxDesc PositionOnly()
+{
+	TVtxDesc desc;
+	desc.Hex = 0;
+	desc.Position = DIRECT;
+	return desc;
+}
+
+VAT FloatPosition()
+{
+	VAT vat;
+	vat.g0.Hex = 0;
+	vat.g1.Hex = 0;
+	vat.g2.Hex = 0;
+	vat.g0.PosElements = 1;
+	vat.g0.PosFormat = FORMAT_FLOAT;
+	return vat;
+}
+
+void SetTexCoord(TVtxDesc &desc, VAT &vat, int i, int mode, int format, int elements)
+{
+	desc.Hex &= ~(3ULL << (17 + 2 * i));
+	desc.Hex |= (u64)mode << (17 + 2 * i);
+	switch (i)
+	{
+	case 0: vat.g0.Tex0CoordFormat = format; vat.g0.Tex0CoordElements = elements; break;
+	case 1: vat.g1.Tex1CoordFormat = format; vat.g1.Tex1CoordElements = elements; break;
+	case 2: vat.g1.Tex2CoordFormat = format; vat.g1.Tex2CoordElements = elements; break;
+	case 3: vat.g1.Tex3CoordFormat = format; vat.g1.Tex3CoordElements = elements; break;
+	case 4: vat.g1.Tex4CoordFormat = format; vat.g1.Tex4CoordElements = elements; break;
+	case 5: vat.g2.Tex5CoordFormat = format; vat.g2.Tex5CoordElements = elements; break;
+	case 6: vat.g2.Tex6CoordFormat = format; vat.g2.Tex6CoordElements = elements; break;
+	case 7: vat.g2.Tex7CoordFormat = format; vat.g2.Tex7CoordElements = elements; break;
+	}
+}
+
+void PositionTests()
+{
+	for (int mode = DIRECT; mode <= INDEX16; mode++)
+	for (int format = FORMAT_UBYTE; format <= FORMAT_FLOAT; format++)
+	for (int elements = 0; elements < 2; elements++)
+	{
+		TVtxDesc desc = PositionOnly();
+		desc.Position = mode;
+		VAT vat = FloatPosition();
+		vat.g0.PosFormat = format;
+		vat.g0.PosElements = elements;
+		TestFormat(desc, vat, "position");
+
+		desc.PosMatIdx = 1;
+		TestFormat(desc, vat, "position with matrix index");
+	}
+}
+
+void NormalTests()
+{
+	for (int mode = DIRECT; mode <= INDEX16; mode++)
+	for (int format = FORMAT_UBYTE; format <= FORMAT_FLOAT; format++)
+	for (int elements = 0; elements < 2; elements++)
+	for (int index3 = 0; index3 < 2; index3++)
+	{
+		TVtxDesc desc = PositionOnly();
+		desc.Normal = mode;
+		VAT vat = FloatPosition();
+		vat.g0.NormalFormat = format;
+		vat.g0.NormalElements = elements;
+		vat.g0.NormalIndex3 = index3;
+		TestFormat(desc, vat, "normal");
+	}
+}
+
+void ColorTests()
+{
+	for (int mode = DIRECT; mode <= INDEX16; mode++)
+	for (int format = FORMAT_16B_565; format <= FORMAT_32B_8888; format++)
+	for (int elements = 0; elements < 2; elements++)
+	{
+		TVtxDesc desc = PositionOnly();
+		VAT vat = FloatPosition();
+		vat.g0.Color0Comp = format;
+		vat.g0.Color0Elements = elements;
+		vat.g0.Color1Comp = format;
+		vat.g0.Color1Elements = !elements;
+
+		desc.Color0 = mode;
+		TestFormat(desc, vat, "color 0");
+
+		// Color 1 on its own uses the array and element count of color 0
+		desc.Color0 = NOT_PRESENT;
+		desc.Color1 = mode;
+		TestFormat(desc, vat, "color 1");
+
+		desc.Color0 = DIRECT;
+		vat.g0.Color0Comp = FORMAT_16B_565;
+		TestFormat(desc, vat, "both colors");
+	}
+}
+
+void TexCoordTests()
+{
+	const int coords[3] = {0, 3, 7};
+	for (int c = 0; c < 3; c++)
+	for (int mode = DIRECT; mode <= INDEX16; mode++)
+	for (int format = FORMAT_UBYTE; format <= FORMAT_FLOAT; format++)
+	for (int elements = 0; elements < 2; elements++)
+	{
+		const int i = coords[c];
+		TVtxDesc desc = PositionOnly();
+		VAT vat = FloatPosition();
+		SetTexCoord(desc, vat, i, mode, format, elements);
+		TestFormat(desc, vat, "texture coordinate");
+
+		desc.Hex |= 2ULL << i;
+		TestFormat(desc, vat, "texture coordinate with matrix index");
+
+		// Plus coordinate 7 with its own matrix, leaving a gap before it
+		if (i < 7)
+		{
+			desc.Hex |= 2ULL << 7;
+			SetTexCoord(desc, vat, 7, DIRECT, FORMAT_SHORT, 1);
+			TestFormat(desc, vat, "texture coordinates with matrix indices");
+		}
+	}
+
+	TVtxDesc desc = PositionOnly();
+	desc.Tex2MatIdx = 1;
+	TestFormat(desc, FloatPosition(), "texture matrix index without coordinate");
+}
+
+void Benchmarks()
+{
+	// Metroid Prime: P I16-flt N I16-s16 T0 I16-u16 T1 i16-flt
+	TVtxDesc desc = PositionOnly();
+	VAT vat = FloatPosition();
+	desc.Position = INDEX16;
+	desc.Normal = INDEX16;
+	vat.g0.NormalFormat = FORMAT_SHORT;
+	SetTexCoord(desc, vat, 0, INDEX16, FORMAT_USHORT, 1);
+	SetTexCoord(desc, vat, 1, INDEX16, FORMAT_FLOAT, 1);
+	TestFormat(desc, vat, "benchmark", true);
+
+	desc = PositionOnly();
+	vat = FloatPosition();
+	desc.PosMatIdx = 1;
+	desc.Normal = DIRECT;
+	desc.Color0 = DIRECT;
+	vat.g0.PosFormat = FORMAT_SHORT;
+	vat.g0.NormalFormat = FORMAT_BYTE;
+	vat.g0.Color0Comp = FORMAT_32B_8888;
+	vat.g0.Color0Elements = 1;
+	SetTexCoord(desc, vat, 0, DIRECT, FORMAT_SHORT, 1);
+	TestFormat(desc, vat, "benchmark", true);
+
+	desc = PositionOnly();
+	vat = FloatPosition();
+	desc.Color0 = INDEX8;
+	vat.g0.Color0Comp = FORMAT_16B_565;
+	SetTexCoord(desc, vat, 0, INDEX8, FORMAT_FLOAT, 1);
+	TestFormat(desc, vat, "benchmark", true);
+}
+
+}  // namespace
+
+void VertexLoaderTests()
+{
+	if (!cpu_info.bSSSE3)
+	{
+		std::cout << "Skipping vertex loader tests, the inline translator needs SSSE3" << std::endl;
+		return;
+	}
+
+	TestVertexManager vertex_manager;
+	g_vertex_manager = &vertex_manager;
+	g_ActiveConfig.bUseBBox = false;
+
+	s_source.resize(NUM_VERTICES * MAX_VERTEX_SIZE + 32);
+	s_arrays.resize(ARRAY_SIZE);
+	s_output[0].resize(NUM_VERTICES * MAX_VERTEX_SIZE + 32);
+	s_output[1].resize(NUM_VERTICES * MAX_VERTEX_SIZE + 32);
+
+	FillRandom(s_arrays);
+	for (int i = 0; i < 16; i++)
+	{
+		cached_arraybases[i] = &s_arrays[16];
+		arraystrides[i] = ARRAY_STRIDE;
+	}
+
+	PositionTests();
+	NormalTests();
+	ColorTests();
+	TexCoordTests();
+	Benchmarks();
+
+	g_vertex_manager = NULL;
+}